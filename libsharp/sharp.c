@@ -30,6 +30,10 @@
  */
 
 #include <math.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "ls_fft.h"
 #include "sharp_ylmgen_c.h"
 #include "sharp_internal.h"
@@ -38,6 +42,7 @@
 #include "sharp_vecutil.h"
 #include "walltime_c.h"
 #include "sharp_almhelpers.h"
+#include "sharp_almops.h"
 #include "sharp_geomhelpers.h"
 
 typedef complex double dcmplx;
@@ -48,6 +53,13 @@ static const double sqrt_two = 1.414213562373095145474621858739;
 
 static int chunksize_min=500, nchunks_max=10;
 
+/* geometries with fewer rings are constructed without OpenMP */
+#define GEOM_PARALLEL_MIN 1024
+
+/* largest mmax for which transforms may use direct Fourier sums instead of
+   FFTs and parallelize the Legendre stage over rings instead of m */
+#define SMALL_MMAX_MAX 16
+
 static void get_chunk_info (int ndata, int nmult, int *nchunks, int *chunksize)
   {
   *chunksize = (ndata+nchunks_max-1)/nchunks_max;
@@ -77,6 +89,63 @@ int sharp_get_mlim (int lmax, int spin, double sth, double cth)
   return (int)(res+0.5);
   }
 
+/* FFT plans for all distinct ring lengths of a geometry. Executing a
+   real_plan modifies its scratch space, so the plans are never used directly;
+   every thread works on copies, which are much cheaper to make than new
+   plans. */
+typedef struct
+  {
+  int n;
+  int *nph; /* sorted */
+  real_plan *plan;
+  } fftcache;
+
+static int int_compare (const void *xa, const void *xb)
+  {
+  int a=*(const int *)xa, b=*(const int *)xb;
+  return (a<b) ? -1 : ((a>b) ? 1 : 0);
+  }
+
+static void make_fftcache (const sharp_geom_info *ginfo, fftcache *fc)
+  {
+  int *nph=RALLOC(int,2*IMAX(ginfo->npairs,1)), n=0;
+  for (int i=0; i<ginfo->npairs; ++i)
+    {
+    nph[n++]=ginfo->pair[i].r1.nph;
+    if (ginfo->pair[i].r2.nph>0) nph[n++]=ginfo->pair[i].r2.nph;
+    }
+  qsort(nph,n,sizeof(int),int_compare);
+  fc->n=0;
+  for (int i=0; i<n; ++i)
+    if ((fc->n==0)||(nph[i]!=nph[fc->n-1]))
+      nph[fc->n++]=nph[i];
+  fc->nph=nph;
+  fc->plan=RALLOC(real_plan,IMAX(fc->n,1));
+#pragma omp parallel for schedule(dynamic,1) if (fc->n>=GEOM_PARALLEL_MIN)
+  for (int i=0; i<fc->n; ++i)
+    fc->plan[i]=make_real_plan(fc->nph[i]);
+  }
+
+static void destroy_fftcache (fftcache *fc)
+  {
+  for (int i=0; i<fc->n; ++i)
+    kill_real_plan(fc->plan[i]);
+  DEALLOC(fc->plan);
+  DEALLOC(fc->nph);
+  fc->n=0;
+  }
+
+/* Returns a new plan of length nph, copied from fc if possible. */
+static real_plan fftcache_plan (const fftcache *fc, int nph)
+  {
+  if (fc!=NULL)
+    {
+    const int *p=bsearch(&nph,fc->nph,fc->n,sizeof(int),int_compare);
+    if (p!=NULL) return copy_real_plan(fc->plan[p-fc->nph]);
+    }
+  return make_real_plan(nph);
+  }
+
 typedef struct
   {
   double phi0_;
@@ -84,11 +153,13 @@ typedef struct
   int s_shift;
   real_plan plan;
   int norot;
+  int dft; /* if nonzero, use direct Fourier sums instead of FFTs */
+  const fftcache *fc; /* source of new FFT plans; may be NULL */
   } ringhelper;
 
 static void ringhelper_init (ringhelper *self)
   {
-  static ringhelper rh_null = { 0, NULL, 0, NULL, 0 };
+  static ringhelper rh_null = { 0, NULL, 0, NULL, 0, 0, NULL };
   *self = rh_null;
   }
 
@@ -111,11 +182,11 @@ static void ringhelper_update (ringhelper *self, int nph, int mmax, double phi0)
       for (int m=0; m<=mmax; ++m)
         self->shiftarr[m] = cos(m*phi0) + _Complex_I*sin(m*phi0);
       }
-  if (!self->plan) self->plan=make_real_plan(nph);
+  if (!self->plan) self->plan=fftcache_plan(self->fc,nph);
   if (nph!=(int)self->plan->length)
     {
     kill_real_plan(self->plan);
-    self->plan=make_real_plan(nph);
+    self->plan=fftcache_plan(self->fc,nph);
     }
   }
 
@@ -189,6 +260,34 @@ void sharp_destroy_alm_info (sharp_alm_info *info)
   DEALLOC (info);
   }
 
+static void fill_ringinfo (sharp_ringinfo *ri, double theta, double cth,
+  double sth, const int *nph, const ptrdiff_t *ofs, const int *stride,
+  const double *phi0, const double *wgt, int m)
+  {
+  ri->theta = theta;
+  ri->cth = cth;
+  ri->sth = sth;
+  ri->weight = (wgt != NULL) ? wgt[m] : 1.;
+  ri->phi0 = phi0[m];
+  ri->ofs = ofs[m];
+  ri->stride = stride[m];
+  ri->nph = nph[m];
+  ri->nest_nside = ri->nest_ring = 0;
+  ri->pix0 = 0;
+  ri->npix = nph[m];
+  ri->lmax = -1;
+  }
+
+static void set_nphmax (sharp_geom_info *info)
+  {
+  info->nphmax=0;
+  for (int i=0; i<info->npairs; ++i)
+    {
+    if (info->nphmax<info->pair[i].r1.nph) info->nphmax=info->pair[i].r1.nph;
+    if (info->nphmax<info->pair[i].r2.nph) info->nphmax=info->pair[i].r2.nph;
+    }
+  }
+
 void sharp_make_geom_info (int nrings, const int *nph, const ptrdiff_t *ofs,
   const int *stride, const double *phi0, const double *theta,
   const double *wgt, sharp_geom_info **geom_info)
@@ -199,26 +298,24 @@ void sharp_make_geom_info (int nrings, const int *nph, const ptrdiff_t *ofs,
   int pos=0;
   info->pair=RALLOC(sharp_ringpair,nrings);
   info->npairs=0;
-  info->nphmax=0;
   *geom_info = info;
 
+#pragma omp parallel if (nrings>=GEOM_PARALLEL_MIN)
+{
+#pragma omp for schedule(static)
   for (int m=0; m<nrings; ++m)
-    {
-    infos[m].theta = theta[m];
-    infos[m].cth = cos(theta[m]);
-    infos[m].sth = sin(theta[m]);
-    infos[m].weight = (wgt != NULL) ? wgt[m] : 1.;
-    infos[m].phi0 = phi0[m];
-    infos[m].ofs = ofs[m];
-    infos[m].stride = stride[m];
-    infos[m].nph = nph[m];
-    if (info->nphmax<nph[m]) info->nphmax=nph[m];
-    }
+    fill_ringinfo (&infos[m], theta[m], cos(theta[m]), sin(theta[m]), nph, ofs,
+      stride, phi0, wgt, m);
+} /* end of parallel region */
   qsort(infos,nrings,sizeof(sharp_ringinfo),ringinfo_compare);
   while (pos<nrings)
     {
     info->pair[info->npairs].r1=infos[pos];
-    if ((pos<nrings-1) && FAPPROX(infos[pos].cth,-infos[pos+1].cth,1e-12))
+    /* the absolute test catches rings next to the equator, where cos(theta)
+       and cos(pi-theta) can differ by much more than 1e-12 relatively */
+    if ((pos<nrings-1) &&
+        (FAPPROX(infos[pos].cth,-infos[pos+1].cth,1e-12) ||
+         (fabs(infos[pos].cth+infos[pos+1].cth)<1e-12)))
       {
       if (infos[pos].cth>0)  // make sure northern ring is in r1
         info->pair[info->npairs].r2=infos[pos+1];
@@ -237,6 +334,94 @@ void sharp_make_geom_info (int nrings, const int *nph, const ptrdiff_t *ofs,
   DEALLOC(infos);
 
   qsort(info->pair,info->npairs,sizeof(sharp_ringpair),ringpair_compare);
+  set_nphmax(info);
+  }
+
+/* Brings pairs that are ordered from north to south into the order
+   established by ringpair_compare(). Grids from the helpers have
+   non-decreasing ring lengths and at most two phi0 values per ring length
+   (HEALPix), so a stable partition of each block of equal ring length is
+   all that is needed; anything else is handed to qsort(). */
+static void sort_pairs (sharp_geom_info *info)
+  {
+  int sorted=1, nph_monotonic=1;
+  for (int i=1; i<info->npairs; ++i)
+    {
+    if (ringpair_compare(&info->pair[i-1],&info->pair[i])>0) sorted=0;
+    if (info->pair[i-1].r1.nph>info->pair[i].r1.nph) nph_monotonic=0;
+    }
+  if (sorted) return;
+  if (!nph_monotonic)
+    {
+    qsort(info->pair,info->npairs,sizeof(sharp_ringpair),ringpair_compare);
+    return;
+    }
+
+  sharp_ringpair *tmp=RALLOC(sharp_ringpair,info->npairs);
+  for (int lo=0, hi; lo<info->npairs; lo=hi)
+    {
+    double plo=info->pair[lo].r1.phi0, phi=plo;
+    int ntwo=1;
+    for (hi=lo; (hi<info->npairs)&&(info->pair[hi].r1.nph==info->pair[lo].r1.nph);
+         ++hi)
+      {
+      double p0=info->pair[hi].r1.phi0;
+      if ((p0!=plo)&&(p0!=phi))
+        {
+        if (plo==phi) { if (p0<plo) plo=p0; else phi=p0; }
+        else ntwo=0;
+        }
+      }
+    if (!ntwo)
+      {
+      qsort(info->pair+lo,hi-lo,sizeof(sharp_ringpair),ringpair_compare);
+      continue;
+      }
+    int n=lo;
+    for (int k=lo; k<hi; ++k)
+      if (info->pair[k].r1.phi0==plo) tmp[n++]=info->pair[k];
+    for (int k=lo; k<hi; ++k)
+      if (info->pair[k].r1.phi0!=plo) tmp[n++]=info->pair[k];
+    memcpy(info->pair+lo,tmp+lo,(hi-lo)*sizeof(sharp_ringpair));
+    }
+  DEALLOC(tmp);
+  }
+
+void sharp_make_ordered_geom_info (int nrings, const int *nph,
+  const ptrdiff_t *ofs, const int *stride, const double *phi0,
+  const double *theta, const double *wgt, sharp_geom_info **geom_info)
+  {
+  const double pi=3.141592653589793238462643383279502884197;
+  sharp_geom_info *info = RALLOC(sharp_geom_info,1);
+  info->npairs=(nrings+1)/2;
+  info->pair=RALLOC(sharp_ringpair,info->npairs);
+  *geom_info = info;
+
+  int nbad=0;
+#pragma omp parallel if (nrings>=GEOM_PARALLEL_MIN)
+{
+#pragma omp for schedule(static) reduction(+:nbad)
+  for (int i=0; i<info->npairs; ++i)
+    {
+    int j=nrings-1-i;
+    double cth=cos(theta[i]), sth=sin(theta[i]);
+    fill_ringinfo (&info->pair[i].r1, theta[i], cth, sth, nph, ofs, stride,
+      phi0, wgt, i);
+    if (j>i)
+      {
+      /* the southern ring gets exactly mirrored trigonometric values */
+      fill_ringinfo (&info->pair[i].r2, theta[j], -cth, sth, nph, ofs, stride,
+        phi0, wgt, j);
+      if ((cth<=0.) || (fabs(theta[i]+theta[j]-pi)>1e-10)) ++nbad;
+      }
+    else
+      info->pair[i].r2.nph=-1;
+    }
+} /* end of parallel region */
+  UTIL_ASSERT(nbad==0,"rings are not ordered symmetrically about the equator");
+
+  sort_pairs(info);
+  set_nphmax(info);
   }
 
 ptrdiff_t sharp_map_size(const sharp_geom_info *info)
@@ -244,8 +429,8 @@ ptrdiff_t sharp_map_size(const sharp_geom_info *info)
   ptrdiff_t result = 0;
   for (int m=0; m<info->npairs; ++m)
     {
-      result+=info->pair[m].r1.nph;
-      result+=(info->pair[m].r2.nph>=0) ? (info->pair[m].r2.nph) : 0;
+      result+=info->pair[m].r1.npix;
+      result+=(info->pair[m].r2.nph>=0) ? (info->pair[m].r2.npix) : 0;
     }
   return result;
   }
@@ -274,18 +459,84 @@ static int sharp_get_mmax (int *mval, int nm)
   return nm-1;
   }
 
+/* Returns exp(i*sign*(phi0+2*pi*j/nph)). */
+static dcmplx ring_phase_factor (double phi0, int j, int nph, double sign)
+  {
+  const double pi=3.141592653589793238462643383279502884197;
+  double ang=sign*(phi0+(2*pi*j)/nph);
+  return cos(ang) + _Complex_I*sin(ang);
+  }
+
+/* Direct evaluation of the ring values from the (already weighted) Fourier
+   coefficients; costs O(nph*mmax) and needs no FFT plan. The sum over m is
+   done with Clenshaw's recurrence, the phase factors are obtained by rotation
+   and recomputed exactly every 64 pixels. */
+static void ring_dft_backward (const sharp_ringinfo *info, double *data,
+  int mmax, const dcmplx *phase, int pstride, double wgt)
+  {
+  int nph = info->nph;
+  dcmplx c[SMALL_MMAX_MAX+1];
+  for (int m=1; m<=mmax; ++m)
+    c[m] = 2*wgt*phase[m*pstride];
+  double c0 = creal(phase[0])*wgt;
+  dcmplx step = ring_phase_factor(0.,1,nph,1.), z = 0.;
+  for (int j=0; j<nph; ++j)
+    {
+    z = ((j&63)==0) ? ring_phase_factor(info->phi0,j,nph,1.) : z*step;
+    double alpha = 2*creal(z);
+    dcmplx b1=0., b2=0.;
+    for (int m=mmax; m>0; --m)
+      {
+      dcmplx b = c[m] + alpha*b1 - b2;
+      b2=b1; b1=b;
+      }
+    data[j+1] = c0 + creal(z*b1) - creal(b2);
+    }
+  }
+
+/* Direct computation of the Fourier coefficients 0..mmax of a ring; the
+   powers of the phase factor are generated by the Chebyshev recurrence. */
+static void ring_dft_forward (const sharp_ringinfo *info, const double *data,
+  int mmax, dcmplx *phase, int pstride, double wgt)
+  {
+  int nph = info->nph;
+  dcmplx acc[SMALL_MMAX_MAX+1];
+  SET_ARRAY(acc,0,mmax+1,0.);
+  dcmplx step = ring_phase_factor(0.,1,nph,-1.), z = 0.;
+  for (int j=0; j<nph; ++j)
+    {
+    z = ((j&63)==0) ? ring_phase_factor(info->phi0,j,nph,-1.) : z*step;
+    double val = data[j+1], alpha = 2*creal(z);
+    acc[0] += val;
+    dcmplx zm1 = 1., zm = z;
+    for (int m=1; m<=mmax; ++m)
+      {
+      acc[m] += val*zm;
+      dcmplx tmp = alpha*zm - zm1;
+      zm1=zm; zm=tmp;
+      }
+    }
+  for (int m=0; m<=mmax; ++m)
+    phase[m*pstride] = acc[m]*wgt;
+  }
+
 static void ringhelper_phase2ring (ringhelper *self,
   const sharp_ringinfo *info, double *data, int mmax, const dcmplx *phase,
   int pstride, int flags)
   {
   int nph = info->nph;
-
-  ringhelper_update (self, nph, mmax, info->phi0);
+  /* modes above the band limit of the ring vanish */
+  if ((info->lmax>=0)&&(info->lmax<mmax)) mmax=info->lmax;
 
   double wgt = (flags&SHARP_USE_WEIGHTS) ? info->weight : 1.;
   if (flags&SHARP_REAL_HARMONICS)
     wgt *= sqrt_one_half;
 
+  if (self->dft)
+    { ring_dft_backward (info, data, mmax, phase, pstride, wgt); return; }
+
+  ringhelper_update (self, nph, mmax, info->phi0);
+
   if (nph>=2*mmax+1)
     {
     for (int m=0; m<=mmax; ++m)
@@ -336,12 +587,22 @@ static void ringhelper_ring2phase (ringhelper *self,
 #else
   int maxidx = IMIN(nph-1,mmax);
 #endif
+  /* modes above the band limit of the ring are not needed */
+  if ((info->lmax>=0)&&(info->lmax<maxidx)) maxidx=info->lmax;
 
-  ringhelper_update (self, nph, mmax, -info->phi0);
   double wgt = (flags&SHARP_USE_WEIGHTS) ? info->weight : 1;
   if (flags&SHARP_REAL_HARMONICS)
     wgt *= sqrt_two;
 
+  if (self->dft)
+    {
+    ring_dft_forward (info, data, maxidx, phase, pstride, wgt);
+    for (int m=maxidx+1;m<=mmax; ++m)
+      phase[m*pstride]=0.;
+    return;
+    }
+
+  ringhelper_update (self, nph, mmax, -info->phi0);
   real_plan_forward_fftpack (self->plan, &(data[1]));
   data[0]=data[1];
   data[1]=data[nph+1]=0.;
@@ -376,6 +637,83 @@ static void ringhelper_ring2phase (ringhelper *self,
     phase[m*pstride]=0.;
   }
 
+/* bit-spreading table: entry i holds the bits of i at the even bit
+   positions of a 16-bit word */
+static const unsigned short utab[]={
+#define Z(a) 0x##a##0, 0x##a##1, 0x##a##4, 0x##a##5
+#define Y(a) Z(a##0), Z(a##1), Z(a##4), Z(a##5)
+#define X(a) Y(a##0), Y(a##1), Y(a##4), Y(a##5)
+X(0),X(1),X(4),X(5)
+#undef X
+#undef Y
+#undef Z
+};
+
+static ptrdiff_t spread_bits (int v)
+  {
+  return (ptrdiff_t)utab[v&0xff] | ((ptrdiff_t)utab[(v>>8)&0xff]<<16)
+    | ((ptrdiff_t)utab[(v>>16)&0xff]<<32) | ((ptrdiff_t)utab[(v>>24)&0xff]<<48);
+  }
+
+/* Loops over the stored pixels of ring \a ri; \a j is the position in the
+   ring, starting at pix0 and wrapping around at nph. Missing partner rings
+   (nph<0) have no pixels, whatever their other fields contain. */
+#define STORED_LOOP(ri,j)                                                \
+  for (int k_##j=0, n_##j=((ri)->nph>0) ? (ri)->npix : 0, j=(ri)->pix0;  \
+       k_##j<n_##j; ++k_##j, j=(j+1<(ri)->nph) ? j+1 : 0)
+
+/* Stores the array indices of all pixels of ring \a ri in \a idx,
+   including positions that are not stored in the map.
+   For NESTED HEALPix rings the pixel numbers are generated base pixel by
+   base pixel: along a ring, the x coordinate inside a base pixel grows and
+   the y coordinate shrinks by one per pixel, so each index is the base pixel
+   offset plus the interleaved bits of x and y. */
+static void ring_pixel_indices (const sharp_ringinfo *ri, ptrdiff_t *idx)
+  {
+  if (ri->nph<=0) return; /* missing partner ring, fields undefined */
+  if (ri->nest_nside==0)
+    {
+    for (int i=0; i<ri->nph; ++i)
+      idx[i]=ri->ofs+i*ri->stride;
+    return;
+    }
+  static const int jrll[]={2,2,2,2,3,3,3,3,4,4,4,4},
+                   jpll[]={1,3,5,7,0,2,4,6,1,3,5,7};
+  int nside=ri->nest_nside, iring=ri->nest_ring, order=0;
+  while ((1<<order)<nside) ++order;
+  ptrdiff_t npface=(ptrdiff_t)nside*nside;
+  if ((iring<nside)||(iring>3*nside)) /* polar caps */
+    {
+    int north = iring<nside;
+    int nr = north ? iring : 4*nside-iring;
+    int ix0 = north ? nside-nr : 0, iy0 = north ? nside-1 : nr-1;
+    for (int f=0; f<4; ++f)
+      {
+      ptrdiff_t fofs = (north ? f : f+8)*npface;
+      for (int k=0; k<nr; ++k)
+        idx[f*nr+k] = ri->ofs
+          + ri->stride*(fofs+spread_bits(ix0+k)+2*spread_bits(iy0-k));
+      }
+    }
+  else /* equatorial region; faces 0-3 and 8-11 are only touched at corners */
+    {
+    int tmp=iring-nside, ire=tmp+1, irm=2*nside+1-tmp;
+    int kshift=(iring+nside)&1;
+    for (int iphi=1; iphi<=ri->nph; ++iphi)
+      {
+      int ifm = (iphi-(ire>>1)+nside-1)>>order,
+          ifp = (iphi-(irm>>1)+nside-1)>>order;
+      int face = (ifp==ifm) ? (ifp|4) : ((ifp<ifm) ? ifp : (ifm+8));
+      int irt = iring-jrll[face]*nside+1;
+      int ipt = 2*iphi-jpll[face]*nside-kshift-1;
+      if (ipt>=2*nside) ipt-=8*nside;
+      int ix=(ipt-irt)>>1, iy=(-ipt-irt)>>1;
+      idx[iphi-1] = ri->ofs
+        + ri->stride*(face*npface+spread_bits(ix)+2*spread_bits(iy));
+      }
+    }
+  }
+
 static void fill_map (const sharp_geom_info *ginfo, void *map, double value,
   int flags)
   {
@@ -383,6 +721,10 @@ static void fill_map (const sharp_geom_info *ginfo, void *map, double value,
     {
     for (int j=0;j<ginfo->npairs;++j)
       {
+      UTIL_ASSERT(ginfo->pair[j].r1.nest_nside==0,
+        "SHARP_NO_FFT is not supported for NESTED maps");
+      UTIL_ASSERT(ginfo->pair[j].r1.npix==ginfo->pair[j].r1.nph,
+        "SHARP_NO_FFT is not supported for partial rings");
       if (flags&SHARP_DP)
         {
         for (ptrdiff_t i=0;i<ginfo->pair[j].r1.nph;++i)
@@ -405,30 +747,132 @@ static void fill_map (const sharp_geom_info *ginfo, void *map, double value,
     }
   else
     {
+    ptrdiff_t *idx=RALLOC(ptrdiff_t,IMAX(ginfo->nphmax,1));
     for (int j=0;j<ginfo->npairs;++j)
-      {
-      if (flags&SHARP_DP)
-        {
-        for (ptrdiff_t i=0;i<ginfo->pair[j].r1.nph;++i)
-          ((double *)map)[ginfo->pair[j].r1.ofs+i*ginfo->pair[j].r1.stride]
-            =value;
-        for (ptrdiff_t i=0;i<ginfo->pair[j].r2.nph;++i)
-          ((double *)map)[ginfo->pair[j].r2.ofs+i*ginfo->pair[j].r2.stride]
-            =value;
-        }
-      else
+      for (int r=0;r<2;++r)
         {
-        for (ptrdiff_t i=0;i<ginfo->pair[j].r1.nph;++i)
-          ((float *)map)[ginfo->pair[j].r1.ofs+i*ginfo->pair[j].r1.stride]
-            =(float)value;
-        for (ptrdiff_t i=0;i<ginfo->pair[j].r2.nph;++i)
-          ((float *)map)[ginfo->pair[j].r2.ofs+i*ginfo->pair[j].r2.stride]
-            =(float)value;
+        const sharp_ringinfo *ri = r ? &ginfo->pair[j].r2 : &ginfo->pair[j].r1;
+        ring_pixel_indices(ri,idx);
+        if (flags&SHARP_DP)
+          STORED_LOOP(ri,i)
+            ((double *)map)[idx[i]]=value;
+        else
+          STORED_LOOP(ri,i)
+            ((float *)map)[idx[i]]=(float)value;
         }
+    DEALLOC(idx);
+    }
+  }
+
+ptrdiff_t sharp_map_extent(const sharp_geom_info *info)
+  {
+  ptrdiff_t res=0;
+  ptrdiff_t *idx=RALLOC(ptrdiff_t,IMAX(info->nphmax,1));
+  for (int j=0; j<info->npairs; ++j)
+    for (int r=0; r<2; ++r)
+      {
+      const sharp_ringinfo *ri = r ? &info->pair[j].r2 : &info->pair[j].r1;
+      ring_pixel_indices(ri,idx);
+      STORED_LOOP(ri,i)
+        if (idx[i]>=res) res=idx[i]+1;
       }
+  DEALLOC(idx);
+  return res;
+  }
+
+/* Shrinks \a ri to the shortest cyclic range containing all pixels with
+   nonzero \a mask, i.e. the complement of the longest cyclic run of zeros.
+   Returns 0 if there are no such pixels. */
+static int mask_ring (sharp_ringinfo *ri, const double *mask, ptrdiff_t *idx)
+  {
+  if (ri->nph<=0) return 0;
+  ring_pixel_indices(ri,idx);
+  int first=-1, last=-1, gap=0, gapend=-1;
+  STORED_LOOP(ri,j)
+    if (mask[idx[j]]!=0.)
+      {
+      if (first<0) first=k_j;
+      else if (k_j-last-1>gap) { gap=k_j-last-1; gapend=k_j; }
+      last=k_j;
+      }
+  if (first<0) return 0;
+  int start=first, len=last-first+1;
+  if ((ri->npix==ri->nph) && (gap>ri->nph-len)) /* complete rings are cyclic */
+    { start=gapend; len=ri->nph-gap; }
+  ri->pix0=(ri->pix0+start)%ri->nph;
+  ri->npix=len;
+  return 1;
+  }
+
+void sharp_make_masked_geom_info (const sharp_geom_info *full,
+  const double *mask, sharp_geom_info **geom_info)
+  {
+  sharp_geom_info *info = RALLOC(sharp_geom_info,1);
+  info->pair=RALLOC(sharp_ringpair,IMAX(full->npairs,1));
+  info->npairs=0;
+  ptrdiff_t *idx=RALLOC(ptrdiff_t,IMAX(full->nphmax,1));
+  for (int i=0; i<full->npairs; ++i)
+    {
+    sharp_ringpair rp=full->pair[i];
+    int have1=mask_ring(&rp.r1,mask,idx), have2=mask_ring(&rp.r2,mask,idx);
+    if (!(have1||have2)) continue;
+    if (!have1) rp.r1=rp.r2;
+    if (!(have1&&have2)) rp.r2.nph=-1;
+    info->pair[info->npairs++]=rp;
+    }
+  DEALLOC(idx);
+  set_nphmax(info);
+  sort_pairs(info);
+  *geom_info=info;
+  }
+
+void sharp_make_strided_geom_info (const sharp_geom_info *full, int stride,
+  sharp_geom_info **geom_info)
+  {
+  UTIL_ASSERT(stride>0,"stride must be positive");
+  sharp_geom_info *info = RALLOC(sharp_geom_info,1);
+  info->pair=RALLOC(sharp_ringpair,IMAX(full->npairs,1));
+  info->npairs=full->npairs;
+  info->nphmax=full->nphmax;
+  for (int i=0; i<full->npairs; ++i)
+    {
+    info->pair[i]=full->pair[i];
+    sharp_ringinfo *r1=&info->pair[i].r1, *r2=&info->pair[i].r2;
+    r1->ofs*=stride; r1->stride*=stride;
+    if (r2->nph>0)
+      { r2->ofs*=stride; r2->stride*=stride; }
+    }
+  *geom_info=info;
+  }
+
+void sharp_set_band_lmax (sharp_geom_info *info, double theta1, double theta2,
+  int lmax)
+  {
+  for (int i=0; i<info->npairs; ++i)
+    {
+    sharp_ringinfo *r1=&info->pair[i].r1, *r2=&info->pair[i].r2;
+    if ((r1->theta>=theta1)&&(r1->theta<=theta2)) r1->lmax=lmax;
+    if ((r2->nph>0)&&(r2->theta>=theta1)&&(r2->theta<=theta2)) r2->lmax=lmax;
     }
   }
 
+/* Stores the band limits of both rings of the \a npairs pairs in \a res
+   (the entry for a missing partner ring duplicates that of \a r1), capped at
+   \a lmax. Returns 1 if any of them is below \a lmax, else 0. */
+static int get_ring_lmax (const sharp_ringpair *pair, int npairs, int lmax,
+  int *res)
+  {
+  int limited=0;
+  for (int i=0; i<npairs; ++i)
+    {
+    int l1=pair[i].r1.lmax, l2=(pair[i].r2.nph>0) ? pair[i].r2.lmax : l1;
+    res[2*i  ] = ((l1>=0)&&(l1<lmax)) ? l1 : lmax;
+    res[2*i+1] = ((l2>=0)&&(l2<lmax)) ? l2 : lmax;
+    if ((res[2*i]<lmax)||(res[2*i+1]<lmax)) limited=1;
+    }
+  return limited;
+  }
+
 static void clear_alm (const sharp_alm_info *ainfo, void *alm, int flags)
   {
 #define CLEARLOOP(real_t,body)             \
@@ -629,11 +1073,25 @@ static void almtmp2alm (sharp_job *job, int lmax, int mi)
 #undef COPY_LOOP
   }
 
+/* \a idx is scratch space for nphmax indices; it is only needed for NESTED
+   and partial rings, whose pixel indices are computed once and reused for
+   all maps. */
 static void ringtmp2ring (sharp_job *job, sharp_ringinfo *ri, double *ringtmp,
-  int rstride)
+  int rstride, ptrdiff_t *idx)
   {
   double **dmap = (double **)job->map;
   float  **fmap = (float  **)job->map;
+  if ((ri->nest_nside>0)||(ri->npix<ri->nph))
+    {
+    ring_pixel_indices(ri,idx);
+    for (int i=0; i<job->ntrans*job->nmaps; ++i)
+      STORED_LOOP(ri,m)
+        if (job->flags & SHARP_DP)
+          dmap[i][idx[m]] += ringtmp[i*rstride+m+1];
+        else
+          fmap[i][idx[m]] += (float)ringtmp[i*rstride+m+1];
+    return;
+    }
   for (int i=0; i<job->ntrans*job->nmaps; ++i)
     for (int m=0; m<ri->nph; ++m)
       if (job->flags & SHARP_DP)
@@ -643,8 +1101,22 @@ static void ringtmp2ring (sharp_job *job, sharp_ringinfo *ri, double *ringtmp,
   }
 
 static void ring2ringtmp (sharp_job *job, sharp_ringinfo *ri, double *ringtmp,
-  int rstride)
+  int rstride, ptrdiff_t *idx)
   {
+  if ((ri->nest_nside>0)||(ri->npix<ri->nph))
+    {
+    ring_pixel_indices(ri,idx);
+    for (int i=0; i<job->ntrans*job->nmaps; ++i)
+      {
+      if (ri->npix<ri->nph) /* zero-pad partial rings */
+        SET_ARRAY(ringtmp,i*rstride+1,i*rstride+ri->nph+1,0.);
+      STORED_LOOP(ri,m)
+        ringtmp[i*rstride+m+1] = (job->flags & SHARP_DP) ?
+          ((double *)(job->map[i]))[idx[m]] :
+          ((float  *)(job->map[i]))[idx[m]];
+      }
+    return;
+    }
   for (int i=0; i<job->ntrans*job->nmaps; ++i)
     for (int m=0; m<ri->nph; ++m)
       ringtmp[i*rstride+m+1] = (job->flags & SHARP_DP) ?
@@ -664,6 +1136,8 @@ static void ring2phase_direct (sharp_job *job, sharp_ringinfo *ri, int mmax,
   else
     {
     UTIL_ASSERT(ri->nph==mmax+1,"bad ring size");
+    UTIL_ASSERT(ri->nest_nside==0,"SHARP_NO_FFT is not supported for NESTED maps");
+    UTIL_ASSERT(ri->npix==ri->nph,"SHARP_NO_FFT is not supported for partial rings");
     double wgt = (job->flags&SHARP_USE_WEIGHTS) ? (ri->nph*ri->weight) : 1.;
     if (job->flags&SHARP_REAL_HARMONICS)
       wgt *= sqrt_two;
@@ -679,6 +1153,8 @@ static void phase2ring_direct (sharp_job *job, sharp_ringinfo *ri, int mmax,
   {
   if (ri->nph<0) return;
   UTIL_ASSERT(ri->nph==mmax+1,"bad ring size");
+  UTIL_ASSERT(ri->nest_nside==0,"SHARP_NO_FFT is not supported for NESTED maps");
+  UTIL_ASSERT(ri->npix==ri->nph,"SHARP_NO_FFT is not supported for partial rings");
   dcmplx **dmap = (dcmplx **)job->map;
   fcmplx **fmap = (fcmplx **)job->map;
   double wgt = (job->flags&SHARP_USE_WEIGHTS) ? (ri->nph*ri->weight) : 1.;
@@ -693,7 +1169,8 @@ static void phase2ring_direct (sharp_job *job, sharp_ringinfo *ri, int mmax,
   }
 
 //FIXME: set phase to zero if not SHARP_MAP2ALM?
-static void map2phase (sharp_job *job, int mmax, int llim, int ulim)
+static void map2phase (sharp_job *job, int mmax, int llim, int ulim,
+  const fftcache *fc)
   {
   if (job->type != SHARP_MAP2ALM) return;
   int pstride = job->s_m;
@@ -714,31 +1191,36 @@ static void map2phase (sharp_job *job, int mmax, int llim, int ulim)
 {
     ringhelper helper;
     ringhelper_init(&helper);
+    helper.dft=(job->flags&SHARP_SMALL_MMAX)!=0;
+    helper.fc=fc;
     int rstride=job->ginfo->nphmax+2;
     double *ringtmp=RALLOC(double,job->ntrans*job->nmaps*rstride);
+    ptrdiff_t *idx=RALLOC(ptrdiff_t,rstride);
 #pragma omp for schedule(dynamic,1)
     for (int ith=llim; ith<ulim; ++ith)
       {
       int dim2 = job->s_th*(ith-llim);
-      ring2ringtmp(job,&(job->ginfo->pair[ith].r1),ringtmp,rstride);
+      ring2ringtmp(job,&(job->ginfo->pair[ith].r1),ringtmp,rstride,idx);
       for (int i=0; i<job->ntrans*job->nmaps; ++i)
         ringhelper_ring2phase (&helper,&(job->ginfo->pair[ith].r1),
           &ringtmp[i*rstride],mmax,&job->phase[dim2+2*i],pstride,job->flags);
       if (job->ginfo->pair[ith].r2.nph>0)
         {
-        ring2ringtmp(job,&(job->ginfo->pair[ith].r2),ringtmp,rstride);
+        ring2ringtmp(job,&(job->ginfo->pair[ith].r2),ringtmp,rstride,idx);
         for (int i=0; i<job->ntrans*job->nmaps; ++i)
           ringhelper_ring2phase (&helper,&(job->ginfo->pair[ith].r2),
            &ringtmp[i*rstride],mmax,&job->phase[dim2+2*i+1],pstride,job->flags);
         }
       }
+    DEALLOC(idx);
     DEALLOC(ringtmp);
     ringhelper_destroy(&helper);
 } /* end of parallel region */
     }
   }
 
-static void phase2map (sharp_job *job, int mmax, int llim, int ulim)
+static void phase2map (sharp_job *job, int mmax, int llim, int ulim,
+  const fftcache *fc)
   {
   if (job->type == SHARP_MAP2ALM) return;
   int pstride = job->s_m;
@@ -759,8 +1241,11 @@ static void phase2map (sharp_job *job, int mmax, int llim, int ulim)
 {
     ringhelper helper;
     ringhelper_init(&helper);
+    helper.dft=(job->flags&SHARP_SMALL_MMAX)!=0;
+    helper.fc=fc;
     int rstride=job->ginfo->nphmax+2;
     double *ringtmp=RALLOC(double,job->ntrans*job->nmaps*rstride);
+    ptrdiff_t *idx=RALLOC(ptrdiff_t,rstride);
 #pragma omp for schedule(dynamic,1)
     for (int ith=llim; ith<ulim; ++ith)
       {
@@ -768,34 +1253,196 @@ static void phase2map (sharp_job *job, int mmax, int llim, int ulim)
       for (int i=0; i<job->ntrans*job->nmaps; ++i)
         ringhelper_phase2ring (&helper,&(job->ginfo->pair[ith].r1),
           &ringtmp[i*rstride],mmax,&job->phase[dim2+2*i],pstride,job->flags);
-      ringtmp2ring(job,&(job->ginfo->pair[ith].r1),ringtmp,rstride);
+      ringtmp2ring(job,&(job->ginfo->pair[ith].r1),ringtmp,rstride,idx);
       if (job->ginfo->pair[ith].r2.nph>0)
         {
         for (int i=0; i<job->ntrans*job->nmaps; ++i)
           ringhelper_phase2ring (&helper,&(job->ginfo->pair[ith].r2),
             &ringtmp[i*rstride],mmax,&job->phase[dim2+2*i+1],pstride,job->flags);
-        ringtmp2ring(job,&(job->ginfo->pair[ith].r2),ringtmp,rstride);
+        ringtmp2ring(job,&(job->ginfo->pair[ith].r2),ringtmp,rstride,idx);
         }
       }
+    DEALLOC(idx);
     DEALLOC(ringtmp);
     ringhelper_destroy(&helper);
 } /* end of parallel region */
     }
   }
 
-static void sharp_execute_job (sharp_job *job)
+/* Per-pair data needed by inner_loop() and the FFTs, for all pairs of a
+   geometry */
+typedef struct
   {
-  double timer=wallTime();
-  job->opcnt=0;
-  int lmax = job->ainfo->lmax,
-      mmax=sharp_get_mmax(job->ainfo->mval, job->ainfo->nm);
+  int *ispair, *mlim;
+  double *cth, *sth;
+  int *rlmax; /* per-ring band limits; NULL if all rings use the full lmax */
+  fftcache fft; /* empty if the job does no FFTs */
+  } pairdata;
+
+static void make_pair_data (const sharp_job *job, int lmax, pairdata *pd)
+  {
+  int npairs=job->ginfo->npairs, n=IMAX(npairs,1);
+  pd->ispair = RALLOC(int,n);
+  pd->mlim = RALLOC(int,n);
+  pd->cth = RALLOC(double,n);
+  pd->sth = RALLOC(double,n);
+  pd->rlmax = RALLOC(int,2*n);
+  if (!get_ring_lmax(job->ginfo->pair,npairs,lmax,pd->rlmax))
+    DEALLOC(pd->rlmax);
+  for (int i=0; i<npairs; ++i)
+    {
+    pd->ispair[i] = job->ginfo->pair[i].r2.nph>0;
+    pd->cth[i] = job->ginfo->pair[i].r1.cth;
+    pd->sth[i] = job->ginfo->pair[i].r1.sth;
+    pd->mlim[i] = sharp_get_mlim(pd->rlmax ?
+      IMAX(pd->rlmax[2*i],pd->rlmax[2*i+1]) : lmax, job->spin, pd->sth[i],
+      pd->cth[i]);
+    }
+  pd->fft.n=0;
+  pd->fft.nph=NULL;
+  pd->fft.plan=NULL;
+  if ((job->flags&(SHARP_NO_FFT|SHARP_SMALL_MMAX))==0)
+    make_fftcache (job->ginfo, &pd->fft);
+  }
 
-  job->norm_l = (job->type==SHARP_ALM2MAP_DERIV1) ?
+static void destroy_pair_data (pairdata *pd)
+  {
+  DEALLOC(pd->ispair);
+  DEALLOC(pd->mlim);
+  DEALLOC(pd->cth);
+  DEALLOC(pd->sth);
+  DEALLOC(pd->rlmax);
+  destroy_fftcache (&pd->fft);
+  }
+
+static int thread_count (const sharp_job *job)
+  {
+#ifdef _OPENMP
+  if ((job->flags&SHARP_NO_OPENMP)==0)
+    return omp_get_max_threads();
+#else
+  (void)job;
+#endif
+  return 1;
+  }
+
+/* If nthreads>0, limits the parallel regions subsequently started by the
+   calling thread to nthreads threads. Returns the previous limit. */
+static int set_thread_count (int nthreads)
+  {
+#ifdef _OPENMP
+  int old=omp_get_max_threads();
+  if (nthreads>0) omp_set_num_threads(nthreads);
+  return old;
+#else
+  (void)nthreads;
+  return 1;
+#endif
+  }
+
+static int sharp_small_mmax_oracle (sharp_jobtype type, int spin, int ntrans);
+
+/* Decides whether the job uses sharp_execute_job_small_mmax() and records
+   the decision in its flags. */
+static void set_small_mmax (sharp_job *job, int mmax)
+  {
+  if (job->flags&SHARP_SMALL_MMAX)
+    {
+    UTIL_ASSERT(mmax<=SMALL_MMAX_MAX,"mmax too large for SHARP_SMALL_MMAX");
+    return;
+    }
+  if ((job->flags&(SHARP_NO_SMALL_MMAX|SHARP_NO_FFT))||(mmax>SMALL_MMAX_MAX)
+    ||(mmax>sharp_small_mmax_oracle(job->type,job->spin,job->ntrans)))
+    job->flags|=SHARP_NO_SMALL_MMAX;
+  else
+    job->flags|=SHARP_SMALL_MMAX;
+  }
+
+static double *get_norm_l (const sharp_job *job, int lmax)
+  {
+  return (job->type==SHARP_ALM2MAP_DERIV1) ?
      sharp_Ylmgen_get_d1norm (lmax) :
      sharp_Ylmgen_get_norm (lmax, job->spin);
+  }
 
-/* clear output arrays if requested */
-  init_output (job);
+/* Transform for small mmax: all rings are handled in a single chunk, the
+   azimuthal transforms are done by direct Fourier sums, and the Legendre
+   stage is parallelized over blocks of ring pairs instead of m. */
+static void sharp_execute_job_small_mmax (sharp_job *job, int lmax, int mmax,
+  const pairdata *pd)
+  {
+  int npairs=job->ginfo->npairs, nval=(job->flags&SHARP_NVMAX)*VLEN;
+  int nvec=(npairs+nval-1)/nval, nblk=IMAX(1,IMIN(thread_count(job),nvec));
+  alloc_phase (job,mmax+1,npairs);
+
+  /* one a_lm buffer per block for analysis, so that the per-block results
+     can be summed in a fixed order */
+  ptrdiff_t nalmtmp = job->ntrans*job->nalm*(lmax+1);
+  dcmplx *almtmp = RALLOC(dcmplx,(job->type==SHARP_MAP2ALM) ?
+    nblk*nalmtmp : nalmtmp);
+
+  map2phase (job, mmax, 0, npairs, NULL);
+
+  for (int mi=0; mi<job->ainfo->nm; ++mi)
+    {
+    job->almtmp = almtmp;
+    if (job->type!=SHARP_MAP2ALM)
+      alm2almtmp (job, lmax, mi);
+
+#pragma omp parallel if ((job->flags&SHARP_NO_OPENMP)==0)
+{
+    sharp_job ljob = *job;
+    ljob.opcnt=0;
+    sharp_Ylmgen_C generator;
+    sharp_Ylmgen_init (&generator,lmax,mmax,ljob.spin);
+
+#pragma omp for schedule(static,1)
+    for (int blk=0; blk<nblk; ++blk)
+      {
+      int lo = (int)(((ptrdiff_t)nvec*blk)/nblk)*nval,
+          hi = IMIN((int)(((ptrdiff_t)nvec*(blk+1))/nblk)*nval,npairs);
+      ljob.phase = job->phase + (ptrdiff_t)lo*job->s_th;
+      if (job->type==SHARP_MAP2ALM)
+        {
+        ljob.almtmp = almtmp + blk*nalmtmp;
+        alm2almtmp (&ljob, lmax, mi);
+        }
+      inner_loop (&ljob, pd->ispair+lo, pd->cth+lo, pd->sth+lo, 0, hi-lo,
+        &generator, mi, pd->mlim+lo, pd->rlmax ? pd->rlmax+2*lo : NULL);
+      }
+
+    sharp_Ylmgen_destroy(&generator);
+
+#pragma omp critical
+    job->opcnt+=ljob.opcnt;
+} /* end of parallel region */
+
+    if (job->type==SHARP_MAP2ALM)
+      {
+      ptrdiff_t ofs = job->ntrans*job->nalm*job->ainfo->mval[mi];
+      for (int blk=1; blk<nblk; ++blk)
+        for (ptrdiff_t i=ofs; i<nalmtmp; ++i)
+          almtmp[i] += almtmp[blk*nalmtmp+i];
+      almtmp2alm (job, lmax, mi);
+      }
+    }
+
+  phase2map (job, mmax, 0, npairs, NULL);
+
+  job->almtmp = NULL;
+  DEALLOC(almtmp);
+  dealloc_phase (job);
+  }
+
+/* Runs a job whose output arrays have been initialized, using the
+   precomputed job->norm_l and \a pd. */
+static void run_job (sharp_job *job, int lmax, int mmax, const pairdata *pd)
+  {
+  if (job->flags&SHARP_SMALL_MMAX)
+    {
+    sharp_execute_job_small_mmax (job, lmax, mmax, pd);
+    return;
+    }
 
   int nchunks, chunksize;
   get_chunk_info(job->ginfo->npairs,(job->flags&SHARP_NVMAX)*VLEN,&nchunks,
@@ -806,19 +1453,12 @@ static void sharp_execute_job (sharp_job *job)
   for (int chunk=0; chunk<nchunks; ++chunk)
     {
     int llim=chunk*chunksize, ulim=IMIN(llim+chunksize,job->ginfo->npairs);
-    int *ispair = RALLOC(int,ulim-llim);
-    int *mlim = RALLOC(int,ulim-llim);
-    double *cth = RALLOC(double,ulim-llim), *sth = RALLOC(double,ulim-llim);
-    for (int i=0; i<ulim-llim; ++i)
-      {
-      ispair[i] = job->ginfo->pair[i+llim].r2.nph>0;
-      cth[i] = job->ginfo->pair[i+llim].r1.cth;
-      sth[i] = job->ginfo->pair[i+llim].r1.sth;
-      mlim[i] = sharp_get_mlim(lmax, job->spin, sth[i], cth[i]);
-      }
+    const int *ispair=pd->ispair+llim, *mlim=pd->mlim+llim,
+              *rlmax=pd->rlmax ? pd->rlmax+2*llim : NULL;
+    const double *cth=pd->cth+llim, *sth=pd->sth+llim;
 
 /* map->phase where necessary */
-    map2phase (job, mmax, llim, ulim);
+    map2phase (job, mmax, llim, ulim, &pd->fft);
 
 #pragma omp parallel if ((job->flags&SHARP_NO_OPENMP)==0)
 {
@@ -834,7 +1474,8 @@ static void sharp_execute_job (sharp_job *job)
 /* alm->alm_tmp where necessary */
       alm2almtmp (&ljob, lmax, mi);
 
-      inner_loop (&ljob, ispair, cth, sth, llim, ulim, &generator, mi, mlim);
+      inner_loop (&ljob, ispair, cth, sth, llim, ulim, &generator, mi, mlim,
+        rlmax);
 
 /* alm_tmp->alm where necessary */
       almtmp2alm (&ljob, lmax, mi);
@@ -848,16 +1489,31 @@ static void sharp_execute_job (sharp_job *job)
 } /* end of parallel region */
 
 /* phase->map where necessary */
-    phase2map (job, mmax, llim, ulim);
-
-    DEALLOC(ispair);
-    DEALLOC(mlim);
-    DEALLOC(cth);
-    DEALLOC(sth);
+    phase2map (job, mmax, llim, ulim, &pd->fft);
     } /* end of chunk loop */
 
-  DEALLOC(job->norm_l);
   dealloc_phase (job);
+  }
+
+static void sharp_execute_job (sharp_job *job)
+  {
+  double timer=wallTime();
+  job->opcnt=0;
+  int lmax = job->ainfo->lmax,
+      mmax=sharp_get_mmax(job->ainfo->mval, job->ainfo->nm);
+
+  job->norm_l = get_norm_l (job, lmax);
+  set_small_mmax (job, mmax);
+  pairdata pd;
+  make_pair_data (job, lmax, &pd);
+
+/* clear output arrays if requested */
+  init_output (job);
+
+  run_job (job, lmax, mmax, &pd);
+
+  destroy_pair_data (&pd);
+  DEALLOC(job->norm_l);
   job->time=wallTime()-timer;
   }
 
@@ -905,6 +1561,55 @@ void sharp_execute (sharp_jobtype type, int spin, void *alm, void *map,
   if (opcnt!=NULL) *opcnt = job.opcnt;
   }
 
+struct sharp_plan_s
+  {
+  sharp_job job; /* with resolved flags and norm_l; no arrays */
+  int lmax, mmax;
+  pairdata pd;
+  };
+
+void sharp_make_plan (sharp_jobtype type, int spin,
+  const sharp_geom_info *geom_info, const sharp_alm_info *alm_info, int ntrans,
+  int flags, sharp_plan **plan)
+  {
+  sharp_plan *res = RALLOC(sharp_plan,1);
+  sharp_build_job_common (&res->job, type, spin, NULL, NULL, geom_info,
+    alm_info, ntrans, flags);
+  res->lmax = alm_info->lmax;
+  res->mmax = sharp_get_mmax(alm_info->mval, alm_info->nm);
+  res->job.norm_l = get_norm_l (&res->job, res->lmax);
+  set_small_mmax (&res->job, res->mmax);
+  make_pair_data (&res->job, res->lmax, &res->pd);
+  *plan=res;
+  }
+
+void sharp_execute_plan (const sharp_plan *plan, void *alm, void *map,
+  int flags, int nthreads, double *time, unsigned long long *opcnt)
+  {
+  UTIL_ASSERT((flags&~SHARP_ADD)==0,"bad flags for sharp_execute_plan");
+  double timer=wallTime();
+  sharp_job job = plan->job;
+  job.alm=alm;
+  job.map=map;
+  job.flags|=flags&SHARP_ADD;
+  job.opcnt=0;
+  int nthreads_old=set_thread_count(nthreads);
+
+  init_output (&job);
+  run_job (&job, plan->lmax, plan->mmax, &plan->pd);
+
+  set_thread_count(nthreads_old);
+  if (time!=NULL) *time = wallTime()-timer;
+  if (opcnt!=NULL) *opcnt = job.opcnt;
+  }
+
+void sharp_destroy_plan (sharp_plan *plan)
+  {
+  DEALLOC(plan->job.norm_l);
+  destroy_pair_data (&plan->pd);
+  DEALLOC(plan);
+  }
+
 void sharp_set_chunksize_min(int new_chunksize_min)
   { chunksize_min=new_chunksize_min; }
 void sharp_set_nchunks_max(int new_nchunks_max)
@@ -985,9 +1690,104 @@ int sharp_nv_oracle (sharp_jobtype type, int spin, int ntrans)
   UTIL_ASSERT(spin>=0, "bad spin");
   ntrans=IMIN(ntrans,maxtr);
 
+  int res;
+/* concurrent first calls must neither race on the table nor benchmark
+   against each other */
+#pragma omp critical (sharp_nv_oracle)
+{
   if (nv_opt[ntrans-1][spin!=0][type]==0)
     nv_opt[ntrans-1][spin!=0][type]=sharp_oracle(type,spin,ntrans);
-  return nv_opt[ntrans-1][spin!=0][type];
+  res=nv_opt[ntrans-1][spin!=0][type];
+}
+  return res;
+  }
+
+/* Returns the minimum wall time of (at least) two executions of the job. */
+static double time_job (sharp_jobtype type, int spin, void *alm, void *map,
+  const sharp_geom_info *tinfo, const sharp_alm_info *alms, int ntrans,
+  int flags)
+  {
+  double time=1e30, time_acc=0.;
+  int ntries=0;
+  do
+    {
+    double jtime;
+    sharp_execute(type,spin,alm,map,tinfo,alms,ntrans,flags,&jtime,NULL);
+    if (jtime<time) time=jtime;
+    time_acc+=jtime;
+    ++ntries;
+    }
+  while ((time_acc<0.02)||(ntries<2));
+  return time;
+  }
+
+/* Returns the largest mmax for which the small-mmax transform beats the
+   standard one, or -1 if it never does. \a nv is the SHARP_NVMAX part of
+   the flags of the timed jobs. */
+static int small_mmax_benchmark (sharp_jobtype type, int spin, int ntrans,
+  int nv)
+  {
+  static const int mmax_try[] = { 0, 1, 2, 4, 8, SMALL_MMAX_MAX };
+  int nside=256, lmax=2*nside, mmax=SMALL_MMAX_MAX;
+
+  ptrdiff_t npix=12*(ptrdiff_t)nside*nside;
+  sharp_geom_info *tinfo;
+  sharp_make_healpix_geom_info (nside, 1, &tinfo);
+
+  ptrdiff_t nalms = ((mmax+1)*(mmax+2))/2 + (mmax+1)*(lmax-mmax);
+  int ncomp = ntrans*((spin==0) ? 1 : 2);
+
+  double **map;
+  ALLOC2D(map,double,ncomp,npix);
+  SET_ARRAY(map[0],0,npix*ncomp,0.);
+
+  dcmplx **alm;
+  ALLOC2D(alm,dcmplx,ncomp,nalms);
+  SET_ARRAY(alm[0],0,nalms*ncomp,0.);
+
+  int res=-1;
+  for (size_t i=0; i<sizeof(mmax_try)/sizeof(mmax_try[0]); ++i)
+    {
+    sharp_alm_info *alms;
+    sharp_make_triangular_alm_info(lmax,mmax_try[i],1,&alms);
+    double tsmall=time_job(type,spin,&alm[0],&map[0],tinfo,alms,ntrans,
+      nv|SHARP_DP|SHARP_SMALL_MMAX);
+    double tstd=time_job(type,spin,&alm[0],&map[0],tinfo,alms,ntrans,
+      nv|SHARP_DP|SHARP_NO_SMALL_MMAX);
+    sharp_destroy_alm_info(alms);
+    if (tsmall>=tstd) break;
+    res=mmax_try[i];
+    }
+
+  DEALLOC2D(map);
+  DEALLOC2D(alm);
+  sharp_destroy_geom_info(tinfo);
+  return res;
+  }
+
+static int sharp_small_mmax_oracle (sharp_jobtype type, int spin, int ntrans)
+  {
+  static const int maxtr = 6;
+  /* 0: not yet determined; otherwise the benchmark result plus 2 */
+  static int mmax_opt[6][2][5];
+
+  if (type==SHARP_ALM2MAP_DERIV1) spin=1;
+  spin = (spin!=0) ? 2 : 0;
+  ntrans=IMIN(ntrans,maxtr);
+
+  /* looked up first, so that sharp_nv_oracle() never enters its critical
+     section from within this one */
+  int nv=sharp_nv_oracle(type,spin,ntrans), res;
+/* concurrent first calls must neither race on the table nor benchmark
+   against each other */
+#pragma omp critical (sharp_small_mmax_oracle)
+{
+  if (mmax_opt[ntrans-1][spin!=0][type]==0)
+    mmax_opt[ntrans-1][spin!=0][type]
+      =small_mmax_benchmark(type,spin,ntrans,nv)+2;
+  res=mmax_opt[ntrans-1][spin!=0][type];
+}
+  return res-2;
   }
 
 #ifdef USE_MPI
@@ -1018,3 +1818,312 @@ int sharp_execute_mpi_maybe (void *pcomm, sharp_jobtype type, int spin,
   }
 
 #endif
+
+/* Helpers for iterative map analysis. The loops visit every real number
+   stored in an a_lm or map array; w is its weight in the inner product for
+   which SHARP_MAP2ALM is the adjoint of SHARP_ALM2MAP. */
+
+#define ALM_LOOP(ainfo,realharm,body)                                    \
+  for (int mi=0; mi<(ainfo)->nm; ++mi)                                   \
+    {                                                                    \
+    int m_=(ainfo)->mval[mi];                                            \
+    ptrdiff_t ofs_=(ainfo)->mvstart[mi], str_=(ainfo)->stride;           \
+    int ncomp_ = ((ainfo)->flags&SHARP_PACKED)&&(m_==0) ? 1 : 2;         \
+    double w = ((m_==0)||(realharm)) ? 1. : 2.;                          \
+    if (!((ainfo)->flags&SHARP_PACKED)) ofs_*=2;                         \
+    if (ncomp_==2) str_*=2;                                              \
+    for (int l=m_; l<=(ainfo)->lmax; ++l)                                \
+      for (ptrdiff_t i=ofs_+l*str_; i<ofs_+l*str_+ncomp_; ++i)           \
+        { body }                                                         \
+    }
+
+#define MAP_LOOP(ginfo,body)                                             \
+  {                                                                      \
+  ptrdiff_t *idx_=RALLOC(ptrdiff_t,IMAX((ginfo)->nphmax,1));             \
+  for (int j_=0; j_<(ginfo)->npairs; ++j_)                               \
+    for (int r_=0; r_<2; ++r_)                                           \
+      {                                                                  \
+      const sharp_ringinfo *ri_ = r_ ? &((ginfo)->pair[j_].r2)           \
+                                     : &((ginfo)->pair[j_].r1);          \
+      double w = ri_->weight;                                            \
+      ring_pixel_indices(ri_,idx_);                                      \
+      STORED_LOOP(ri_,k_)                                                \
+        { ptrdiff_t i=idx_[k_]; body }                                   \
+      }                                                                  \
+  DEALLOC(idx_);                                                         \
+  }
+
+static ptrdiff_t alm_extent (const sharp_alm_info *ainfo)
+  {
+  ptrdiff_t res=0;
+  ALM_LOOP(ainfo,0,if (i>=res) res=i+1; (void)w;)
+  return res;
+  }
+
+static double map_dot (const sharp_geom_info *ginfo, int flags, const void *a,
+  const void *b)
+  {
+  double res=0;
+  if (flags&SHARP_DP)
+    MAP_LOOP(ginfo,res+=w*((const double *)a)[i]*((const double *)b)[i];)
+  else
+    MAP_LOOP(ginfo,res+=w*((const float *)a)[i]*((const float *)b)[i];)
+  return res;
+  }
+
+/* y = alpha*x + beta*y */
+static void map_axpby (const sharp_geom_info *ginfo, int flags, double alpha,
+  const void *x, double beta, void *y)
+  {
+  if (flags&SHARP_DP)
+    MAP_LOOP(ginfo,(void)w; ((double *)y)[i]
+      = alpha*((const double *)x)[i]+beta*((double *)y)[i];)
+  else
+    MAP_LOOP(ginfo,(void)w; ((float *)y)[i]
+      = (float)(alpha*((const float *)x)[i]+beta*((float *)y)[i]);)
+  }
+
+#undef ALM_LOOP
+#undef MAP_LOOP
+
+/* A job of map2alm_iter() together with all of its setup that does not
+   depend on the a_lm and map arrays, so that the iterations only run the
+   transform itself */
+typedef struct
+  {
+  sharp_job job; /* with resolved flags; no arrays */
+  sharp_plan *plan; /* for execution on a single task */
+#ifdef USE_MPI
+  sharp_mpi_plan *mplan; /* for execution on more than one task */
+#endif
+  } iter_job;
+
+static void make_iter_job (iter_job *ij, void *pcomm, sharp_jobtype type,
+  int spin, const sharp_geom_info *geom_info, const sharp_alm_info *alm_info,
+  int ntrans, int flags)
+  {
+  sharp_build_job_common (&ij->job, type, spin, NULL, NULL, geom_info,
+    alm_info, ntrans, flags);
+  ij->plan=NULL;
+#ifdef USE_MPI
+  ij->mplan=NULL;
+  if (pcomm!=NULL)
+    {
+    int ntasks;
+    MPI_Comm_size(*(MPI_Comm *)pcomm, &ntasks);
+    if (ntasks>1)
+      {
+      ij->mplan=RALLOC(sharp_mpi_plan,1);
+      sharp_make_mpi_plan (&ij->job, *(MPI_Comm *)pcomm, ij->mplan);
+      return;
+      }
+    }
+#else
+  (void)pcomm;
+#endif
+  sharp_make_plan (type, spin, geom_info, alm_info, ntrans, flags, &ij->plan);
+  }
+
+static void destroy_iter_job (iter_job *ij)
+  {
+  if (ij->plan!=NULL) sharp_destroy_plan (ij->plan);
+#ifdef USE_MPI
+  if (ij->mplan!=NULL)
+    {
+    sharp_destroy_mpi_plan (ij->mplan);
+    DEALLOC(ij->mplan);
+    }
+#endif
+  }
+
+static void iter_allreduce (double *v, int n, void *pcomm)
+  {
+#ifdef USE_MPI
+  if (pcomm!=NULL)
+    MPI_Allreduce (MPI_IN_PLACE, v, n, MPI_DOUBLE, MPI_SUM,
+      *(MPI_Comm *)pcomm);
+#else
+  (void)v; (void)n; (void)pcomm;
+#endif
+  }
+
+/* per-transform inner products of the a_lm (isalm!=0) or maps in x and y,
+   summed over all components and MPI tasks */
+static void iter_dots (const sharp_job *job, int isalm, void **x, void **y,
+  double *res, void *pcomm)
+  {
+  int ncomp=job->nalm; /* == job->nmaps for the supported job types */
+  for (int t=0; t<job->ntrans; ++t)
+    {
+    res[t]=0.;
+    for (int c=t*ncomp; c<(t+1)*ncomp; ++c)
+      res[t] += isalm ? sharp_alm_dot(job->ainfo,x[c],y[c],job->flags)
+                      : map_dot(job->ginfo,job->flags,x[c],y[c]);
+    }
+  iter_allreduce (res, job->ntrans, pcomm);
+  }
+
+/* runs the job on the given a_lm and maps */
+static void iter_run (const iter_job *ij, void **alm, void **map, int add)
+  {
+#ifdef USE_MPI
+  if (ij->mplan!=NULL)
+    {
+    sharp_job job=ij->job;
+    job.alm=alm;
+    job.map=map;
+    if (add) job.flags|=SHARP_ADD;
+    sharp_run_job_mpi (&job, ij->mplan);
+    return;
+    }
+#endif
+  sharp_execute_plan (ij->plan, alm, map, add ? SHARP_ADD : 0, 0, NULL, NULL);
+  }
+
+static int map2alm_iter (void *pcomm, sharp_itermethod method, int spin,
+  void *alm, void *map, const sharp_geom_info *geom_info,
+  const sharp_alm_info *alm_info, int ntrans, int flags, int niter,
+  double epsilon, double *resid)
+  {
+  UTIL_ASSERT(niter>=0,"niter must not be negative");
+  UTIL_ASSERT((method==SHARP_ITER_JACOBI)||(method==SHARP_ITER_CG),
+    "unknown iteration method");
+  UTIL_ASSERT((flags&SHARP_NO_FFT)==0,"SHARP_NO_FFT is not supported");
+  UTIL_ASSERT((flags&SHARP_ADD)==0,"SHARP_ADD is not supported");
+
+  iter_job ja, jy;
+  void **ua=(void **)alm, **um=(void **)map;
+  int ncomp=ntrans*((spin>0) ? 2 : 1);
+  make_iter_job (&ja, pcomm, SHARP_MAP2ALM, spin, geom_info, alm_info, ntrans,
+    flags);
+  make_iter_job (&jy, pcomm, SHARP_ALM2MAP, spin, geom_info, alm_info, ntrans,
+    flags);
+
+  size_t rsize = (flags&SHARP_DP) ? sizeof(double) : sizeof(float);
+  ptrdiff_t nalm=alm_extent(alm_info), npix=sharp_map_extent(geom_info);
+  int nabuf = (method==SHARP_ITER_CG) ? 2 : 0, nmbuf = 2;
+  char *abuf=RALLOC(char,nabuf*ncomp*nalm*rsize),
+       *mbuf=RALLOC(char,nmbuf*ncomp*npix*rsize);
+  void **r=RALLOC(void *,nmbuf*ncomp), **q=r+ncomp,
+       **s=RALLOC(void *,(nabuf+1)*ncomp), **p=s+ncomp;
+  for (int i=0; i<ncomp; ++i)
+    {
+    r[i]=mbuf+i*npix*rsize;
+    q[i]=mbuf+(ncomp+i)*npix*rsize;
+    if (nabuf>0)
+      {
+      s[i]=abuf+i*nalm*rsize;
+      p[i]=abuf+(ncomp+i)*nalm*rsize;
+      }
+    }
+
+  double *mnorm=RALLOC(double,4*ntrans), *res=mnorm+ntrans,
+         *gamma=mnorm+2*ntrans, *tmp=mnorm+3*ntrans;
+  iter_dots (&jy.job, 0, um, um, mnorm, pcomm);
+
+  int it;
+  if (method==SHARP_ITER_JACOBI)
+    {
+    iter_run (&ja, ua, um, 0);
+    for (it=0; ; ++it)
+      {
+      int need_resid = (epsilon>0.) || (resid!=NULL) || (it<niter);
+      if (!need_resid) break;
+      /* r = map - Y alm */
+      iter_run (&jy, ua, r, 0);
+      for (int i=0; i<ncomp; ++i)
+        map_axpby (geom_info, flags, 1., um[i], -1., r[i]);
+      iter_dots (&jy.job, 0, r, r, res, pcomm);
+      double rmax=0.;
+      for (int t=0; t<ntrans; ++t)
+        {
+        res[t] = (mnorm[t]>0.) ? sqrt(res[t]/mnorm[t]) : 0.;
+        if (res[t]>rmax) rmax=res[t];
+        }
+      if ((it==niter)||(rmax<epsilon)) break;
+      /* alm += YtW r */
+      iter_run (&ja, ua, r, 1);
+      }
+    }
+  else
+    {
+    /* CGLS on the weighted least-squares problem, starting from the plain
+       analysis, so that niter==0 gives the same result as for Jacobi */
+    iter_run (&ja, ua, um, 0);
+    iter_run (&jy, ua, r, 0);
+    for (int i=0; i<ncomp; ++i)
+      map_axpby (geom_info, flags, 1., um[i], -1., r[i]);
+    for (it=0; ; ++it)
+      {
+      double rmax=0.;
+      iter_dots (&jy.job, 0, r, r, res, pcomm);
+      for (int t=0; t<ntrans; ++t)
+        {
+        res[t] = (mnorm[t]>0.) ? sqrt(res[t]/mnorm[t]) : 0.;
+        if (res[t]>rmax) rmax=res[t];
+        }
+      if ((it==niter)||(rmax<epsilon)) break;
+      iter_run (&ja, s, r, 0);
+      if (it==0)
+        {
+        for (int i=0; i<ncomp; ++i)
+          sharp_alm_axpby (alm_info, 1., s[i], 0., p[i], ja.job.flags);
+        iter_dots (&ja.job, 1, s, s, gamma, pcomm);
+        }
+      else
+        {
+        iter_dots (&ja.job, 1, s, s, tmp, pcomm);
+        for (int t=0; t<ntrans; ++t)
+          {
+          double beta = (gamma[t]>0.) ? tmp[t]/gamma[t] : 0.;
+          for (int c=t*ncomp/ntrans; c<(t+1)*ncomp/ntrans; ++c)
+            sharp_alm_axpby (alm_info, 1., s[c], beta, p[c], ja.job.flags);
+          gamma[t]=tmp[t];
+          }
+        }
+      /* q = Y p */
+      iter_run (&jy, p, q, 0);
+      iter_dots (&jy.job, 0, q, q, tmp, pcomm);
+      for (int t=0; t<ntrans; ++t)
+        {
+        double alpha = (tmp[t]>0.) ? gamma[t]/tmp[t] : 0.;
+        for (int c=t*ncomp/ntrans; c<(t+1)*ncomp/ntrans; ++c)
+          {
+          sharp_alm_axpby (alm_info, alpha, p[c], 1., ua[c], ja.job.flags);
+          map_axpby (geom_info, flags, -alpha, q[c], 1., r[c]);
+          }
+        }
+      }
+    }
+
+  if (resid!=NULL)
+    for (int t=0; t<ntrans; ++t) resid[t]=res[t];
+
+  DEALLOC(mnorm);
+  DEALLOC(s);
+  DEALLOC(r);
+  DEALLOC(abuf);
+  DEALLOC(mbuf);
+  destroy_iter_job (&ja);
+  destroy_iter_job (&jy);
+  return it;
+  }
+
+int sharp_map2alm_iter (sharp_itermethod method, int spin, void *alm,
+  void *map, const sharp_geom_info *geom_info, const sharp_alm_info *alm_info,
+  int ntrans, int flags, int niter, double epsilon, double *resid)
+  {
+  return map2alm_iter (NULL, method, spin, alm, map, geom_info, alm_info,
+    ntrans, flags, niter, epsilon, resid);
+  }
+
+#ifdef USE_MPI
+int sharp_map2alm_iter_mpi (MPI_Comm comm, sharp_itermethod method, int spin,
+  void *alm, void *map, const sharp_geom_info *geom_info,
+  const sharp_alm_info *alm_info, int ntrans, int flags, int niter,
+  double epsilon, double *resid)
+  {
+  return map2alm_iter (&comm, method, spin, alm, map, geom_info, alm_info,
+    ntrans, flags, niter, epsilon, resid);
+  }
+#endif
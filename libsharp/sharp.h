@@ -39,8 +39,10 @@
 #include <complex.h>
 
 #include "sharp_lowlevel.h"
+#include "sharp_almops.h"
 #include "sharp_legendre.h"
 #include "sharp_legendre_roots.h"
 #include "sharp_legendre_table.h"
+#include "sharp_wigner3j.h"
 
 #endif
@@ -0,0 +1,330 @@
+/*
+ *  This file is part of libsharp.
+ *
+ *  libsharp is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libsharp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libsharp; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*! \file sharp_almops.c
+ *  Layout conversion and arithmetic for a_lm arrays
+ *
+ *  Copyright (C) 2026 The libsharp developers
+ */
+
+#include <math.h>
+#include "sharp_almops.h"
+#include "sharp_vecsupport.h"
+#include "c_utils.h"
+
+/* Below this number of coefficients, the operations run single-threaded. */
+#define ALMOPS_PARALLEL_MIN 32768
+
+/* Storage of the coefficients with m=mval[mi]: the real numbers belonging
+   to l are found at indices ofs+l*str to ofs+l*str+ncomp-1. */
+typedef struct
+  {
+  ptrdiff_t ofs, str;
+  int m, ncomp;
+  } almcol;
+
+static almcol get_column (const sharp_alm_info *ainfo, int mi)
+  {
+  almcol res;
+  res.m = ainfo->mval[mi];
+  res.ofs = ainfo->mvstart[mi];
+  res.str = ainfo->stride;
+  res.ncomp = ((ainfo->flags&SHARP_PACKED)&&(res.m==0)) ? 1 : 2;
+  if (!(ainfo->flags&SHARP_PACKED)) res.ofs*=2;
+  if (res.ncomp==2) res.str*=2;
+  return res;
+  }
+
+static int use_threads (const sharp_alm_info *ainfo, int flags)
+  {
+  return ((flags&SHARP_NO_OPENMP)==0)
+    && ((ptrdiff_t)ainfo->nm*(ainfo->lmax+1)>=ALMOPS_PARALLEL_MIN);
+  }
+
+static int contiguous (almcol c)
+  { return c.str==c.ncomp; }
+
+/* Loops over all real numbers of column c with l from lo to hi. */
+#define COLUMN_LOOP(c,lo,hi,body)                                        \
+  for (int l_=(lo); l_<=(hi); ++l_)                                      \
+    for (ptrdiff_t i=(c).ofs+l_*(c).str; i<(c).ofs+l_*(c).str+(c).ncomp; ++i) \
+      { body }
+
+/* Vectorized kernels for contiguous double precision columns */
+
+/* y[i] = a*x[i] + b*y[i] */
+static void axpby_d (ptrdiff_t n, double a, const double *x, double b,
+  double *y)
+  {
+  ptrdiff_t i=0;
+  Tv va=vload(a), vb=vload(b);
+  if (a==0.)
+    for (; i+VLEN<=n; i+=VLEN)
+      vstoreu(y+i,vmul(vb,vloadu(y+i)));
+  else if (b==0.)
+    for (; i+VLEN<=n; i+=VLEN)
+      vstoreu(y+i,vmul(va,vloadu(x+i)));
+  else
+    for (; i+VLEN<=n; i+=VLEN)
+      vstoreu(y+i,vadd(vmul(va,vloadu(x+i)),vmul(vb,vloadu(y+i))));
+  for (; i<n; ++i)
+    y[i] = (a==0.) ? b*y[i] : ((b==0.) ? a*x[i] : a*x[i]+b*y[i]);
+  }
+
+/* y[i] *= f[i] */
+static void mul_d (ptrdiff_t n, const double *f, double *y)
+  {
+  ptrdiff_t i=0;
+  for (; i+VLEN<=n; i+=VLEN)
+    vstoreu(y+i,vmul(vloadu(f+i),vloadu(y+i)));
+  for (; i<n; ++i)
+    y[i]*=f[i];
+  }
+
+static double dot_d (ptrdiff_t n, const double *a, const double *b)
+  {
+  ptrdiff_t i=0;
+  Tv acc=vzero;
+  for (; i+VLEN<=n; i+=VLEN)
+    vfmaeq(acc,vloadu(a+i),vloadu(b+i));
+  double tmp[VLEN], res=0;
+  vstoreu(tmp,acc);
+  for (int k=0; k<VLEN; ++k)
+    res+=tmp[k];
+  for (; i<n; ++i)
+    res+=a[i]*b[i];
+  return res;
+  }
+
+void sharp_alm_convert (const sharp_alm_info *ainfo_in, const void *in,
+  const sharp_alm_info *ainfo_out, void *out, int flags)
+  {
+  int mmax_in=0;
+  for (int mi=0; mi<ainfo_in->nm; ++mi)
+    mmax_in=IMAX(mmax_in,ainfo_in->mval[mi]);
+  int *mi_in=RALLOC(int,mmax_in+1);
+  SET_ARRAY(mi_in,0,mmax_in+1,-1);
+  for (int mi=0; mi<ainfo_in->nm; ++mi)
+    mi_in[ainfo_in->mval[mi]]=mi;
+  /* real harmonic coefficients with m!=0 are larger by sqrt(2) */
+  int rh_in=ainfo_in->flags&SHARP_REAL_HARMONICS,
+      rh_out=ainfo_out->flags&SHARP_REAL_HARMONICS;
+  double fct_m = (rh_in==rh_out) ? 1. : (rh_out ? sqrt(2.) : sqrt(.5));
+
+#define CONVERT_LOOP(real_t)                                             \
+  {                                                                      \
+  const real_t *pin=(const real_t *)in;                                  \
+  real_t *pout=(real_t *)out;                                            \
+  if ((ci.ncomp==2)&&(co.ncomp==2))                                      \
+    for (int l=co.m; l<=lcopy; ++l)                                      \
+      {                                                                  \
+      pout[co.ofs+l*co.str  ]=(real_t)(fct*pin[ci.ofs+l*ci.str  ]);      \
+      pout[co.ofs+l*co.str+1]=(real_t)(fct*pin[ci.ofs+l*ci.str+1]);      \
+      }                                                                  \
+  else if (co.ncomp==2)                                                  \
+    for (int l=co.m; l<=lcopy; ++l)                                      \
+      {                                                                  \
+      pout[co.ofs+l*co.str  ]=(real_t)(fct*pin[ci.ofs+l*ci.str]);        \
+      pout[co.ofs+l*co.str+1]=0;                                         \
+      }                                                                  \
+  else                                                                   \
+    for (int l=co.m; l<=lcopy; ++l)                                      \
+      pout[co.ofs+l*co.str]=(real_t)(fct*pin[ci.ofs+l*ci.str]);          \
+  COLUMN_LOOP(co,IMAX(co.m,lcopy+1),ainfo_out->lmax,pout[i]=0;)          \
+  }
+
+#pragma omp parallel if (use_threads(ainfo_out,flags))
+{
+#pragma omp for schedule(dynamic,4)
+  for (int mi=0; mi<ainfo_out->nm; ++mi)
+    {
+    almcol co=get_column(ainfo_out,mi);
+    int mii = (co.m<=mmax_in) ? mi_in[co.m] : -1;
+    almcol ci = (mii>=0) ? get_column(ainfo_in,mii) : co;
+    int lcopy = (mii>=0) ? IMIN(ainfo_in->lmax,ainfo_out->lmax) : co.m-1;
+    double fct = (co.m==0) ? 1. : fct_m;
+    if ((flags&SHARP_DP)&&contiguous(ci)&&contiguous(co)
+      &&(ci.ncomp==co.ncomp)&&(lcopy>=co.m))
+      {
+      axpby_d ((lcopy+1-co.m)*co.ncomp,fct,
+        (const double *)in+ci.ofs+co.m*ci.str,0.,
+        (double *)out+co.ofs+co.m*co.str);
+      COLUMN_LOOP(co,lcopy+1,ainfo_out->lmax,((double *)out)[i]=0;)
+      }
+    else if (flags&SHARP_DP)
+      CONVERT_LOOP(double)
+    else
+      CONVERT_LOOP(float)
+    }
+} /* end of parallel region */
+
+#undef CONVERT_LOOP
+
+  DEALLOC(mi_in);
+  }
+
+void sharp_almxfl (const sharp_alm_info *ainfo, void *alm, int ncomp,
+  const double *fl, ptrdiff_t fl_stride, int flags)
+  {
+  int lmax=ainfo->lmax;
+  /* every filter value duplicated, so that a contiguous complex column is
+     multiplied element by element with fl2 */
+  double *fl2=RALLOC(double,2*(lmax+1)*ncomp);
+  for (int n=0; n<ncomp; ++n)
+    for (int l=0; l<=lmax; ++l)
+      fl2[2*(lmax+1)*n+2*l]=fl2[2*(lmax+1)*n+2*l+1]=fl[n*fl_stride+l];
+
+#pragma omp parallel if (use_threads(ainfo,flags))
+{
+#pragma omp for schedule(dynamic,4)
+  for (int mi=0; mi<ainfo->nm; ++mi)
+    {
+    almcol c=get_column(ainfo,mi);
+    for (int n=0; n<ncomp; ++n)
+      {
+      const double *f=fl+n*fl_stride;
+      if (flags&SHARP_DP)
+        {
+        double *p=((double **)alm)[n];
+        if (contiguous(c))
+          mul_d ((lmax+1-c.m)*c.ncomp,
+            (c.ncomp==2) ? fl2+2*(lmax+1)*n+2*c.m : f+c.m, p+c.ofs+c.m*c.str);
+        else
+          COLUMN_LOOP(c,c.m,lmax,p[i]*=f[l_];)
+        }
+      else
+        {
+        float *p=((float **)alm)[n];
+        COLUMN_LOOP(c,c.m,lmax,p[i]*=(float)f[l_];)
+        }
+      }
+    }
+} /* end of parallel region */
+
+  DEALLOC(fl2);
+  }
+
+void sharp_almxfm (const sharp_alm_info *ainfo, void *alm, int ncomp,
+  const double *fm, ptrdiff_t fm_stride, int flags)
+  {
+#pragma omp parallel if (use_threads(ainfo,flags))
+{
+#pragma omp for schedule(dynamic,4)
+  for (int mi=0; mi<ainfo->nm; ++mi)
+    {
+    almcol c=get_column(ainfo,mi);
+    for (int n=0; n<ncomp; ++n)
+      {
+      double f=fm[n*fm_stride+c.m];
+      if (flags&SHARP_DP)
+        {
+        double *p=((double **)alm)[n];
+        if (contiguous(c))
+          axpby_d ((ainfo->lmax+1-c.m)*c.ncomp,0.,NULL,f,p+c.ofs+c.m*c.str);
+        else
+          COLUMN_LOOP(c,c.m,ainfo->lmax,p[i]*=f;)
+        }
+      else
+        {
+        float *p=((float **)alm)[n];
+        COLUMN_LOOP(c,c.m,ainfo->lmax,p[i]*=(float)f;)
+        }
+      }
+    }
+} /* end of parallel region */
+  }
+
+void sharp_alm_axpby (const sharp_alm_info *ainfo, double alpha,
+  const void *x, double beta, void *y, int flags)
+  {
+#define AXPBY_LOOP(real_t)                                               \
+  {                                                                      \
+  const real_t *px=(const real_t *)x;                                    \
+  real_t *py=(real_t *)y;                                                \
+  if (alpha==0.)                                                         \
+    COLUMN_LOOP(c,c.m,ainfo->lmax,py[i]=(real_t)(beta*py[i]);)           \
+  else if (beta==0.)                                                     \
+    COLUMN_LOOP(c,c.m,ainfo->lmax,py[i]=(real_t)(alpha*px[i]);)          \
+  else                                                                   \
+    COLUMN_LOOP(c,c.m,ainfo->lmax,py[i]=(real_t)(alpha*px[i]+beta*py[i]);) \
+  }
+
+#pragma omp parallel if (use_threads(ainfo,flags))
+{
+#pragma omp for schedule(dynamic,4)
+  for (int mi=0; mi<ainfo->nm; ++mi)
+    {
+    almcol c=get_column(ainfo,mi);
+    if ((flags&SHARP_DP)&&contiguous(c))
+      {
+      ptrdiff_t lo=c.ofs+c.m*c.str;
+      axpby_d ((ainfo->lmax+1-c.m)*c.ncomp,alpha,
+        (alpha==0.) ? NULL : (const double *)x+lo,beta,(double *)y+lo);
+      }
+    else if (flags&SHARP_DP)
+      AXPBY_LOOP(double)
+    else
+      AXPBY_LOOP(float)
+    }
+} /* end of parallel region */
+
+#undef AXPBY_LOOP
+  }
+
+double sharp_alm_dot (const sharp_alm_info *ainfo, const void *a,
+  const void *b, int flags)
+  {
+  int realharm=(ainfo->flags|flags)&SHARP_REAL_HARMONICS;
+  /* per-column sums keep the result independent of the thread count */
+  double *part=RALLOC(double,IMAX(ainfo->nm,1));
+
+#define DOT_LOOP(real_t)                                                 \
+  {                                                                      \
+  const real_t *pa=(const real_t *)a, *pb=(const real_t *)b;             \
+  COLUMN_LOOP(c,c.m,ainfo->lmax,sum+=(double)pa[i]*pb[i];)               \
+  }
+
+#pragma omp parallel if (use_threads(ainfo,flags))
+{
+#pragma omp for schedule(dynamic,4)
+  for (int mi=0; mi<ainfo->nm; ++mi)
+    {
+    almcol c=get_column(ainfo,mi);
+    double sum=0;
+    if ((flags&SHARP_DP)&&contiguous(c))
+      {
+      ptrdiff_t lo=c.ofs+c.m*c.str;
+      sum=dot_d((ainfo->lmax+1-c.m)*c.ncomp,(const double *)a+lo,
+        (const double *)b+lo);
+      }
+    else if (flags&SHARP_DP)
+      DOT_LOOP(double)
+    else
+      DOT_LOOP(float)
+    part[mi] = ((c.m==0)||realharm) ? sum : 2*sum;
+    }
+} /* end of parallel region */
+
+#undef DOT_LOOP
+
+  double res=0;
+  for (int mi=0; mi<ainfo->nm; ++mi)
+    res+=part[mi];
+  DEALLOC(part);
+  return res;
+  }
@@ -0,0 +1,81 @@
+/*
+ *  This file is part of libsharp.
+ *
+ *  libsharp is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libsharp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libsharp; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*! \file sharp_almops.h
+ *  Layout conversion and arithmetic for a_lm arrays
+ *
+ *  All functions work on a single set of coefficients laid out as described
+ *  by a \a sharp_alm_info, in single or double precision depending on
+ *  whether SHARP_DP is set in \a flags. They are OpenMP-parallel over \a m.
+ *
+ *  Copyright (C) 2026 The libsharp developers
+ */
+
+#ifndef PLANCK_SHARP_ALMOPS_H
+#define PLANCK_SHARP_ALMOPS_H
+
+#include "sharp_lowlevel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \addtogroup almgroup */
+/*! \{ */
+
+/*! Copies the a_lm in \a in, laid out as described by \a ainfo_in, to
+    \a out, laid out as described by \a ainfo_out. Complex, packed and real
+    harmonic layouts are converted into each other as needed. Coefficients
+    of \a out whose \a l or \a m is not present in \a ainfo_in are set to
+    zero; when converting to a packed layout, the (vanishing) imaginary parts
+    of the m=0 coefficients are dropped. \a in and \a out must not overlap. */
+void sharp_alm_convert (const sharp_alm_info *ainfo_in, const void *in,
+  const sharp_alm_info *ainfo_out, void *out, int flags);
+
+/*! Multiplies the a_lm of the \a ncomp components in \a alm (an array of
+    \a ncomp pointers, as for sharp_execute()) by an \a l dependent factor.
+    The filter for component \a c is \a fl[c*fl_stride+l], \a l=0..lmax;
+    with \a fl_stride=0 all components share the same filter. */
+void sharp_almxfl (const sharp_alm_info *ainfo, void *alm, int ncomp,
+  const double *fl, ptrdiff_t fl_stride, int flags);
+
+/*! Like sharp_almxfl(), but multiplies by an \a m dependent factor: the
+    filter for component \a c is \a fm[c*fm_stride+m], \a m=0..mmax. */
+void sharp_almxfm (const sharp_alm_info *ainfo, void *alm, int ncomp,
+  const double *fm, ptrdiff_t fm_stride, int flags);
+
+/*! Computes \a y = \a alpha * \a x + \a beta * \a y. If \a alpha is 0,
+    \a x is not accessed and may be NULL. */
+void sharp_alm_axpby (const sharp_alm_info *ainfo, double alpha,
+  const void *x, double beta, void *y, int flags);
+
+/*! Returns the real inner product of the fields described by \a a and \a b,
+    i.e. the sum of \f$\mathrm{Re}(a_{lm}^* b_{lm})\f$ over all \a l and all
+    \a m from \a -l to \a l that are present in \a ainfo. Real harmonic
+    coefficients are accounted for accordingly. With MPI, the caller has to
+    sum the results of all tasks. */
+double sharp_alm_dot (const sharp_alm_info *ainfo, const void *a,
+  const void *b, int flags);
+
+/*! \} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -41,7 +41,7 @@ extern "C" {
 
 void inner_loop (sharp_job *job, const int *ispair,const double *cth,
   const double *sth, int llim, int ulim, sharp_Ylmgen_C *gen, int mi,
-  const int *mlim);
+  const int *mlim, const int *rlmax);
 
 #ifdef __cplusplus
 }
@@ -623,10 +623,12 @@ static void Z(calc_alm2map_deriv1) (const Tb cth, const Tb sth,
 
 static void Z(inner_loop) (sharp_job *job, const int *ispair,
   const double *cth_, const double *sth_, int llim, int ulim,
-  sharp_Ylmgen_C *gen, int mi, const int *mlim NJ1)
+  sharp_Ylmgen_C *gen, int mi, const int *mlim, const int *rlmax NJ1)
   {
   const int nval=nvec*VLEN;
   const int m = job->ainfo->mval[mi];
+  const int lmax = gen->lmax;
+  int lv[2*nvec*VLEN];
   sharp_Ylmgen_prepare (gen, m);
 
   switch (job->type)
@@ -638,7 +640,6 @@ static void Z(inner_loop) (sharp_job *job, const int *ispair,
         {
         for (int ith=0; ith<ulim-llim; ith+=nval)
           {
-          Y(Tburi) p1[njobs],p2[njobs]; VZERO(p1); VZERO(p2);
           Y(Tbu) cth, sth;
 
           int skip=1;
@@ -649,32 +650,41 @@ static void Z(inner_loop) (sharp_job *job, const int *ispair,
             if (mlim[itot]>=m) skip=0;
             cth.s[i]=cth_[itot]; sth.s[i]=sth_[itot];
             }
-          if (!skip)
-            Z(calc_alm2map) (cth.b,sth.b,gen,job,&p1[0].b,&p2[0].b NJ2);
-
-          for (int i=0; i<nval; ++i)
+          int nlv=block_lmax(rlmax,ith,nval,ulim-llim,lmax,lv);
+          for (int il=0; il<nlv; ++il)
             {
-            int itot=i+ith;
-            if (itot<ulim-llim)
+            Y(Tburi) p1[njobs],p2[njobs]; VZERO(p1); VZERO(p2);
+            gen->lmax=lv[il];
+            if (!skip)
+              Z(calc_alm2map) (cth.b,sth.b,gen,job,&p1[0].b,&p2[0].b NJ2);
+
+            for (int i=0; i<nval; ++i)
               {
-              for (int j=0; j<njobs; ++j)
+              int itot=i+ith;
+              if (itot<ulim-llim)
                 {
-                int phas_idx = itot*job->s_th + mi*job->s_m + 2*j;
-                complex double r1 = p1[j].s.r[i] + p1[j].s.i[i]*_Complex_I,
-                               r2 = p2[j].s.r[i] + p2[j].s.i[i]*_Complex_I;
-                job->phase[phas_idx] = r1+r2;
-                if (ispair[itot])
-                  job->phase[phas_idx+1] = r1-r2;
+                int use1=ring_lmax(rlmax,itot,0,lmax)==lv[il],
+                    use2=ispair[itot]&&(ring_lmax(rlmax,itot,1,lmax)==lv[il]);
+                for (int j=0; j<njobs; ++j)
+                  {
+                  int phas_idx = itot*job->s_th + mi*job->s_m + 2*j;
+                  complex double r1 = p1[j].s.r[i] + p1[j].s.i[i]*_Complex_I,
+                                 r2 = p2[j].s.r[i] + p2[j].s.i[i]*_Complex_I;
+                  if (use1)
+                    job->phase[phas_idx] = r1+r2;
+                  if (use2)
+                    job->phase[phas_idx+1] = r1-r2;
+                  }
                 }
               }
             }
+          gen->lmax=lmax;
           }
         }
       else
         {
         for (int ith=0; ith<ulim-llim; ith+=nval)
           {
-          Y(Tbuqu) p1[njobs],p2[njobs]; VZERO(p1); VZERO(p2);
           Y(Tbu) cth, sth;
           int skip=1;
 
@@ -685,39 +695,51 @@ static void Z(inner_loop) (sharp_job *job, const int *ispair,
             if (mlim[itot]>=m) skip=0;
             cth.s[i]=cth_[itot]; sth.s[i]=sth_[itot];
             }
-          if (!skip)
-            (job->type==SHARP_ALM2MAP) ?
-              Z(calc_alm2map_spin  )
-                (cth.b,sth.b,gen,job,&p1[0].b,&p2[0].b NJ2) :
-              Z(calc_alm2map_deriv1)
-                (cth.b,sth.b,gen,job,&p1[0].b,&p2[0].b NJ2);
-
-          for (int i=0; i<nval; ++i)
+          int nlv=block_lmax(rlmax,ith,nval,ulim-llim,lmax,lv);
+          for (int il=0; il<nlv; ++il)
             {
-            int itot=i+ith;
-            if (itot<ulim-llim)
+            Y(Tbuqu) p1[njobs],p2[njobs]; VZERO(p1); VZERO(p2);
+            gen->lmax=lv[il];
+            if (!skip)
+              (job->type==SHARP_ALM2MAP) ?
+                Z(calc_alm2map_spin  )
+                  (cth.b,sth.b,gen,job,&p1[0].b,&p2[0].b NJ2) :
+                Z(calc_alm2map_deriv1)
+                  (cth.b,sth.b,gen,job,&p1[0].b,&p2[0].b NJ2);
+
+            for (int i=0; i<nval; ++i)
               {
-              for (int j=0; j<njobs; ++j)
+              int itot=i+ith;
+              if (itot<ulim-llim)
                 {
-                int phas_idx = itot*job->s_th + mi*job->s_m + 4*j;
-                complex double q1 = p1[j].s.qr[i] + p1[j].s.qi[i]*_Complex_I,
-                               q2 = p2[j].s.qr[i] + p2[j].s.qi[i]*_Complex_I,
-                               u1 = p1[j].s.ur[i] + p1[j].s.ui[i]*_Complex_I,
-                               u2 = p2[j].s.ur[i] + p2[j].s.ui[i]*_Complex_I;
-                job->phase[phas_idx] = q1+q2;
-                job->phase[phas_idx+2] = u1+u2;
-                if (ispair[itot])
+                int use1=ring_lmax(rlmax,itot,0,lmax)==lv[il],
+                    use2=ispair[itot]&&(ring_lmax(rlmax,itot,1,lmax)==lv[il]);
+                for (int j=0; j<njobs; ++j)
                   {
-                  dcmplx *phQ = &(job->phase[phas_idx+1]),
-                         *phU = &(job->phase[phas_idx+3]);
-                  *phQ = q1-q2;
-                  *phU = u1-u2;
-                  if ((gen->mhi-gen->m+gen->s)&1)
-                    { *phQ=-(*phQ); *phU=-(*phU); }
+                  int phas_idx = itot*job->s_th + mi*job->s_m + 4*j;
+                  complex double q1 = p1[j].s.qr[i] + p1[j].s.qi[i]*_Complex_I,
+                                 q2 = p2[j].s.qr[i] + p2[j].s.qi[i]*_Complex_I,
+                                 u1 = p1[j].s.ur[i] + p1[j].s.ui[i]*_Complex_I,
+                                 u2 = p2[j].s.ur[i] + p2[j].s.ui[i]*_Complex_I;
+                  if (use1)
+                    {
+                    job->phase[phas_idx] = q1+q2;
+                    job->phase[phas_idx+2] = u1+u2;
+                    }
+                  if (use2)
+                    {
+                    dcmplx *phQ = &(job->phase[phas_idx+1]),
+                           *phU = &(job->phase[phas_idx+3]);
+                    *phQ = q1-q2;
+                    *phU = u1-u2;
+                    if ((gen->mhi-gen->m+gen->s)&1)
+                      { *phQ=-(*phQ); *phU=-(*phU); }
+                    }
                   }
                 }
               }
             }
+          gen->lmax=lmax;
           }
         }
       break;
@@ -728,7 +750,6 @@ static void Z(inner_loop) (sharp_job *job, const int *ispair,
         {
         for (int ith=0; ith<ulim-llim; ith+=nval)
           {
-          Y(Tburi) p1[njobs], p2[njobs]; VZERO(p1); VZERO(p2);
           Y(Tbu) cth, sth;
           int skip=1;
 
@@ -738,27 +759,39 @@ static void Z(inner_loop) (sharp_job *job, const int *ispair,
             if (itot>=ulim-llim) itot=ulim-llim-1;
             if (mlim[itot]>=m) skip=0;
             cth.s[i]=cth_[itot]; sth.s[i]=sth_[itot];
-            if ((i+ith<ulim-llim)&&(mlim[itot]>=m))
+            }
+          int nlv=block_lmax(rlmax,ith,nval,ulim-llim,lmax,lv);
+          for (int il=0; il<nlv; ++il)
+            {
+            Y(Tburi) p1[njobs], p2[njobs]; VZERO(p1); VZERO(p2);
+            for (int i=0; i<nval; ++i)
               {
-              for (int j=0; j<njobs; ++j)
+              int itot=i+ith;
+              if ((itot<ulim-llim)&&(mlim[itot]>=m))
                 {
-                int phas_idx = itot*job->s_th + mi*job->s_m + 2*j;
-                dcmplx ph1=job->phase[phas_idx];
-                dcmplx ph2=ispair[itot] ? job->phase[phas_idx+1] : 0.;
-                p1[j].s.r[i]=creal(ph1+ph2); p1[j].s.i[i]=cimag(ph1+ph2);
-                p2[j].s.r[i]=creal(ph1-ph2); p2[j].s.i[i]=cimag(ph1-ph2);
+                int use1=ring_lmax(rlmax,itot,0,lmax)==lv[il],
+                    use2=ispair[itot]&&(ring_lmax(rlmax,itot,1,lmax)==lv[il]);
+                for (int j=0; j<njobs; ++j)
+                  {
+                  int phas_idx = itot*job->s_th + mi*job->s_m + 2*j;
+                  dcmplx ph1=use1 ? job->phase[phas_idx] : 0.;
+                  dcmplx ph2=use2 ? job->phase[phas_idx+1] : 0.;
+                  p1[j].s.r[i]=creal(ph1+ph2); p1[j].s.i[i]=cimag(ph1+ph2);
+                  p2[j].s.r[i]=creal(ph1-ph2); p2[j].s.i[i]=cimag(ph1-ph2);
+                  }
                 }
               }
+            gen->lmax=lv[il];
+            if (!skip)
+              Z(calc_map2alm)(cth.b,sth.b,gen,job,&p1[0].b,&p2[0].b NJ2);
             }
-          if (!skip)
-            Z(calc_map2alm)(cth.b,sth.b,gen,job,&p1[0].b,&p2[0].b NJ2);
+          gen->lmax=lmax;
           }
         }
       else
         {
         for (int ith=0; ith<ulim-llim; ith+=nval)
           {
-          Y(Tbuqu) p1[njobs], p2[njobs]; VZERO(p1); VZERO(p2);
           Y(Tbu) cth, sth;
           int skip=1;
 
@@ -768,26 +801,39 @@ static void Z(inner_loop) (sharp_job *job, const int *ispair,
             if (itot>=ulim-llim) itot=ulim-llim-1;
             if (mlim[itot]>=m) skip=0;
             cth.s[i]=cth_[itot]; sth.s[i]=sth_[itot];
-            if (i+ith<ulim-llim)
+            }
+          int nlv=block_lmax(rlmax,ith,nval,ulim-llim,lmax,lv);
+          for (int il=0; il<nlv; ++il)
+            {
+            Y(Tbuqu) p1[njobs], p2[njobs]; VZERO(p1); VZERO(p2);
+            for (int i=0; i<nval; ++i)
               {
-              for (int j=0; j<njobs; ++j)
+              int itot=i+ith;
+              if (itot<ulim-llim)
                 {
-                int phas_idx = itot*job->s_th + mi*job->s_m + 4*j;
-                dcmplx p1Q=job->phase[phas_idx],
-                       p1U=job->phase[phas_idx+2],
-                       p2Q=ispair[itot] ? job->phase[phas_idx+1]:0.,
-                       p2U=ispair[itot] ? job->phase[phas_idx+3]:0.;
-                if ((gen->mhi-gen->m+gen->s)&1)
-                  { p2Q=-p2Q; p2U=-p2U; }
-                p1[j].s.qr[i]=creal(p1Q+p2Q); p1[j].s.qi[i]=cimag(p1Q+p2Q);
-                p1[j].s.ur[i]=creal(p1U+p2U); p1[j].s.ui[i]=cimag(p1U+p2U);
-                p2[j].s.qr[i]=creal(p1Q-p2Q); p2[j].s.qi[i]=cimag(p1Q-p2Q);
-                p2[j].s.ur[i]=creal(p1U-p2U); p2[j].s.ui[i]=cimag(p1U-p2U);
+                int use1=ring_lmax(rlmax,itot,0,lmax)==lv[il],
+                    use2=ispair[itot]&&(ring_lmax(rlmax,itot,1,lmax)==lv[il]);
+                for (int j=0; j<njobs; ++j)
+                  {
+                  int phas_idx = itot*job->s_th + mi*job->s_m + 4*j;
+                  dcmplx p1Q=use1 ? job->phase[phas_idx] : 0.,
+                         p1U=use1 ? job->phase[phas_idx+2] : 0.,
+                         p2Q=use2 ? job->phase[phas_idx+1] : 0.,
+                         p2U=use2 ? job->phase[phas_idx+3] : 0.;
+                  if ((gen->mhi-gen->m+gen->s)&1)
+                    { p2Q=-p2Q; p2U=-p2U; }
+                  p1[j].s.qr[i]=creal(p1Q+p2Q); p1[j].s.qi[i]=cimag(p1Q+p2Q);
+                  p1[j].s.ur[i]=creal(p1U+p2U); p1[j].s.ui[i]=cimag(p1U+p2U);
+                  p2[j].s.qr[i]=creal(p1Q-p2Q); p2[j].s.qi[i]=cimag(p1Q-p2Q);
+                  p2[j].s.ur[i]=creal(p1U-p2U); p2[j].s.ui[i]=cimag(p1U-p2U);
+                  }
                 }
               }
+            gen->lmax=lv[il];
+            if (!skip)
+              Z(calc_map2alm_spin) (cth.b,sth.b,gen,job,&p1[0].b,&p2[0].b NJ2);
             }
-          if (!skip)
-            Z(calc_map2alm_spin) (cth.b,sth.b,gen,job,&p1[0].b,&p2[0].b NJ2);
+          gen->lmax=lmax;
           }
         }
       break;
@@ -31,14 +31,18 @@
  */
 
 #include <math.h>
+#include <string.h>
 #include "sharp_geomhelpers.h"
 #include "sharp_legendre_roots.h"
+#include "sharp_legendre.h"
+#include "sharp_internal.h"
 #include "c_utils.h"
 #include "ls_fft.h"
 #include <stdio.h>
 
-void sharp_make_subset_healpix_geom_info (int nside, int stride, int nrings,
-  const int *rings, const double *weight, sharp_geom_info **geom_info)
+static void make_healpix_geom_info (int nside, int stride, int nrings,
+  const int *rings, const double *weight, int nested,
+  sharp_geom_info **geom_info)
   {
   const double pi=3.141592653589793238462643383279502884197;
   ptrdiff_t npix=(ptrdiff_t)nside*nside*12;
@@ -83,15 +87,31 @@ void sharp_make_subset_healpix_geom_info (int nside, int stride, int nrings,
       ofs[m] = curofs;
       }
     weight_[m]=4.*pi/npix*((weight==NULL) ? 1. : weight[northring-1]);
-    if (rings==NULL) {
+    if ((rings==NULL)&&(!nested)) {
         UTIL_ASSERT(curofs==checkofs, "Bug in computing ofs[m]");
     }
-    ofs[m] = curofs;
+    ofs[m] = nested ? m : curofs; /* NESTED: remember the ring for now */
     curofs+=nph[m];
     }
 
-  sharp_make_geom_info (nrings, nph, ofs, stride_, phi0, theta, weight_,
-    geom_info);
+  if ((rings==NULL)&&(nrings==4*nside-1))
+    sharp_make_ordered_geom_info (nrings, nph, ofs, stride_, phi0, theta,
+      weight_, geom_info);
+  else
+    sharp_make_geom_info (nrings, nph, ofs, stride_, phi0, theta, weight_,
+      geom_info);
+
+  if (nested)
+    for (int i=0; i<(*geom_info)->npairs; ++i)
+      for (int r=0; r<2; ++r)
+        {
+        sharp_ringinfo *ri = r ? &(*geom_info)->pair[i].r2
+                               : &(*geom_info)->pair[i].r1;
+        if (ri->nph<0) continue;
+        ri->nest_ring = (rings==NULL) ? (int)ri->ofs+1 : rings[ri->ofs];
+        ri->nest_nside = nside;
+        ri->ofs = 0;
+        }
 
   DEALLOC(theta);
   DEALLOC(weight_);
@@ -101,12 +121,132 @@ void sharp_make_subset_healpix_geom_info (int nside, int stride, int nrings,
   DEALLOC(stride_);
   }
 
+void sharp_make_subset_healpix_geom_info (int nside, int stride, int nrings,
+  const int *rings, const double *weight, sharp_geom_info **geom_info)
+  {
+  make_healpix_geom_info (nside, stride, nrings, rings, weight, 0, geom_info);
+  }
+
 void sharp_make_weighted_healpix_geom_info (int nside, int stride,
   const double *weight, sharp_geom_info **geom_info)
   {
   sharp_make_subset_healpix_geom_info(nside, stride, 4 * nside - 1, NULL, weight, geom_info);
   }
 
+void sharp_make_nested_healpix_geom_info (int nside, int stride,
+  const double *weight, sharp_geom_info **geom_info)
+  {
+  UTIL_ASSERT((nside>0)&&((nside&(nside-1))==0),
+    "NESTED ordering requires nside to be a power of 2");
+  make_healpix_geom_info (nside, stride, 4*nside-1, NULL, weight, 1,
+    geom_info);
+  }
+
+#ifndef NO_LEGENDRE
+
+/* The quadrature conditions for HEALPix ring weights: for even l<=lmax,
+   sqrt(2l+1) sum_i c_i v_i P_l(x_i) = delta_l0, where the sum runs over the
+   2*nside northern rings (the southern ones are mirrored, which makes all
+   odd-l conditions hold automatically), x_i=cos(theta_i) and c_i is the
+   fraction of all pixels lying in ring i and its mirror image. */
+typedef struct
+  {
+  ptrdiff_t lmax, nrings;
+  double *x, *c, *recfac, *sq, *tmp;
+  } ringweight_system;
+
+/* res = A*v (length lmax+1) */
+static void ringweight_apply (const ringweight_system *sys, double *v,
+  double *res)
+  {
+  sharp_legendre_transform_adjoint_batch (v, 0, 1, sys->c, sys->recfac,
+    sys->lmax, sys->x, res, 0, sys->nrings);
+  for (ptrdiff_t l=0; l<=sys->lmax; ++l)
+    res[l] = (l&1) ? 0. : res[l]*sys->sq[l];
+  }
+
+/* res = A^T*y (length nrings) */
+static void ringweight_apply_adjoint (const ringweight_system *sys,
+  const double *y, double *res)
+  {
+  for (ptrdiff_t l=0; l<=sys->lmax; ++l)
+    sys->tmp[l] = (l&1) ? 0. : y[l]*sys->sq[l];
+  sharp_legendre_transform_batch (sys->tmp, 0, 1, sys->recfac, sys->lmax,
+    sys->x, res, 0, sys->nrings);
+  for (ptrdiff_t i=0; i<sys->nrings; ++i)
+    res[i]*=sys->c[i];
+  }
+
+static double dotprod (const double *a, const double *b, ptrdiff_t n)
+  {
+  double res=0;
+  for (ptrdiff_t i=0; i<n; ++i) res+=a[i]*b[i];
+  return res;
+  }
+
+double sharp_healpix_ring_weights (int nside, int lmax, double *weight)
+  {
+  UTIL_ASSERT(nside>0,"nside must be positive");
+  UTIL_ASSERT(lmax>=0,"lmax must not be negative");
+  const double epsilon=1e-14;
+  const int itmax=10000;
+  ringweight_system sys;
+  ptrdiff_t nr=2*(ptrdiff_t)nside, nl=(ptrdiff_t)lmax+1;
+  double npix=12.*nside*nside;
+  sys.lmax=lmax;
+  sys.nrings=nr;
+  sys.x=RALLOC(double,nr);
+  sys.c=RALLOC(double,nr);
+  sys.recfac=RALLOC(double,nl+1);
+  sys.sq=RALLOC(double,nl);
+  sys.tmp=RALLOC(double,nl);
+  for (ptrdiff_t i=0; i<nr; ++i)
+    {
+    ptrdiff_t ring=i+1;
+    int nph = (ring<nside) ? 4*ring : 4*nside;
+    sys.x[i] = (ring<nside) ? 1.-ring*(double)ring/(3.*nside*nside)
+                            : (2*nside-ring)*(2./(3.*nside));
+    sys.c[i] = ((ring==nr) ? 1. : 2.)*nph/npix;
+    }
+  sharp_legendre_transform_recfac(sys.recfac,lmax);
+  for (ptrdiff_t l=0; l<nl; ++l)
+    sys.sq[l]=sqrt(2.*l+1.);
+
+  /* CGLS for the correction d to the unit weights, started from d=0, so
+     that an underdetermined system yields the minimum-norm correction */
+  double *d=RALLOC(double,nr), *p=RALLOC(double,nr), *s=RALLOC(double,nr),
+         *r=RALLOC(double,nl), *q=RALLOC(double,nl);
+  for (ptrdiff_t i=0; i<nr; ++i) { d[i]=0.; p[i]=1.; }
+  ringweight_apply(&sys,p,r);
+  for (ptrdiff_t l=0; l<nl; ++l) r[l]=((l==0) ? 1. : 0.)-r[l];
+  double rnorm0=sqrt(dotprod(r,r,nl)), rnorm=rnorm0;
+  ringweight_apply_adjoint(&sys,r,s);
+  memcpy(p,s,nr*sizeof(double));
+  double gamma=dotprod(s,s,nr), gamma0=gamma;
+  for (int it=0; (it<itmax)&&(rnorm>epsilon*rnorm0)
+                 &&(gamma>epsilon*epsilon*gamma0); ++it)
+    {
+    ringweight_apply(&sys,p,q);
+    double alpha=gamma/dotprod(q,q,nl);
+    for (ptrdiff_t i=0; i<nr; ++i) d[i]+=alpha*p[i];
+    for (ptrdiff_t l=0; l<nl; ++l) r[l]-=alpha*q[l];
+    rnorm=sqrt(dotprod(r,r,nl));
+    ringweight_apply_adjoint(&sys,r,s);
+    double gnew=dotprod(s,s,nr);
+    for (ptrdiff_t i=0; i<nr; ++i) p[i]=s[i]+(gnew/gamma)*p[i];
+    gamma=gnew;
+    }
+  for (ptrdiff_t i=0; i<nr; ++i)
+    weight[i]=1.+d[i];
+
+  DEALLOC(d); DEALLOC(p); DEALLOC(s); DEALLOC(r); DEALLOC(q);
+  DEALLOC(sys.x); DEALLOC(sys.c); DEALLOC(sys.recfac); DEALLOC(sys.sq);
+  DEALLOC(sys.tmp);
+  return rnorm;
+  }
+
+#endif
+
 void sharp_make_gauss_geom_info (int nrings, int nphi, double phi0,
   int stride_lon, int stride_lat, sharp_geom_info **geom_info)
   {
@@ -130,8 +270,8 @@ void sharp_make_gauss_geom_info (int nrings, int nphi, double phi0,
     weight[m]*=2*pi/nphi;
     }
 
-  sharp_make_geom_info (nrings, nph, ofs, stride_, phi0_, theta, weight,
-    geom_info);
+  sharp_make_ordered_geom_info (nrings, nph, ofs, stride_, phi0_, theta,
+    weight, geom_info);
 
   DEALLOC(theta);
   DEALLOC(weight);
@@ -141,6 +281,92 @@ void sharp_make_gauss_geom_info (int nrings, int nphi, double phi0,
   DEALLOC(stride_);
   }
 
+/* smallest n'>=n with only the prime factors 2, 3 and 5 */
+static int good_fft_size (int n)
+  {
+  if (n<=6) return n;
+  int bestfac=2*n;
+
+  for (int f2=1; f2<bestfac; f2*=2)
+    for (int f23=f2; f23<bestfac; f23*=3)
+      for (int f235=f23; f235<bestfac; f235*=5)
+        if (f235>=n) bestfac=f235;
+
+  return bestfac;
+  }
+
+/* Gauss-Legendre rings with nph[i] pixels in the i-th ring from the north
+   pole; the rings are stored one after another, from north to south. */
+static void make_reduced_gauss_geom_info (int nrings, const int *nph,
+  double phi0, int stride, sharp_geom_info **geom_info)
+  {
+  const double pi=3.141592653589793238462643383279502884197;
+
+  double *theta=RALLOC(double,nrings);
+  double *weight=RALLOC(double,nrings);
+  double *phi0_=RALLOC(double,nrings);
+  ptrdiff_t *ofs=RALLOC(ptrdiff_t,nrings);
+  int *stride_=RALLOC(int,nrings);
+
+  sharp_legendre_roots(nrings,theta,weight);
+  ptrdiff_t curofs=0;
+  for (int m=0; m<nrings; ++m)
+    {
+    theta[m] = acos(-theta[m]);
+    phi0_[m]=phi0;
+    ofs[m]=curofs*stride;
+    stride_[m]=stride;
+    weight[m]*=2*pi/nph[m];
+    curofs+=nph[m];
+    }
+
+  sharp_make_ordered_geom_info (nrings, nph, ofs, stride_, phi0_, theta,
+    weight, geom_info);
+
+  DEALLOC(theta);
+  DEALLOC(weight);
+  DEALLOC(phi0_);
+  DEALLOC(ofs);
+  DEALLOC(stride_);
+  }
+
+/* number of pixels needed in a ring at colatitude theta for band limit lmax */
+static int reduced_ring_length (int lmax, int spin, double theta)
+  { return good_fft_size(2*sharp_get_mlim(lmax,spin,sin(theta),cos(theta))+1); }
+
+void sharp_make_reduced_gauss_geom_info (int nrings, int nphi, int lmax,
+  int spin, double phi0, int stride, sharp_geom_info **geom_info)
+  {
+  double *x=RALLOC(double,nrings), *w=RALLOC(double,nrings);
+  int *nph=RALLOC(int,nrings);
+  sharp_legendre_roots(nrings,x,w);
+  for (int m=0; m<nrings; ++m)
+    nph[m]=IMIN(nphi,reduced_ring_length(lmax,spin,acos(-x[m])));
+  make_reduced_gauss_geom_info (nrings, nph, phi0, stride, geom_info);
+  DEALLOC(nph);
+  DEALLOC(w);
+  DEALLOC(x);
+  }
+
+void sharp_make_octahedral_geom_info (int nrings, int lmax, int spin,
+  double phi0, int stride, sharp_geom_info **geom_info)
+  {
+  double *x=RALLOC(double,nrings), *w=RALLOC(double,nrings);
+  int *nph=RALLOC(int,nrings);
+  sharp_legendre_roots(nrings,x,w);
+  for (int m=0; m<nrings; ++m)
+    {
+    int k=IMIN(m,nrings-1-m)+1; /* ring number counted from the nearer pole */
+    nph[m]=4*k+16;
+    if (lmax>=0)
+      nph[m]=IMAX(nph[m],reduced_ring_length(lmax,spin,acos(-x[m])));
+    }
+  make_reduced_gauss_geom_info (nrings, nph, phi0, stride, geom_info);
+  DEALLOC(nph);
+  DEALLOC(w);
+  DEALLOC(x);
+  }
+
 /* Weights from Waldvogel 2006: BIT Numerical Mathematics 46, p. 195 */
 void sharp_make_fejer1_geom_info (int nrings, int ppring, double phi0,
   int stride_lon, int stride_lat, sharp_geom_info **geom_info)
@@ -177,8 +403,8 @@ void sharp_make_fejer1_geom_info (int nrings, int ppring, double phi0,
     weight[m]=weight[nrings-1-m]=weight[m]*2*pi/(nrings*nph[m]);
     }
 
-  sharp_make_geom_info (nrings, nph, ofs, stride_, phi0_, theta, weight,
-    geom_info);
+  sharp_make_ordered_geom_info (nrings, nph, ofs, stride_, phi0_, theta,
+    weight, geom_info);
 
   DEALLOC(theta);
   DEALLOC(weight);
@@ -226,8 +452,8 @@ void sharp_make_cc_geom_info (int nrings, int ppring, double phi0,
     weight[m]=weight[nrings-1-m]=weight[m]*2*pi/(n*nph[m]);
     }
 
-  sharp_make_geom_info (nrings, nph, ofs, stride_, phi0_, theta, weight,
-    geom_info);
+  sharp_make_ordered_geom_info (nrings, nph, ofs, stride_, phi0_, theta,
+    weight, geom_info);
 
   DEALLOC(theta);
   DEALLOC(weight);
@@ -274,8 +500,8 @@ void sharp_make_fejer2_geom_info (int nrings, int ppring, double phi0,
     weight[m]=weight[nrings-1-m]=weight[m]*2*pi/(n*nph[m]);
     }
 
-  sharp_make_geom_info (nrings, nph, ofs, stride_, phi0_, theta, weight,
-    geom_info);
+  sharp_make_ordered_geom_info (nrings, nph, ofs, stride_, phi0_, theta,
+    weight, geom_info);
 
   DEALLOC(theta);
   DEALLOC(weight);
@@ -58,6 +58,37 @@ void sharp_make_subset_healpix_geom_info (int nside, int stride, int nrings,
 void sharp_make_weighted_healpix_geom_info (int nside, int stride,
   const double *weight, sharp_geom_info **geom_info);
 
+/*! Creates a geometry information describing a HEALPix map with an
+    Nside parameter \a nside in NESTED ordering, i.e. pixel \a p of the map
+    is the NESTED pixel \a p. The pixel indices are computed on the fly while
+    copying rings to and from the FFT buffers, so no reordering pass over the
+    map is needed. \a weight is used as in
+    sharp_make_weighted_healpix_geom_info().
+    \note \a nside must be a power of 2, and SHARP_NO_FFT is not supported.
+    \ingroup geominfogroup */
+void sharp_make_nested_healpix_geom_info (int nside, int stride,
+  const double *weight, sharp_geom_info **geom_info);
+
+#ifndef NO_LEGENDRE
+/*! Computes relative quadrature weights for the 2*\a nside northern rings of
+    a HEALPix map with Nside parameter \a nside and stores them in \a weight,
+    which must have 2*\a nside entries and can be passed directly to
+    sharp_make_weighted_healpix_geom_info(). The weights are the smallest
+    corrections to unit weights for which the quadrature integrates all
+    axisymmetric functions up to degree \a lmax exactly; analysing maps with
+    band limit L therefore calls for \a lmax=2*L. This replaces the weight
+    files distributed with HEALPix and works for any \a nside.
+    \note The conditions become ill-conditioned as \a lmax approaches
+      4*\a nside; keep \a lmax below about 3*\a nside.
+    \note The result depends only on \a nside and \a lmax, so callers
+      analysing many maps should compute it once and keep it. Each of the
+      conjugate gradient iterations costs O(\a nside*\a lmax) and is
+      parallelized with OpenMP.
+    \returns the remaining residual of the quadrature conditions.
+    \ingroup geominfogroup */
+double sharp_healpix_ring_weights (int nside, int lmax, double *weight);
+#endif
+
 /*! Creates a geometry information describing a HEALPix map with an
     Nside parameter \a nside.
     \ingroup geominfogroup */
@@ -75,6 +106,33 @@ static inline void sharp_make_healpix_geom_info (int nside, int stride,
 void sharp_make_gauss_geom_info (int nrings, int nphi, double phi0,
   int stride_lon, int stride_lat, sharp_geom_info **geom_info);
 
+/*! Creates a geometry information describing a reduced Gaussian map with
+    \a nrings iso-latitude rings at the Gauss-Legendre colatitudes. The
+    number of pixels in each ring is the smallest length with prime factors
+    2, 3 and 5 only that still holds 2*mlim+1 pixels, where mlim is the
+    highest m with non-negligible contributions at that colatitude for band
+    limit \a lmax and spin \a spin (see sharp_get_mlim()); it is capped at
+    \a nphi. For lmax~nrings this saves roughly 25-30% of the pixels (and FFT
+    work) compared to sharp_make_gauss_geom_info() at the same accuracy.
+    The azimuth of the first pixel in each ring is \a phi0 (in radians).
+    The rings are stored one after another from north to south; the index
+    difference between two adjacent pixels is \a stride.
+    \ingroup geominfogroup */
+void sharp_make_reduced_gauss_geom_info (int nrings, int nphi, int lmax,
+  int spin, double phi0, int stride, sharp_geom_info **geom_info);
+
+/*! Creates a geometry information describing an octahedral reduced Gaussian
+    map (the "O" grid used at ECMWF) with \a nrings iso-latitude rings at the
+    Gauss-Legendre colatitudes. The k-th ring counted from the nearer pole
+    has 4*k+16 pixels. If \a lmax>=0, rings that are too short for band limit
+    \a lmax and spin \a spin are lengthened as in
+    sharp_make_reduced_gauss_geom_info(); pass a negative \a lmax to get the
+    unmodified grid. The pixel layout is as for
+    sharp_make_reduced_gauss_geom_info().
+    \ingroup geominfogroup */
+void sharp_make_octahedral_geom_info (int nrings, int lmax, int spin,
+  double phi0, int stride, sharp_geom_info **geom_info);
+
 /*! Creates a geometry information describing an ECP map with \a nrings
     iso-latitude rings and \a nphi pixels per ring. The azimuth of the first
     pixel in each ring is \a phi0 (in radians). The index difference between
@@ -0,0 +1,279 @@
+/*
+ *  This file is part of libsharp.
+ *
+ *  libsharp is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libsharp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libsharp; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*! \file sharp_infoio.c
+ *  Hashing, comparison and serialization of geometry and a_lm information
+ *
+ *  Copyright (C) 2026 The libsharp developers
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include "sharp_lowlevel.h"
+#include "c_utils.h"
+
+/* The serialized form is a flat record in host byte order: a 16 byte header
+   (magic, version and two 32 bit integers), followed by 8 byte aligned
+   arrays. The hashes are 64 bit FNV-1a over exactly these bytes, so they are
+   independent of struct padding and of unused fields. */
+
+#define GEOM_MAGIC 0x49474853u /* "SHGI" */
+#define ALM_MAGIC  0x49414853u /* "SHAI" */
+#define INFOIO_VERSION 4u
+
+typedef struct
+  {
+  unsigned char *buf; /* may be NULL, in which case nothing is stored */
+  size_t pos;
+  uint64_t hash;
+  } infostream;
+
+static void stream_init (infostream *s, void *buf)
+  {
+  s->buf=buf;
+  s->pos=0;
+  s->hash=0xcbf29ce484222325ull;
+  }
+
+static void put (infostream *s, const void *data, size_t len)
+  {
+  const unsigned char *d=data;
+  if (s->buf) memcpy(s->buf+s->pos,d,len);
+  for (size_t i=0; i<len; ++i)
+    s->hash=(s->hash^d[i])*0x100000001b3ull;
+  s->pos+=len;
+  }
+
+static void put_u32 (infostream *s, uint32_t v) { put(s,&v,sizeof(v)); }
+static void put_i32 (infostream *s, int32_t v) { put(s,&v,sizeof(v)); }
+static void put_i64 (infostream *s, int64_t v) { put(s,&v,sizeof(v)); }
+static void put_f64 (infostream *s, double v) { put(s,&v,sizeof(v)); }
+
+#define RING_BYTES (6*8+8*4)
+
+static void put_ring (infostream *s, const sharp_ringinfo *ri)
+  {
+  if (ri->nph<0) /* missing partner ring; its other fields are undefined */
+    {
+    static const sharp_ringinfo empty = { 0, 0, 0, 0, 0, 0, -1, 0, 0, 0, 0, 0, -1 };
+    ri=&empty;
+    }
+  put_f64(s,ri->theta);
+  put_f64(s,ri->phi0);
+  put_f64(s,ri->weight);
+  put_f64(s,ri->cth);
+  put_f64(s,ri->sth);
+  put_i64(s,ri->ofs);
+  put_i32(s,ri->nph);
+  put_i32(s,ri->stride);
+  put_i32(s,ri->nest_nside);
+  put_i32(s,ri->nest_ring);
+  put_i32(s,ri->pix0);
+  put_i32(s,ri->npix);
+  put_i32(s,(ri->lmax<0) ? -1 : ri->lmax);
+  put_i32(s,0);
+  }
+
+static void put_geom (infostream *s, const sharp_geom_info *info)
+  {
+  put_u32(s,GEOM_MAGIC);
+  put_u32(s,INFOIO_VERSION);
+  put_i32(s,info->npairs);
+  put_i32(s,info->nphmax);
+  for (int i=0; i<info->npairs; ++i)
+    {
+    put_ring(s,&info->pair[i].r1);
+    put_ring(s,&info->pair[i].r2);
+    }
+  }
+
+static void put_alm (infostream *s, const sharp_alm_info *info)
+  {
+  put_u32(s,ALM_MAGIC);
+  put_u32(s,INFOIO_VERSION);
+  put_i32(s,info->lmax);
+  put_i32(s,info->nm);
+  put_i32(s,info->flags);
+  put_i32(s,0);
+  put_i64(s,info->stride);
+  for (int i=0; i<info->nm; ++i)
+    put_i64(s,info->mvstart[i]);
+  for (int i=0; i<info->nm; ++i)
+    put_i32(s,info->mval[i]);
+  if (info->nm&1) put_i32(s,0);
+  }
+
+unsigned long long sharp_geom_info_hash (const sharp_geom_info *info)
+  {
+  infostream s;
+  stream_init(&s,NULL);
+  put_geom(&s,info);
+  return s.hash;
+  }
+
+unsigned long long sharp_alm_info_hash (const sharp_alm_info *info)
+  {
+  infostream s;
+  stream_init(&s,NULL);
+  put_alm(&s,info);
+  return s.hash;
+  }
+
+size_t sharp_geom_info_serialize (const sharp_geom_info *info, void *buf)
+  {
+  if (buf==NULL) return 16+2*RING_BYTES*(size_t)info->npairs;
+  infostream s;
+  stream_init(&s,buf);
+  put_geom(&s,info);
+  return s.pos;
+  }
+
+size_t sharp_alm_info_serialize (const sharp_alm_info *info, void *buf)
+  {
+  if (buf==NULL) return 32+12*(size_t)info->nm+4*(size_t)(info->nm&1);
+  infostream s;
+  stream_init(&s,buf);
+  put_alm(&s,info);
+  return s.pos;
+  }
+
+static int ring_equal (const sharp_ringinfo *a, const sharp_ringinfo *b)
+  {
+  if ((a->nph<0)||(b->nph<0)) return (a->nph<0)&&(b->nph<0);
+  return (a->theta==b->theta) && (a->phi0==b->phi0) && (a->weight==b->weight)
+      && (a->cth==b->cth) && (a->sth==b->sth) && (a->ofs==b->ofs)
+      && (a->nph==b->nph) && (a->stride==b->stride)
+      && (a->nest_nside==b->nest_nside) && (a->nest_ring==b->nest_ring)
+      && (a->pix0==b->pix0) && (a->npix==b->npix)
+      && (IMAX(a->lmax,-1)==IMAX(b->lmax,-1));
+  }
+
+int sharp_geom_info_equal (const sharp_geom_info *a, const sharp_geom_info *b)
+  {
+  if ((a->npairs!=b->npairs)||(a->nphmax!=b->nphmax)) return 0;
+  for (int i=0; i<a->npairs; ++i)
+    if (!(ring_equal(&a->pair[i].r1,&b->pair[i].r1)
+        &&ring_equal(&a->pair[i].r2,&b->pair[i].r2)))
+      return 0;
+  return 1;
+  }
+
+int sharp_alm_info_equal (const sharp_alm_info *a, const sharp_alm_info *b)
+  {
+  if ((a->lmax!=b->lmax)||(a->nm!=b->nm)||(a->flags!=b->flags)
+    ||(a->stride!=b->stride)) return 0;
+  for (int i=0; i<a->nm; ++i)
+    if ((a->mval[i]!=b->mval[i])||(a->mvstart[i]!=b->mvstart[i])) return 0;
+  return 1;
+  }
+
+/* reads from a possibly unaligned buffer */
+static const unsigned char *get (const unsigned char *p, void *data,
+  size_t len)
+  { memcpy(data,p,len); return p+len; }
+
+static int check_header (const unsigned char *p, size_t size, uint32_t magic,
+  int32_t *n1, int32_t *n2)
+  {
+  uint32_t m, v;
+  if (size<16) return 0;
+  p=get(p,&m,4);
+  p=get(p,&v,4);
+  p=get(p,n1,4);
+  get(p,n2,4);
+  return (m==magic) && (v==INFOIO_VERSION);
+  }
+
+size_t sharp_geom_info_deserialize (const void *buf, size_t size,
+  sharp_geom_info **info)
+  {
+  const unsigned char *p=buf;
+  int32_t npairs, nphmax;
+  *info=NULL;
+  if (!check_header(p,size,GEOM_MAGIC,&npairs,&nphmax)) return 0;
+  size_t len=16+2*RING_BYTES*(size_t)npairs;
+  if ((npairs<0)||(size<len)) return 0;
+  p+=16;
+
+  sharp_geom_info *res=RALLOC(sharp_geom_info,1);
+  res->npairs=npairs;
+  res->nphmax=nphmax;
+  res->pair=RALLOC(sharp_ringpair,IMAX(npairs,1));
+  for (int i=0; i<2*npairs; ++i)
+    {
+    sharp_ringinfo *ri = (i&1) ? &res->pair[i>>1].r2 : &res->pair[i>>1].r1;
+    int64_t ofs;
+    int32_t nph, stride, nest_nside, nest_ring, pix0, npix, lmax;
+    p=get(p,&ri->theta,8);
+    p=get(p,&ri->phi0,8);
+    p=get(p,&ri->weight,8);
+    p=get(p,&ri->cth,8);
+    p=get(p,&ri->sth,8);
+    p=get(p,&ofs,8);
+    p=get(p,&nph,4);
+    p=get(p,&stride,4);
+    p=get(p,&nest_nside,4);
+    p=get(p,&nest_ring,4);
+    p=get(p,&pix0,4);
+    p=get(p,&npix,4);
+    p=get(p,&lmax,4)+4;
+    ri->ofs=ofs;
+    ri->nph=nph;
+    ri->stride=stride;
+    ri->nest_nside=nest_nside;
+    ri->nest_ring=nest_ring;
+    ri->pix0=pix0;
+    ri->npix=npix;
+    ri->lmax=lmax;
+    }
+  *info=res;
+  return len;
+  }
+
+size_t sharp_alm_info_deserialize (const void *buf, size_t size,
+  sharp_alm_info **info)
+  {
+  const unsigned char *p=buf;
+  int32_t lmax, nm, flags;
+  int64_t stride;
+  *info=NULL;
+  if (!check_header(p,size,ALM_MAGIC,&lmax,&nm)) return 0;
+  size_t len=32+12*(size_t)nm+4*(size_t)(nm&1);
+  if ((nm<0)||(lmax<0)||(size<len)) return 0;
+  p=get(p+16,&flags,4);
+  p=get(p+4,&stride,8);
+
+  ptrdiff_t *mvstart=RALLOC(ptrdiff_t,IMAX(nm,1));
+  int *mval=RALLOC(int,IMAX(nm,1));
+  for (int i=0; i<nm; ++i)
+    {
+    int64_t v;
+    p=get(p,&v,8);
+    mvstart[i]=v;
+    }
+  for (int i=0; i<nm; ++i)
+    {
+    int32_t v;
+    p=get(p,&v,4);
+    mval[i]=v;
+    }
+  sharp_make_general_alm_info (lmax, nm, (int)stride, mval, mvstart, flags, info);
+  DEALLOC(mval);
+  DEALLOC(mvstart);
+  return len;
+  }
@@ -1,4 +1,4 @@
-/* DO NOT EDIT. md5sum of source: a8c5c18a7a19c378187dbf461d12eb5c *//*
+/* DO NOT EDIT. md5sum of source: af60e9e524a41d78899f597310728df1 *//*
 
     NOTE NOTE NOTE
 
@@ -61,10 +61,28 @@
 #error (SHARP_LEGENDRE_CS > MAX_CS)
 #endif
 
+/* Chunk size (in vectors) of the Clenshaw kernels, which keep only two
+   recursion values per vector live and can therefore use larger chunks */
+#ifndef SHARP_LEGENDRE_CLENSHAW_CS
+#define SHARP_LEGENDRE_CLENSHAW_CS 8
+#endif
+
+#define MAX_CLENSHAW_CS 8
+#if (SHARP_LEGENDRE_CLENSHAW_CS > MAX_CLENSHAW_CS)
+#error (SHARP_LEGENDRE_CLENSHAW_CS > MAX_CLENSHAW_CS)
+#endif
+
+/* Number of P_l(x) values buffered per chunk in the batched kernels;
+   every b_l vector in the batch is then streamed against this block. */
+#ifndef SHARP_LEGENDRE_LBLOCK
+#define SHARP_LEGENDRE_LBLOCK 64
+#endif
+
 #include "sharp_legendre.h"
 #include "sharp_vecsupport.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 
 
@@ -1213,107 +1231,6366 @@ static void legendre_transform_vec6_s(float *recfacs, float *bl, ptrdiff_t lmax,
 
 
 
+/*
+  Clenshaw's backward summation of sum_l b_l P_l(x). With the recursion
+  written as P_l = alpha_l x P_{l-1} + gamma_l P_{l-2}, where
+  alpha_l = 1 + recfac[l] and gamma_l = -recfac[l],
 
-void sharp_legendre_transform_recfac(double *r, ptrdiff_t lmax) {
-    /* (l - 1) / l, for l >= 2 */
+    B_l = b_l + alpha_{l+1} x B_{l+1} + gamma_{l+2} B_{l+2},
+
+  and the result is B_0. The coefficients are passed interleaved in ag,
+  with ag[2l] = alpha_l and ag[2l+1] = gamma_l for 0 <= l <= lmax+2.
+ */
+
+
+static void legendre_transform_clenshaw_vec1(double *ag, double *bl, ptrdiff_t lmax,
+                                                       double xarr[(1) * VLEN],
+                                                       double out[(1) * VLEN]) {
+    
+    Tv B1_0, B2_0, x0;
+    
+    Tv A, G, b, W, Bn;
     ptrdiff_t l;
-    r[0] = 0;
-    r[1] = 1;
-    for (l = 2; l <= lmax; ++l) {
-        r[l] = (double)(l - 1) / (double)l;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    B1_0 = vload(0.0);
+    B2_0 = vload(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload(bl[l]);
+        A = vload(ag[2 * (l + 1)]);
+        G = vload(ag[2 * (l + 2) + 1]);
+        
+        W = vmul(x0, B1_0);
+        Bn = b;
+        vfmaeq(Bn, B2_0, G);
+        vfmaeq(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
     }
+    
+    vstoreu(out + 0 * VLEN, B1_0);
+    
 }
 
-void sharp_legendre_transform_recfac_s(float *r, ptrdiff_t lmax) {
-    /* (l - 1) / l, for l >= 2 */
+static void legendre_transform_clenshaw_vec2(double *ag, double *bl, ptrdiff_t lmax,
+                                                       double xarr[(2) * VLEN],
+                                                       double out[(2) * VLEN]) {
+    
+    Tv B1_0, B2_0, x0;
+    
+    Tv B1_1, B2_1, x1;
+    
+    Tv A, G, b, W, Bn;
     ptrdiff_t l;
-    r[0] = 0;
-    r[1] = 1;
-    for (l = 2; l <= lmax; ++l) {
-        r[l] = (float)(l - 1) / (float)l;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    B1_0 = vload(0.0);
+    B2_0 = vload(0.0);
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    B1_1 = vload(0.0);
+    B2_1 = vload(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload(bl[l]);
+        A = vload(ag[2 * (l + 1)]);
+        G = vload(ag[2 * (l + 2) + 1]);
+        
+        W = vmul(x0, B1_0);
+        Bn = b;
+        vfmaeq(Bn, B2_0, G);
+        vfmaeq(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul(x1, B1_1);
+        Bn = b;
+        vfmaeq(Bn, B2_1, G);
+        vfmaeq(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
     }
+    
+    vstoreu(out + 0 * VLEN, B1_0);
+    
+    vstoreu(out + 1 * VLEN, B1_1);
+    
 }
 
+static void legendre_transform_clenshaw_vec3(double *ag, double *bl, ptrdiff_t lmax,
+                                                       double xarr[(3) * VLEN],
+                                                       double out[(3) * VLEN]) {
+    
+    Tv B1_0, B2_0, x0;
+    
+    Tv B1_1, B2_1, x1;
+    
+    Tv B1_2, B2_2, x2;
+    
+    Tv A, G, b, W, Bn;
+    ptrdiff_t l;
 
-/*
-  Compute sum_l b_l P_l(x_i) for all i. 
- */
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    B1_0 = vload(0.0);
+    B2_0 = vload(0.0);
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    B1_1 = vload(0.0);
+    B2_1 = vload(0.0);
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    B1_2 = vload(0.0);
+    B2_2 = vload(0.0);
+    
 
-#define LEN (SHARP_LEGENDRE_CS * VLEN)
-#define LEN_s (SHARP_LEGENDRE_CS * VLEN_s)
+    for (l = lmax; l >= 0; --l) {
+        b = vload(bl[l]);
+        A = vload(ag[2 * (l + 1)]);
+        G = vload(ag[2 * (l + 2) + 1]);
+        
+        W = vmul(x0, B1_0);
+        Bn = b;
+        vfmaeq(Bn, B2_0, G);
+        vfmaeq(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul(x1, B1_1);
+        Bn = b;
+        vfmaeq(Bn, B2_1, G);
+        vfmaeq(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul(x2, B1_2);
+        Bn = b;
+        vfmaeq(Bn, B2_2, G);
+        vfmaeq(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+    }
+    
+    vstoreu(out + 0 * VLEN, B1_0);
+    
+    vstoreu(out + 1 * VLEN, B1_1);
+    
+    vstoreu(out + 2 * VLEN, B1_2);
+    
+}
 
+static void legendre_transform_clenshaw_vec4(double *ag, double *bl, ptrdiff_t lmax,
+                                                       double xarr[(4) * VLEN],
+                                                       double out[(4) * VLEN]) {
+    
+    Tv B1_0, B2_0, x0;
+    
+    Tv B1_1, B2_1, x1;
+    
+    Tv B1_2, B2_2, x2;
+    
+    Tv B1_3, B2_3, x3;
+    
+    Tv A, G, b, W, Bn;
+    ptrdiff_t l;
 
-void sharp_legendre_transform(double *bl,
-                                   double *recfac,
-                                   ptrdiff_t lmax,
-                                   double *x, double *out, ptrdiff_t nx) {
-    double xchunk[MAX_CS * VLEN], outchunk[MAX_CS * LEN];
-    int compute_recfac;
-    ptrdiff_t i, j, len;
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    B1_0 = vload(0.0);
+    B2_0 = vload(0.0);
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    B1_1 = vload(0.0);
+    B2_1 = vload(0.0);
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    B1_2 = vload(0.0);
+    B2_2 = vload(0.0);
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    B1_3 = vload(0.0);
+    B2_3 = vload(0.0);
+    
 
-    compute_recfac = (recfac == NULL);
-    if (compute_recfac) {
-        recfac = malloc(sizeof(double) * (lmax + 1));
-        sharp_legendre_transform_recfac(recfac, lmax);
+    for (l = lmax; l >= 0; --l) {
+        b = vload(bl[l]);
+        A = vload(ag[2 * (l + 1)]);
+        G = vload(ag[2 * (l + 2) + 1]);
+        
+        W = vmul(x0, B1_0);
+        Bn = b;
+        vfmaeq(Bn, B2_0, G);
+        vfmaeq(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul(x1, B1_1);
+        Bn = b;
+        vfmaeq(Bn, B2_1, G);
+        vfmaeq(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul(x2, B1_2);
+        Bn = b;
+        vfmaeq(Bn, B2_2, G);
+        vfmaeq(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+        W = vmul(x3, B1_3);
+        Bn = b;
+        vfmaeq(Bn, B2_3, G);
+        vfmaeq(Bn, W, A);
+        B2_3 = B1_3;
+        B1_3 = Bn;
+        
     }
+    
+    vstoreu(out + 0 * VLEN, B1_0);
+    
+    vstoreu(out + 1 * VLEN, B1_1);
+    
+    vstoreu(out + 2 * VLEN, B1_2);
+    
+    vstoreu(out + 3 * VLEN, B1_3);
+    
+}
 
-    for (j = 0; j != LEN; ++j) xchunk[j] = 0;
+static void legendre_transform_clenshaw_vec5(double *ag, double *bl, ptrdiff_t lmax,
+                                                       double xarr[(5) * VLEN],
+                                                       double out[(5) * VLEN]) {
+    
+    Tv B1_0, B2_0, x0;
+    
+    Tv B1_1, B2_1, x1;
+    
+    Tv B1_2, B2_2, x2;
+    
+    Tv B1_3, B2_3, x3;
+    
+    Tv B1_4, B2_4, x4;
+    
+    Tv A, G, b, W, Bn;
+    ptrdiff_t l;
 
-    for (i = 0; i < nx; i += LEN) {
-        len = (i + (LEN) <= nx) ? (LEN) : (nx - i);
-        for (j = 0; j != len; ++j) xchunk[j] = x[i + j];
-        switch ((len + VLEN - 1) / VLEN) {
-          case 6: legendre_transform_vec6(recfac, bl, lmax, xchunk, outchunk); break;
-          case 5: legendre_transform_vec5(recfac, bl, lmax, xchunk, outchunk); break;
-          case 4: legendre_transform_vec4(recfac, bl, lmax, xchunk, outchunk); break;
-          case 3: legendre_transform_vec3(recfac, bl, lmax, xchunk, outchunk); break;
-          case 2: legendre_transform_vec2(recfac, bl, lmax, xchunk, outchunk); break;
-          case 1:
-          case 0:
-              legendre_transform_vec1(recfac, bl, lmax, xchunk, outchunk); break;
-        }
-        for (j = 0; j != len; ++j) out[i + j] = outchunk[j];
-    }
-    if (compute_recfac) {
-        free(recfac);
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    B1_0 = vload(0.0);
+    B2_0 = vload(0.0);
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    B1_1 = vload(0.0);
+    B2_1 = vload(0.0);
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    B1_2 = vload(0.0);
+    B2_2 = vload(0.0);
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    B1_3 = vload(0.0);
+    B2_3 = vload(0.0);
+    
+    x4 = vloadu(xarr + 4 * VLEN);
+    B1_4 = vload(0.0);
+    B2_4 = vload(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload(bl[l]);
+        A = vload(ag[2 * (l + 1)]);
+        G = vload(ag[2 * (l + 2) + 1]);
+        
+        W = vmul(x0, B1_0);
+        Bn = b;
+        vfmaeq(Bn, B2_0, G);
+        vfmaeq(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul(x1, B1_1);
+        Bn = b;
+        vfmaeq(Bn, B2_1, G);
+        vfmaeq(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul(x2, B1_2);
+        Bn = b;
+        vfmaeq(Bn, B2_2, G);
+        vfmaeq(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+        W = vmul(x3, B1_3);
+        Bn = b;
+        vfmaeq(Bn, B2_3, G);
+        vfmaeq(Bn, W, A);
+        B2_3 = B1_3;
+        B1_3 = Bn;
+        
+        W = vmul(x4, B1_4);
+        Bn = b;
+        vfmaeq(Bn, B2_4, G);
+        vfmaeq(Bn, W, A);
+        B2_4 = B1_4;
+        B1_4 = Bn;
+        
     }
+    
+    vstoreu(out + 0 * VLEN, B1_0);
+    
+    vstoreu(out + 1 * VLEN, B1_1);
+    
+    vstoreu(out + 2 * VLEN, B1_2);
+    
+    vstoreu(out + 3 * VLEN, B1_3);
+    
+    vstoreu(out + 4 * VLEN, B1_4);
+    
 }
 
-void sharp_legendre_transform_s(float *bl,
-                                   float *recfac,
-                                   ptrdiff_t lmax,
-                                   float *x, float *out, ptrdiff_t nx) {
-    float xchunk[MAX_CS * VLEN_s], outchunk[MAX_CS * LEN_s];
-    int compute_recfac;
-    ptrdiff_t i, j, len;
-
-    compute_recfac = (recfac == NULL);
-    if (compute_recfac) {
-        recfac = malloc(sizeof(float) * (lmax + 1));
-        sharp_legendre_transform_recfac_s(recfac, lmax);
-    }
+static void legendre_transform_clenshaw_vec6(double *ag, double *bl, ptrdiff_t lmax,
+                                                       double xarr[(6) * VLEN],
+                                                       double out[(6) * VLEN]) {
+    
+    Tv B1_0, B2_0, x0;
+    
+    Tv B1_1, B2_1, x1;
+    
+    Tv B1_2, B2_2, x2;
+    
+    Tv B1_3, B2_3, x3;
+    
+    Tv B1_4, B2_4, x4;
+    
+    Tv B1_5, B2_5, x5;
+    
+    Tv A, G, b, W, Bn;
+    ptrdiff_t l;
 
-    for (j = 0; j != LEN_s; ++j) xchunk[j] = 0;
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    B1_0 = vload(0.0);
+    B2_0 = vload(0.0);
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    B1_1 = vload(0.0);
+    B2_1 = vload(0.0);
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    B1_2 = vload(0.0);
+    B2_2 = vload(0.0);
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    B1_3 = vload(0.0);
+    B2_3 = vload(0.0);
+    
+    x4 = vloadu(xarr + 4 * VLEN);
+    B1_4 = vload(0.0);
+    B2_4 = vload(0.0);
+    
+    x5 = vloadu(xarr + 5 * VLEN);
+    B1_5 = vload(0.0);
+    B2_5 = vload(0.0);
+    
 
-    for (i = 0; i < nx; i += LEN_s) {
-        len = (i + (LEN_s) <= nx) ? (LEN_s) : (nx - i);
-        for (j = 0; j != len; ++j) xchunk[j] = x[i + j];
-        switch ((len + VLEN_s - 1) / VLEN_s) {
-          case 6: legendre_transform_vec6_s(recfac, bl, lmax, xchunk, outchunk); break;
-          case 5: legendre_transform_vec5_s(recfac, bl, lmax, xchunk, outchunk); break;
-          case 4: legendre_transform_vec4_s(recfac, bl, lmax, xchunk, outchunk); break;
-          case 3: legendre_transform_vec3_s(recfac, bl, lmax, xchunk, outchunk); break;
-          case 2: legendre_transform_vec2_s(recfac, bl, lmax, xchunk, outchunk); break;
-          case 1:
-          case 0:
-              legendre_transform_vec1_s(recfac, bl, lmax, xchunk, outchunk); break;
-        }
-        for (j = 0; j != len; ++j) out[i + j] = outchunk[j];
-    }
-    if (compute_recfac) {
-        free(recfac);
+    for (l = lmax; l >= 0; --l) {
+        b = vload(bl[l]);
+        A = vload(ag[2 * (l + 1)]);
+        G = vload(ag[2 * (l + 2) + 1]);
+        
+        W = vmul(x0, B1_0);
+        Bn = b;
+        vfmaeq(Bn, B2_0, G);
+        vfmaeq(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul(x1, B1_1);
+        Bn = b;
+        vfmaeq(Bn, B2_1, G);
+        vfmaeq(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul(x2, B1_2);
+        Bn = b;
+        vfmaeq(Bn, B2_2, G);
+        vfmaeq(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+        W = vmul(x3, B1_3);
+        Bn = b;
+        vfmaeq(Bn, B2_3, G);
+        vfmaeq(Bn, W, A);
+        B2_3 = B1_3;
+        B1_3 = Bn;
+        
+        W = vmul(x4, B1_4);
+        Bn = b;
+        vfmaeq(Bn, B2_4, G);
+        vfmaeq(Bn, W, A);
+        B2_4 = B1_4;
+        B1_4 = Bn;
+        
+        W = vmul(x5, B1_5);
+        Bn = b;
+        vfmaeq(Bn, B2_5, G);
+        vfmaeq(Bn, W, A);
+        B2_5 = B1_5;
+        B1_5 = Bn;
+        
     }
+    
+    vstoreu(out + 0 * VLEN, B1_0);
+    
+    vstoreu(out + 1 * VLEN, B1_1);
+    
+    vstoreu(out + 2 * VLEN, B1_2);
+    
+    vstoreu(out + 3 * VLEN, B1_3);
+    
+    vstoreu(out + 4 * VLEN, B1_4);
+    
+    vstoreu(out + 5 * VLEN, B1_5);
+    
 }
 
+static void legendre_transform_clenshaw_vec7(double *ag, double *bl, ptrdiff_t lmax,
+                                                       double xarr[(7) * VLEN],
+                                                       double out[(7) * VLEN]) {
+    
+    Tv B1_0, B2_0, x0;
+    
+    Tv B1_1, B2_1, x1;
+    
+    Tv B1_2, B2_2, x2;
+    
+    Tv B1_3, B2_3, x3;
+    
+    Tv B1_4, B2_4, x4;
+    
+    Tv B1_5, B2_5, x5;
+    
+    Tv B1_6, B2_6, x6;
+    
+    Tv A, G, b, W, Bn;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    B1_0 = vload(0.0);
+    B2_0 = vload(0.0);
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    B1_1 = vload(0.0);
+    B2_1 = vload(0.0);
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    B1_2 = vload(0.0);
+    B2_2 = vload(0.0);
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    B1_3 = vload(0.0);
+    B2_3 = vload(0.0);
+    
+    x4 = vloadu(xarr + 4 * VLEN);
+    B1_4 = vload(0.0);
+    B2_4 = vload(0.0);
+    
+    x5 = vloadu(xarr + 5 * VLEN);
+    B1_5 = vload(0.0);
+    B2_5 = vload(0.0);
+    
+    x6 = vloadu(xarr + 6 * VLEN);
+    B1_6 = vload(0.0);
+    B2_6 = vload(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload(bl[l]);
+        A = vload(ag[2 * (l + 1)]);
+        G = vload(ag[2 * (l + 2) + 1]);
+        
+        W = vmul(x0, B1_0);
+        Bn = b;
+        vfmaeq(Bn, B2_0, G);
+        vfmaeq(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul(x1, B1_1);
+        Bn = b;
+        vfmaeq(Bn, B2_1, G);
+        vfmaeq(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul(x2, B1_2);
+        Bn = b;
+        vfmaeq(Bn, B2_2, G);
+        vfmaeq(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+        W = vmul(x3, B1_3);
+        Bn = b;
+        vfmaeq(Bn, B2_3, G);
+        vfmaeq(Bn, W, A);
+        B2_3 = B1_3;
+        B1_3 = Bn;
+        
+        W = vmul(x4, B1_4);
+        Bn = b;
+        vfmaeq(Bn, B2_4, G);
+        vfmaeq(Bn, W, A);
+        B2_4 = B1_4;
+        B1_4 = Bn;
+        
+        W = vmul(x5, B1_5);
+        Bn = b;
+        vfmaeq(Bn, B2_5, G);
+        vfmaeq(Bn, W, A);
+        B2_5 = B1_5;
+        B1_5 = Bn;
+        
+        W = vmul(x6, B1_6);
+        Bn = b;
+        vfmaeq(Bn, B2_6, G);
+        vfmaeq(Bn, W, A);
+        B2_6 = B1_6;
+        B1_6 = Bn;
+        
+    }
+    
+    vstoreu(out + 0 * VLEN, B1_0);
+    
+    vstoreu(out + 1 * VLEN, B1_1);
+    
+    vstoreu(out + 2 * VLEN, B1_2);
+    
+    vstoreu(out + 3 * VLEN, B1_3);
+    
+    vstoreu(out + 4 * VLEN, B1_4);
+    
+    vstoreu(out + 5 * VLEN, B1_5);
+    
+    vstoreu(out + 6 * VLEN, B1_6);
+    
+}
+
+static void legendre_transform_clenshaw_vec8(double *ag, double *bl, ptrdiff_t lmax,
+                                                       double xarr[(8) * VLEN],
+                                                       double out[(8) * VLEN]) {
+    
+    Tv B1_0, B2_0, x0;
+    
+    Tv B1_1, B2_1, x1;
+    
+    Tv B1_2, B2_2, x2;
+    
+    Tv B1_3, B2_3, x3;
+    
+    Tv B1_4, B2_4, x4;
+    
+    Tv B1_5, B2_5, x5;
+    
+    Tv B1_6, B2_6, x6;
+    
+    Tv B1_7, B2_7, x7;
+    
+    Tv A, G, b, W, Bn;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    B1_0 = vload(0.0);
+    B2_0 = vload(0.0);
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    B1_1 = vload(0.0);
+    B2_1 = vload(0.0);
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    B1_2 = vload(0.0);
+    B2_2 = vload(0.0);
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    B1_3 = vload(0.0);
+    B2_3 = vload(0.0);
+    
+    x4 = vloadu(xarr + 4 * VLEN);
+    B1_4 = vload(0.0);
+    B2_4 = vload(0.0);
+    
+    x5 = vloadu(xarr + 5 * VLEN);
+    B1_5 = vload(0.0);
+    B2_5 = vload(0.0);
+    
+    x6 = vloadu(xarr + 6 * VLEN);
+    B1_6 = vload(0.0);
+    B2_6 = vload(0.0);
+    
+    x7 = vloadu(xarr + 7 * VLEN);
+    B1_7 = vload(0.0);
+    B2_7 = vload(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload(bl[l]);
+        A = vload(ag[2 * (l + 1)]);
+        G = vload(ag[2 * (l + 2) + 1]);
+        
+        W = vmul(x0, B1_0);
+        Bn = b;
+        vfmaeq(Bn, B2_0, G);
+        vfmaeq(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul(x1, B1_1);
+        Bn = b;
+        vfmaeq(Bn, B2_1, G);
+        vfmaeq(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul(x2, B1_2);
+        Bn = b;
+        vfmaeq(Bn, B2_2, G);
+        vfmaeq(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+        W = vmul(x3, B1_3);
+        Bn = b;
+        vfmaeq(Bn, B2_3, G);
+        vfmaeq(Bn, W, A);
+        B2_3 = B1_3;
+        B1_3 = Bn;
+        
+        W = vmul(x4, B1_4);
+        Bn = b;
+        vfmaeq(Bn, B2_4, G);
+        vfmaeq(Bn, W, A);
+        B2_4 = B1_4;
+        B1_4 = Bn;
+        
+        W = vmul(x5, B1_5);
+        Bn = b;
+        vfmaeq(Bn, B2_5, G);
+        vfmaeq(Bn, W, A);
+        B2_5 = B1_5;
+        B1_5 = Bn;
+        
+        W = vmul(x6, B1_6);
+        Bn = b;
+        vfmaeq(Bn, B2_6, G);
+        vfmaeq(Bn, W, A);
+        B2_6 = B1_6;
+        B1_6 = Bn;
+        
+        W = vmul(x7, B1_7);
+        Bn = b;
+        vfmaeq(Bn, B2_7, G);
+        vfmaeq(Bn, W, A);
+        B2_7 = B1_7;
+        B1_7 = Bn;
+        
+    }
+    
+    vstoreu(out + 0 * VLEN, B1_0);
+    
+    vstoreu(out + 1 * VLEN, B1_1);
+    
+    vstoreu(out + 2 * VLEN, B1_2);
+    
+    vstoreu(out + 3 * VLEN, B1_3);
+    
+    vstoreu(out + 4 * VLEN, B1_4);
+    
+    vstoreu(out + 5 * VLEN, B1_5);
+    
+    vstoreu(out + 6 * VLEN, B1_6);
+    
+    vstoreu(out + 7 * VLEN, B1_7);
+    
+}
+
+
+
+static void legendre_transform_clenshaw_vec1_s(float *ag, float *bl, ptrdiff_t lmax,
+                                                       float xarr[(1) * VLEN_s],
+                                                       float out[(1) * VLEN_s]) {
+    
+    Tv_s B1_0, B2_0, x0;
+    
+    Tv_s A, G, b, W, Bn;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    B1_0 = vload_s(0.0);
+    B2_0 = vload_s(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload_s(bl[l]);
+        A = vload_s(ag[2 * (l + 1)]);
+        G = vload_s(ag[2 * (l + 2) + 1]);
+        
+        W = vmul_s(x0, B1_0);
+        Bn = b;
+        vfmaeq_s(Bn, B2_0, G);
+        vfmaeq_s(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+    }
+    
+    vstoreu_s(out + 0 * VLEN_s, B1_0);
+    
+}
+
+static void legendre_transform_clenshaw_vec2_s(float *ag, float *bl, ptrdiff_t lmax,
+                                                       float xarr[(2) * VLEN_s],
+                                                       float out[(2) * VLEN_s]) {
+    
+    Tv_s B1_0, B2_0, x0;
+    
+    Tv_s B1_1, B2_1, x1;
+    
+    Tv_s A, G, b, W, Bn;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    B1_0 = vload_s(0.0);
+    B2_0 = vload_s(0.0);
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    B1_1 = vload_s(0.0);
+    B2_1 = vload_s(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload_s(bl[l]);
+        A = vload_s(ag[2 * (l + 1)]);
+        G = vload_s(ag[2 * (l + 2) + 1]);
+        
+        W = vmul_s(x0, B1_0);
+        Bn = b;
+        vfmaeq_s(Bn, B2_0, G);
+        vfmaeq_s(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul_s(x1, B1_1);
+        Bn = b;
+        vfmaeq_s(Bn, B2_1, G);
+        vfmaeq_s(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+    }
+    
+    vstoreu_s(out + 0 * VLEN_s, B1_0);
+    
+    vstoreu_s(out + 1 * VLEN_s, B1_1);
+    
+}
+
+static void legendre_transform_clenshaw_vec3_s(float *ag, float *bl, ptrdiff_t lmax,
+                                                       float xarr[(3) * VLEN_s],
+                                                       float out[(3) * VLEN_s]) {
+    
+    Tv_s B1_0, B2_0, x0;
+    
+    Tv_s B1_1, B2_1, x1;
+    
+    Tv_s B1_2, B2_2, x2;
+    
+    Tv_s A, G, b, W, Bn;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    B1_0 = vload_s(0.0);
+    B2_0 = vload_s(0.0);
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    B1_1 = vload_s(0.0);
+    B2_1 = vload_s(0.0);
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    B1_2 = vload_s(0.0);
+    B2_2 = vload_s(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload_s(bl[l]);
+        A = vload_s(ag[2 * (l + 1)]);
+        G = vload_s(ag[2 * (l + 2) + 1]);
+        
+        W = vmul_s(x0, B1_0);
+        Bn = b;
+        vfmaeq_s(Bn, B2_0, G);
+        vfmaeq_s(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul_s(x1, B1_1);
+        Bn = b;
+        vfmaeq_s(Bn, B2_1, G);
+        vfmaeq_s(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul_s(x2, B1_2);
+        Bn = b;
+        vfmaeq_s(Bn, B2_2, G);
+        vfmaeq_s(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+    }
+    
+    vstoreu_s(out + 0 * VLEN_s, B1_0);
+    
+    vstoreu_s(out + 1 * VLEN_s, B1_1);
+    
+    vstoreu_s(out + 2 * VLEN_s, B1_2);
+    
+}
+
+static void legendre_transform_clenshaw_vec4_s(float *ag, float *bl, ptrdiff_t lmax,
+                                                       float xarr[(4) * VLEN_s],
+                                                       float out[(4) * VLEN_s]) {
+    
+    Tv_s B1_0, B2_0, x0;
+    
+    Tv_s B1_1, B2_1, x1;
+    
+    Tv_s B1_2, B2_2, x2;
+    
+    Tv_s B1_3, B2_3, x3;
+    
+    Tv_s A, G, b, W, Bn;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    B1_0 = vload_s(0.0);
+    B2_0 = vload_s(0.0);
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    B1_1 = vload_s(0.0);
+    B2_1 = vload_s(0.0);
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    B1_2 = vload_s(0.0);
+    B2_2 = vload_s(0.0);
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    B1_3 = vload_s(0.0);
+    B2_3 = vload_s(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload_s(bl[l]);
+        A = vload_s(ag[2 * (l + 1)]);
+        G = vload_s(ag[2 * (l + 2) + 1]);
+        
+        W = vmul_s(x0, B1_0);
+        Bn = b;
+        vfmaeq_s(Bn, B2_0, G);
+        vfmaeq_s(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul_s(x1, B1_1);
+        Bn = b;
+        vfmaeq_s(Bn, B2_1, G);
+        vfmaeq_s(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul_s(x2, B1_2);
+        Bn = b;
+        vfmaeq_s(Bn, B2_2, G);
+        vfmaeq_s(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+        W = vmul_s(x3, B1_3);
+        Bn = b;
+        vfmaeq_s(Bn, B2_3, G);
+        vfmaeq_s(Bn, W, A);
+        B2_3 = B1_3;
+        B1_3 = Bn;
+        
+    }
+    
+    vstoreu_s(out + 0 * VLEN_s, B1_0);
+    
+    vstoreu_s(out + 1 * VLEN_s, B1_1);
+    
+    vstoreu_s(out + 2 * VLEN_s, B1_2);
+    
+    vstoreu_s(out + 3 * VLEN_s, B1_3);
+    
+}
+
+static void legendre_transform_clenshaw_vec5_s(float *ag, float *bl, ptrdiff_t lmax,
+                                                       float xarr[(5) * VLEN_s],
+                                                       float out[(5) * VLEN_s]) {
+    
+    Tv_s B1_0, B2_0, x0;
+    
+    Tv_s B1_1, B2_1, x1;
+    
+    Tv_s B1_2, B2_2, x2;
+    
+    Tv_s B1_3, B2_3, x3;
+    
+    Tv_s B1_4, B2_4, x4;
+    
+    Tv_s A, G, b, W, Bn;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    B1_0 = vload_s(0.0);
+    B2_0 = vload_s(0.0);
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    B1_1 = vload_s(0.0);
+    B2_1 = vload_s(0.0);
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    B1_2 = vload_s(0.0);
+    B2_2 = vload_s(0.0);
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    B1_3 = vload_s(0.0);
+    B2_3 = vload_s(0.0);
+    
+    x4 = vloadu_s(xarr + 4 * VLEN_s);
+    B1_4 = vload_s(0.0);
+    B2_4 = vload_s(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload_s(bl[l]);
+        A = vload_s(ag[2 * (l + 1)]);
+        G = vload_s(ag[2 * (l + 2) + 1]);
+        
+        W = vmul_s(x0, B1_0);
+        Bn = b;
+        vfmaeq_s(Bn, B2_0, G);
+        vfmaeq_s(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul_s(x1, B1_1);
+        Bn = b;
+        vfmaeq_s(Bn, B2_1, G);
+        vfmaeq_s(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul_s(x2, B1_2);
+        Bn = b;
+        vfmaeq_s(Bn, B2_2, G);
+        vfmaeq_s(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+        W = vmul_s(x3, B1_3);
+        Bn = b;
+        vfmaeq_s(Bn, B2_3, G);
+        vfmaeq_s(Bn, W, A);
+        B2_3 = B1_3;
+        B1_3 = Bn;
+        
+        W = vmul_s(x4, B1_4);
+        Bn = b;
+        vfmaeq_s(Bn, B2_4, G);
+        vfmaeq_s(Bn, W, A);
+        B2_4 = B1_4;
+        B1_4 = Bn;
+        
+    }
+    
+    vstoreu_s(out + 0 * VLEN_s, B1_0);
+    
+    vstoreu_s(out + 1 * VLEN_s, B1_1);
+    
+    vstoreu_s(out + 2 * VLEN_s, B1_2);
+    
+    vstoreu_s(out + 3 * VLEN_s, B1_3);
+    
+    vstoreu_s(out + 4 * VLEN_s, B1_4);
+    
+}
+
+static void legendre_transform_clenshaw_vec6_s(float *ag, float *bl, ptrdiff_t lmax,
+                                                       float xarr[(6) * VLEN_s],
+                                                       float out[(6) * VLEN_s]) {
+    
+    Tv_s B1_0, B2_0, x0;
+    
+    Tv_s B1_1, B2_1, x1;
+    
+    Tv_s B1_2, B2_2, x2;
+    
+    Tv_s B1_3, B2_3, x3;
+    
+    Tv_s B1_4, B2_4, x4;
+    
+    Tv_s B1_5, B2_5, x5;
+    
+    Tv_s A, G, b, W, Bn;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    B1_0 = vload_s(0.0);
+    B2_0 = vload_s(0.0);
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    B1_1 = vload_s(0.0);
+    B2_1 = vload_s(0.0);
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    B1_2 = vload_s(0.0);
+    B2_2 = vload_s(0.0);
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    B1_3 = vload_s(0.0);
+    B2_3 = vload_s(0.0);
+    
+    x4 = vloadu_s(xarr + 4 * VLEN_s);
+    B1_4 = vload_s(0.0);
+    B2_4 = vload_s(0.0);
+    
+    x5 = vloadu_s(xarr + 5 * VLEN_s);
+    B1_5 = vload_s(0.0);
+    B2_5 = vload_s(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload_s(bl[l]);
+        A = vload_s(ag[2 * (l + 1)]);
+        G = vload_s(ag[2 * (l + 2) + 1]);
+        
+        W = vmul_s(x0, B1_0);
+        Bn = b;
+        vfmaeq_s(Bn, B2_0, G);
+        vfmaeq_s(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul_s(x1, B1_1);
+        Bn = b;
+        vfmaeq_s(Bn, B2_1, G);
+        vfmaeq_s(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul_s(x2, B1_2);
+        Bn = b;
+        vfmaeq_s(Bn, B2_2, G);
+        vfmaeq_s(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+        W = vmul_s(x3, B1_3);
+        Bn = b;
+        vfmaeq_s(Bn, B2_3, G);
+        vfmaeq_s(Bn, W, A);
+        B2_3 = B1_3;
+        B1_3 = Bn;
+        
+        W = vmul_s(x4, B1_4);
+        Bn = b;
+        vfmaeq_s(Bn, B2_4, G);
+        vfmaeq_s(Bn, W, A);
+        B2_4 = B1_4;
+        B1_4 = Bn;
+        
+        W = vmul_s(x5, B1_5);
+        Bn = b;
+        vfmaeq_s(Bn, B2_5, G);
+        vfmaeq_s(Bn, W, A);
+        B2_5 = B1_5;
+        B1_5 = Bn;
+        
+    }
+    
+    vstoreu_s(out + 0 * VLEN_s, B1_0);
+    
+    vstoreu_s(out + 1 * VLEN_s, B1_1);
+    
+    vstoreu_s(out + 2 * VLEN_s, B1_2);
+    
+    vstoreu_s(out + 3 * VLEN_s, B1_3);
+    
+    vstoreu_s(out + 4 * VLEN_s, B1_4);
+    
+    vstoreu_s(out + 5 * VLEN_s, B1_5);
+    
+}
+
+static void legendre_transform_clenshaw_vec7_s(float *ag, float *bl, ptrdiff_t lmax,
+                                                       float xarr[(7) * VLEN_s],
+                                                       float out[(7) * VLEN_s]) {
+    
+    Tv_s B1_0, B2_0, x0;
+    
+    Tv_s B1_1, B2_1, x1;
+    
+    Tv_s B1_2, B2_2, x2;
+    
+    Tv_s B1_3, B2_3, x3;
+    
+    Tv_s B1_4, B2_4, x4;
+    
+    Tv_s B1_5, B2_5, x5;
+    
+    Tv_s B1_6, B2_6, x6;
+    
+    Tv_s A, G, b, W, Bn;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    B1_0 = vload_s(0.0);
+    B2_0 = vload_s(0.0);
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    B1_1 = vload_s(0.0);
+    B2_1 = vload_s(0.0);
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    B1_2 = vload_s(0.0);
+    B2_2 = vload_s(0.0);
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    B1_3 = vload_s(0.0);
+    B2_3 = vload_s(0.0);
+    
+    x4 = vloadu_s(xarr + 4 * VLEN_s);
+    B1_4 = vload_s(0.0);
+    B2_4 = vload_s(0.0);
+    
+    x5 = vloadu_s(xarr + 5 * VLEN_s);
+    B1_5 = vload_s(0.0);
+    B2_5 = vload_s(0.0);
+    
+    x6 = vloadu_s(xarr + 6 * VLEN_s);
+    B1_6 = vload_s(0.0);
+    B2_6 = vload_s(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload_s(bl[l]);
+        A = vload_s(ag[2 * (l + 1)]);
+        G = vload_s(ag[2 * (l + 2) + 1]);
+        
+        W = vmul_s(x0, B1_0);
+        Bn = b;
+        vfmaeq_s(Bn, B2_0, G);
+        vfmaeq_s(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul_s(x1, B1_1);
+        Bn = b;
+        vfmaeq_s(Bn, B2_1, G);
+        vfmaeq_s(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul_s(x2, B1_2);
+        Bn = b;
+        vfmaeq_s(Bn, B2_2, G);
+        vfmaeq_s(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+        W = vmul_s(x3, B1_3);
+        Bn = b;
+        vfmaeq_s(Bn, B2_3, G);
+        vfmaeq_s(Bn, W, A);
+        B2_3 = B1_3;
+        B1_3 = Bn;
+        
+        W = vmul_s(x4, B1_4);
+        Bn = b;
+        vfmaeq_s(Bn, B2_4, G);
+        vfmaeq_s(Bn, W, A);
+        B2_4 = B1_4;
+        B1_4 = Bn;
+        
+        W = vmul_s(x5, B1_5);
+        Bn = b;
+        vfmaeq_s(Bn, B2_5, G);
+        vfmaeq_s(Bn, W, A);
+        B2_5 = B1_5;
+        B1_5 = Bn;
+        
+        W = vmul_s(x6, B1_6);
+        Bn = b;
+        vfmaeq_s(Bn, B2_6, G);
+        vfmaeq_s(Bn, W, A);
+        B2_6 = B1_6;
+        B1_6 = Bn;
+        
+    }
+    
+    vstoreu_s(out + 0 * VLEN_s, B1_0);
+    
+    vstoreu_s(out + 1 * VLEN_s, B1_1);
+    
+    vstoreu_s(out + 2 * VLEN_s, B1_2);
+    
+    vstoreu_s(out + 3 * VLEN_s, B1_3);
+    
+    vstoreu_s(out + 4 * VLEN_s, B1_4);
+    
+    vstoreu_s(out + 5 * VLEN_s, B1_5);
+    
+    vstoreu_s(out + 6 * VLEN_s, B1_6);
+    
+}
+
+static void legendre_transform_clenshaw_vec8_s(float *ag, float *bl, ptrdiff_t lmax,
+                                                       float xarr[(8) * VLEN_s],
+                                                       float out[(8) * VLEN_s]) {
+    
+    Tv_s B1_0, B2_0, x0;
+    
+    Tv_s B1_1, B2_1, x1;
+    
+    Tv_s B1_2, B2_2, x2;
+    
+    Tv_s B1_3, B2_3, x3;
+    
+    Tv_s B1_4, B2_4, x4;
+    
+    Tv_s B1_5, B2_5, x5;
+    
+    Tv_s B1_6, B2_6, x6;
+    
+    Tv_s B1_7, B2_7, x7;
+    
+    Tv_s A, G, b, W, Bn;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    B1_0 = vload_s(0.0);
+    B2_0 = vload_s(0.0);
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    B1_1 = vload_s(0.0);
+    B2_1 = vload_s(0.0);
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    B1_2 = vload_s(0.0);
+    B2_2 = vload_s(0.0);
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    B1_3 = vload_s(0.0);
+    B2_3 = vload_s(0.0);
+    
+    x4 = vloadu_s(xarr + 4 * VLEN_s);
+    B1_4 = vload_s(0.0);
+    B2_4 = vload_s(0.0);
+    
+    x5 = vloadu_s(xarr + 5 * VLEN_s);
+    B1_5 = vload_s(0.0);
+    B2_5 = vload_s(0.0);
+    
+    x6 = vloadu_s(xarr + 6 * VLEN_s);
+    B1_6 = vload_s(0.0);
+    B2_6 = vload_s(0.0);
+    
+    x7 = vloadu_s(xarr + 7 * VLEN_s);
+    B1_7 = vload_s(0.0);
+    B2_7 = vload_s(0.0);
+    
+
+    for (l = lmax; l >= 0; --l) {
+        b = vload_s(bl[l]);
+        A = vload_s(ag[2 * (l + 1)]);
+        G = vload_s(ag[2 * (l + 2) + 1]);
+        
+        W = vmul_s(x0, B1_0);
+        Bn = b;
+        vfmaeq_s(Bn, B2_0, G);
+        vfmaeq_s(Bn, W, A);
+        B2_0 = B1_0;
+        B1_0 = Bn;
+        
+        W = vmul_s(x1, B1_1);
+        Bn = b;
+        vfmaeq_s(Bn, B2_1, G);
+        vfmaeq_s(Bn, W, A);
+        B2_1 = B1_1;
+        B1_1 = Bn;
+        
+        W = vmul_s(x2, B1_2);
+        Bn = b;
+        vfmaeq_s(Bn, B2_2, G);
+        vfmaeq_s(Bn, W, A);
+        B2_2 = B1_2;
+        B1_2 = Bn;
+        
+        W = vmul_s(x3, B1_3);
+        Bn = b;
+        vfmaeq_s(Bn, B2_3, G);
+        vfmaeq_s(Bn, W, A);
+        B2_3 = B1_3;
+        B1_3 = Bn;
+        
+        W = vmul_s(x4, B1_4);
+        Bn = b;
+        vfmaeq_s(Bn, B2_4, G);
+        vfmaeq_s(Bn, W, A);
+        B2_4 = B1_4;
+        B1_4 = Bn;
+        
+        W = vmul_s(x5, B1_5);
+        Bn = b;
+        vfmaeq_s(Bn, B2_5, G);
+        vfmaeq_s(Bn, W, A);
+        B2_5 = B1_5;
+        B1_5 = Bn;
+        
+        W = vmul_s(x6, B1_6);
+        Bn = b;
+        vfmaeq_s(Bn, B2_6, G);
+        vfmaeq_s(Bn, W, A);
+        B2_6 = B1_6;
+        B1_6 = Bn;
+        
+        W = vmul_s(x7, B1_7);
+        Bn = b;
+        vfmaeq_s(Bn, B2_7, G);
+        vfmaeq_s(Bn, W, A);
+        B2_7 = B1_7;
+        B1_7 = Bn;
+        
+    }
+    
+    vstoreu_s(out + 0 * VLEN_s, B1_0);
+    
+    vstoreu_s(out + 1 * VLEN_s, B1_1);
+    
+    vstoreu_s(out + 2 * VLEN_s, B1_2);
+    
+    vstoreu_s(out + 3 * VLEN_s, B1_3);
+    
+    vstoreu_s(out + 4 * VLEN_s, B1_4);
+    
+    vstoreu_s(out + 5 * VLEN_s, B1_5);
+    
+    vstoreu_s(out + 6 * VLEN_s, B1_6);
+    
+    vstoreu_s(out + 7 * VLEN_s, B1_7);
+    
+}
+
+
+
+
+
+static void legendre_transform_batch_vec1(double *recfacs, double *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    double xarr[(1) * VLEN],
+                                                    double *out) {
+    /* out holds nbl consecutive accumulators of (1) * VLEN entries each;
+       the caller zeroes it. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 1];
+    Tv W1, W2, b, R;
+    double *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            if (nl > 1) {
+                
+                Pblock[1 + 0] = P_0;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 1 + 0] = P_0;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (1) * VLEN;
+            
+            y0 = vloadu(outk + 0 * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload(*(blk + j));
+                
+                vfmaeq(y0, Pblock[j * 1 + 0], b);
+                
+            }
+            
+            vstoreu(outk + 0 * VLEN, y0);
+            
+        }
+    }
+}
+
+static void legendre_transform_batch_vec2(double *recfacs, double *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    double xarr[(2) * VLEN],
+                                                    double *out) {
+    /* out holds nbl consecutive accumulators of (2) * VLEN entries each;
+       the caller zeroes it. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, y1;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 2];
+    Tv W1, W2, b, R;
+    double *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            if (nl > 1) {
+                
+                Pblock[2 + 0] = P_0;
+                
+                Pblock[2 + 1] = P_1;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 2 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq(P_1, W2, R);
+            Pblock[j * 2 + 1] = P_1;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (2) * VLEN;
+            
+            y0 = vloadu(outk + 0 * VLEN);
+            
+            y1 = vloadu(outk + 1 * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload(*(blk + j));
+                
+                vfmaeq(y0, Pblock[j * 2 + 0], b);
+                
+                vfmaeq(y1, Pblock[j * 2 + 1], b);
+                
+            }
+            
+            vstoreu(outk + 0 * VLEN, y0);
+            
+            vstoreu(outk + 1 * VLEN, y1);
+            
+        }
+    }
+}
+
+static void legendre_transform_batch_vec3(double *recfacs, double *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    double xarr[(3) * VLEN],
+                                                    double *out) {
+    /* out holds nbl consecutive accumulators of (3) * VLEN entries each;
+       the caller zeroes it. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, y1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, y2;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 3];
+    Tv W1, W2, b, R;
+    double *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            if (nl > 1) {
+                
+                Pblock[3 + 0] = P_0;
+                
+                Pblock[3 + 1] = P_1;
+                
+                Pblock[3 + 2] = P_2;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 3 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq(P_1, W2, R);
+            Pblock[j * 3 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq(P_2, W2, R);
+            Pblock[j * 3 + 2] = P_2;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (3) * VLEN;
+            
+            y0 = vloadu(outk + 0 * VLEN);
+            
+            y1 = vloadu(outk + 1 * VLEN);
+            
+            y2 = vloadu(outk + 2 * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload(*(blk + j));
+                
+                vfmaeq(y0, Pblock[j * 3 + 0], b);
+                
+                vfmaeq(y1, Pblock[j * 3 + 1], b);
+                
+                vfmaeq(y2, Pblock[j * 3 + 2], b);
+                
+            }
+            
+            vstoreu(outk + 0 * VLEN, y0);
+            
+            vstoreu(outk + 1 * VLEN, y1);
+            
+            vstoreu(outk + 2 * VLEN, y2);
+            
+        }
+    }
+}
+
+static void legendre_transform_batch_vec4(double *recfacs, double *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    double xarr[(4) * VLEN],
+                                                    double *out) {
+    /* out holds nbl consecutive accumulators of (4) * VLEN entries each;
+       the caller zeroes it. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, y1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, y2;
+    
+    Tv P_3, Pm1_3, Pm2_3, x3, y3;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 4];
+    Tv W1, W2, b, R;
+    double *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    Pm1_3 = vload(1.0);
+    P_3 = x3;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            if (nl > 1) {
+                
+                Pblock[4 + 0] = P_0;
+                
+                Pblock[4 + 1] = P_1;
+                
+                Pblock[4 + 2] = P_2;
+                
+                Pblock[4 + 3] = P_3;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 4 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq(P_1, W2, R);
+            Pblock[j * 4 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq(P_2, W2, R);
+            Pblock[j * 4 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq(P_3, W2, R);
+            Pblock[j * 4 + 3] = P_3;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (4) * VLEN;
+            
+            y0 = vloadu(outk + 0 * VLEN);
+            
+            y1 = vloadu(outk + 1 * VLEN);
+            
+            y2 = vloadu(outk + 2 * VLEN);
+            
+            y3 = vloadu(outk + 3 * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload(*(blk + j));
+                
+                vfmaeq(y0, Pblock[j * 4 + 0], b);
+                
+                vfmaeq(y1, Pblock[j * 4 + 1], b);
+                
+                vfmaeq(y2, Pblock[j * 4 + 2], b);
+                
+                vfmaeq(y3, Pblock[j * 4 + 3], b);
+                
+            }
+            
+            vstoreu(outk + 0 * VLEN, y0);
+            
+            vstoreu(outk + 1 * VLEN, y1);
+            
+            vstoreu(outk + 2 * VLEN, y2);
+            
+            vstoreu(outk + 3 * VLEN, y3);
+            
+        }
+    }
+}
+
+static void legendre_transform_batch_vec5(double *recfacs, double *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    double xarr[(5) * VLEN],
+                                                    double *out) {
+    /* out holds nbl consecutive accumulators of (5) * VLEN entries each;
+       the caller zeroes it. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, y1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, y2;
+    
+    Tv P_3, Pm1_3, Pm2_3, x3, y3;
+    
+    Tv P_4, Pm1_4, Pm2_4, x4, y4;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 5];
+    Tv W1, W2, b, R;
+    double *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    Pm1_3 = vload(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu(xarr + 4 * VLEN);
+    Pm1_4 = vload(1.0);
+    P_4 = x4;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            Pblock[4] = Pm1_4;
+            
+            if (nl > 1) {
+                
+                Pblock[5 + 0] = P_0;
+                
+                Pblock[5 + 1] = P_1;
+                
+                Pblock[5 + 2] = P_2;
+                
+                Pblock[5 + 3] = P_3;
+                
+                Pblock[5 + 4] = P_4;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 5 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq(P_1, W2, R);
+            Pblock[j * 5 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq(P_2, W2, R);
+            Pblock[j * 5 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq(P_3, W2, R);
+            Pblock[j * 5 + 3] = P_3;
+            
+            Pm2_4 = Pm1_4; Pm1_4 = P_4;
+            W1 = vmul(x4, Pm1_4);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_4);
+            P_4 = W1;
+            vfmaeq(P_4, W2, R);
+            Pblock[j * 5 + 4] = P_4;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (5) * VLEN;
+            
+            y0 = vloadu(outk + 0 * VLEN);
+            
+            y1 = vloadu(outk + 1 * VLEN);
+            
+            y2 = vloadu(outk + 2 * VLEN);
+            
+            y3 = vloadu(outk + 3 * VLEN);
+            
+            y4 = vloadu(outk + 4 * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload(*(blk + j));
+                
+                vfmaeq(y0, Pblock[j * 5 + 0], b);
+                
+                vfmaeq(y1, Pblock[j * 5 + 1], b);
+                
+                vfmaeq(y2, Pblock[j * 5 + 2], b);
+                
+                vfmaeq(y3, Pblock[j * 5 + 3], b);
+                
+                vfmaeq(y4, Pblock[j * 5 + 4], b);
+                
+            }
+            
+            vstoreu(outk + 0 * VLEN, y0);
+            
+            vstoreu(outk + 1 * VLEN, y1);
+            
+            vstoreu(outk + 2 * VLEN, y2);
+            
+            vstoreu(outk + 3 * VLEN, y3);
+            
+            vstoreu(outk + 4 * VLEN, y4);
+            
+        }
+    }
+}
+
+static void legendre_transform_batch_vec6(double *recfacs, double *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    double xarr[(6) * VLEN],
+                                                    double *out) {
+    /* out holds nbl consecutive accumulators of (6) * VLEN entries each;
+       the caller zeroes it. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, y1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, y2;
+    
+    Tv P_3, Pm1_3, Pm2_3, x3, y3;
+    
+    Tv P_4, Pm1_4, Pm2_4, x4, y4;
+    
+    Tv P_5, Pm1_5, Pm2_5, x5, y5;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 6];
+    Tv W1, W2, b, R;
+    double *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    Pm1_3 = vload(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu(xarr + 4 * VLEN);
+    Pm1_4 = vload(1.0);
+    P_4 = x4;
+    
+    x5 = vloadu(xarr + 5 * VLEN);
+    Pm1_5 = vload(1.0);
+    P_5 = x5;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            Pblock[4] = Pm1_4;
+            
+            Pblock[5] = Pm1_5;
+            
+            if (nl > 1) {
+                
+                Pblock[6 + 0] = P_0;
+                
+                Pblock[6 + 1] = P_1;
+                
+                Pblock[6 + 2] = P_2;
+                
+                Pblock[6 + 3] = P_3;
+                
+                Pblock[6 + 4] = P_4;
+                
+                Pblock[6 + 5] = P_5;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 6 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq(P_1, W2, R);
+            Pblock[j * 6 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq(P_2, W2, R);
+            Pblock[j * 6 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq(P_3, W2, R);
+            Pblock[j * 6 + 3] = P_3;
+            
+            Pm2_4 = Pm1_4; Pm1_4 = P_4;
+            W1 = vmul(x4, Pm1_4);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_4);
+            P_4 = W1;
+            vfmaeq(P_4, W2, R);
+            Pblock[j * 6 + 4] = P_4;
+            
+            Pm2_5 = Pm1_5; Pm1_5 = P_5;
+            W1 = vmul(x5, Pm1_5);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_5);
+            P_5 = W1;
+            vfmaeq(P_5, W2, R);
+            Pblock[j * 6 + 5] = P_5;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (6) * VLEN;
+            
+            y0 = vloadu(outk + 0 * VLEN);
+            
+            y1 = vloadu(outk + 1 * VLEN);
+            
+            y2 = vloadu(outk + 2 * VLEN);
+            
+            y3 = vloadu(outk + 3 * VLEN);
+            
+            y4 = vloadu(outk + 4 * VLEN);
+            
+            y5 = vloadu(outk + 5 * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload(*(blk + j));
+                
+                vfmaeq(y0, Pblock[j * 6 + 0], b);
+                
+                vfmaeq(y1, Pblock[j * 6 + 1], b);
+                
+                vfmaeq(y2, Pblock[j * 6 + 2], b);
+                
+                vfmaeq(y3, Pblock[j * 6 + 3], b);
+                
+                vfmaeq(y4, Pblock[j * 6 + 4], b);
+                
+                vfmaeq(y5, Pblock[j * 6 + 5], b);
+                
+            }
+            
+            vstoreu(outk + 0 * VLEN, y0);
+            
+            vstoreu(outk + 1 * VLEN, y1);
+            
+            vstoreu(outk + 2 * VLEN, y2);
+            
+            vstoreu(outk + 3 * VLEN, y3);
+            
+            vstoreu(outk + 4 * VLEN, y4);
+            
+            vstoreu(outk + 5 * VLEN, y5);
+            
+        }
+    }
+}
+
+
+
+static void legendre_transform_batch_vec1_s(float *recfacs, float *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    float xarr[(1) * VLEN_s],
+                                                    float *out) {
+    /* out holds nbl consecutive accumulators of (1) * VLEN_s entries each;
+       the caller zeroes it. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 1];
+    Tv_s W1, W2, b, R;
+    float *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            if (nl > 1) {
+                
+                Pblock[1 + 0] = P_0;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 1 + 0] = P_0;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (1) * VLEN_s;
+            
+            y0 = vloadu_s(outk + 0 * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload_s(*(blk + j));
+                
+                vfmaeq_s(y0, Pblock[j * 1 + 0], b);
+                
+            }
+            
+            vstoreu_s(outk + 0 * VLEN_s, y0);
+            
+        }
+    }
+}
+
+static void legendre_transform_batch_vec2_s(float *recfacs, float *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    float xarr[(2) * VLEN_s],
+                                                    float *out) {
+    /* out holds nbl consecutive accumulators of (2) * VLEN_s entries each;
+       the caller zeroes it. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, y1;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 2];
+    Tv_s W1, W2, b, R;
+    float *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            if (nl > 1) {
+                
+                Pblock[2 + 0] = P_0;
+                
+                Pblock[2 + 1] = P_1;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 2 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul_s(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq_s(P_1, W2, R);
+            Pblock[j * 2 + 1] = P_1;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (2) * VLEN_s;
+            
+            y0 = vloadu_s(outk + 0 * VLEN_s);
+            
+            y1 = vloadu_s(outk + 1 * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload_s(*(blk + j));
+                
+                vfmaeq_s(y0, Pblock[j * 2 + 0], b);
+                
+                vfmaeq_s(y1, Pblock[j * 2 + 1], b);
+                
+            }
+            
+            vstoreu_s(outk + 0 * VLEN_s, y0);
+            
+            vstoreu_s(outk + 1 * VLEN_s, y1);
+            
+        }
+    }
+}
+
+static void legendre_transform_batch_vec3_s(float *recfacs, float *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    float xarr[(3) * VLEN_s],
+                                                    float *out) {
+    /* out holds nbl consecutive accumulators of (3) * VLEN_s entries each;
+       the caller zeroes it. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, y1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, y2;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 3];
+    Tv_s W1, W2, b, R;
+    float *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            if (nl > 1) {
+                
+                Pblock[3 + 0] = P_0;
+                
+                Pblock[3 + 1] = P_1;
+                
+                Pblock[3 + 2] = P_2;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 3 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul_s(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq_s(P_1, W2, R);
+            Pblock[j * 3 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul_s(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq_s(P_2, W2, R);
+            Pblock[j * 3 + 2] = P_2;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (3) * VLEN_s;
+            
+            y0 = vloadu_s(outk + 0 * VLEN_s);
+            
+            y1 = vloadu_s(outk + 1 * VLEN_s);
+            
+            y2 = vloadu_s(outk + 2 * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload_s(*(blk + j));
+                
+                vfmaeq_s(y0, Pblock[j * 3 + 0], b);
+                
+                vfmaeq_s(y1, Pblock[j * 3 + 1], b);
+                
+                vfmaeq_s(y2, Pblock[j * 3 + 2], b);
+                
+            }
+            
+            vstoreu_s(outk + 0 * VLEN_s, y0);
+            
+            vstoreu_s(outk + 1 * VLEN_s, y1);
+            
+            vstoreu_s(outk + 2 * VLEN_s, y2);
+            
+        }
+    }
+}
+
+static void legendre_transform_batch_vec4_s(float *recfacs, float *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    float xarr[(4) * VLEN_s],
+                                                    float *out) {
+    /* out holds nbl consecutive accumulators of (4) * VLEN_s entries each;
+       the caller zeroes it. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, y1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, y2;
+    
+    Tv_s P_3, Pm1_3, Pm2_3, x3, y3;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 4];
+    Tv_s W1, W2, b, R;
+    float *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    Pm1_3 = vload_s(1.0);
+    P_3 = x3;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            if (nl > 1) {
+                
+                Pblock[4 + 0] = P_0;
+                
+                Pblock[4 + 1] = P_1;
+                
+                Pblock[4 + 2] = P_2;
+                
+                Pblock[4 + 3] = P_3;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 4 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul_s(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq_s(P_1, W2, R);
+            Pblock[j * 4 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul_s(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq_s(P_2, W2, R);
+            Pblock[j * 4 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul_s(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq_s(P_3, W2, R);
+            Pblock[j * 4 + 3] = P_3;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (4) * VLEN_s;
+            
+            y0 = vloadu_s(outk + 0 * VLEN_s);
+            
+            y1 = vloadu_s(outk + 1 * VLEN_s);
+            
+            y2 = vloadu_s(outk + 2 * VLEN_s);
+            
+            y3 = vloadu_s(outk + 3 * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload_s(*(blk + j));
+                
+                vfmaeq_s(y0, Pblock[j * 4 + 0], b);
+                
+                vfmaeq_s(y1, Pblock[j * 4 + 1], b);
+                
+                vfmaeq_s(y2, Pblock[j * 4 + 2], b);
+                
+                vfmaeq_s(y3, Pblock[j * 4 + 3], b);
+                
+            }
+            
+            vstoreu_s(outk + 0 * VLEN_s, y0);
+            
+            vstoreu_s(outk + 1 * VLEN_s, y1);
+            
+            vstoreu_s(outk + 2 * VLEN_s, y2);
+            
+            vstoreu_s(outk + 3 * VLEN_s, y3);
+            
+        }
+    }
+}
+
+static void legendre_transform_batch_vec5_s(float *recfacs, float *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    float xarr[(5) * VLEN_s],
+                                                    float *out) {
+    /* out holds nbl consecutive accumulators of (5) * VLEN_s entries each;
+       the caller zeroes it. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, y1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, y2;
+    
+    Tv_s P_3, Pm1_3, Pm2_3, x3, y3;
+    
+    Tv_s P_4, Pm1_4, Pm2_4, x4, y4;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 5];
+    Tv_s W1, W2, b, R;
+    float *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    Pm1_3 = vload_s(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu_s(xarr + 4 * VLEN_s);
+    Pm1_4 = vload_s(1.0);
+    P_4 = x4;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            Pblock[4] = Pm1_4;
+            
+            if (nl > 1) {
+                
+                Pblock[5 + 0] = P_0;
+                
+                Pblock[5 + 1] = P_1;
+                
+                Pblock[5 + 2] = P_2;
+                
+                Pblock[5 + 3] = P_3;
+                
+                Pblock[5 + 4] = P_4;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 5 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul_s(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq_s(P_1, W2, R);
+            Pblock[j * 5 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul_s(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq_s(P_2, W2, R);
+            Pblock[j * 5 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul_s(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq_s(P_3, W2, R);
+            Pblock[j * 5 + 3] = P_3;
+            
+            Pm2_4 = Pm1_4; Pm1_4 = P_4;
+            W1 = vmul_s(x4, Pm1_4);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_4);
+            P_4 = W1;
+            vfmaeq_s(P_4, W2, R);
+            Pblock[j * 5 + 4] = P_4;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (5) * VLEN_s;
+            
+            y0 = vloadu_s(outk + 0 * VLEN_s);
+            
+            y1 = vloadu_s(outk + 1 * VLEN_s);
+            
+            y2 = vloadu_s(outk + 2 * VLEN_s);
+            
+            y3 = vloadu_s(outk + 3 * VLEN_s);
+            
+            y4 = vloadu_s(outk + 4 * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload_s(*(blk + j));
+                
+                vfmaeq_s(y0, Pblock[j * 5 + 0], b);
+                
+                vfmaeq_s(y1, Pblock[j * 5 + 1], b);
+                
+                vfmaeq_s(y2, Pblock[j * 5 + 2], b);
+                
+                vfmaeq_s(y3, Pblock[j * 5 + 3], b);
+                
+                vfmaeq_s(y4, Pblock[j * 5 + 4], b);
+                
+            }
+            
+            vstoreu_s(outk + 0 * VLEN_s, y0);
+            
+            vstoreu_s(outk + 1 * VLEN_s, y1);
+            
+            vstoreu_s(outk + 2 * VLEN_s, y2);
+            
+            vstoreu_s(outk + 3 * VLEN_s, y3);
+            
+            vstoreu_s(outk + 4 * VLEN_s, y4);
+            
+        }
+    }
+}
+
+static void legendre_transform_batch_vec6_s(float *recfacs, float *bl,
+                                                    ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                                    ptrdiff_t lmax,
+                                                    float xarr[(6) * VLEN_s],
+                                                    float *out) {
+    /* out holds nbl consecutive accumulators of (6) * VLEN_s entries each;
+       the caller zeroes it. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, y0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, y1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, y2;
+    
+    Tv_s P_3, Pm1_3, Pm2_3, x3, y3;
+    
+    Tv_s P_4, Pm1_4, Pm2_4, x4, y4;
+    
+    Tv_s P_5, Pm1_5, Pm2_5, x5, y5;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 6];
+    Tv_s W1, W2, b, R;
+    float *blk, *outk;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    Pm1_3 = vload_s(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu_s(xarr + 4 * VLEN_s);
+    Pm1_4 = vload_s(1.0);
+    P_4 = x4;
+    
+    x5 = vloadu_s(xarr + 5 * VLEN_s);
+    Pm1_5 = vload_s(1.0);
+    P_5 = x5;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            Pblock[4] = Pm1_4;
+            
+            Pblock[5] = Pm1_5;
+            
+            if (nl > 1) {
+                
+                Pblock[6 + 0] = P_0;
+                
+                Pblock[6 + 1] = P_1;
+                
+                Pblock[6 + 2] = P_2;
+                
+                Pblock[6 + 3] = P_3;
+                
+                Pblock[6 + 4] = P_4;
+                
+                Pblock[6 + 5] = P_5;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 6 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul_s(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq_s(P_1, W2, R);
+            Pblock[j * 6 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul_s(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq_s(P_2, W2, R);
+            Pblock[j * 6 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul_s(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq_s(P_3, W2, R);
+            Pblock[j * 6 + 3] = P_3;
+            
+            Pm2_4 = Pm1_4; Pm1_4 = P_4;
+            W1 = vmul_s(x4, Pm1_4);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_4);
+            P_4 = W1;
+            vfmaeq_s(P_4, W2, R);
+            Pblock[j * 6 + 4] = P_4;
+            
+            Pm2_5 = Pm1_5; Pm1_5 = P_5;
+            W1 = vmul_s(x5, Pm1_5);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_5);
+            P_5 = W1;
+            vfmaeq_s(P_5, W2, R);
+            Pblock[j * 6 + 5] = P_5;
+            
+        }
+
+        /* Stream every b_l vector against the buffered block of P_l */
+        for (k = 0; k != nbl; ++k) {
+            blk = bl + k * bl_stride + l0;
+            outk = out + k * (6) * VLEN_s;
+            
+            y0 = vloadu_s(outk + 0 * VLEN_s);
+            
+            y1 = vloadu_s(outk + 1 * VLEN_s);
+            
+            y2 = vloadu_s(outk + 2 * VLEN_s);
+            
+            y3 = vloadu_s(outk + 3 * VLEN_s);
+            
+            y4 = vloadu_s(outk + 4 * VLEN_s);
+            
+            y5 = vloadu_s(outk + 5 * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                b = vload_s(*(blk + j));
+                
+                vfmaeq_s(y0, Pblock[j * 6 + 0], b);
+                
+                vfmaeq_s(y1, Pblock[j * 6 + 1], b);
+                
+                vfmaeq_s(y2, Pblock[j * 6 + 2], b);
+                
+                vfmaeq_s(y3, Pblock[j * 6 + 3], b);
+                
+                vfmaeq_s(y4, Pblock[j * 6 + 4], b);
+                
+                vfmaeq_s(y5, Pblock[j * 6 + 5], b);
+                
+            }
+            
+            vstoreu_s(outk + 0 * VLEN_s, y0);
+            
+            vstoreu_s(outk + 1 * VLEN_s, y1);
+            
+            vstoreu_s(outk + 2 * VLEN_s, y2);
+            
+            vstoreu_s(outk + 3 * VLEN_s, y3);
+            
+            vstoreu_s(outk + 4 * VLEN_s, y4);
+            
+            vstoreu_s(outk + 5 * VLEN_s, y5);
+            
+        }
+    }
+}
+
+
+
+
+
+static void legendre_transform_adjoint_vec1(double *recfacs, ptrdiff_t lmax,
+                                                      double xarr[(1) * VLEN],
+                                                      double farr[(1) * VLEN],
+                                                      double *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    f0 = vloadu(farr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+
+    y = vloadu(acc);
+    
+    y = vadd(y, f0);
+    
+    vstoreu(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu(acc + VLEN);
+    
+    vfmaeq(y, P_0, f0);
+    
+    vstoreu(acc + VLEN, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload(*(recfacs + l));
+        y = vloadu(acc + l * VLEN);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq(P_0, W2, R);
+        vfmaeq(y, P_0, f0);
+        
+        vstoreu(acc + l * VLEN, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec1(double *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            double xarr[(1) * VLEN],
+                                                            double *farr,
+                                                            double *acc) {
+    /* farr holds nf consecutive chunks of (1) * VLEN entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN lanes. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 1];
+    Tv W1, W2, R, y;
+    double *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            if (nl > 1) {
+                
+                Pblock[1 + 0] = P_0;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 1 + 0] = P_0;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN;
+            
+            f0 = vloadu(farr + (k * 1 + 0) * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu(acck + j * VLEN);
+                
+                vfmaeq(y, Pblock[j * 1 + 0], f0);
+                
+                vstoreu(acck + j * VLEN, y);
+            }
+        }
+    }
+}
+
+static void legendre_transform_adjoint_vec2(double *recfacs, ptrdiff_t lmax,
+                                                      double xarr[(2) * VLEN],
+                                                      double farr[(2) * VLEN],
+                                                      double *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    f0 = vloadu(farr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    f1 = vloadu(farr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+
+    y = vloadu(acc);
+    
+    y = vadd(y, f0);
+    
+    y = vadd(y, f1);
+    
+    vstoreu(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu(acc + VLEN);
+    
+    vfmaeq(y, P_0, f0);
+    
+    vfmaeq(y, P_1, f1);
+    
+    vstoreu(acc + VLEN, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload(*(recfacs + l));
+        y = vloadu(acc + l * VLEN);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq(P_0, W2, R);
+        vfmaeq(y, P_0, f0);
+        
+        Pm2_1 = Pm1_1; Pm1_1 = P_1;
+        W1 = vmul(x1, Pm1_1);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_1);
+        P_1 = W1;
+        vfmaeq(P_1, W2, R);
+        vfmaeq(y, P_1, f1);
+        
+        vstoreu(acc + l * VLEN, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec2(double *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            double xarr[(2) * VLEN],
+                                                            double *farr,
+                                                            double *acc) {
+    /* farr holds nf consecutive chunks of (2) * VLEN entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN lanes. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 2];
+    Tv W1, W2, R, y;
+    double *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            if (nl > 1) {
+                
+                Pblock[2 + 0] = P_0;
+                
+                Pblock[2 + 1] = P_1;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 2 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq(P_1, W2, R);
+            Pblock[j * 2 + 1] = P_1;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN;
+            
+            f0 = vloadu(farr + (k * 2 + 0) * VLEN);
+            
+            f1 = vloadu(farr + (k * 2 + 1) * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu(acck + j * VLEN);
+                
+                vfmaeq(y, Pblock[j * 2 + 0], f0);
+                
+                vfmaeq(y, Pblock[j * 2 + 1], f1);
+                
+                vstoreu(acck + j * VLEN, y);
+            }
+        }
+    }
+}
+
+static void legendre_transform_adjoint_vec3(double *recfacs, ptrdiff_t lmax,
+                                                      double xarr[(3) * VLEN],
+                                                      double farr[(3) * VLEN],
+                                                      double *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    f0 = vloadu(farr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    f1 = vloadu(farr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    f2 = vloadu(farr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+
+    y = vloadu(acc);
+    
+    y = vadd(y, f0);
+    
+    y = vadd(y, f1);
+    
+    y = vadd(y, f2);
+    
+    vstoreu(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu(acc + VLEN);
+    
+    vfmaeq(y, P_0, f0);
+    
+    vfmaeq(y, P_1, f1);
+    
+    vfmaeq(y, P_2, f2);
+    
+    vstoreu(acc + VLEN, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload(*(recfacs + l));
+        y = vloadu(acc + l * VLEN);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq(P_0, W2, R);
+        vfmaeq(y, P_0, f0);
+        
+        Pm2_1 = Pm1_1; Pm1_1 = P_1;
+        W1 = vmul(x1, Pm1_1);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_1);
+        P_1 = W1;
+        vfmaeq(P_1, W2, R);
+        vfmaeq(y, P_1, f1);
+        
+        Pm2_2 = Pm1_2; Pm1_2 = P_2;
+        W1 = vmul(x2, Pm1_2);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_2);
+        P_2 = W1;
+        vfmaeq(P_2, W2, R);
+        vfmaeq(y, P_2, f2);
+        
+        vstoreu(acc + l * VLEN, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec3(double *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            double xarr[(3) * VLEN],
+                                                            double *farr,
+                                                            double *acc) {
+    /* farr holds nf consecutive chunks of (3) * VLEN entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN lanes. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 3];
+    Tv W1, W2, R, y;
+    double *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            if (nl > 1) {
+                
+                Pblock[3 + 0] = P_0;
+                
+                Pblock[3 + 1] = P_1;
+                
+                Pblock[3 + 2] = P_2;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 3 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq(P_1, W2, R);
+            Pblock[j * 3 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq(P_2, W2, R);
+            Pblock[j * 3 + 2] = P_2;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN;
+            
+            f0 = vloadu(farr + (k * 3 + 0) * VLEN);
+            
+            f1 = vloadu(farr + (k * 3 + 1) * VLEN);
+            
+            f2 = vloadu(farr + (k * 3 + 2) * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu(acck + j * VLEN);
+                
+                vfmaeq(y, Pblock[j * 3 + 0], f0);
+                
+                vfmaeq(y, Pblock[j * 3 + 1], f1);
+                
+                vfmaeq(y, Pblock[j * 3 + 2], f2);
+                
+                vstoreu(acck + j * VLEN, y);
+            }
+        }
+    }
+}
+
+static void legendre_transform_adjoint_vec4(double *recfacs, ptrdiff_t lmax,
+                                                      double xarr[(4) * VLEN],
+                                                      double farr[(4) * VLEN],
+                                                      double *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    f0 = vloadu(farr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    f1 = vloadu(farr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    f2 = vloadu(farr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    f3 = vloadu(farr + 3 * VLEN);
+    Pm1_3 = vload(1.0);
+    P_3 = x3;
+    
+
+    y = vloadu(acc);
+    
+    y = vadd(y, f0);
+    
+    y = vadd(y, f1);
+    
+    y = vadd(y, f2);
+    
+    y = vadd(y, f3);
+    
+    vstoreu(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu(acc + VLEN);
+    
+    vfmaeq(y, P_0, f0);
+    
+    vfmaeq(y, P_1, f1);
+    
+    vfmaeq(y, P_2, f2);
+    
+    vfmaeq(y, P_3, f3);
+    
+    vstoreu(acc + VLEN, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload(*(recfacs + l));
+        y = vloadu(acc + l * VLEN);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq(P_0, W2, R);
+        vfmaeq(y, P_0, f0);
+        
+        Pm2_1 = Pm1_1; Pm1_1 = P_1;
+        W1 = vmul(x1, Pm1_1);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_1);
+        P_1 = W1;
+        vfmaeq(P_1, W2, R);
+        vfmaeq(y, P_1, f1);
+        
+        Pm2_2 = Pm1_2; Pm1_2 = P_2;
+        W1 = vmul(x2, Pm1_2);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_2);
+        P_2 = W1;
+        vfmaeq(P_2, W2, R);
+        vfmaeq(y, P_2, f2);
+        
+        Pm2_3 = Pm1_3; Pm1_3 = P_3;
+        W1 = vmul(x3, Pm1_3);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_3);
+        P_3 = W1;
+        vfmaeq(P_3, W2, R);
+        vfmaeq(y, P_3, f3);
+        
+        vstoreu(acc + l * VLEN, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec4(double *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            double xarr[(4) * VLEN],
+                                                            double *farr,
+                                                            double *acc) {
+    /* farr holds nf consecutive chunks of (4) * VLEN entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN lanes. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 4];
+    Tv W1, W2, R, y;
+    double *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    Pm1_3 = vload(1.0);
+    P_3 = x3;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            if (nl > 1) {
+                
+                Pblock[4 + 0] = P_0;
+                
+                Pblock[4 + 1] = P_1;
+                
+                Pblock[4 + 2] = P_2;
+                
+                Pblock[4 + 3] = P_3;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 4 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq(P_1, W2, R);
+            Pblock[j * 4 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq(P_2, W2, R);
+            Pblock[j * 4 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq(P_3, W2, R);
+            Pblock[j * 4 + 3] = P_3;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN;
+            
+            f0 = vloadu(farr + (k * 4 + 0) * VLEN);
+            
+            f1 = vloadu(farr + (k * 4 + 1) * VLEN);
+            
+            f2 = vloadu(farr + (k * 4 + 2) * VLEN);
+            
+            f3 = vloadu(farr + (k * 4 + 3) * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu(acck + j * VLEN);
+                
+                vfmaeq(y, Pblock[j * 4 + 0], f0);
+                
+                vfmaeq(y, Pblock[j * 4 + 1], f1);
+                
+                vfmaeq(y, Pblock[j * 4 + 2], f2);
+                
+                vfmaeq(y, Pblock[j * 4 + 3], f3);
+                
+                vstoreu(acck + j * VLEN, y);
+            }
+        }
+    }
+}
+
+static void legendre_transform_adjoint_vec5(double *recfacs, ptrdiff_t lmax,
+                                                      double xarr[(5) * VLEN],
+                                                      double farr[(5) * VLEN],
+                                                      double *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv P_4, Pm1_4, Pm2_4, x4, f4;
+    
+    Tv W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    f0 = vloadu(farr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    f1 = vloadu(farr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    f2 = vloadu(farr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    f3 = vloadu(farr + 3 * VLEN);
+    Pm1_3 = vload(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu(xarr + 4 * VLEN);
+    f4 = vloadu(farr + 4 * VLEN);
+    Pm1_4 = vload(1.0);
+    P_4 = x4;
+    
+
+    y = vloadu(acc);
+    
+    y = vadd(y, f0);
+    
+    y = vadd(y, f1);
+    
+    y = vadd(y, f2);
+    
+    y = vadd(y, f3);
+    
+    y = vadd(y, f4);
+    
+    vstoreu(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu(acc + VLEN);
+    
+    vfmaeq(y, P_0, f0);
+    
+    vfmaeq(y, P_1, f1);
+    
+    vfmaeq(y, P_2, f2);
+    
+    vfmaeq(y, P_3, f3);
+    
+    vfmaeq(y, P_4, f4);
+    
+    vstoreu(acc + VLEN, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload(*(recfacs + l));
+        y = vloadu(acc + l * VLEN);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq(P_0, W2, R);
+        vfmaeq(y, P_0, f0);
+        
+        Pm2_1 = Pm1_1; Pm1_1 = P_1;
+        W1 = vmul(x1, Pm1_1);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_1);
+        P_1 = W1;
+        vfmaeq(P_1, W2, R);
+        vfmaeq(y, P_1, f1);
+        
+        Pm2_2 = Pm1_2; Pm1_2 = P_2;
+        W1 = vmul(x2, Pm1_2);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_2);
+        P_2 = W1;
+        vfmaeq(P_2, W2, R);
+        vfmaeq(y, P_2, f2);
+        
+        Pm2_3 = Pm1_3; Pm1_3 = P_3;
+        W1 = vmul(x3, Pm1_3);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_3);
+        P_3 = W1;
+        vfmaeq(P_3, W2, R);
+        vfmaeq(y, P_3, f3);
+        
+        Pm2_4 = Pm1_4; Pm1_4 = P_4;
+        W1 = vmul(x4, Pm1_4);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_4);
+        P_4 = W1;
+        vfmaeq(P_4, W2, R);
+        vfmaeq(y, P_4, f4);
+        
+        vstoreu(acc + l * VLEN, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec5(double *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            double xarr[(5) * VLEN],
+                                                            double *farr,
+                                                            double *acc) {
+    /* farr holds nf consecutive chunks of (5) * VLEN entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN lanes. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv P_4, Pm1_4, Pm2_4, x4, f4;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 5];
+    Tv W1, W2, R, y;
+    double *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    Pm1_3 = vload(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu(xarr + 4 * VLEN);
+    Pm1_4 = vload(1.0);
+    P_4 = x4;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            Pblock[4] = Pm1_4;
+            
+            if (nl > 1) {
+                
+                Pblock[5 + 0] = P_0;
+                
+                Pblock[5 + 1] = P_1;
+                
+                Pblock[5 + 2] = P_2;
+                
+                Pblock[5 + 3] = P_3;
+                
+                Pblock[5 + 4] = P_4;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 5 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq(P_1, W2, R);
+            Pblock[j * 5 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq(P_2, W2, R);
+            Pblock[j * 5 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq(P_3, W2, R);
+            Pblock[j * 5 + 3] = P_3;
+            
+            Pm2_4 = Pm1_4; Pm1_4 = P_4;
+            W1 = vmul(x4, Pm1_4);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_4);
+            P_4 = W1;
+            vfmaeq(P_4, W2, R);
+            Pblock[j * 5 + 4] = P_4;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN;
+            
+            f0 = vloadu(farr + (k * 5 + 0) * VLEN);
+            
+            f1 = vloadu(farr + (k * 5 + 1) * VLEN);
+            
+            f2 = vloadu(farr + (k * 5 + 2) * VLEN);
+            
+            f3 = vloadu(farr + (k * 5 + 3) * VLEN);
+            
+            f4 = vloadu(farr + (k * 5 + 4) * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu(acck + j * VLEN);
+                
+                vfmaeq(y, Pblock[j * 5 + 0], f0);
+                
+                vfmaeq(y, Pblock[j * 5 + 1], f1);
+                
+                vfmaeq(y, Pblock[j * 5 + 2], f2);
+                
+                vfmaeq(y, Pblock[j * 5 + 3], f3);
+                
+                vfmaeq(y, Pblock[j * 5 + 4], f4);
+                
+                vstoreu(acck + j * VLEN, y);
+            }
+        }
+    }
+}
+
+static void legendre_transform_adjoint_vec6(double *recfacs, ptrdiff_t lmax,
+                                                      double xarr[(6) * VLEN],
+                                                      double farr[(6) * VLEN],
+                                                      double *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv P_4, Pm1_4, Pm2_4, x4, f4;
+    
+    Tv P_5, Pm1_5, Pm2_5, x5, f5;
+    
+    Tv W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    f0 = vloadu(farr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    f1 = vloadu(farr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    f2 = vloadu(farr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    f3 = vloadu(farr + 3 * VLEN);
+    Pm1_3 = vload(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu(xarr + 4 * VLEN);
+    f4 = vloadu(farr + 4 * VLEN);
+    Pm1_4 = vload(1.0);
+    P_4 = x4;
+    
+    x5 = vloadu(xarr + 5 * VLEN);
+    f5 = vloadu(farr + 5 * VLEN);
+    Pm1_5 = vload(1.0);
+    P_5 = x5;
+    
+
+    y = vloadu(acc);
+    
+    y = vadd(y, f0);
+    
+    y = vadd(y, f1);
+    
+    y = vadd(y, f2);
+    
+    y = vadd(y, f3);
+    
+    y = vadd(y, f4);
+    
+    y = vadd(y, f5);
+    
+    vstoreu(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu(acc + VLEN);
+    
+    vfmaeq(y, P_0, f0);
+    
+    vfmaeq(y, P_1, f1);
+    
+    vfmaeq(y, P_2, f2);
+    
+    vfmaeq(y, P_3, f3);
+    
+    vfmaeq(y, P_4, f4);
+    
+    vfmaeq(y, P_5, f5);
+    
+    vstoreu(acc + VLEN, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload(*(recfacs + l));
+        y = vloadu(acc + l * VLEN);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq(P_0, W2, R);
+        vfmaeq(y, P_0, f0);
+        
+        Pm2_1 = Pm1_1; Pm1_1 = P_1;
+        W1 = vmul(x1, Pm1_1);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_1);
+        P_1 = W1;
+        vfmaeq(P_1, W2, R);
+        vfmaeq(y, P_1, f1);
+        
+        Pm2_2 = Pm1_2; Pm1_2 = P_2;
+        W1 = vmul(x2, Pm1_2);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_2);
+        P_2 = W1;
+        vfmaeq(P_2, W2, R);
+        vfmaeq(y, P_2, f2);
+        
+        Pm2_3 = Pm1_3; Pm1_3 = P_3;
+        W1 = vmul(x3, Pm1_3);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_3);
+        P_3 = W1;
+        vfmaeq(P_3, W2, R);
+        vfmaeq(y, P_3, f3);
+        
+        Pm2_4 = Pm1_4; Pm1_4 = P_4;
+        W1 = vmul(x4, Pm1_4);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_4);
+        P_4 = W1;
+        vfmaeq(P_4, W2, R);
+        vfmaeq(y, P_4, f4);
+        
+        Pm2_5 = Pm1_5; Pm1_5 = P_5;
+        W1 = vmul(x5, Pm1_5);
+        W2 = W1;
+        W2 = vsub(W2, Pm2_5);
+        P_5 = W1;
+        vfmaeq(P_5, W2, R);
+        vfmaeq(y, P_5, f5);
+        
+        vstoreu(acc + l * VLEN, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec6(double *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            double xarr[(6) * VLEN],
+                                                            double *farr,
+                                                            double *acc) {
+    /* farr holds nf consecutive chunks of (6) * VLEN entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN lanes. */
+    
+    Tv P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv P_4, Pm1_4, Pm2_4, x4, f4;
+    
+    Tv P_5, Pm1_5, Pm2_5, x5, f5;
+    
+    Tv Pblock[SHARP_LEGENDRE_LBLOCK * 6];
+    Tv W1, W2, R, y;
+    double *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu(xarr + 0 * VLEN);
+    Pm1_0 = vload(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu(xarr + 1 * VLEN);
+    Pm1_1 = vload(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu(xarr + 2 * VLEN);
+    Pm1_2 = vload(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu(xarr + 3 * VLEN);
+    Pm1_3 = vload(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu(xarr + 4 * VLEN);
+    Pm1_4 = vload(1.0);
+    P_4 = x4;
+    
+    x5 = vloadu(xarr + 5 * VLEN);
+    Pm1_5 = vload(1.0);
+    P_5 = x5;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            Pblock[4] = Pm1_4;
+            
+            Pblock[5] = Pm1_5;
+            
+            if (nl > 1) {
+                
+                Pblock[6 + 0] = P_0;
+                
+                Pblock[6 + 1] = P_1;
+                
+                Pblock[6 + 2] = P_2;
+                
+                Pblock[6 + 3] = P_3;
+                
+                Pblock[6 + 4] = P_4;
+                
+                Pblock[6 + 5] = P_5;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq(P_0, W2, R);
+            Pblock[j * 6 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq(P_1, W2, R);
+            Pblock[j * 6 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq(P_2, W2, R);
+            Pblock[j * 6 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq(P_3, W2, R);
+            Pblock[j * 6 + 3] = P_3;
+            
+            Pm2_4 = Pm1_4; Pm1_4 = P_4;
+            W1 = vmul(x4, Pm1_4);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_4);
+            P_4 = W1;
+            vfmaeq(P_4, W2, R);
+            Pblock[j * 6 + 4] = P_4;
+            
+            Pm2_5 = Pm1_5; Pm1_5 = P_5;
+            W1 = vmul(x5, Pm1_5);
+            W2 = W1;
+            W2 = vsub(W2, Pm2_5);
+            P_5 = W1;
+            vfmaeq(P_5, W2, R);
+            Pblock[j * 6 + 5] = P_5;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN;
+            
+            f0 = vloadu(farr + (k * 6 + 0) * VLEN);
+            
+            f1 = vloadu(farr + (k * 6 + 1) * VLEN);
+            
+            f2 = vloadu(farr + (k * 6 + 2) * VLEN);
+            
+            f3 = vloadu(farr + (k * 6 + 3) * VLEN);
+            
+            f4 = vloadu(farr + (k * 6 + 4) * VLEN);
+            
+            f5 = vloadu(farr + (k * 6 + 5) * VLEN);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu(acck + j * VLEN);
+                
+                vfmaeq(y, Pblock[j * 6 + 0], f0);
+                
+                vfmaeq(y, Pblock[j * 6 + 1], f1);
+                
+                vfmaeq(y, Pblock[j * 6 + 2], f2);
+                
+                vfmaeq(y, Pblock[j * 6 + 3], f3);
+                
+                vfmaeq(y, Pblock[j * 6 + 4], f4);
+                
+                vfmaeq(y, Pblock[j * 6 + 5], f5);
+                
+                vstoreu(acck + j * VLEN, y);
+            }
+        }
+    }
+}
+
+
+
+static void legendre_transform_adjoint_vec1_s(float *recfacs, ptrdiff_t lmax,
+                                                      float xarr[(1) * VLEN_s],
+                                                      float farr[(1) * VLEN_s],
+                                                      float *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN_s lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    f0 = vloadu_s(farr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+
+    y = vloadu_s(acc);
+    
+    y = vadd_s(y, f0);
+    
+    vstoreu_s(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu_s(acc + VLEN_s);
+    
+    vfmaeq_s(y, P_0, f0);
+    
+    vstoreu_s(acc + VLEN_s, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload_s(*(recfacs + l));
+        y = vloadu_s(acc + l * VLEN_s);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul_s(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq_s(P_0, W2, R);
+        vfmaeq_s(y, P_0, f0);
+        
+        vstoreu_s(acc + l * VLEN_s, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec1_s(float *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            float xarr[(1) * VLEN_s],
+                                                            float *farr,
+                                                            float *acc) {
+    /* farr holds nf consecutive chunks of (1) * VLEN_s entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN_s lanes. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 1];
+    Tv_s W1, W2, R, y;
+    float *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            if (nl > 1) {
+                
+                Pblock[1 + 0] = P_0;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 1 + 0] = P_0;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN_s;
+            
+            f0 = vloadu_s(farr + (k * 1 + 0) * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu_s(acck + j * VLEN_s);
+                
+                vfmaeq_s(y, Pblock[j * 1 + 0], f0);
+                
+                vstoreu_s(acck + j * VLEN_s, y);
+            }
+        }
+    }
+}
+
+static void legendre_transform_adjoint_vec2_s(float *recfacs, ptrdiff_t lmax,
+                                                      float xarr[(2) * VLEN_s],
+                                                      float farr[(2) * VLEN_s],
+                                                      float *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN_s lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv_s W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    f0 = vloadu_s(farr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    f1 = vloadu_s(farr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+
+    y = vloadu_s(acc);
+    
+    y = vadd_s(y, f0);
+    
+    y = vadd_s(y, f1);
+    
+    vstoreu_s(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu_s(acc + VLEN_s);
+    
+    vfmaeq_s(y, P_0, f0);
+    
+    vfmaeq_s(y, P_1, f1);
+    
+    vstoreu_s(acc + VLEN_s, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload_s(*(recfacs + l));
+        y = vloadu_s(acc + l * VLEN_s);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul_s(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq_s(P_0, W2, R);
+        vfmaeq_s(y, P_0, f0);
+        
+        Pm2_1 = Pm1_1; Pm1_1 = P_1;
+        W1 = vmul_s(x1, Pm1_1);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_1);
+        P_1 = W1;
+        vfmaeq_s(P_1, W2, R);
+        vfmaeq_s(y, P_1, f1);
+        
+        vstoreu_s(acc + l * VLEN_s, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec2_s(float *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            float xarr[(2) * VLEN_s],
+                                                            float *farr,
+                                                            float *acc) {
+    /* farr holds nf consecutive chunks of (2) * VLEN_s entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN_s lanes. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 2];
+    Tv_s W1, W2, R, y;
+    float *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            if (nl > 1) {
+                
+                Pblock[2 + 0] = P_0;
+                
+                Pblock[2 + 1] = P_1;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 2 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul_s(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq_s(P_1, W2, R);
+            Pblock[j * 2 + 1] = P_1;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN_s;
+            
+            f0 = vloadu_s(farr + (k * 2 + 0) * VLEN_s);
+            
+            f1 = vloadu_s(farr + (k * 2 + 1) * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu_s(acck + j * VLEN_s);
+                
+                vfmaeq_s(y, Pblock[j * 2 + 0], f0);
+                
+                vfmaeq_s(y, Pblock[j * 2 + 1], f1);
+                
+                vstoreu_s(acck + j * VLEN_s, y);
+            }
+        }
+    }
+}
+
+static void legendre_transform_adjoint_vec3_s(float *recfacs, ptrdiff_t lmax,
+                                                      float xarr[(3) * VLEN_s],
+                                                      float farr[(3) * VLEN_s],
+                                                      float *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN_s lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv_s W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    f0 = vloadu_s(farr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    f1 = vloadu_s(farr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    f2 = vloadu_s(farr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+
+    y = vloadu_s(acc);
+    
+    y = vadd_s(y, f0);
+    
+    y = vadd_s(y, f1);
+    
+    y = vadd_s(y, f2);
+    
+    vstoreu_s(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu_s(acc + VLEN_s);
+    
+    vfmaeq_s(y, P_0, f0);
+    
+    vfmaeq_s(y, P_1, f1);
+    
+    vfmaeq_s(y, P_2, f2);
+    
+    vstoreu_s(acc + VLEN_s, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload_s(*(recfacs + l));
+        y = vloadu_s(acc + l * VLEN_s);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul_s(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq_s(P_0, W2, R);
+        vfmaeq_s(y, P_0, f0);
+        
+        Pm2_1 = Pm1_1; Pm1_1 = P_1;
+        W1 = vmul_s(x1, Pm1_1);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_1);
+        P_1 = W1;
+        vfmaeq_s(P_1, W2, R);
+        vfmaeq_s(y, P_1, f1);
+        
+        Pm2_2 = Pm1_2; Pm1_2 = P_2;
+        W1 = vmul_s(x2, Pm1_2);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_2);
+        P_2 = W1;
+        vfmaeq_s(P_2, W2, R);
+        vfmaeq_s(y, P_2, f2);
+        
+        vstoreu_s(acc + l * VLEN_s, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec3_s(float *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            float xarr[(3) * VLEN_s],
+                                                            float *farr,
+                                                            float *acc) {
+    /* farr holds nf consecutive chunks of (3) * VLEN_s entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN_s lanes. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 3];
+    Tv_s W1, W2, R, y;
+    float *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            if (nl > 1) {
+                
+                Pblock[3 + 0] = P_0;
+                
+                Pblock[3 + 1] = P_1;
+                
+                Pblock[3 + 2] = P_2;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 3 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul_s(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq_s(P_1, W2, R);
+            Pblock[j * 3 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul_s(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq_s(P_2, W2, R);
+            Pblock[j * 3 + 2] = P_2;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN_s;
+            
+            f0 = vloadu_s(farr + (k * 3 + 0) * VLEN_s);
+            
+            f1 = vloadu_s(farr + (k * 3 + 1) * VLEN_s);
+            
+            f2 = vloadu_s(farr + (k * 3 + 2) * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu_s(acck + j * VLEN_s);
+                
+                vfmaeq_s(y, Pblock[j * 3 + 0], f0);
+                
+                vfmaeq_s(y, Pblock[j * 3 + 1], f1);
+                
+                vfmaeq_s(y, Pblock[j * 3 + 2], f2);
+                
+                vstoreu_s(acck + j * VLEN_s, y);
+            }
+        }
+    }
+}
+
+static void legendre_transform_adjoint_vec4_s(float *recfacs, ptrdiff_t lmax,
+                                                      float xarr[(4) * VLEN_s],
+                                                      float farr[(4) * VLEN_s],
+                                                      float *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN_s lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv_s P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv_s W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    f0 = vloadu_s(farr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    f1 = vloadu_s(farr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    f2 = vloadu_s(farr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    f3 = vloadu_s(farr + 3 * VLEN_s);
+    Pm1_3 = vload_s(1.0);
+    P_3 = x3;
+    
+
+    y = vloadu_s(acc);
+    
+    y = vadd_s(y, f0);
+    
+    y = vadd_s(y, f1);
+    
+    y = vadd_s(y, f2);
+    
+    y = vadd_s(y, f3);
+    
+    vstoreu_s(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu_s(acc + VLEN_s);
+    
+    vfmaeq_s(y, P_0, f0);
+    
+    vfmaeq_s(y, P_1, f1);
+    
+    vfmaeq_s(y, P_2, f2);
+    
+    vfmaeq_s(y, P_3, f3);
+    
+    vstoreu_s(acc + VLEN_s, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload_s(*(recfacs + l));
+        y = vloadu_s(acc + l * VLEN_s);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul_s(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq_s(P_0, W2, R);
+        vfmaeq_s(y, P_0, f0);
+        
+        Pm2_1 = Pm1_1; Pm1_1 = P_1;
+        W1 = vmul_s(x1, Pm1_1);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_1);
+        P_1 = W1;
+        vfmaeq_s(P_1, W2, R);
+        vfmaeq_s(y, P_1, f1);
+        
+        Pm2_2 = Pm1_2; Pm1_2 = P_2;
+        W1 = vmul_s(x2, Pm1_2);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_2);
+        P_2 = W1;
+        vfmaeq_s(P_2, W2, R);
+        vfmaeq_s(y, P_2, f2);
+        
+        Pm2_3 = Pm1_3; Pm1_3 = P_3;
+        W1 = vmul_s(x3, Pm1_3);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_3);
+        P_3 = W1;
+        vfmaeq_s(P_3, W2, R);
+        vfmaeq_s(y, P_3, f3);
+        
+        vstoreu_s(acc + l * VLEN_s, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec4_s(float *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            float xarr[(4) * VLEN_s],
+                                                            float *farr,
+                                                            float *acc) {
+    /* farr holds nf consecutive chunks of (4) * VLEN_s entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN_s lanes. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv_s P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 4];
+    Tv_s W1, W2, R, y;
+    float *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    Pm1_3 = vload_s(1.0);
+    P_3 = x3;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            if (nl > 1) {
+                
+                Pblock[4 + 0] = P_0;
+                
+                Pblock[4 + 1] = P_1;
+                
+                Pblock[4 + 2] = P_2;
+                
+                Pblock[4 + 3] = P_3;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 4 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul_s(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq_s(P_1, W2, R);
+            Pblock[j * 4 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul_s(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq_s(P_2, W2, R);
+            Pblock[j * 4 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul_s(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq_s(P_3, W2, R);
+            Pblock[j * 4 + 3] = P_3;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN_s;
+            
+            f0 = vloadu_s(farr + (k * 4 + 0) * VLEN_s);
+            
+            f1 = vloadu_s(farr + (k * 4 + 1) * VLEN_s);
+            
+            f2 = vloadu_s(farr + (k * 4 + 2) * VLEN_s);
+            
+            f3 = vloadu_s(farr + (k * 4 + 3) * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu_s(acck + j * VLEN_s);
+                
+                vfmaeq_s(y, Pblock[j * 4 + 0], f0);
+                
+                vfmaeq_s(y, Pblock[j * 4 + 1], f1);
+                
+                vfmaeq_s(y, Pblock[j * 4 + 2], f2);
+                
+                vfmaeq_s(y, Pblock[j * 4 + 3], f3);
+                
+                vstoreu_s(acck + j * VLEN_s, y);
+            }
+        }
+    }
+}
+
+static void legendre_transform_adjoint_vec5_s(float *recfacs, ptrdiff_t lmax,
+                                                      float xarr[(5) * VLEN_s],
+                                                      float farr[(5) * VLEN_s],
+                                                      float *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN_s lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv_s P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv_s P_4, Pm1_4, Pm2_4, x4, f4;
+    
+    Tv_s W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    f0 = vloadu_s(farr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    f1 = vloadu_s(farr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    f2 = vloadu_s(farr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    f3 = vloadu_s(farr + 3 * VLEN_s);
+    Pm1_3 = vload_s(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu_s(xarr + 4 * VLEN_s);
+    f4 = vloadu_s(farr + 4 * VLEN_s);
+    Pm1_4 = vload_s(1.0);
+    P_4 = x4;
+    
+
+    y = vloadu_s(acc);
+    
+    y = vadd_s(y, f0);
+    
+    y = vadd_s(y, f1);
+    
+    y = vadd_s(y, f2);
+    
+    y = vadd_s(y, f3);
+    
+    y = vadd_s(y, f4);
+    
+    vstoreu_s(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu_s(acc + VLEN_s);
+    
+    vfmaeq_s(y, P_0, f0);
+    
+    vfmaeq_s(y, P_1, f1);
+    
+    vfmaeq_s(y, P_2, f2);
+    
+    vfmaeq_s(y, P_3, f3);
+    
+    vfmaeq_s(y, P_4, f4);
+    
+    vstoreu_s(acc + VLEN_s, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload_s(*(recfacs + l));
+        y = vloadu_s(acc + l * VLEN_s);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul_s(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq_s(P_0, W2, R);
+        vfmaeq_s(y, P_0, f0);
+        
+        Pm2_1 = Pm1_1; Pm1_1 = P_1;
+        W1 = vmul_s(x1, Pm1_1);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_1);
+        P_1 = W1;
+        vfmaeq_s(P_1, W2, R);
+        vfmaeq_s(y, P_1, f1);
+        
+        Pm2_2 = Pm1_2; Pm1_2 = P_2;
+        W1 = vmul_s(x2, Pm1_2);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_2);
+        P_2 = W1;
+        vfmaeq_s(P_2, W2, R);
+        vfmaeq_s(y, P_2, f2);
+        
+        Pm2_3 = Pm1_3; Pm1_3 = P_3;
+        W1 = vmul_s(x3, Pm1_3);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_3);
+        P_3 = W1;
+        vfmaeq_s(P_3, W2, R);
+        vfmaeq_s(y, P_3, f3);
+        
+        Pm2_4 = Pm1_4; Pm1_4 = P_4;
+        W1 = vmul_s(x4, Pm1_4);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_4);
+        P_4 = W1;
+        vfmaeq_s(P_4, W2, R);
+        vfmaeq_s(y, P_4, f4);
+        
+        vstoreu_s(acc + l * VLEN_s, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec5_s(float *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            float xarr[(5) * VLEN_s],
+                                                            float *farr,
+                                                            float *acc) {
+    /* farr holds nf consecutive chunks of (5) * VLEN_s entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN_s lanes. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv_s P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv_s P_4, Pm1_4, Pm2_4, x4, f4;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 5];
+    Tv_s W1, W2, R, y;
+    float *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    Pm1_3 = vload_s(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu_s(xarr + 4 * VLEN_s);
+    Pm1_4 = vload_s(1.0);
+    P_4 = x4;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            Pblock[4] = Pm1_4;
+            
+            if (nl > 1) {
+                
+                Pblock[5 + 0] = P_0;
+                
+                Pblock[5 + 1] = P_1;
+                
+                Pblock[5 + 2] = P_2;
+                
+                Pblock[5 + 3] = P_3;
+                
+                Pblock[5 + 4] = P_4;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 5 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul_s(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq_s(P_1, W2, R);
+            Pblock[j * 5 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul_s(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq_s(P_2, W2, R);
+            Pblock[j * 5 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul_s(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq_s(P_3, W2, R);
+            Pblock[j * 5 + 3] = P_3;
+            
+            Pm2_4 = Pm1_4; Pm1_4 = P_4;
+            W1 = vmul_s(x4, Pm1_4);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_4);
+            P_4 = W1;
+            vfmaeq_s(P_4, W2, R);
+            Pblock[j * 5 + 4] = P_4;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN_s;
+            
+            f0 = vloadu_s(farr + (k * 5 + 0) * VLEN_s);
+            
+            f1 = vloadu_s(farr + (k * 5 + 1) * VLEN_s);
+            
+            f2 = vloadu_s(farr + (k * 5 + 2) * VLEN_s);
+            
+            f3 = vloadu_s(farr + (k * 5 + 3) * VLEN_s);
+            
+            f4 = vloadu_s(farr + (k * 5 + 4) * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu_s(acck + j * VLEN_s);
+                
+                vfmaeq_s(y, Pblock[j * 5 + 0], f0);
+                
+                vfmaeq_s(y, Pblock[j * 5 + 1], f1);
+                
+                vfmaeq_s(y, Pblock[j * 5 + 2], f2);
+                
+                vfmaeq_s(y, Pblock[j * 5 + 3], f3);
+                
+                vfmaeq_s(y, Pblock[j * 5 + 4], f4);
+                
+                vstoreu_s(acck + j * VLEN_s, y);
+            }
+        }
+    }
+}
+
+static void legendre_transform_adjoint_vec6_s(float *recfacs, ptrdiff_t lmax,
+                                                      float xarr[(6) * VLEN_s],
+                                                      float farr[(6) * VLEN_s],
+                                                      float *acc) {
+    /* acc holds lmax + 1 partial sums of VLEN_s lanes each; farr must be
+       zero in the padding entries of the chunk. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv_s P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv_s P_4, Pm1_4, Pm2_4, x4, f4;
+    
+    Tv_s P_5, Pm1_5, Pm2_5, x5, f5;
+    
+    Tv_s W1, W2, R, y;
+    ptrdiff_t l;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    f0 = vloadu_s(farr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    f1 = vloadu_s(farr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    f2 = vloadu_s(farr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    f3 = vloadu_s(farr + 3 * VLEN_s);
+    Pm1_3 = vload_s(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu_s(xarr + 4 * VLEN_s);
+    f4 = vloadu_s(farr + 4 * VLEN_s);
+    Pm1_4 = vload_s(1.0);
+    P_4 = x4;
+    
+    x5 = vloadu_s(xarr + 5 * VLEN_s);
+    f5 = vloadu_s(farr + 5 * VLEN_s);
+    Pm1_5 = vload_s(1.0);
+    P_5 = x5;
+    
+
+    y = vloadu_s(acc);
+    
+    y = vadd_s(y, f0);
+    
+    y = vadd_s(y, f1);
+    
+    y = vadd_s(y, f2);
+    
+    y = vadd_s(y, f3);
+    
+    y = vadd_s(y, f4);
+    
+    y = vadd_s(y, f5);
+    
+    vstoreu_s(acc, y);
+
+    if (lmax == 0) return;
+    y = vloadu_s(acc + VLEN_s);
+    
+    vfmaeq_s(y, P_0, f0);
+    
+    vfmaeq_s(y, P_1, f1);
+    
+    vfmaeq_s(y, P_2, f2);
+    
+    vfmaeq_s(y, P_3, f3);
+    
+    vfmaeq_s(y, P_4, f4);
+    
+    vfmaeq_s(y, P_5, f5);
+    
+    vstoreu_s(acc + VLEN_s, y);
+
+    for (l = 2; l <= lmax; ++l) {
+        R = vload_s(*(recfacs + l));
+        y = vloadu_s(acc + l * VLEN_s);
+        
+        Pm2_0 = Pm1_0; Pm1_0 = P_0;
+        W1 = vmul_s(x0, Pm1_0);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_0);
+        P_0 = W1;
+        vfmaeq_s(P_0, W2, R);
+        vfmaeq_s(y, P_0, f0);
+        
+        Pm2_1 = Pm1_1; Pm1_1 = P_1;
+        W1 = vmul_s(x1, Pm1_1);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_1);
+        P_1 = W1;
+        vfmaeq_s(P_1, W2, R);
+        vfmaeq_s(y, P_1, f1);
+        
+        Pm2_2 = Pm1_2; Pm1_2 = P_2;
+        W1 = vmul_s(x2, Pm1_2);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_2);
+        P_2 = W1;
+        vfmaeq_s(P_2, W2, R);
+        vfmaeq_s(y, P_2, f2);
+        
+        Pm2_3 = Pm1_3; Pm1_3 = P_3;
+        W1 = vmul_s(x3, Pm1_3);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_3);
+        P_3 = W1;
+        vfmaeq_s(P_3, W2, R);
+        vfmaeq_s(y, P_3, f3);
+        
+        Pm2_4 = Pm1_4; Pm1_4 = P_4;
+        W1 = vmul_s(x4, Pm1_4);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_4);
+        P_4 = W1;
+        vfmaeq_s(P_4, W2, R);
+        vfmaeq_s(y, P_4, f4);
+        
+        Pm2_5 = Pm1_5; Pm1_5 = P_5;
+        W1 = vmul_s(x5, Pm1_5);
+        W2 = W1;
+        W2 = vsub_s(W2, Pm2_5);
+        P_5 = W1;
+        vfmaeq_s(P_5, W2, R);
+        vfmaeq_s(y, P_5, f5);
+        
+        vstoreu_s(acc + l * VLEN_s, y);
+    }
+}
+
+static void legendre_transform_adjoint_batch_vec6_s(float *recfacs, ptrdiff_t lmax,
+                                                            ptrdiff_t nf,
+                                                            float xarr[(6) * VLEN_s],
+                                                            float *farr,
+                                                            float *acc) {
+    /* farr holds nf consecutive chunks of (6) * VLEN_s entries, acc holds
+       nf consecutive sets of lmax + 1 partial sums of VLEN_s lanes. */
+    
+    Tv_s P_0, Pm1_0, Pm2_0, x0, f0;
+    
+    Tv_s P_1, Pm1_1, Pm2_1, x1, f1;
+    
+    Tv_s P_2, Pm1_2, Pm2_2, x2, f2;
+    
+    Tv_s P_3, Pm1_3, Pm2_3, x3, f3;
+    
+    Tv_s P_4, Pm1_4, Pm2_4, x4, f4;
+    
+    Tv_s P_5, Pm1_5, Pm2_5, x5, f5;
+    
+    Tv_s Pblock[SHARP_LEGENDRE_LBLOCK * 6];
+    Tv_s W1, W2, R, y;
+    float *acck;
+    ptrdiff_t l0, nl, j, k;
+
+    
+    x0 = vloadu_s(xarr + 0 * VLEN_s);
+    Pm1_0 = vload_s(1.0);
+    P_0 = x0;
+    
+    x1 = vloadu_s(xarr + 1 * VLEN_s);
+    Pm1_1 = vload_s(1.0);
+    P_1 = x1;
+    
+    x2 = vloadu_s(xarr + 2 * VLEN_s);
+    Pm1_2 = vload_s(1.0);
+    P_2 = x2;
+    
+    x3 = vloadu_s(xarr + 3 * VLEN_s);
+    Pm1_3 = vload_s(1.0);
+    P_3 = x3;
+    
+    x4 = vloadu_s(xarr + 4 * VLEN_s);
+    Pm1_4 = vload_s(1.0);
+    P_4 = x4;
+    
+    x5 = vloadu_s(xarr + 5 * VLEN_s);
+    Pm1_5 = vload_s(1.0);
+    P_5 = x5;
+    
+
+    for (l0 = 0; l0 <= lmax; l0 += SHARP_LEGENDRE_LBLOCK) {
+        nl = (lmax + 1 - l0 < SHARP_LEGENDRE_LBLOCK) ? (lmax + 1 - l0) : SHARP_LEGENDRE_LBLOCK;
+        j = 0;
+        if (l0 == 0) {
+            
+            Pblock[0] = Pm1_0;
+            
+            Pblock[1] = Pm1_1;
+            
+            Pblock[2] = Pm1_2;
+            
+            Pblock[3] = Pm1_3;
+            
+            Pblock[4] = Pm1_4;
+            
+            Pblock[5] = Pm1_5;
+            
+            if (nl > 1) {
+                
+                Pblock[6 + 0] = P_0;
+                
+                Pblock[6 + 1] = P_1;
+                
+                Pblock[6 + 2] = P_2;
+                
+                Pblock[6 + 3] = P_3;
+                
+                Pblock[6 + 4] = P_4;
+                
+                Pblock[6 + 5] = P_5;
+                
+            }
+            j = (nl > 1) ? 2 : 1;
+        }
+        for (; j != nl; ++j) {
+            R = vload_s(*(recfacs + l0 + j));
+            
+            Pm2_0 = Pm1_0; Pm1_0 = P_0;
+            W1 = vmul_s(x0, Pm1_0);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_0);
+            P_0 = W1;
+            vfmaeq_s(P_0, W2, R);
+            Pblock[j * 6 + 0] = P_0;
+            
+            Pm2_1 = Pm1_1; Pm1_1 = P_1;
+            W1 = vmul_s(x1, Pm1_1);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_1);
+            P_1 = W1;
+            vfmaeq_s(P_1, W2, R);
+            Pblock[j * 6 + 1] = P_1;
+            
+            Pm2_2 = Pm1_2; Pm1_2 = P_2;
+            W1 = vmul_s(x2, Pm1_2);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_2);
+            P_2 = W1;
+            vfmaeq_s(P_2, W2, R);
+            Pblock[j * 6 + 2] = P_2;
+            
+            Pm2_3 = Pm1_3; Pm1_3 = P_3;
+            W1 = vmul_s(x3, Pm1_3);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_3);
+            P_3 = W1;
+            vfmaeq_s(P_3, W2, R);
+            Pblock[j * 6 + 3] = P_3;
+            
+            Pm2_4 = Pm1_4; Pm1_4 = P_4;
+            W1 = vmul_s(x4, Pm1_4);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_4);
+            P_4 = W1;
+            vfmaeq_s(P_4, W2, R);
+            Pblock[j * 6 + 4] = P_4;
+            
+            Pm2_5 = Pm1_5; Pm1_5 = P_5;
+            W1 = vmul_s(x5, Pm1_5);
+            W2 = W1;
+            W2 = vsub_s(W2, Pm2_5);
+            P_5 = W1;
+            vfmaeq_s(P_5, W2, R);
+            Pblock[j * 6 + 5] = P_5;
+            
+        }
+
+        for (k = 0; k != nf; ++k) {
+            acck = acc + (k * (lmax + 1) + l0) * VLEN_s;
+            
+            f0 = vloadu_s(farr + (k * 6 + 0) * VLEN_s);
+            
+            f1 = vloadu_s(farr + (k * 6 + 1) * VLEN_s);
+            
+            f2 = vloadu_s(farr + (k * 6 + 2) * VLEN_s);
+            
+            f3 = vloadu_s(farr + (k * 6 + 3) * VLEN_s);
+            
+            f4 = vloadu_s(farr + (k * 6 + 4) * VLEN_s);
+            
+            f5 = vloadu_s(farr + (k * 6 + 5) * VLEN_s);
+            
+            for (j = 0; j != nl; ++j) {
+                y = vloadu_s(acck + j * VLEN_s);
+                
+                vfmaeq_s(y, Pblock[j * 6 + 0], f0);
+                
+                vfmaeq_s(y, Pblock[j * 6 + 1], f1);
+                
+                vfmaeq_s(y, Pblock[j * 6 + 2], f2);
+                
+                vfmaeq_s(y, Pblock[j * 6 + 3], f3);
+                
+                vfmaeq_s(y, Pblock[j * 6 + 4], f4);
+                
+                vfmaeq_s(y, Pblock[j * 6 + 5], f5);
+                
+                vstoreu_s(acck + j * VLEN_s, y);
+            }
+        }
+    }
+}
+
+
+
+
+void sharp_legendre_transform_recfac(double *r, ptrdiff_t lmax) {
+    /* (l - 1) / l, for l >= 2 */
+    ptrdiff_t l;
+    r[0] = 0;
+    r[1] = 1;
+    for (l = 2; l <= lmax; ++l) {
+        r[l] = (double)(l - 1) / (double)l;
+    }
+}
+
+void sharp_legendre_transform_recfac_s(float *r, ptrdiff_t lmax) {
+    /* (l - 1) / l, for l >= 2 */
+    ptrdiff_t l;
+    r[0] = 0;
+    r[1] = 1;
+    for (l = 2; l <= lmax; ++l) {
+        r[l] = (float)(l - 1) / (float)l;
+    }
+}
+
+
+/*
+  Compute sum_l b_l P_l(x_i) for all i. The x_i are split into chunks
+  of LEN entries which are distributed over the OpenMP threads.
+ */
+
+#define LEN (SHARP_LEGENDRE_CS * VLEN)
+#define LEN_s (SHARP_LEGENDRE_CS * VLEN_s)
+
+
+void sharp_legendre_transform(double *bl,
+                                   double *recfac,
+                                   ptrdiff_t lmax,
+                                   double *x, double *out, ptrdiff_t nx) {
+    int compute_recfac;
+    ptrdiff_t nchunks;
+
+    compute_recfac = (recfac == NULL);
+    if (compute_recfac) {
+        recfac = malloc(sizeof(double) * (lmax + 1));
+        sharp_legendre_transform_recfac(recfac, lmax);
+    }
+
+    nchunks = (nx + LEN - 1) / LEN;
+#pragma omp parallel
+{
+    double xchunk[MAX_CS * VLEN], outchunk[MAX_CS * VLEN];
+    ptrdiff_t ichunk, i, j, len;
+
+    for (j = 0; j != MAX_CS * VLEN; ++j) xchunk[j] = 0;
+
+#pragma omp for schedule(static)
+    for (ichunk = 0; ichunk < nchunks; ++ichunk) {
+        i = ichunk * LEN;
+        len = (i + (LEN) <= nx) ? (LEN) : (nx - i);
+        for (j = 0; j != len; ++j) xchunk[j] = x[i + j];
+        switch ((len + VLEN - 1) / VLEN) {
+          case 6: legendre_transform_vec6(recfac, bl, lmax, xchunk, outchunk); break;
+          case 5: legendre_transform_vec5(recfac, bl, lmax, xchunk, outchunk); break;
+          case 4: legendre_transform_vec4(recfac, bl, lmax, xchunk, outchunk); break;
+          case 3: legendre_transform_vec3(recfac, bl, lmax, xchunk, outchunk); break;
+          case 2: legendre_transform_vec2(recfac, bl, lmax, xchunk, outchunk); break;
+          case 1:
+          case 0:
+              legendre_transform_vec1(recfac, bl, lmax, xchunk, outchunk); break;
+        }
+        for (j = 0; j != len; ++j) out[i + j] = outchunk[j];
+    }
+} /* end of parallel region */
+
+    if (compute_recfac) {
+        free(recfac);
+    }
+}
+
+#define CLEN (SHARP_LEGENDRE_CLENSHAW_CS * VLEN)
+#define CLEN_s (SHARP_LEGENDRE_CLENSHAW_CS * VLEN_s)
+
+void sharp_legendre_transform_clenshaw(double *bl,
+                                            double *recfac,
+                                            ptrdiff_t lmax,
+                                            double *x, double *out, ptrdiff_t nx) {
+    double *ag;
+    ptrdiff_t l, nchunks;
+
+    ag = malloc(sizeof(double) * 2 * (lmax + 3));
+    if (recfac == NULL) {
+        sharp_legendre_transform_recfac(ag + lmax + 3, lmax);
+        recfac = ag + lmax + 3;
+    }
+    /* recfac may live in the upper half of ag, so fill from below */
+    for (l = 0; l <= lmax; ++l) {
+        double r = (l < 2) ? 0 : recfac[l];
+        ag[2 * l] = 1 + r;
+        ag[2 * l + 1] = -r;
+    }
+    for (l = lmax + 1; l <= lmax + 2; ++l) {
+        ag[2 * l] = (double)(2 * l - 1) / l;
+        ag[2 * l + 1] = -(double)(l - 1) / l;
+    }
+
+    nchunks = (nx + CLEN - 1) / CLEN;
+#pragma omp parallel
+{
+    double xchunk[MAX_CLENSHAW_CS * VLEN], outchunk[MAX_CLENSHAW_CS * VLEN];
+    ptrdiff_t ichunk, i, j, len;
+
+    for (j = 0; j != MAX_CLENSHAW_CS * VLEN; ++j) xchunk[j] = 0;
+
+#pragma omp for schedule(static)
+    for (ichunk = 0; ichunk < nchunks; ++ichunk) {
+        i = ichunk * CLEN;
+        len = (i + (CLEN) <= nx) ? (CLEN) : (nx - i);
+        for (j = 0; j != len; ++j) xchunk[j] = x[i + j];
+        switch ((len + VLEN - 1) / VLEN) {
+          
+          case 8: legendre_transform_clenshaw_vec8(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 7: legendre_transform_clenshaw_vec7(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 6: legendre_transform_clenshaw_vec6(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 5: legendre_transform_clenshaw_vec5(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 4: legendre_transform_clenshaw_vec4(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 3: legendre_transform_clenshaw_vec3(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 2: legendre_transform_clenshaw_vec2(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 1:
+          case 0:
+              legendre_transform_clenshaw_vec1(ag, bl, lmax, xchunk, outchunk); break;
+        }
+        for (j = 0; j != len; ++j) out[i + j] = outchunk[j];
+    }
+} /* end of parallel region */
+
+    free(ag);
+}
+
+void sharp_legendre_transform_batch(double *bl, ptrdiff_t bl_stride,
+                                         ptrdiff_t nbl,
+                                         double *recfac,
+                                         ptrdiff_t lmax,
+                                         double *x,
+                                         double *out, ptrdiff_t out_stride,
+                                         ptrdiff_t nx) {
+    int compute_recfac;
+    ptrdiff_t nchunks;
+
+    if (nbl == 1) {
+        sharp_legendre_transform(bl, recfac, lmax, x, out, nx);
+        return;
+    }
+    if (nbl <= 0) return;
+
+    compute_recfac = (recfac == NULL);
+    if (compute_recfac) {
+        recfac = malloc(sizeof(double) * (lmax + 1));
+        sharp_legendre_transform_recfac(recfac, lmax);
+    }
+
+    nchunks = (nx + LEN - 1) / LEN;
+#pragma omp parallel
+{
+    double xchunk[MAX_CS * VLEN], *outchunk;
+    ptrdiff_t ichunk, i, j, k, len, clen;
+
+    outchunk = malloc(sizeof(double) * nbl * LEN);
+    for (j = 0; j != MAX_CS * VLEN; ++j) xchunk[j] = 0;
+
+#pragma omp for schedule(static)
+    for (ichunk = 0; ichunk < nchunks; ++ichunk) {
+        i = ichunk * LEN;
+        len = (i + (LEN) <= nx) ? (LEN) : (nx - i);
+        for (j = 0; j != len; ++j) xchunk[j] = x[i + j];
+        clen = ((len + VLEN - 1) / VLEN) * VLEN;
+        memset(outchunk, 0, sizeof(double) * nbl * clen);
+        switch (clen / VLEN) {
+          case 6: legendre_transform_batch_vec6(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+          case 5: legendre_transform_batch_vec5(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+          case 4: legendre_transform_batch_vec4(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+          case 3: legendre_transform_batch_vec3(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+          case 2: legendre_transform_batch_vec2(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+          case 1:
+          case 0:
+              legendre_transform_batch_vec1(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+        }
+        for (k = 0; k != nbl; ++k)
+            for (j = 0; j != len; ++j)
+                out[k * out_stride + i + j] = outchunk[k * clen + j];
+    }
+    free(outchunk);
+} /* end of parallel region */
+
+    if (compute_recfac) {
+        free(recfac);
+    }
+}
+
+void sharp_legendre_transform_s(float *bl,
+                                   float *recfac,
+                                   ptrdiff_t lmax,
+                                   float *x, float *out, ptrdiff_t nx) {
+    int compute_recfac;
+    ptrdiff_t nchunks;
+
+    compute_recfac = (recfac == NULL);
+    if (compute_recfac) {
+        recfac = malloc(sizeof(float) * (lmax + 1));
+        sharp_legendre_transform_recfac_s(recfac, lmax);
+    }
+
+    nchunks = (nx + LEN_s - 1) / LEN_s;
+#pragma omp parallel
+{
+    float xchunk[MAX_CS * VLEN_s], outchunk[MAX_CS * VLEN_s];
+    ptrdiff_t ichunk, i, j, len;
+
+    for (j = 0; j != MAX_CS * VLEN_s; ++j) xchunk[j] = 0;
+
+#pragma omp for schedule(static)
+    for (ichunk = 0; ichunk < nchunks; ++ichunk) {
+        i = ichunk * LEN_s;
+        len = (i + (LEN_s) <= nx) ? (LEN_s) : (nx - i);
+        for (j = 0; j != len; ++j) xchunk[j] = x[i + j];
+        switch ((len + VLEN_s - 1) / VLEN_s) {
+          case 6: legendre_transform_vec6_s(recfac, bl, lmax, xchunk, outchunk); break;
+          case 5: legendre_transform_vec5_s(recfac, bl, lmax, xchunk, outchunk); break;
+          case 4: legendre_transform_vec4_s(recfac, bl, lmax, xchunk, outchunk); break;
+          case 3: legendre_transform_vec3_s(recfac, bl, lmax, xchunk, outchunk); break;
+          case 2: legendre_transform_vec2_s(recfac, bl, lmax, xchunk, outchunk); break;
+          case 1:
+          case 0:
+              legendre_transform_vec1_s(recfac, bl, lmax, xchunk, outchunk); break;
+        }
+        for (j = 0; j != len; ++j) out[i + j] = outchunk[j];
+    }
+} /* end of parallel region */
+
+    if (compute_recfac) {
+        free(recfac);
+    }
+}
+
+#define CLEN (SHARP_LEGENDRE_CLENSHAW_CS * VLEN)
+#define CLEN_s (SHARP_LEGENDRE_CLENSHAW_CS * VLEN_s)
+
+void sharp_legendre_transform_clenshaw_s(float *bl,
+                                            float *recfac,
+                                            ptrdiff_t lmax,
+                                            float *x, float *out, ptrdiff_t nx) {
+    float *ag;
+    ptrdiff_t l, nchunks;
+
+    ag = malloc(sizeof(float) * 2 * (lmax + 3));
+    if (recfac == NULL) {
+        sharp_legendre_transform_recfac_s(ag + lmax + 3, lmax);
+        recfac = ag + lmax + 3;
+    }
+    /* recfac may live in the upper half of ag, so fill from below */
+    for (l = 0; l <= lmax; ++l) {
+        float r = (l < 2) ? 0 : recfac[l];
+        ag[2 * l] = 1 + r;
+        ag[2 * l + 1] = -r;
+    }
+    for (l = lmax + 1; l <= lmax + 2; ++l) {
+        ag[2 * l] = (float)(2 * l - 1) / l;
+        ag[2 * l + 1] = -(float)(l - 1) / l;
+    }
+
+    nchunks = (nx + CLEN_s - 1) / CLEN_s;
+#pragma omp parallel
+{
+    float xchunk[MAX_CLENSHAW_CS * VLEN_s], outchunk[MAX_CLENSHAW_CS * VLEN_s];
+    ptrdiff_t ichunk, i, j, len;
+
+    for (j = 0; j != MAX_CLENSHAW_CS * VLEN_s; ++j) xchunk[j] = 0;
+
+#pragma omp for schedule(static)
+    for (ichunk = 0; ichunk < nchunks; ++ichunk) {
+        i = ichunk * CLEN_s;
+        len = (i + (CLEN_s) <= nx) ? (CLEN_s) : (nx - i);
+        for (j = 0; j != len; ++j) xchunk[j] = x[i + j];
+        switch ((len + VLEN_s - 1) / VLEN_s) {
+          
+          case 8: legendre_transform_clenshaw_vec8_s(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 7: legendre_transform_clenshaw_vec7_s(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 6: legendre_transform_clenshaw_vec6_s(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 5: legendre_transform_clenshaw_vec5_s(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 4: legendre_transform_clenshaw_vec4_s(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 3: legendre_transform_clenshaw_vec3_s(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 2: legendre_transform_clenshaw_vec2_s(ag, bl, lmax, xchunk, outchunk); break;
+          
+          case 1:
+          case 0:
+              legendre_transform_clenshaw_vec1_s(ag, bl, lmax, xchunk, outchunk); break;
+        }
+        for (j = 0; j != len; ++j) out[i + j] = outchunk[j];
+    }
+} /* end of parallel region */
+
+    free(ag);
+}
+
+void sharp_legendre_transform_batch_s(float *bl, ptrdiff_t bl_stride,
+                                         ptrdiff_t nbl,
+                                         float *recfac,
+                                         ptrdiff_t lmax,
+                                         float *x,
+                                         float *out, ptrdiff_t out_stride,
+                                         ptrdiff_t nx) {
+    int compute_recfac;
+    ptrdiff_t nchunks;
+
+    if (nbl == 1) {
+        sharp_legendre_transform_s(bl, recfac, lmax, x, out, nx);
+        return;
+    }
+    if (nbl <= 0) return;
+
+    compute_recfac = (recfac == NULL);
+    if (compute_recfac) {
+        recfac = malloc(sizeof(float) * (lmax + 1));
+        sharp_legendre_transform_recfac_s(recfac, lmax);
+    }
+
+    nchunks = (nx + LEN_s - 1) / LEN_s;
+#pragma omp parallel
+{
+    float xchunk[MAX_CS * VLEN_s], *outchunk;
+    ptrdiff_t ichunk, i, j, k, len, clen;
+
+    outchunk = malloc(sizeof(float) * nbl * LEN_s);
+    for (j = 0; j != MAX_CS * VLEN_s; ++j) xchunk[j] = 0;
+
+#pragma omp for schedule(static)
+    for (ichunk = 0; ichunk < nchunks; ++ichunk) {
+        i = ichunk * LEN_s;
+        len = (i + (LEN_s) <= nx) ? (LEN_s) : (nx - i);
+        for (j = 0; j != len; ++j) xchunk[j] = x[i + j];
+        clen = ((len + VLEN_s - 1) / VLEN_s) * VLEN_s;
+        memset(outchunk, 0, sizeof(float) * nbl * clen);
+        switch (clen / VLEN_s) {
+          case 6: legendre_transform_batch_vec6_s(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+          case 5: legendre_transform_batch_vec5_s(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+          case 4: legendre_transform_batch_vec4_s(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+          case 3: legendre_transform_batch_vec3_s(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+          case 2: legendre_transform_batch_vec2_s(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+          case 1:
+          case 0:
+              legendre_transform_batch_vec1_s(recfac, bl, bl_stride, nbl, lmax, xchunk, outchunk); break;
+        }
+        for (k = 0; k != nbl; ++k)
+            for (j = 0; j != len; ++j)
+                out[k * out_stride + i + j] = outchunk[k * clen + j];
+    }
+    free(outchunk);
+} /* end of parallel region */
+
+    if (compute_recfac) {
+        free(recfac);
+    }
+}
+
+
+/*
+  Compute sum_i w_i f_i P_l(x_i) for all l, the adjoint of the above.
+  The work is split into tasks, each covering a group of at most ADJ_NF
+  functions and a block of the x chunks; the x are only split into blocks
+  until there are ADJ_NTASK tasks. A task sums over its chunks into out
+  (first block) or into a buffer (other blocks), which is added to out in
+  block order at the end. The result therefore does not depend on the
+  number of threads or on scheduling.
+ */
+
+#define ADJ_NF 32
+#define ADJ_NTASK 64
+
+
+void sharp_legendre_transform_adjoint_batch(double *f, ptrdiff_t f_stride,
+                                                 ptrdiff_t nf,
+                                                 double *w,
+                                                 double *recfac,
+                                                 ptrdiff_t lmax,
+                                                 double *x,
+                                                 double *out, ptrdiff_t out_stride,
+                                                 ptrdiff_t nx) {
+    int compute_recfac;
+    ptrdiff_t nchunks, ngroups, nblocks, ntasks;
+    double *part;
+
+    if (nf <= 0) return;
+
+    compute_recfac = (recfac == NULL);
+    if (compute_recfac) {
+        recfac = malloc(sizeof(double) * (lmax + 1));
+        sharp_legendre_transform_recfac(recfac, lmax);
+    }
+
+    nchunks = (nx + LEN - 1) / LEN;
+    ngroups = (nf + ADJ_NF - 1) / ADJ_NF;
+    nblocks = (ADJ_NTASK + ngroups - 1) / ngroups;
+    if (nblocks > nchunks) nblocks = nchunks;
+    if (nblocks < 1) nblocks = 1;
+    ntasks = ngroups * nblocks;
+    /* sums of the blocks after the first, (nblocks - 1) * nf rows of lmax + 1 */
+    part = (nblocks > 1) ? malloc(sizeof(double) * (nblocks - 1) * nf * (lmax + 1))
+                         : NULL;
+
+#pragma omp parallel
+{
+    double xchunk[MAX_CS * VLEN], *fchunk, *acc, *dst;
+    ptrdiff_t itask, ichunk, i, j, k, l, b, k0, nk, len, clen, dst_stride;
+
+    fchunk = malloc(sizeof(double) * ADJ_NF * LEN);
+    acc = malloc(sizeof(double) * ADJ_NF * (lmax + 1) * VLEN);
+    for (j = 0; j != MAX_CS * VLEN; ++j) xchunk[j] = 0;
+
+#pragma omp for schedule(dynamic, 1)
+    for (itask = 0; itask < ntasks; ++itask) {
+        b = itask % nblocks;
+        k0 = (itask / nblocks) * ADJ_NF;
+        nk = (nf - k0 < ADJ_NF) ? (nf - k0) : ADJ_NF;
+        for (j = 0; j != nk * (lmax + 1) * VLEN; ++j) acc[j] = 0;
+
+        for (ichunk = nchunks * b / nblocks; ichunk < nchunks * (b + 1) / nblocks; ++ichunk) {
+            i = ichunk * LEN;
+            len = (i + (LEN) <= nx) ? (LEN) : (nx - i);
+            clen = ((len + VLEN - 1) / VLEN) * VLEN;
+            for (j = 0; j != len; ++j) xchunk[j] = x[i + j];
+            for (k = 0; k != nk; ++k) {
+                for (j = 0; j != len; ++j)
+                    fchunk[k * clen + j] = (w == NULL) ? f[(k0 + k) * f_stride + i + j]
+                                                       : w[i + j] * f[(k0 + k) * f_stride + i + j];
+                for (j = len; j != clen; ++j) fchunk[k * clen + j] = 0;
+            }
+            if (nk == 1) {
+                switch (clen / VLEN) {
+                  case 6: legendre_transform_adjoint_vec6(recfac, lmax, xchunk, fchunk, acc); break;
+                  case 5: legendre_transform_adjoint_vec5(recfac, lmax, xchunk, fchunk, acc); break;
+                  case 4: legendre_transform_adjoint_vec4(recfac, lmax, xchunk, fchunk, acc); break;
+                  case 3: legendre_transform_adjoint_vec3(recfac, lmax, xchunk, fchunk, acc); break;
+                  case 2: legendre_transform_adjoint_vec2(recfac, lmax, xchunk, fchunk, acc); break;
+                  case 1:
+                  case 0:
+                      legendre_transform_adjoint_vec1(recfac, lmax, xchunk, fchunk, acc); break;
+                }
+            } else {
+                switch (clen / VLEN) {
+                  case 6: legendre_transform_adjoint_batch_vec6(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                  case 5: legendre_transform_adjoint_batch_vec5(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                  case 4: legendre_transform_adjoint_batch_vec4(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                  case 3: legendre_transform_adjoint_batch_vec3(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                  case 2: legendre_transform_adjoint_batch_vec2(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                  case 1:
+                  case 0:
+                      legendre_transform_adjoint_batch_vec1(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                }
+            }
+        }
+
+        if (b == 0) {
+            dst = out + k0 * out_stride;
+            dst_stride = out_stride;
+        } else {
+            dst = part + ((b - 1) * nf + k0) * (lmax + 1);
+            dst_stride = lmax + 1;
+        }
+        for (k = 0; k != nk; ++k)
+            for (l = 0; l <= lmax; ++l) {
+                double sum = 0;
+                for (j = 0; j != VLEN; ++j)
+                    sum += acc[(k * (lmax + 1) + l) * VLEN + j];
+                dst[k * dst_stride + l] = sum;
+            }
+    }
+
+    if (nblocks > 1) {
+#pragma omp for schedule(static)
+        for (k = 0; k < nf; ++k)
+            for (b = 1; b < nblocks; ++b)
+                for (l = 0; l <= lmax; ++l)
+                    out[k * out_stride + l] += part[((b - 1) * nf + k) * (lmax + 1) + l];
+    }
+
+    free(acc);
+    free(fchunk);
+} /* end of parallel region */
+
+    free(part);
+    if (compute_recfac) {
+        free(recfac);
+    }
+}
+
+void sharp_legendre_transform_adjoint(double *f, double *w,
+                                           double *recfac,
+                                           ptrdiff_t lmax,
+                                           double *x, double *out, ptrdiff_t nx) {
+    sharp_legendre_transform_adjoint_batch(f, nx, 1, w, recfac, lmax, x, out, lmax + 1, nx);
+}
+
+void sharp_legendre_transform_adjoint_batch_s(float *f, ptrdiff_t f_stride,
+                                                 ptrdiff_t nf,
+                                                 float *w,
+                                                 float *recfac,
+                                                 ptrdiff_t lmax,
+                                                 float *x,
+                                                 float *out, ptrdiff_t out_stride,
+                                                 ptrdiff_t nx) {
+    int compute_recfac;
+    ptrdiff_t nchunks, ngroups, nblocks, ntasks;
+    float *part;
+
+    if (nf <= 0) return;
+
+    compute_recfac = (recfac == NULL);
+    if (compute_recfac) {
+        recfac = malloc(sizeof(float) * (lmax + 1));
+        sharp_legendre_transform_recfac_s(recfac, lmax);
+    }
+
+    nchunks = (nx + LEN_s - 1) / LEN_s;
+    ngroups = (nf + ADJ_NF - 1) / ADJ_NF;
+    nblocks = (ADJ_NTASK + ngroups - 1) / ngroups;
+    if (nblocks > nchunks) nblocks = nchunks;
+    if (nblocks < 1) nblocks = 1;
+    ntasks = ngroups * nblocks;
+    /* sums of the blocks after the first, (nblocks - 1) * nf rows of lmax + 1 */
+    part = (nblocks > 1) ? malloc(sizeof(float) * (nblocks - 1) * nf * (lmax + 1))
+                         : NULL;
+
+#pragma omp parallel
+{
+    float xchunk[MAX_CS * VLEN_s], *fchunk, *acc, *dst;
+    ptrdiff_t itask, ichunk, i, j, k, l, b, k0, nk, len, clen, dst_stride;
+
+    fchunk = malloc(sizeof(float) * ADJ_NF * LEN_s);
+    acc = malloc(sizeof(float) * ADJ_NF * (lmax + 1) * VLEN_s);
+    for (j = 0; j != MAX_CS * VLEN_s; ++j) xchunk[j] = 0;
+
+#pragma omp for schedule(dynamic, 1)
+    for (itask = 0; itask < ntasks; ++itask) {
+        b = itask % nblocks;
+        k0 = (itask / nblocks) * ADJ_NF;
+        nk = (nf - k0 < ADJ_NF) ? (nf - k0) : ADJ_NF;
+        for (j = 0; j != nk * (lmax + 1) * VLEN_s; ++j) acc[j] = 0;
+
+        for (ichunk = nchunks * b / nblocks; ichunk < nchunks * (b + 1) / nblocks; ++ichunk) {
+            i = ichunk * LEN_s;
+            len = (i + (LEN_s) <= nx) ? (LEN_s) : (nx - i);
+            clen = ((len + VLEN_s - 1) / VLEN_s) * VLEN_s;
+            for (j = 0; j != len; ++j) xchunk[j] = x[i + j];
+            for (k = 0; k != nk; ++k) {
+                for (j = 0; j != len; ++j)
+                    fchunk[k * clen + j] = (w == NULL) ? f[(k0 + k) * f_stride + i + j]
+                                                       : w[i + j] * f[(k0 + k) * f_stride + i + j];
+                for (j = len; j != clen; ++j) fchunk[k * clen + j] = 0;
+            }
+            if (nk == 1) {
+                switch (clen / VLEN_s) {
+                  case 6: legendre_transform_adjoint_vec6_s(recfac, lmax, xchunk, fchunk, acc); break;
+                  case 5: legendre_transform_adjoint_vec5_s(recfac, lmax, xchunk, fchunk, acc); break;
+                  case 4: legendre_transform_adjoint_vec4_s(recfac, lmax, xchunk, fchunk, acc); break;
+                  case 3: legendre_transform_adjoint_vec3_s(recfac, lmax, xchunk, fchunk, acc); break;
+                  case 2: legendre_transform_adjoint_vec2_s(recfac, lmax, xchunk, fchunk, acc); break;
+                  case 1:
+                  case 0:
+                      legendre_transform_adjoint_vec1_s(recfac, lmax, xchunk, fchunk, acc); break;
+                }
+            } else {
+                switch (clen / VLEN_s) {
+                  case 6: legendre_transform_adjoint_batch_vec6_s(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                  case 5: legendre_transform_adjoint_batch_vec5_s(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                  case 4: legendre_transform_adjoint_batch_vec4_s(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                  case 3: legendre_transform_adjoint_batch_vec3_s(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                  case 2: legendre_transform_adjoint_batch_vec2_s(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                  case 1:
+                  case 0:
+                      legendre_transform_adjoint_batch_vec1_s(recfac, lmax, nk, xchunk, fchunk, acc); break;
+                }
+            }
+        }
+
+        if (b == 0) {
+            dst = out + k0 * out_stride;
+            dst_stride = out_stride;
+        } else {
+            dst = part + ((b - 1) * nf + k0) * (lmax + 1);
+            dst_stride = lmax + 1;
+        }
+        for (k = 0; k != nk; ++k)
+            for (l = 0; l <= lmax; ++l) {
+                float sum = 0;
+                for (j = 0; j != VLEN_s; ++j)
+                    sum += acc[(k * (lmax + 1) + l) * VLEN_s + j];
+                dst[k * dst_stride + l] = sum;
+            }
+    }
+
+    if (nblocks > 1) {
+#pragma omp for schedule(static)
+        for (k = 0; k < nf; ++k)
+            for (b = 1; b < nblocks; ++b)
+                for (l = 0; l <= lmax; ++l)
+                    out[k * out_stride + l] += part[((b - 1) * nf + k) * (lmax + 1) + l];
+    }
+
+    free(acc);
+    free(fchunk);
+} /* end of parallel region */
+
+    free(part);
+    if (compute_recfac) {
+        free(recfac);
+    }
+}
+
+void sharp_legendre_transform_adjoint_s(float *f, float *w,
+                                           float *recfac,
+                                           ptrdiff_t lmax,
+                                           float *x, float *out, ptrdiff_t nx) {
+    sharp_legendre_transform_adjoint_batch_s(f, nx, 1, w, recfac, lmax, x, out, lmax + 1, nx);
+}
+
+
+/*
+  Precomputed tables. The x_i are padded to blocks of TXB entries; for each
+  block the table holds P_l(x_i) for all l, with the TXB values of one l
+  contiguous. Transforms then become cache-blocked matrix products: for each
+  x block and each block of TLB values of l, every b_l vector is streamed
+  against the (L1-resident) table block, four vectors at a time.
+ */
+
+#define TXB (2 * VLEN)
+
+#ifndef SHARP_LEGENDRE_TABLE_LBLOCK
+#define SHARP_LEGENDRE_TABLE_LBLOCK 256
+#endif
+#define TLB SHARP_LEGENDRE_TABLE_LBLOCK
+
+/* Largest table (in bytes) built by sharp_legendre_make_plan() when the
+   choice is left to the library. Streaming a table from main memory is no
+   faster than the recursion, so this is of the order of the cache size. */
+#ifndef SHARP_LEGENDRE_TABLE_MAXMEM
+#define SHARP_LEGENDRE_TABLE_MAXMEM (8 * 1024 * 1024)
+#endif
+
+struct sharp_legendre_plan_s {
+    ptrdiff_t lmax, nx, nxb;
+    double *x, *recfac;
+    double *table;  /* nxb * (lmax + 1) * TXB entries, or NULL */
+    float *table_s; /* same, in single precision, or NULL */
+};
+
+static void legendre_table_build_block(const double *recfac, ptrdiff_t lmax,
+                                       const double *xblock, double *P) {
+    Tv x0, x1, Pm1_0, Pm1_1, P_0, P_1, Pm2, W, R;
+    ptrdiff_t l;
+
+    x0 = vloadu(xblock); x1 = vloadu(xblock + VLEN);
+    Pm1_0 = Pm1_1 = vload(1.0);
+    P_0 = x0; P_1 = x1;
+    vstoreu(P, Pm1_0); vstoreu(P + VLEN, Pm1_1);
+    if (lmax == 0) return;
+    vstoreu(P + TXB, P_0); vstoreu(P + TXB + VLEN, P_1);
+    for (l = 2; l <= lmax; ++l) {
+        R = vload(recfac[l]);
+        Pm2 = Pm1_0; Pm1_0 = P_0;
+        W = vmul(x0, Pm1_0);
+        P_0 = W;
+        vfmaeq(P_0, vsub(W, Pm2), R);
+        Pm2 = Pm1_1; Pm1_1 = P_1;
+        W = vmul(x1, Pm1_1);
+        P_1 = W;
+        vfmaeq(P_1, vsub(W, Pm2), R);
+        vstoreu(P + l * TXB, P_0); vstoreu(P + l * TXB + VLEN, P_1);
+    }
+}
+
+/* acc[k * TXB + j] += sum_{l < nl} b_k[l] P[l * TXB + j] for k < 4 */
+static void legendre_table_kernel4(const double *P, ptrdiff_t nl,
+                                   const double *b0, const double *b1,
+                                   const double *b2, const double *b3,
+                                   double *acc) {
+    Tv a00, a01, a10, a11, a20, a21, a30, a31, p0, p1, b;
+    ptrdiff_t l;
+
+    a00 = vloadu(acc);           a01 = vloadu(acc + VLEN);
+    a10 = vloadu(acc + TXB);     a11 = vloadu(acc + TXB + VLEN);
+    a20 = vloadu(acc + 2 * TXB); a21 = vloadu(acc + 2 * TXB + VLEN);
+    a30 = vloadu(acc + 3 * TXB); a31 = vloadu(acc + 3 * TXB + VLEN);
+    for (l = 0; l < nl; ++l) {
+        p0 = vloadu(P + l * TXB); p1 = vloadu(P + l * TXB + VLEN);
+        b = vload(b0[l]); vfmaeq(a00, p0, b); vfmaeq(a01, p1, b);
+        b = vload(b1[l]); vfmaeq(a10, p0, b); vfmaeq(a11, p1, b);
+        b = vload(b2[l]); vfmaeq(a20, p0, b); vfmaeq(a21, p1, b);
+        b = vload(b3[l]); vfmaeq(a30, p0, b); vfmaeq(a31, p1, b);
+    }
+    vstoreu(acc, a00);           vstoreu(acc + VLEN, a01);
+    vstoreu(acc + TXB, a10);     vstoreu(acc + TXB + VLEN, a11);
+    vstoreu(acc + 2 * TXB, a20); vstoreu(acc + 2 * TXB + VLEN, a21);
+    vstoreu(acc + 3 * TXB, a30); vstoreu(acc + 3 * TXB + VLEN, a31);
+}
+
+static void legendre_table_kernel1(const double *P, ptrdiff_t nl,
+                                   const double *b0, double *acc) {
+    Tv a00, a01, a10, a11, b;
+    ptrdiff_t l;
+
+    /* two independent accumulator pairs to hide the FMA latency */
+    a00 = vloadu(acc); a01 = vloadu(acc + VLEN);
+    a10 = a11 = vload(0.0);
+    for (l = 0; l + 1 < nl; l += 2) {
+        b = vload(b0[l]);
+        vfmaeq(a00, vloadu(P + l * TXB), b);
+        vfmaeq(a01, vloadu(P + l * TXB + VLEN), b);
+        b = vload(b0[l + 1]);
+        vfmaeq(a10, vloadu(P + (l + 1) * TXB), b);
+        vfmaeq(a11, vloadu(P + (l + 1) * TXB + VLEN), b);
+    }
+    if (l < nl) {
+        b = vload(b0[l]);
+        vfmaeq(a00, vloadu(P + l * TXB), b);
+        vfmaeq(a01, vloadu(P + l * TXB + VLEN), b);
+    }
+    vstoreu(acc, vadd(a00, a10)); vstoreu(acc + VLEN, vadd(a01, a11));
+}
+
+void sharp_legendre_make_plan(ptrdiff_t lmax, double *x, ptrdiff_t nx,
+                              ptrdiff_t nreuse, int flags,
+                              sharp_legendre_plan **plan) {
+    sharp_legendre_plan *p = malloc(sizeof(sharp_legendre_plan));
+    ptrdiff_t i, ib, nentries;
+    size_t nbytes;
+    int use_table;
+
+    p->lmax = lmax;
+    p->nx = nx;
+    p->nxb = (nx + TXB - 1) / TXB;
+    p->x = malloc(sizeof(double) * (p->nxb * TXB + 1));
+    for (i = 0; i != p->nxb * TXB; ++i) p->x[i] = (i < nx) ? x[i] : 0;
+    p->recfac = malloc(sizeof(double) * (lmax + 1));
+    sharp_legendre_transform_recfac(p->recfac, lmax);
+    p->table = NULL;
+    p->table_s = NULL;
+
+    nentries = p->nxb * (lmax + 1) * TXB;
+    nbytes = nentries * ((flags & SHARP_LEGENDRE_PLAN_FLOAT) ? sizeof(float)
+                                                             : sizeof(double));
+    if (flags & SHARP_LEGENDRE_PLAN_TABLE)
+        use_table = 1;
+    else if (flags & SHARP_LEGENDRE_PLAN_RECURSION)
+        use_table = 0;
+    else
+        /* building the table costs about as much as one transform by
+           recursion; the single precision table is only used on request,
+           since converting it back costs about as much as it saves */
+        use_table = (nreuse > 1) && (nbytes <= SHARP_LEGENDRE_TABLE_MAXMEM);
+
+    if (use_table) {
+        if (flags & SHARP_LEGENDRE_PLAN_FLOAT)
+            p->table_s = malloc(nbytes);
+        else
+            p->table = malloc(nbytes);
+#pragma omp parallel
+{
+        double *buf = (p->table == NULL) ? malloc(sizeof(double) * (lmax + 1) * TXB) : NULL;
+        ptrdiff_t j;
+#pragma omp for schedule(static)
+        for (ib = 0; ib < p->nxb; ++ib) {
+            if (p->table != NULL) {
+                legendre_table_build_block(p->recfac, lmax, p->x + ib * TXB,
+                                           p->table + ib * (lmax + 1) * TXB);
+            } else {
+                legendre_table_build_block(p->recfac, lmax, p->x + ib * TXB, buf);
+                for (j = 0; j != (lmax + 1) * TXB; ++j)
+                    p->table_s[ib * (lmax + 1) * TXB + j] = (float)buf[j];
+            }
+        }
+        free(buf);
+} /* end of parallel region */
+    }
+    *plan = p;
+}
+
+void sharp_legendre_destroy_plan(sharp_legendre_plan *plan) {
+    free(plan->table);
+    free(plan->table_s);
+    free(plan->recfac);
+    free(plan->x);
+    free(plan);
+}
+
+int sharp_legendre_plan_uses_table(const sharp_legendre_plan *plan) {
+    return (plan->table != NULL) || (plan->table_s != NULL);
+}
+
+void sharp_legendre_execute_plan(const sharp_legendre_plan *plan, double *bl,
+                                 ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                 double *out, ptrdiff_t out_stride) {
+    ptrdiff_t lmax = plan->lmax, nx = plan->nx;
+
+    if (nbl <= 0) return;
+    if (!sharp_legendre_plan_uses_table(plan)) {
+        sharp_legendre_transform_batch(bl, bl_stride, nbl, plan->recfac, lmax,
+                                       plan->x, out, out_stride, nx);
+        return;
+    }
+
+#pragma omp parallel
+{
+    double *acc = malloc(sizeof(double) * nbl * TXB);
+    double *Pbuf = (plan->table == NULL) ? malloc(sizeof(double) * TLB * TXB) : NULL;
+    ptrdiff_t ib, l0, nl, k, j, len;
+    const double *P;
+
+#pragma omp for schedule(static)
+    for (ib = 0; ib < plan->nxb; ++ib) {
+        memset(acc, 0, sizeof(double) * nbl * TXB);
+        for (l0 = 0; l0 <= lmax; l0 += TLB) {
+            nl = (l0 + TLB <= lmax + 1) ? TLB : (lmax + 1 - l0);
+            if (plan->table != NULL) {
+                P = plan->table + (ib * (lmax + 1) + l0) * TXB;
+            } else {
+                const float *Ps = plan->table_s + (ib * (lmax + 1) + l0) * TXB;
+                for (j = 0; j != nl * TXB; ++j) Pbuf[j] = Ps[j];
+                P = Pbuf;
+            }
+            for (k = 0; k + 4 <= nbl; k += 4)
+                legendre_table_kernel4(P, nl, bl + k * bl_stride + l0,
+                                       bl + (k + 1) * bl_stride + l0,
+                                       bl + (k + 2) * bl_stride + l0,
+                                       bl + (k + 3) * bl_stride + l0, acc + k * TXB);
+            for (; k < nbl; ++k)
+                legendre_table_kernel1(P, nl, bl + k * bl_stride + l0, acc + k * TXB);
+        }
+        len = (ib * TXB + TXB <= nx) ? TXB : (nx - ib * TXB);
+        for (k = 0; k != nbl; ++k)
+            for (j = 0; j != len; ++j)
+                out[k * out_stride + ib * TXB + j] = acc[k * TXB + j];
+    }
+    free(Pbuf);
+    free(acc);
+} /* end of parallel region */
+}
 
 #endif
\ No newline at end of file
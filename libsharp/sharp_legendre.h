@@ -53,6 +53,89 @@ void sharp_legendre_transform_s(float *bl, float *recfac, ptrdiff_t lmax, float
 void sharp_legendre_transform_recfac(double *r, ptrdiff_t lmax);
 void sharp_legendre_transform_recfac_s(float *r, ptrdiff_t lmax);
 
+/*! Computes the same as sharp_legendre_transform(), but by Clenshaw's backward
+    summation. This keeps only two recursion values per vector of x in
+    registers, so the x values are processed in larger chunks
+    (SHARP_LEGENDRE_CLENSHAW_CS vectors, default 8, versus SHARP_LEGENDRE_CS)
+    and each degree costs one operation less. Which of the two is faster
+    depends on the instruction set; see "sharp_testsuite legbench".
+    \param recfac may be NULL, in which case it is computed internally. */
+void sharp_legendre_transform_clenshaw(double *bl, double *recfac, ptrdiff_t lmax,
+                                       double *x, double *out, ptrdiff_t nx);
+/*! Single precision version of sharp_legendre_transform_clenshaw(). */
+void sharp_legendre_transform_clenshaw_s(float *bl, float *recfac, ptrdiff_t lmax,
+                                         float *x, float *out, ptrdiff_t nx);
+
+/*! Computes \a out[k*out_stride+i] = sum_l \a bl[k*bl_stride+l] P_l(\a x[i])
+    for \a nbl coefficient vectors at once, sharing the Legendre recursion
+    between them. Work is distributed over OpenMP threads by chunks of \a x.
+    \param recfac may be NULL, in which case it is computed internally. */
+void sharp_legendre_transform_batch(double *bl, ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                    double *recfac, ptrdiff_t lmax, double *x,
+                                    double *out, ptrdiff_t out_stride, ptrdiff_t nx);
+/*! Single precision version of sharp_legendre_transform_batch(). */
+void sharp_legendre_transform_batch_s(float *bl, ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                      float *recfac, ptrdiff_t lmax, float *x,
+                                      float *out, ptrdiff_t out_stride, ptrdiff_t nx);
+
+/*! Computes \a out[l] = sum_i \a w[i] \a f[i] P_l(\a x[i]) for 0<=l<=\a lmax,
+    i.e. the adjoint of sharp_legendre_transform(). With Gauss-Legendre nodes
+    and weights this is the inverse transform up to the factors (2l+1)/2.
+    \param w quadrature weights; may be NULL, in which case all weights are 1.
+    \param recfac may be NULL, in which case it is computed internally. */
+void sharp_legendre_transform_adjoint(double *f, double *w, double *recfac,
+                                      ptrdiff_t lmax, double *x, double *out,
+                                      ptrdiff_t nx);
+/*! Single precision version of sharp_legendre_transform_adjoint(). */
+void sharp_legendre_transform_adjoint_s(float *f, float *w, float *recfac,
+                                        ptrdiff_t lmax, float *x, float *out,
+                                        ptrdiff_t nx);
+/*! Computes \a out[k*out_stride+l] = sum_i \a w[i] \a f[k*f_stride+i] P_l(\a x[i])
+    for \a nf input vectors at once, sharing the Legendre recursion between
+    them. */
+void sharp_legendre_transform_adjoint_batch(double *f, ptrdiff_t f_stride,
+                                            ptrdiff_t nf, double *w, double *recfac,
+                                            ptrdiff_t lmax, double *x, double *out,
+                                            ptrdiff_t out_stride, ptrdiff_t nx);
+/*! Single precision version of sharp_legendre_transform_adjoint_batch(). */
+void sharp_legendre_transform_adjoint_batch_s(float *f, ptrdiff_t f_stride,
+                                              ptrdiff_t nf, float *w, float *recfac,
+                                              ptrdiff_t lmax, float *x, float *out,
+                                              ptrdiff_t out_stride, ptrdiff_t nx);
+
+/*! A plan for repeated Legendre transforms at fixed \a lmax and x. */
+typedef struct sharp_legendre_plan_s sharp_legendre_plan;
+
+/*! Flags for sharp_legendre_make_plan() */
+enum { SHARP_LEGENDRE_PLAN_RECURSION = 1, /*!< always evaluate P_l(x) by recursion */
+       SHARP_LEGENDRE_PLAN_TABLE     = 2, /*!< always precompute the P_l(x) table */
+       SHARP_LEGENDRE_PLAN_FLOAT     = 4  /*!< store the table in single precision;
+                                               accumulation is still done in double
+                                               precision */
+     };
+
+/*! Creates a plan for computing sum_l b_l P_l(x[i]) for the \a nx values in
+    \a x (which are copied). Unless forced by \a flags, the plan precomputes
+    the table of P_l(x[i]) if at least two transforms (\a nreuse) are expected
+    and the table takes no more than SHARP_LEGENDRE_TABLE_MAXMEM bytes (8 MB by
+    default: tables that do not fit into the cache are no faster than the
+    recursion); otherwise every transform runs the recursion of
+    sharp_legendre_transform_batch(). The table is stored in blocks of x, so
+    that transforms become cache-blocked matrix-vector (or, for several b_l
+    vectors, matrix-matrix) products. */
+void sharp_legendre_make_plan(ptrdiff_t lmax, double *x, ptrdiff_t nx,
+                              ptrdiff_t nreuse, int flags,
+                              sharp_legendre_plan **plan);
+/*! Deallocates a plan created by sharp_legendre_make_plan(). */
+void sharp_legendre_destroy_plan(sharp_legendre_plan *plan);
+/*! Returns 1 if \a plan has precomputed its table, else 0. */
+int sharp_legendre_plan_uses_table(const sharp_legendre_plan *plan);
+/*! Computes \a out[k*out_stride+i] = sum_l \a bl[k*bl_stride+l] P_l(x[i]) for
+    \a nbl coefficient vectors, like sharp_legendre_transform_batch(). */
+void sharp_legendre_execute_plan(const sharp_legendre_plan *plan, double *bl,
+                                 ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                 double *out, ptrdiff_t out_stride);
+
 #endif
 
 #ifdef __cplusplus
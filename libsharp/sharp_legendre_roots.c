@@ -1,19 +1,31 @@
-/* Function adapted from GNU GSL file glfixed.c
+/* Newton iteration adapted from GNU GSL file glfixed.c
    Original author: Pavel Holoborodko (http://www.holoborodko.com)
 
    Adjustments by M. Reinecke
     - adjusted interface (keep epsilon internal, return full number of points)
     - removed precomputed tables
-    - tweaked Newton iteration to obtain higher accuracy */
+    - tweaked Newton iteration to obtain higher accuracy
+
+   For large n, the nodes and weights are instead obtained without iteration
+   from the asymptotic expansions of
+     I. Bogaert, "Iteration-free computation of Gauss-Legendre quadrature
+     nodes and weights", SIAM J. Sci. Comput. 36 (2014), A1008-A1026,
+   which reduces the cost from O(n^2) to O(n). */
 
 #include <math.h>
 #include "sharp_legendre_roots.h"
 #include "c_utils.h"
 
+/* Above this order the iteration-free asymptotic expansions are used;
+   they are only valid for n>100. */
+#ifndef SHARP_LEGENDRE_ROOTS_NEWTON_MAX
+#define SHARP_LEGENDRE_ROOTS_NEWTON_MAX 100
+#endif
+
 static inline double one_minus_x2 (double x)
   { return (fabs(x)>0.1) ? (1.+x)*(1.-x) : 1.-x*x; }
 
-void sharp_legendre_roots(int n, double *x, double *w)
+static void legendre_roots_newton(int n, double *x, double *w)
   {
   const double pi = 3.141592653589793238462643383279502884197;
   const double eps = 3e-14;
@@ -65,3 +77,122 @@ void sharp_legendre_roots(int n, double *x, double *w)
     }
 } // end of parallel region
   }
+
+/* Zeros j_{0,k} of the Bessel function J_0 and the values J_1(j_{0,k})^2
+   for k=1..20; larger k use the McMahon-type expansions below. */
+static const double besselj0_zeros[20] = {
+  2.404825557695773, 5.520078110286311, 8.653727912911013, 11.791534439014281,
+  14.930917708487787, 18.071063967910924, 21.21163662987926, 24.352471530749302,
+  27.493479132040253, 30.634606468431976, 33.77582021357357, 36.917098353664045,
+  40.05842576462824, 43.19979171317673, 46.341188371661815, 49.482609897397815,
+  52.624051841115, 55.76551075501998, 58.90698392608094, 62.048469190227166 };
+static const double besselj1_squared[20] = {
+  0.26951412394191676, 0.11578013858220378, 0.07368635113640826,
+  0.054037573198116286, 0.04266142901724307, 0.03524210349099611,
+  0.03002107010305466, 0.026147391495308092, 0.023159121824691403,
+  0.020783829122267842, 0.018850450669317672, 0.017246157569665008,
+  0.0158935181059236, 0.014737626096472192, 0.013738465145387117,
+  0.01286618173761514, 0.012098051548626794, 0.011416471224491607,
+  0.010807592791180208, 0.010260372926280771 };
+
+static double besselj0_zero (int k)
+  {
+  const double pi = 3.141592653589793238462643383279502884197;
+  if (k<=20) return besselj0_zeros[k-1];
+  double z = pi*(k-0.25);
+  double r = 1./z, r2 = r*r;
+  return z + r*(0.125+r2*(-0.807291666666666666666666666667e-1
+    +r2*(0.246028645833333333333333333333+r2*(-1.82443876720610119047619047619
+    +r2*(25.3364147973439050099206349206+r2*(-567.644412135183381139802038240
+    +r2*(18690.4765282320653831636345064+r2*(-8.49353580299148769921876983660e5
+    +r2*5.09225462402226769498681286758e7))))))));
+  }
+
+static double besselj1_squared_at_zero (int k)
+  {
+  if (k<=20) return besselj1_squared[k-1];
+  double x = 1./(k-0.25), x2 = x*x;
+  return x*(0.202642367284675542887092416902+x2*x2*(-0.303380429711290253026202643516e-3
+    +x2*(0.198924364245969295201137972743e-3+x2*(-0.228969902772111653038747229723e-3
+    +x2*(0.433710719130746277915572905025e-3+x2*(-0.123632349727175414724737657367e-2
+    +x2*(0.496101423268883102872271417616e-2+x2*(-0.266837393702323757700998557826e-1
+    +x2*.185395398206345628711318848386))))))));
+  }
+
+/* theta and weight of the k-th node (counted from theta=0) for n>100 */
+static void gl_pair_asymptotic (int n, int k, double *theta, double *weight)
+  {
+  double w = 1./(n+0.5);
+  double nu = besselj0_zero(k);
+  double th = w*nu;
+  double x = th*th;
+  double B = besselj1_squared_at_zero(k);
+
+  /* Chebyshev interpolants of the expansion functions for the nodes ... */
+  double SF1T = (((((-1.29052996274280508473467968379e-12*x
+    +2.40724685864330121825976175184e-10)*x -3.13148654635992041468855740012e-08)*x
+    +0.275573168962061235623801563453e-05)*x -0.148809523713909147898955880165e-03)*x
+    +0.416666666665193394525296923981e-02)*x -0.416666666666662959639712457549e-01;
+  double SF2T = (((((+2.20639421781871003734786884322e-09*x
+    -7.53036771373769326811030753538e-08)*x +0.161969259453836261731700382098e-05)*x
+    -0.253300326008232025914059965302e-04)*x +0.282116886057560434805998583817e-03)*x
+    -0.209022248387852902722635654229e-02)*x +0.815972221772932265640401128517e-02;
+  double SF3T = (((((-2.97058225375526229899781956673e-08*x
+    +5.55845330223796209655886325712e-07)*x -0.567797841356833081642185432056e-05)*x
+    +0.418498100329504574443885193835e-04)*x -0.251395293283965914823026348764e-03)*x
+    +0.128654198542845137196151147483e-02)*x -0.416012165620204364833694266818e-02;
+
+  /* ... and for the weights */
+  double WSF1T = ((((((((-2.20902861044616638398573427475e-14*x
+    +2.30365726860377376873232578871e-12)*x -1.75257700735423807659851042318e-10)*x
+    +1.03756066927916795821098009353e-08)*x -4.63968647553221331251529631098e-07)*x
+    +0.149644593625028648361395938176e-04)*x -0.326278659594412170300449074873e-03)*x
+    +0.436507936507598105249726413120e-02)*x -0.305555555555553028279487898503e-01)*x
+    +0.833333333333333302184063103900e-01;
+  double WSF2T = (((((((+3.63117412152654783455929483029e-12*x
+    +7.67643545069893130779501844323e-11)*x -7.12912857233642220650643150625e-09)*x
+    +2.11483880685947151466370130277e-07)*x -0.381817918680045468483009307090e-05)*x
+    +0.465969530694968391417927388162e-04)*x -0.407297185611335764191683161117e-03)*x
+    +0.268959435694729660779984493795e-02)*x -0.111111111111214923138249347172e-01;
+  double WSF3T = (((((((+2.01826791256703301806643264922e-09*x
+    -4.38647122520206649251063212545e-08)*x +5.08898347288671653137451093208e-07)*x
+    -0.397933316519135275712977531366e-05)*x +0.200559326396458326778521795392e-04)*x
+    -0.422888059282921161626339411388e-04)*x -0.105646050254076140548678457002e-03)*x
+    -0.947969308958577323145923317955e-04)*x +0.656966489926484797412985260842e-02;
+
+  double NuoSin = nu/sin(th);
+  double BNuoSin = B*NuoSin;
+  double WInvSinc = w*w*NuoSin;
+  double WIS2 = WInvSinc*WInvSinc;
+
+  *theta = w*(nu + th*WInvSinc*(SF1T + WIS2*(SF2T + WIS2*SF3T)));
+  *weight = (2.*w)/(BNuoSin + BNuoSin*WIS2*(WSF1T + WIS2*(WSF2T + WIS2*WSF3T)));
+  }
+
+static void legendre_roots_asymptotic(int n, double *x, double *w)
+  {
+  int m = (n+1)>>1;
+
+#pragma omp parallel
+{
+  int k;
+#pragma omp for schedule(static)
+  for (k=1; k<=m; ++k)
+    {
+    double theta, weight;
+    gl_pair_asymptotic(n, k, &theta, &weight);
+    double x0 = ((n&1) && (k==m)) ? 0. : cos(theta);
+    x[k-1] = -x0;
+    x[n-k] = x0;
+    w[k-1] = w[n-k] = weight;
+    }
+} // end of parallel region
+  }
+
+void sharp_legendre_roots(int n, double *x, double *w)
+  {
+  if (n>SHARP_LEGENDRE_ROOTS_NEWTON_MAX)
+    legendre_roots_asymptotic(n,x,w);
+  else
+    legendre_roots_newton(n,x,w);
+  }
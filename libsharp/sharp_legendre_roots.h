@@ -36,7 +36,9 @@ extern "C" {
 #endif
 
 /*! Computes roots and Gaussian quadrature weights for Legendre polynomial
-    of degree \a n.
+    of degree \a n. For \a n>100 this takes O(n) operations, using the
+    iteration-free asymptotic expansions of Bogaert (2014); otherwise Newton
+    iteration is used.
     \param n Order of Legendre polynomial
     \param x Array of length \a n for output (root position)
     \param w Array of length \a w for output (weight for Gaussian quadrature)
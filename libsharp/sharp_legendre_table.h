@@ -54,12 +54,13 @@ extern "C" {
     (Internally, sin(theta) is also used for part of the computation, making theta
     the most convenient argument.)
 
-    NOTE: Support for spin-weighted Legendre functions is on the TODO-list. Only spin=0
-    is supported now.
+    For spin != 0 the spin-weighted functions _{+s}lambda_lm and _{-s}lambda_lm are
+    computed, where _{s}Y_lm(theta,phi) = _{s}lambda_lm(theta) exp(i m phi) in the
+    convention of Goldberg et al. (1967); for s=0 this reduces to the above.
 
     \param m The m-value to compute a table for; must be >= 0
-    \param spin The spin parameter; pass 0 for the regular associated Legendre functions.
-                NOTE: This is present for future compatability, currently only 0 is supported.
+    \param spin The spin parameter (>= 0); pass 0 for the regular associated Legendre
+                functions.
     \param lmax A table will be provided for l = m .. lmax
     \param ntheta How many theta values to evaluate for
     \param theta Contiguous 1D array of theta values
@@ -88,6 +89,86 @@ void sharp_normalized_associated_legendre_table(
   double *out
 );
 
+/*! Flags for sharp_normalized_associated_legendre_table_multi() */
+enum { SHARP_LEGENDRE_TABLE_COMPACT = 1
+       /*!< store the m blocks back to back, each holding only l = m .. lmax;
+            \a m_stride is ignored */
+     };
+
+/*! Computes the tables of sharp_normalized_associated_legendre_table() for
+    all \a nm values of m in \a mval at once. A single set of generators is
+    initialized and the work is distributed over OpenMP threads across both
+    m and theta.
+
+    \param nm Number of m values
+    \param mval Array of \a nm m-values (>= 0); entries with m > lmax are skipped
+    \param m_stride Distance between the tables of consecutive m-values
+    \param flags 0 or SHARP_LEGENDRE_TABLE_COMPACT. In compact mode the table for
+                 mval[i] starts at sum_{j<i} (lmax - mval[j] + 1) * l_stride, which
+                 is dense when \a l_stride is the largest of the three strides
+                 (e.g. l_stride = ntheta * nspin, theta_stride = nspin, spin_stride = 1).
+    \param out Receives the entry for mval[im], itheta, l and ispin at
+               out[moffset(im) + itheta * theta_stride + (l - mval[im]) * l_stride
+               + ispin * spin_stride], with moffset(im) = im * m_stride unless
+               in compact mode.
+
+    The remaining arguments are as for sharp_normalized_associated_legendre_table().
+ */
+void sharp_normalized_associated_legendre_table_multi(
+  ptrdiff_t nm,
+  const ptrdiff_t *mval,
+  int spin,
+  ptrdiff_t lmax,
+  ptrdiff_t ntheta,
+  double *theta,
+  ptrdiff_t m_stride,
+  ptrdiff_t theta_stride,
+  ptrdiff_t l_stride,
+  ptrdiff_t spin_stride,
+  int flags,
+  double *out
+);
+
+/*! Computes a table of the Wigner d functions d^l_{m,mp}(theta) for fixed \a mp,
+    all -lmax <= m <= lmax and 0 <= l <= lmax, in the convention where
+    d^1_{1,0}(theta) = -sin(theta)/sqrt(2). Entries with l < max(|m|, |mp|) are
+    set to zero.
+
+    Uses the spin-weighted recursion of sharp_normalized_associated_legendre_table()
+    with spin |mp|, including its SIMD evaluation over theta and its protection
+    against underflow; work is distributed over OpenMP threads across m and theta.
+
+    \param mp The fixed second index; must satisfy |mp| <= lmax
+    \param out Receives d^l_{m,mp}(theta[itheta]) at
+               out[(m + lmax) * m_stride + itheta * theta_stride + l * l_stride].
+ */
+void sharp_wigner_d_table(
+  ptrdiff_t mp,
+  ptrdiff_t lmax,
+  ptrdiff_t ntheta,
+  double *theta,
+  ptrdiff_t m_stride,
+  ptrdiff_t theta_stride,
+  ptrdiff_t l_stride,
+  double *out
+);
+
+/*! Computes the full Wigner d matrices d^l_{m,mp}(theta) for 0 <= l <= lmax and
+    -l <= m, mp <= l. Work is distributed over OpenMP threads across mp (and
+    theta); the entries with |m| < |mp| are obtained by symmetry.
+
+    \param out Array of ntheta * (lmax + 1) * (2 lmax + 1) * (2 lmax + 3) / 3
+               entries; d^l_{m,mp}(theta[itheta]) is stored at
+               out[itheta * ntot + l * (4 l^2 - 1) / 3 + (m + l) * (2 l + 1) + mp + l],
+               where ntot = (lmax + 1) * (2 lmax + 1) * (2 lmax + 3) / 3.
+ */
+void sharp_wigner_d_matrix(
+  ptrdiff_t lmax,
+  ptrdiff_t ntheta,
+  double *theta,
+  double *out
+);
+
 #endif
 
 #ifdef __cplusplus
@@ -45,6 +45,21 @@ typedef struct
   double theta, phi0, weight, cth, sth;
   ptrdiff_t ofs;
   int nph, stride;
+  /*! If nonzero, the ring belongs to a HEALPix map with this Nside stored
+      in NESTED order; pixel \a p of that map is located at index
+      \a ofs+p*stride, and \a nest_ring is the (1-based) HEALPix ring number.
+      Otherwise the ring's pixel \a i is located at index \a ofs+i*stride. */
+  int nest_nside, nest_ring;
+  /*! The ring pixels actually stored in the map: positions \a pix0 to
+      \a pix0+npix-1 (modulo \a nph) of the ring. For complete rings,
+      \a pix0 is 0 and \a npix equals \a nph; see
+      sharp_make_masked_geom_info(). */
+  int pix0, npix;
+  /*! Band limit of the ring: only a_lm with \a l<=lmax contribute to the
+      ring in synthesis, and the ring contributes only to those in analysis.
+      A negative value means that the ring is limited only by the a_lm;
+      see sharp_set_band_lmax(). */
+  int lmax;
   } sharp_ringinfo;
 
 /*! \internal
@@ -140,6 +155,23 @@ ptrdiff_t sharp_alm_index (const sharp_alm_info *self, int l, int mi);
 ptrdiff_t sharp_alm_count(const sharp_alm_info *self);
 /*! Deallocates the a_lm info object. */
 void sharp_destroy_alm_info (sharp_alm_info *info);
+/*! Returns a 64-bit hash of the content of \a info. Objects for which
+    sharp_alm_info_equal() returns true have identical hashes, so the hash can
+    serve as key when caching objects that depend on an \a sharp_alm_info. */
+unsigned long long sharp_alm_info_hash (const sharp_alm_info *info);
+/*! Returns 1 if \a a and \a b describe the same a_lm layout, else 0. */
+int sharp_alm_info_equal (const sharp_alm_info *a, const sharp_alm_info *b);
+/*! Writes a compact binary representation of \a info to \a buf and returns
+    the number of bytes written. If \a buf is NULL, only the required size is
+    returned. The representation uses native byte order and keeps all arrays
+    8-byte aligned relative to the start of \a buf. */
+size_t sharp_alm_info_serialize (const sharp_alm_info *info, void *buf);
+/*! Creates a \a sharp_alm_info from the first \a size bytes of \a buf,
+    which need not be aligned (e.g. a memory-mapped file), and returns the
+    number of bytes consumed. If \a buf does not hold a valid representation,
+    0 is returned and \a *alm_info is set to NULL. */
+size_t sharp_alm_info_deserialize (const void *buf, size_t size,
+  sharp_alm_info **alm_info);
 
 /*! \} */
 
@@ -163,13 +195,74 @@ void sharp_make_geom_info (int nrings, const int *nph, const ptrdiff_t *ofs,
   const int *stride, const double *phi0, const double *theta,
   const double *wgt, sharp_geom_info **geom_info);
 
+/*! Works like sharp_make_geom_info(), but requires the rings to be ordered
+    from north to south, with ring \a i and ring \a nrings-1-i lying
+    symmetrically about the equator. Rings are then paired by their index
+    instead of by sorting and comparing colatitudes, and the ring data are
+    set up in parallel, which matters for grids with 10^5 and more rings.
+    All grid helpers in sharp_geomhelpers.h except the McEwen-Wiaux grid and
+    HEALPix subsets use this function.
+ */
+void sharp_make_ordered_geom_info (int nrings, const int *nph,
+  const ptrdiff_t *ofs, const int *stride, const double *phi0,
+  const double *theta, const double *wgt, sharp_geom_info **geom_info);
+
 /*! Counts the number of grid points needed for (the local part of) a map described
     by \a info.
  */
 ptrdiff_t sharp_map_size(const sharp_geom_info *info);
 
+/*! Returns one more than the largest array index of a pixel in \a info,
+    i.e. the minimum length of a map array. This is larger than
+    sharp_map_size() if the pixels are strided or if \a info only covers
+    part of a map.
+ */
+ptrdiff_t sharp_map_extent(const sharp_geom_info *info);
+
+/*! Creates a geometry covering only the observed part of a map described
+    by \a full. A pixel is observed if its entry in \a mask, a map laid out
+    as described by \a full, is nonzero. Rings without observed pixels are
+    dropped, rings whose partner ring is dropped are transformed on their
+    own, and of every remaining ring only the shortest (possibly wrapping)
+    azimuthal range containing all observed pixels is kept. The FFTs of
+    partial rings are zero-padded to the full ring length.
+    The result uses the same map layout as \a full, so the original map
+    arrays can be passed to SHTs directly; pixels outside the kept ranges
+    are neither read nor written.
+    \param geom_info will hold a pointer to the newly created data structure
+ */
+void sharp_make_masked_geom_info (const sharp_geom_info *full,
+  const double *mask, sharp_geom_info **geom_info);
+
+/*! Creates a copy of \a full for maps whose consecutive pixels are \a stride
+    (>0) elements apart, e.g. a non-contiguous view into a larger array.
+    \param geom_info will hold a pointer to the newly created data structure
+ */
+void sharp_make_strided_geom_info (const sharp_geom_info *full, int stride,
+  sharp_geom_info **geom_info);
+
+/*! Sets the band limit of all rings of \a info with colatitudes in the
+    range [\a theta1; \a theta2] to \a lmax, so that a_lm with higher \a l
+    are ignored on these rings; a negative \a lmax removes the limit.
+    Rings with a low band limit are cheaper to transform, which makes
+    geometries that sample some latitude bands much more finely than others
+    efficient. Unlimited rings use the \a lmax of the a_lm. */
+void sharp_set_band_lmax (sharp_geom_info *info, double theta1, double theta2,
+  int lmax);
+
 /*! Deallocates the geometry information in \a info. */
 void sharp_destroy_geom_info (sharp_geom_info *info);
+/*! Returns a 64-bit hash of the content of \a info; see
+    sharp_alm_info_hash(). */
+unsigned long long sharp_geom_info_hash (const sharp_geom_info *info);
+/*! Returns 1 if \a a and \a b describe the same rings in the same order,
+    else 0. */
+int sharp_geom_info_equal (const sharp_geom_info *a, const sharp_geom_info *b);
+/*! Works like sharp_alm_info_serialize(). */
+size_t sharp_geom_info_serialize (const sharp_geom_info *info, void *buf);
+/*! Works like sharp_alm_info_deserialize(). */
+size_t sharp_geom_info_deserialize (const void *buf, size_t size,
+  sharp_geom_info **geom_info);
 
 /*! \} */
 
@@ -200,6 +293,8 @@ typedef enum { SHARP_DP              = 1<<4,
 
                SHARP_USE_WEIGHTS     = 1<<20,    /* internal use only */
                SHARP_NO_OPENMP       = 1<<21,    /* internal use only */
+               SHARP_SMALL_MMAX      = 1<<22,    /* internal use only */
+               SHARP_NO_SMALL_MMAX   = 1<<23,    /* internal use only */
                SHARP_NVMAX           = (1<<4)-1 /* internal use only */
              } sharp_jobflags;
 
@@ -236,6 +331,62 @@ void sharp_execute (sharp_jobtype type, int spin, void *alm, void *map,
   const sharp_geom_info *geom_info, const sharp_alm_info *alm_info, int ntrans,
   int flags, double *time, unsigned long long *opcnt);
 
+/*! A precomputed SHT job; see sharp_make_plan(). */
+typedef struct sharp_plan_s sharp_plan;
+
+/*! Creates a plan for repeated SHTs with fixed parameters, which have the
+  same meaning as for sharp_execute(). Everything that does not depend on
+  the a_lm and map arrays (normalization factors, per-ring data and the
+  choice of algorithm) is set up only once. \a geom_info and \a alm_info
+  must stay valid as long as the plan exists. */
+void sharp_make_plan (sharp_jobtype type, int spin,
+  const sharp_geom_info *geom_info, const sharp_alm_info *alm_info, int ntrans,
+  int flags, sharp_plan **plan);
+
+/*! Executes \a plan on \a alm and \a map (see sharp_execute()). The only
+  accepted \a flags are SHARP_ADD (in addition to those of the plan) and 0.
+  If \a nthreads>0, at most that many OpenMP threads are used. \a time and
+  \a opcnt work as for sharp_execute(). A plan may be executed by several
+  threads at once. */
+void sharp_execute_plan (const sharp_plan *plan, void *alm, void *map,
+  int flags, int nthreads, double *time, unsigned long long *opcnt);
+
+/*! Deallocates a plan created by sharp_make_plan(). */
+void sharp_destroy_plan (sharp_plan *plan);
+
+/*! Iteration schemes for sharp_map2alm_iter(). */
+typedef enum { SHARP_ITER_JACOBI = 0,
+               /*!< repeatedly add the analysis of the current map residual */
+               SHARP_ITER_CG = 1
+               /*!< conjugate gradients on the weighted least-squares problem
+                    min |W^(1/2) (map - Y alm)|, started from the plain
+                    analysis; usually converges faster than Jacobi
+                    iteration, in particular for spin>0 */
+             } sharp_itermethod;
+
+/*! Performs an iterative map analysis, refining the a_lm until the maps are
+  reproduced by their synthesis. The arguments \a spin, \a alm, \a map,
+  \a geom_info, \a alm_info, \a ntrans and \a flags have the same meaning as
+  for sharp_execute() with type SHARP_MAP2ALM; SHARP_ADD and SHARP_NO_FFT are
+  not supported. The normalization factors, ring pair data, FFT plans and
+  (with MPI) the communication layout are computed once and shared by all
+  transforms, as are the work buffers; the \a ntrans transforms are
+  processed together in every step.
+  \param method the iteration scheme
+  \param niter the maximum number of iterations. With \a niter==0, both
+    methods are equivalent to a plain SHARP_MAP2ALM.
+  \param epsilon iteration stops once the relative residual of every
+    transform falls below \a epsilon; pass 0 to always do \a niter iterations.
+  \param resid If not NULL, the relative residual |W^(1/2)(map - Y alm)| /
+    |W^(1/2) map| of each transform after the last iteration is written here
+    (\a ntrans entries). For SHARP_ITER_JACOBI this costs one additional
+    synthesis.
+  \returns the number of iterations performed.
+  \note Every iteration costs one synthesis and one analysis. */
+int sharp_map2alm_iter (sharp_itermethod method, int spin, void *alm,
+  void *map, const sharp_geom_info *geom_info, const sharp_alm_info *alm_info,
+  int ntrans, int flags, int niter, double epsilon, double *resid);
+
 void sharp_set_chunksize_min(int new_chunksize_min);
 void sharp_set_nchunks_max(int new_nchunks_max);
 
@@ -52,6 +52,8 @@ typedef struct
 
   double *theta;  /* theta of first ring of every pair on task 0, task 1 etc. */
   int *ispair;    /* is this really a pair? */
+  int *rlmax;     /* band limits of both rings of every pair; NULL if all
+                     rings use the full lmax */
 
   int *almcount, *almdisp, *mapcount, *mapdisp; /* for all2all communication */
   } sharp_mpi_info;
@@ -101,6 +103,24 @@ static void sharp_make_mpi_info (MPI_Comm comm, const sharp_job *job,
   DEALLOC(theta_tmp);
   DEALLOC(ispair_tmp);
 
+  int *rlmax_tmp=RALLOC(int,2*job->ginfo->npairs);
+  int limited=get_ring_lmax(job->ginfo->pair,job->ginfo->npairs,
+    job->ainfo->lmax,rlmax_tmp);
+  MPI_Allreduce(MPI_IN_PLACE,&limited,1,MPI_INT,MPI_MAX,comm);
+  minfo->rlmax=NULL;
+  if (limited)
+    {
+    int *cnt=RALLOC(int,minfo->ntasks), *disp=RALLOC(int,minfo->ntasks);
+    for (int i=0; i<minfo->ntasks; ++i)
+      { cnt[i]=2*minfo->npair[i]; disp[i]=2*minfo->ofs_pair[i]; }
+    minfo->rlmax=RALLOC(int,2*minfo->npairtotal);
+    MPI_Allgatherv(rlmax_tmp, 2*job->ginfo->npairs, MPI_INT, minfo->rlmax,
+      cnt, disp, MPI_INT, comm);
+    DEALLOC(cnt);
+    DEALLOC(disp);
+    }
+  DEALLOC(rlmax_tmp);
+
   minfo->nph=2*job->nmaps*job->ntrans;
 
   minfo->almcount=RALLOC(int,minfo->ntasks);
@@ -126,6 +146,7 @@ static void sharp_destroy_mpi_info (sharp_mpi_info *minfo)
   DEALLOC(minfo->ofs_pair);
   DEALLOC(minfo->theta);
   DEALLOC(minfo->ispair);
+  DEALLOC(minfo->rlmax);
   DEALLOC(minfo->almcount);
   DEALLOC(minfo->almdisp);
   DEALLOC(minfo->mapcount);
@@ -207,85 +228,132 @@ static void map2alm_comm (sharp_job *job, const sharp_mpi_info *minfo)
     }
   }
 
-static void sharp_execute_job_mpi (sharp_job *job, MPI_Comm comm)
+/* Everything about one part of an MPI job that does not depend on its a_lm
+   and map arrays */
+typedef struct
   {
-  int ntasks;
-  MPI_Comm_size(comm, &ntasks);
-  if (ntasks==1) /* fall back to scalar implementation */
-    { sharp_execute_job (job); return; }
-
-  MPI_Barrier(comm);
-  double timer=wallTime();
-  job->opcnt=0;
+  sharp_geom_info ginfo; /* view into a block of the local ring pairs */
   sharp_mpi_info minfo;
-  sharp_make_mpi_info(comm, job, &minfo);
+  double *cth, *sth;
+  int *mlim;
+  fftcache fft;
+  } sharp_mpi_part;
+
+/* Setup of an MPI job on more than one task, so that it can be executed
+   repeatedly. Large jobs are processed in several parts, to limit the size
+   of the phase arrays. */
+typedef struct
+  {
+  double *norm_l;
+  int npart;
+  sharp_mpi_part *part;
+  } sharp_mpi_plan;
 
-  if (minfo.npairtotal>minfo.ntasks*300)
+static void sharp_make_mpi_plan (const sharp_job *job, MPI_Comm comm,
+  sharp_mpi_plan *plan)
+  {
+  int ntasks, npairtotal=job->ginfo->npairs;
+  MPI_Comm_size(comm, &ntasks);
+  MPI_Allreduce(MPI_IN_PLACE,&npairtotal,1,MPI_INT,MPI_SUM,comm);
+  plan->npart = (npairtotal>ntasks*300) ?
+    (npairtotal+ntasks*200-1)/(ntasks*200) : 1;
+
+  int lmax = job->ainfo->lmax;
+  plan->norm_l = get_norm_l (job, lmax);
+  plan->part = RALLOC(sharp_mpi_part,plan->npart);
+  for (int ip=0; ip<plan->npart; ++ip)
     {
-    int nsub=(minfo.npairtotal+minfo.ntasks*200-1)/(minfo.ntasks*200);
-    for (int isub=0; isub<nsub; ++isub)
+    sharp_mpi_part *part=plan->part+ip;
+    // Every part works on a contiguous block of the local ring pairs,
+    // so its geometry is just a view into the full one.
+    int lo=(int)(((ptrdiff_t)job->ginfo->npairs*ip)/plan->npart),
+        hi=(int)(((ptrdiff_t)job->ginfo->npairs*(ip+1))/plan->npart);
+    part->ginfo.pair=job->ginfo->pair+lo;
+    part->ginfo.npairs=hi-lo;
+    part->ginfo.nphmax=job->ginfo->nphmax;
+    sharp_job ljob=*job;
+    ljob.ginfo=&part->ginfo;
+    sharp_make_mpi_info(comm, &ljob, &part->minfo);
+
+    const sharp_mpi_info *minfo=&part->minfo;
+    part->cth = RALLOC(double,minfo->npairtotal);
+    part->sth = RALLOC(double,minfo->npairtotal);
+    part->mlim = RALLOC(int,minfo->npairtotal);
+    for (int i=0; i<minfo->npairtotal; ++i)
       {
-      sharp_job ljob=*job;
-      // When creating a_lm, every sub-job produces a complete set of
-      // coefficients; they need to be added up.
-      if ((isub>0)&&(job->type==SHARP_MAP2ALM)) ljob.flags|=SHARP_ADD;
-      sharp_geom_info lginfo;
-      lginfo.pair=RALLOC(sharp_ringpair,(job->ginfo->npairs/nsub)+1);
-      lginfo.npairs=0;
-      lginfo.nphmax = job->ginfo->nphmax;
-      while (lginfo.npairs*nsub+isub<job->ginfo->npairs)
-        {
-        lginfo.pair[lginfo.npairs]=job->ginfo->pair[lginfo.npairs*nsub+isub];
-        ++lginfo.npairs;
-        }
-      ljob.ginfo=&lginfo;
-      sharp_execute_job_mpi (&ljob,comm);
-      job->opcnt+=ljob.opcnt;
-      DEALLOC(lginfo.pair);
+      part->cth[i] = cos(minfo->theta[i]);
+      part->sth[i] = sin(minfo->theta[i]);
+      part->mlim[i] = sharp_get_mlim(minfo->rlmax ?
+        IMAX(minfo->rlmax[2*i],minfo->rlmax[2*i+1]) : lmax,
+        job->spin, part->sth[i], part->cth[i]);
       }
+    part->fft.n=0;
+    part->fft.nph=NULL;
+    part->fft.plan=NULL;
+    if ((job->flags&SHARP_NO_FFT)==0)
+      make_fftcache (&part->ginfo, &part->fft);
+    }
+  }
+
+static void sharp_destroy_mpi_plan (sharp_mpi_plan *plan)
+  {
+  for (int ip=0; ip<plan->npart; ++ip)
+    {
+    sharp_mpi_part *part=plan->part+ip;
+    sharp_destroy_mpi_info(&part->minfo);
+    DEALLOC(part->cth);
+    DEALLOC(part->sth);
+    DEALLOC(part->mlim);
+    destroy_fftcache(&part->fft);
     }
-  else
+  DEALLOC(plan->part);
+  DEALLOC(plan->norm_l);
+  }
+
+static void sharp_run_job_mpi (sharp_job *job, const sharp_mpi_plan *plan)
+  {
+  job->opcnt=0;
+  int lmax = job->ainfo->lmax;
+  for (int ip=0; ip<plan->npart; ++ip)
     {
-    int lmax = job->ainfo->lmax;
-    job->norm_l = sharp_Ylmgen_get_norm (lmax, job->spin);
+    const sharp_mpi_part *part=plan->part+ip;
+    const sharp_mpi_info *minfo=&part->minfo;
+    sharp_job pjob=*job;
+    pjob.ginfo=&part->ginfo;
+    pjob.norm_l=plan->norm_l;
+    pjob.opcnt=0;
+    // When creating a_lm, every part produces a complete set of
+    // coefficients; they need to be added up.
+    if ((ip>0)&&(job->type==SHARP_MAP2ALM)) pjob.flags|=SHARP_ADD;
 
     /* clear output arrays if requested */
-    init_output (job);
+    init_output (&pjob);
 
-    alloc_phase_mpi (job,job->ainfo->nm,job->ginfo->npairs,minfo.mmax+1,
-      minfo.npairtotal);
-
-    double *cth = RALLOC(double,minfo.npairtotal),
-          *sth = RALLOC(double,minfo.npairtotal);
-    int *mlim = RALLOC(int,minfo.npairtotal);
-    for (int i=0; i<minfo.npairtotal; ++i)
-      {
-      cth[i] = cos(minfo.theta[i]);
-      sth[i] = sin(minfo.theta[i]);
-      mlim[i] = sharp_get_mlim(lmax, job->spin, sth[i], cth[i]);
-      }
+    alloc_phase_mpi (&pjob,pjob.ainfo->nm,pjob.ginfo->npairs,minfo->mmax+1,
+      minfo->npairtotal);
 
     /* map->phase where necessary */
-    map2phase (job, minfo.mmax, 0, job->ginfo->npairs);
+    map2phase (&pjob, minfo->mmax, 0, pjob.ginfo->npairs, &part->fft);
 
-    map2alm_comm (job, &minfo);
+    map2alm_comm (&pjob, minfo);
 
 #pragma omp parallel if ((job->flags&SHARP_NO_OPENMP)==0)
 {
-    sharp_job ljob = *job;
+    sharp_job ljob = pjob;
+    ljob.opcnt=0;
     sharp_Ylmgen_C generator;
-    sharp_Ylmgen_init (&generator,lmax,minfo.mmax,ljob.spin);
+    sharp_Ylmgen_init (&generator,lmax,minfo->mmax,ljob.spin);
     alloc_almtmp(&ljob,lmax);
 
 #pragma omp for schedule(dynamic,1)
-    for (int mi=0; mi<job->ainfo->nm; ++mi)
+    for (int mi=0; mi<pjob.ainfo->nm; ++mi)
       {
   /* alm->alm_tmp where necessary */
       alm2almtmp (&ljob, lmax, mi);
 
   /* inner conversion loop */
-      inner_loop (&ljob, minfo.ispair, cth, sth, 0, minfo.npairtotal,
-        &generator, mi, mlim);
+      inner_loop (&ljob, minfo->ispair, part->cth, part->sth, 0,
+        minfo->npairtotal, &generator, mi, part->mlim, minfo->rlmax);
 
   /* alm_tmp->alm where necessary */
       almtmp2alm (&ljob, lmax, mi);
@@ -295,21 +363,32 @@ static void sharp_execute_job_mpi (sharp_job *job, MPI_Comm comm)
     dealloc_almtmp(&ljob);
 
 #pragma omp critical
-    job->opcnt+=ljob.opcnt;
+    pjob.opcnt+=ljob.opcnt;
 } /* end of parallel region */
 
-    alm2map_comm (job, &minfo);
+    alm2map_comm (&pjob, minfo);
 
   /* phase->map where necessary */
-    phase2map (job, minfo.mmax, 0, job->ginfo->npairs);
+    phase2map (&pjob, minfo->mmax, 0, pjob.ginfo->npairs, &part->fft);
 
-    DEALLOC(mlim);
-    DEALLOC(cth);
-    DEALLOC(sth);
-    DEALLOC(job->norm_l);
-    dealloc_phase (job);
+    dealloc_phase (&pjob);
+    job->opcnt+=pjob.opcnt;
     }
-  sharp_destroy_mpi_info(&minfo);
+  }
+
+static void sharp_execute_job_mpi (sharp_job *job, MPI_Comm comm)
+  {
+  int ntasks;
+  MPI_Comm_size(comm, &ntasks);
+  if (ntasks==1) /* fall back to scalar implementation */
+    { sharp_execute_job (job); return; }
+
+  MPI_Barrier(comm);
+  double timer=wallTime();
+  sharp_mpi_plan plan;
+  sharp_make_mpi_plan (job, comm, &plan);
+  sharp_run_job_mpi (job, &plan);
+  sharp_destroy_mpi_plan (&plan);
   job->time=wallTime()-timer;
   }
 
@@ -76,6 +76,14 @@ void sharp_execute_mpi (MPI_Comm comm, sharp_jobtype type, int spin,
   const sharp_alm_info *alm_info, int ntrans, int flags, double *time,
   unsigned long long *opcnt);
 
+/*! Performs an MPI parallel iterative map analysis; see sharp_map2alm_iter().
+  The inner products for the convergence tests are summed over all tasks in
+  \a comm, so all tasks perform the same number of iterations. */
+int sharp_map2alm_iter_mpi (MPI_Comm comm, sharp_itermethod method, int spin,
+  void *alm, void *map, const sharp_geom_info *geom_info,
+  const sharp_alm_info *alm_info, int ntrans, int flags, int niter,
+  double epsilon, double *resid);
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #ifdef USE_MPI
 #include "mpi.h"
 #include "sharp_mpi.h"
@@ -44,6 +45,7 @@
 #include "c_utils.h"
 #include "sharp_announce.h"
 #include "memusage.h"
+#include "walltime_c.h"
 #include "sharp_vecsupport.h"
 
 typedef complex double dcmplx;
@@ -145,6 +147,8 @@ static void reduce_geom_info(sharp_geom_info *ginfo)
   ptrdiff_t ofs = 0;
   for (int i=mytask; i<ginfo->npairs; i+=ntasks,++npairsnew)
     {
+    UTIL_ASSERT(ginfo->pair[i].r1.nest_nside==0,
+      "NESTED maps cannot be distributed");
     ginfo->pair[npairsnew]=ginfo->pair[i];
     ginfo->pair[npairsnew].r1.ofs=ofs;
     ofs+=ginfo->pair[npairsnew].r1.nph;
@@ -228,21 +232,8 @@ static void get_errors (dcmplx **alm, ptrdiff_t nalms, int ncomp, double *sqsum,
     }
   }
 
-static int good_fft_size(int n)
-  {
-  if (n<=6) return n;
-  int bestfac=2*n;
-
-  for (int f2=1; f2<bestfac; f2*=2)
-    for (int f23=f2; f23<bestfac; f23*=3)
-      for (int f235=f23; f235<bestfac; f235*=5)
-        if (f235>=n) bestfac=f235;
-
-  return bestfac;
-  }
-
-static void get_infos (const char *gname, int lmax, int *mmax, int *gpar1,
-  int *gpar2, sharp_geom_info **ginfo, sharp_alm_info **ainfo)
+static void get_infos (const char *gname, int lmax, int *mmax, int spin,
+  int *gpar1, int *gpar2, sharp_geom_info **ginfo, sharp_alm_info **ainfo)
   {
   UTIL_ASSERT(lmax>=0,"lmax must not be negative");
   if (*mmax<0) *mmax=lmax;
@@ -262,6 +253,29 @@ static void get_infos (const char *gname, int lmax, int *mmax, int *gpar1,
     sharp_make_healpix_geom_info (*gpar1, 1, ginfo);
     if (mytask==0) printf ("HEALPix grid, nside=%d\n",*gpar1);
     }
+  else if (strcmp(gname,"nestedhealpix")==0)
+    {
+    if (*gpar1<1) *gpar1=lmax/2;
+    if (*gpar1==0) ++(*gpar1);
+    int nside=1;
+    while (nside<*gpar1) nside*=2;
+    *gpar1=nside;
+    if (mytask==0) printf ("HEALPix grid in NESTED order, nside=%d\n",*gpar1);
+    sharp_make_nested_healpix_geom_info (*gpar1, 1, NULL, ginfo);
+    }
+  else if (strcmp(gname,"weightedhealpix")==0)
+    {
+    if (*gpar1<1) *gpar1=lmax/2;
+    if (*gpar1==0) ++(*gpar1);
+    double *weight=RALLOC(double,2*(*gpar1));
+    double res=sharp_healpix_ring_weights (*gpar1, IMIN(2*lmax,3*(*gpar1)),
+      weight);
+    sharp_make_weighted_healpix_geom_info (*gpar1, 1, weight, ginfo);
+    DEALLOC(weight);
+    if (mytask==0)
+      printf ("HEALPix grid with ring weights, nside=%d, residual=%e\n",
+        *gpar1,res);
+    }
   else if (strcmp(gname,"gauss")==0)
     {
     if (*gpar1<1) *gpar1=lmax+1;
@@ -292,38 +306,29 @@ static void get_infos (const char *gname, int lmax, int *mmax, int *gpar1,
     if (mytask==0)
       printf("Clenshaw-Curtis grid, nlat=%d, nlon=%d\n",*gpar1,*gpar2);
     }
-  else if (strcmp(gname,"smallgauss")==0)
+  else if ((strcmp(gname,"reducedgauss")==0)||(strcmp(gname,"smallgauss")==0))
     {
-    int nlat=*gpar1, nlon=*gpar2;
-    if (nlat<1) nlat=lmax+1;
-    if (nlon<1) nlon=2*(*mmax)+1;
-    *gpar1=nlat; *gpar2=nlon;
-    sharp_make_gauss_geom_info (nlat, nlon, 0., 1, nlon, ginfo);
-    ptrdiff_t npix_o=get_npix(*ginfo);
-    size_t ofs=0;
-    for (int i=0; i<(*ginfo)->npairs; ++i)
+    if (*gpar1<1) *gpar1=lmax+1;
+    if (*gpar2<1) *gpar2=2*(*mmax)+1;
+    sharp_make_reduced_gauss_geom_info (*gpar1, *gpar2, lmax, spin, 0., 1,
+      ginfo);
+    if (mytask==0)
       {
-      sharp_ringpair *pair=&((*ginfo)->pair[i]);
-      int pring=1+2*sharp_get_mlim(lmax,0,pair->r1.sth,pair->r1.cth);
-      if (pring>nlon) pring=nlon;
-      pring=good_fft_size(pring);
-      pair->r1.nph=pring;
-      pair->r1.weight*=nlon*1./pring;
-      pair->r1.ofs=ofs;
-      ofs+=pring;
-      if (pair->r2.nph>0)
-        {
-        pair->r2.nph=pring;
-        pair->r2.weight*=nlon*1./pring;
-        pair->r2.ofs=ofs;
-        ofs+=pring;
-        }
+      ptrdiff_t npix=get_npix(*ginfo), npix_o=(ptrdiff_t)(*gpar1)*(*gpar2);
+      printf("Reduced Gauss grid, nlat=%d, npix=%ld, savings=%.2f%%\n",
+        *gpar1,(long)npix,(npix_o-npix)*100./npix_o);
       }
+    }
+  else if (strcmp(gname,"octahedral")==0)
+    {
+    if (*gpar1<1) *gpar1=lmax+1;
+    if (*gpar2<1) *gpar2=2*(*mmax)+1;
+    sharp_make_octahedral_geom_info (*gpar1, lmax, spin, 0., 1, ginfo);
     if (mytask==0)
       {
-      ptrdiff_t npix=get_npix(*ginfo);
-      printf("Small Gauss grid, nlat=%d, npix=%ld, savings=%.2f%%\n",
-        nlat,(long)npix,(npix_o-npix)*100./npix_o);
+      ptrdiff_t npix=get_npix(*ginfo), npix_o=(ptrdiff_t)(*gpar1)*(*gpar2);
+      printf("Octahedral Gauss grid, nlat=%d, npix=%ld, savings=%.2f%%\n",
+        *gpar1,(long)npix,(npix_o-npix)*100./npix_o);
       }
     }
   else
@@ -500,6 +505,490 @@ static void check_accuracy (sharp_geom_info *ginfo, sharp_alm_info *ainfo,
   DEALLOC(err_abs);
   }
 
+static void check_infoio(void)
+  {
+  sharp_geom_info *ginfo, *ginfo2;
+  sharp_alm_info *ainfo, *ainfo2;
+  int lmax=100, mmax=40, gpar1=-1, gpar2=-1;
+  get_infos ("healpix", lmax, &mmax, 0, &gpar1, &gpar2, &ginfo, &ainfo);
+
+  size_t gsz=sharp_geom_info_serialize(ginfo,NULL),
+         asz=sharp_alm_info_serialize(ainfo,NULL);
+  /* deliberately misaligned buffer */
+  char *buf=RALLOC(char,gsz+asz+1);
+  UTIL_ASSERT(sharp_geom_info_serialize(ginfo,buf+1)==gsz,"size mismatch");
+  UTIL_ASSERT(sharp_alm_info_serialize(ainfo,buf+1+gsz)==asz,"size mismatch");
+  UTIL_ASSERT(sharp_geom_info_deserialize(buf+1,gsz+asz,&ginfo2)==gsz,
+    "geom_info deserialization failed");
+  UTIL_ASSERT(sharp_alm_info_deserialize(buf+1+gsz,asz,&ainfo2)==asz,
+    "alm_info deserialization failed");
+  sharp_destroy_alm_info(ainfo2);
+  sharp_destroy_geom_info(ginfo2);
+  UTIL_ASSERT(sharp_alm_info_deserialize(buf+1,gsz,&ainfo2)==0,
+    "wrong record type accepted");
+  UTIL_ASSERT(sharp_geom_info_deserialize(buf+1,gsz-1,&ginfo2)==0,
+    "truncated record accepted");
+  sharp_geom_info_deserialize(buf+1,gsz,&ginfo2);
+  sharp_alm_info_deserialize(buf+1+gsz,asz,&ainfo2);
+  DEALLOC(buf);
+
+  UTIL_ASSERT(sharp_geom_info_equal(ginfo,ginfo2),"geom_info changed");
+  UTIL_ASSERT(sharp_alm_info_equal(ainfo,ainfo2),"alm_info changed");
+  UTIL_ASSERT(sharp_geom_info_hash(ginfo)==sharp_geom_info_hash(ginfo2),
+    "geom_info hash changed");
+  UTIL_ASSERT(sharp_alm_info_hash(ainfo)==sharp_alm_info_hash(ainfo2),
+    "alm_info hash changed");
+
+  ginfo2->pair[0].r1.phi0+=1e-3;
+  ainfo2->mvstart[1]++;
+  UTIL_ASSERT(!sharp_geom_info_equal(ginfo,ginfo2),"geom_info not compared");
+  UTIL_ASSERT(!sharp_alm_info_equal(ainfo,ainfo2),"alm_info not compared");
+  UTIL_ASSERT(sharp_geom_info_hash(ginfo)!=sharp_geom_info_hash(ginfo2),
+    "geom_info hash collision");
+  UTIL_ASSERT(sharp_alm_info_hash(ainfo)!=sharp_alm_info_hash(ainfo2),
+    "alm_info hash collision");
+
+  sharp_destroy_alm_info(ainfo2);
+  sharp_destroy_geom_info(ginfo2);
+  sharp_destroy_alm_info(ainfo);
+  sharp_destroy_geom_info(ginfo);
+  }
+
+/* A subset of the northernmost rings, passed as rings==NULL, must give the
+   same pixels as the full map. */
+static void check_healpix_subset(void)
+  {
+  int nside=8, nrings=10, lmax=16;
+  sharp_geom_info *full, *sub;
+  sharp_alm_info *ainfo;
+  sharp_make_healpix_geom_info(nside,1,&full);
+  sharp_make_subset_healpix_geom_info(nside,1,nrings,NULL,NULL,&sub);
+  UTIL_ASSERT(sub->npairs==nrings,"bad number of ring pairs");
+  sharp_make_triangular_alm_info(lmax,lmax,1,&ainfo);
+  ptrdiff_t npix=get_npix(full), npix_sub=get_npix(sub),
+            nalms=get_nalms(ainfo);
+  ptrdiff_t npix_exp=0;
+  for (int r=1; r<=nrings; ++r)
+    npix_exp+=4*IMIN(r,nside);
+  UTIL_ASSERT(npix_sub==npix_exp,"bad subset size");
+
+  dcmplx *alm=RALLOC(dcmplx,nalms);
+  double *map=RALLOC(double,npix), *map2=RALLOC(double,npix_sub);
+  random_alm(alm,ainfo,0,1);
+  sharp_execute(SHARP_ALM2MAP,0,&alm,&map,full,ainfo,1,SHARP_DP,NULL,NULL);
+  sharp_execute(SHARP_ALM2MAP,0,&alm,&map2,sub,ainfo,1,SHARP_DP,NULL,NULL);
+  double dmax=0;
+  for (ptrdiff_t i=0; i<npix_sub; ++i)
+    dmax=fmax(dmax,fabs(map[i]-map2[i]));
+  UTIL_ASSERT(dmax<1e-13,"ring subset differs from full map");
+
+  DEALLOC(map2);
+  DEALLOC(map);
+  DEALLOC(alm);
+  sharp_destroy_alm_info(ainfo);
+  sharp_destroy_geom_info(sub);
+  sharp_destroy_geom_info(full);
+  }
+
+static void check_masked_geometry(void)
+  {
+  const double pi=3.141592653589793238462643383279502884197;
+  int nside=32, lmax=64;
+  sharp_geom_info *full, *part;
+  sharp_alm_info *ainfo;
+  sharp_make_healpix_geom_info(nside,1,&full);
+  sharp_make_triangular_alm_info(lmax,lmax,1,&ainfo);
+  ptrdiff_t npix=sharp_map_size(full), nalms=get_nalms(ainfo);
+
+  /* a northern patch around phi=0 and a southern one elsewhere */
+  double *mask=RALLOC(double,npix), *map=RALLOC(double,npix),
+         *map2=RALLOC(double,npix);
+  int state=4711;
+  for (int i=0; i<full->npairs; ++i)
+    for (int r=0; r<2; ++r)
+      {
+      const sharp_ringinfo *ri = r ? &full->pair[i].r2 : &full->pair[i].r1;
+      for (int j=0; j<ri->nph; ++j)
+        {
+        double phi=fmod(ri->phi0+2*pi*j/ri->nph,2*pi);
+        int obs = ((ri->theta<1.)&&((phi<0.5)||(phi>2*pi-0.7)))
+               || ((ri->theta>2.2)&&(phi>2.)&&(phi<3.)&&(j%3!=0));
+        mask[ri->ofs+j*ri->stride]=obs;
+        map[ri->ofs+j*ri->stride]=obs*drand(-1,1,&state);
+        }
+      }
+  sharp_make_masked_geom_info(full,mask,&part);
+  UTIL_ASSERT(part->npairs<full->npairs,"no rings were dropped");
+  UTIL_ASSERT(sharp_map_size(part)<npix/4,"partial rings were not shrunk");
+  UTIL_ASSERT(sharp_map_extent(part)<=npix,"geometry exceeds map");
+
+  dcmplx *alm=RALLOC(dcmplx,nalms), *alm2=RALLOC(dcmplx,nalms);
+  sharp_execute(SHARP_MAP2ALM,0,&alm,&map,full,ainfo,1,SHARP_DP,NULL,NULL);
+  sharp_execute(SHARP_MAP2ALM,0,&alm2,&map,part,ainfo,1,SHARP_DP,NULL,NULL);
+  double dmax=0, amax=0;
+  for (ptrdiff_t i=0; i<nalms; ++i)
+    {
+    dmax=fmax(dmax,cabs(alm[i]-alm2[i]));
+    amax=fmax(amax,cabs(alm[i]));
+    }
+  UTIL_ASSERT(dmax<1e-12*amax,"masked map2alm differs");
+
+  for (ptrdiff_t i=0; i<npix; ++i) map2[i]=1e30;
+  sharp_execute(SHARP_ALM2MAP,0,&alm,&map,full,ainfo,1,SHARP_DP,NULL,NULL);
+  sharp_execute(SHARP_ALM2MAP,0,&alm,&map2,part,ainfo,1,SHARP_DP,NULL,NULL);
+  ptrdiff_t nwritten=0;
+  dmax=amax=0;
+  for (ptrdiff_t i=0; i<npix; ++i)
+    {
+    if (map2[i]!=1e30) ++nwritten;
+    if (mask[i]!=0.)
+      {
+      dmax=fmax(dmax,fabs(map[i]-map2[i]));
+      amax=fmax(amax,fabs(map[i]));
+      }
+    }
+  UTIL_ASSERT(dmax<1e-12*amax,"masked alm2map differs");
+  UTIL_ASSERT(nwritten==sharp_map_size(part),"pixels outside geometry written");
+
+  DEALLOC(alm2);
+  DEALLOC(alm);
+  DEALLOC(map2);
+  DEALLOC(map);
+  DEALLOC(mask);
+  sharp_destroy_alm_info(ainfo);
+  sharp_destroy_geom_info(part);
+  sharp_destroy_geom_info(full);
+  }
+
+static void check_almops(void)
+  {
+  int lmax=40, mmax=30;
+  sharp_alm_info *tri, *rect, *real;
+  sharp_make_triangular_alm_info(lmax,mmax,1,&tri);
+  sharp_make_rectangular_alm_info(lmax+5,mmax+3,2,&rect);
+  sharp_make_mmajor_real_packed_alm_info(lmax,1,mmax+1,NULL,&real);
+  ptrdiff_t ntri=get_nalms(tri);
+  dcmplx *a=RALLOC(dcmplx,ntri), *b=RALLOC(dcmplx,ntri),
+         *r=RALLOC(dcmplx,2*(lmax+6)*(mmax+4));
+  double *p=RALLOC(double,sharp_alm_count(real));
+  random_alm(a,tri,0,1);
+
+  /* a round trip through real packed and strided rectangular layouts */
+  sharp_alm_convert(tri,a,real,p,SHARP_DP);
+  sharp_alm_convert(real,p,rect,r,SHARP_DP);
+  sharp_alm_convert(rect,r,tri,b,SHARP_DP);
+  double dmax=0;
+  for (ptrdiff_t i=0; i<ntri; ++i)
+    dmax=fmax(dmax,cabs(a[i]-b[i]));
+  UTIL_ASSERT(dmax<1e-15,"a_lm layout round trip failed");
+  UTIL_ASSERT(FAPPROX(p[real->mvstart[3]+2*7],
+    sqrt(2.)*creal(a[sharp_alm_index(tri,7,3)]),1e-15),"bad real harmonics");
+  for (int m=0; m<=mmax+3; ++m)
+    for (int l=m; l<=lmax+5; ++l)
+      if ((l>lmax)||(m>mmax))
+        UTIL_ASSERT(r[sharp_alm_index(rect,l,m)]==0.,"missing a_lm not zero");
+
+  /* the inner product does not depend on the layout */
+  double dot=0;
+  for (int m=0; m<=mmax; ++m)
+    for (int l=m; l<=lmax; ++l)
+      {
+      dcmplx v=a[sharp_alm_index(tri,l,m)];
+      dot += ((m==0) ? 1 : 2)*creal(v*conj(v));
+      }
+  UTIL_ASSERT(FAPPROX(sharp_alm_dot(tri,a,a,SHARP_DP),dot,1e-13),
+    "bad a_lm dot product");
+  UTIL_ASSERT(FAPPROX(sharp_alm_dot(real,p,p,SHARP_DP),dot,1e-13),
+    "bad real harmonic dot product");
+
+  /* per-component filters and linear combinations */
+  double *fl=RALLOC(double,2*(lmax+1));
+  for (int l=0; l<=lmax; ++l)
+    { fl[l]=1./(l+1.); fl[lmax+1+l]=l; }
+  void *ab[2]={a,b};
+  sharp_almxfl(tri,ab,2,fl,lmax+1,SHARP_DP);
+  sharp_alm_axpby(tri,2.,a,-3.,b,SHARP_DP);
+  sharp_alm_convert(real,p,tri,a,SHARP_DP);
+  dmax=0;
+  for (int m=0; m<=mmax; ++m)
+    for (int l=m; l<=lmax; ++l)
+      {
+      ptrdiff_t i=sharp_alm_index(tri,l,m);
+      dmax=fmax(dmax,cabs(b[i]-(2*fl[l]-3*fl[lmax+1+l])*a[i]));
+      }
+  UTIL_ASSERT(dmax<1e-13,"almxfl/axpby failed");
+
+  double *fm=RALLOC(double,mmax+1);
+  for (int m=0; m<=mmax; ++m)
+    fm[m]=m+0.5;
+  void *pa=a;
+  sharp_almxfm(tri,&pa,1,fm,0,SHARP_DP);
+  sharp_alm_convert(real,p,tri,b,SHARP_DP);
+  dmax=0;
+  for (int m=0; m<=mmax; ++m)
+    for (int l=m; l<=lmax; ++l)
+      {
+      ptrdiff_t i=sharp_alm_index(tri,l,m);
+      dmax=fmax(dmax,cabs(a[i]-fm[m]*b[i]));
+      }
+  UTIL_ASSERT(dmax<1e-13,"almxfm failed");
+
+  DEALLOC(fm);
+  DEALLOC(fl);
+  DEALLOC(p);
+  DEALLOC(r);
+  DEALLOC(b);
+  DEALLOC(a);
+  sharp_destroy_alm_info(real);
+  sharp_destroy_alm_info(rect);
+  sharp_destroy_alm_info(tri);
+  }
+
+/* Sets a_lm with l>lmax to zero. */
+static void truncate_alm (dcmplx *alm, const sharp_alm_info *ainfo, int lmax)
+  {
+  for (int mi=0; mi<ainfo->nm; ++mi)
+    for (int l=IMAX(ainfo->mval[mi],lmax+1); l<=ainfo->lmax; ++l)
+      alm[sharp_alm_index(ainfo,l,mi)]=0.;
+  }
+
+/* Compares transforms on a geometry with per-ring band limits against
+   transforms of suitably truncated a_lm on the same, unlimited geometry. */
+static void check_band_lmax(void)
+  {
+  int lmax=63, nlat=64, nlon=128;
+  const int lband[3]={lmax,20,40};
+  sharp_geom_info *full, *band;
+  sharp_alm_info *ainfo;
+  sharp_make_gauss_geom_info(nlat,nlon,0.,1,nlon,&full);
+  sharp_make_gauss_geom_info(nlat,nlon,0.,1,nlon,&band);
+  /* the northern cap only, so that paired rings can have different limits */
+  sharp_set_band_lmax(band,0.,1.2,lband[1]);
+  sharp_set_band_lmax(band,1.5,1.7,lband[2]);
+  sharp_make_triangular_alm_info(lmax,lmax,1,&ainfo);
+  ptrdiff_t npix=get_npix(full), nalms=get_nalms(ainfo);
+
+  int *cls=RALLOC(int,npix);
+  for (int i=0; i<band->npairs; ++i)
+    for (int r=0; r<2; ++r)
+      {
+      const sharp_ringinfo *ri = r ? &band->pair[i].r2 : &band->pair[i].r1;
+      for (int j=0; j<ri->nph; ++j)
+        cls[ri->ofs+j*ri->stride] = (ri->lmax==lband[1]) ? 1 :
+                                    ((ri->lmax==lband[2]) ? 2 : 0);
+      }
+
+  for (int spin=0; spin<=2; spin+=2)
+    {
+    int ncomp=(spin==0) ? 1 : 2;
+    dcmplx **alm, **alm2, **alm3;
+    double **map, **map2;
+    ALLOC2D(alm,dcmplx,ncomp,nalms);
+    ALLOC2D(alm2,dcmplx,ncomp,nalms);
+    ALLOC2D(alm3,dcmplx,ncomp,nalms);
+    ALLOC2D(map,double,ncomp,npix);
+    ALLOC2D(map2,double,ncomp,npix);
+
+    /* synthesis */
+    for (int n=0; n<ncomp; ++n)
+      random_alm(alm[n],ainfo,spin,n+1);
+    sharp_execute(SHARP_ALM2MAP,spin,&alm[0],&map[0],band,ainfo,1,SHARP_DP,
+      NULL,NULL);
+    double dmax=0, amax=0;
+    for (int c=0; c<3; ++c)
+      {
+      for (int n=0; n<ncomp; ++n)
+        {
+        memcpy(alm2[n],alm[n],nalms*sizeof(dcmplx));
+        truncate_alm(alm2[n],ainfo,lband[c]);
+        }
+      sharp_execute(SHARP_ALM2MAP,spin,&alm2[0],&map2[0],full,ainfo,1,
+        SHARP_DP,NULL,NULL);
+      for (int n=0; n<ncomp; ++n)
+        for (ptrdiff_t i=0; i<npix; ++i)
+          if (cls[i]==c)
+            {
+            dmax=fmax(dmax,fabs(map[n][i]-map2[n][i]));
+            amax=fmax(amax,fabs(map2[n][i]));
+            }
+      }
+    UTIL_ASSERT(dmax<1e-12*amax,"band-limited alm2map differs");
+
+    /* analysis */
+    int state=4711;
+    for (int n=0; n<ncomp; ++n)
+      {
+      for (ptrdiff_t i=0; i<npix; ++i)
+        map[n][i]=drand(-1,1,&state);
+      SET_ARRAY(alm3[n],0,nalms,0.);
+      }
+    sharp_execute(SHARP_MAP2ALM,spin,&alm[0],&map[0],band,ainfo,1,SHARP_DP,
+      NULL,NULL);
+    for (int c=0; c<3; ++c)
+      {
+      for (int n=0; n<ncomp; ++n)
+        for (ptrdiff_t i=0; i<npix; ++i)
+          map2[n][i] = (cls[i]==c) ? map[n][i] : 0.;
+      sharp_execute(SHARP_MAP2ALM,spin,&alm2[0],&map2[0],full,ainfo,1,
+        SHARP_DP,NULL,NULL);
+      for (int n=0; n<ncomp; ++n)
+        {
+        truncate_alm(alm2[n],ainfo,lband[c]);
+        for (ptrdiff_t i=0; i<nalms; ++i)
+          alm3[n][i]+=alm2[n][i];
+        }
+      }
+    dmax=amax=0;
+    for (int n=0; n<ncomp; ++n)
+      for (ptrdiff_t i=0; i<nalms; ++i)
+        {
+        dmax=fmax(dmax,cabs(alm[n][i]-alm3[n][i]));
+        amax=fmax(amax,cabs(alm3[n][i]));
+        }
+    UTIL_ASSERT(dmax<1e-12*amax,"band-limited map2alm differs");
+
+    DEALLOC2D(map2);
+    DEALLOC2D(map);
+    DEALLOC2D(alm3);
+    DEALLOC2D(alm2);
+    DEALLOC2D(alm);
+    }
+
+  DEALLOC(cls);
+  sharp_destroy_alm_info(ainfo);
+  sharp_destroy_geom_info(band);
+  sharp_destroy_geom_info(full);
+  }
+
+/* Compares the small-mmax transforms against the standard ones, on a HEALPix
+   grid (where the polar rings alias the higher m) with some band limits. */
+static void check_small_mmax(void)
+  {
+  const int lmax=40, ntrans=2, mmax_try[4]={0,1,3,16};
+  sharp_geom_info *ginfo;
+  sharp_make_healpix_geom_info(8,1,&ginfo);
+  sharp_set_band_lmax(ginfo,0.3,0.9,10);
+  ptrdiff_t npix=get_npix(ginfo);
+
+  for (int im=0; im<4; ++im)
+    for (int spin=0; spin<=2; spin+=2)
+      for (int type=0; type<3; ++type)
+        {
+        sharp_jobtype jtype = (type==0) ? SHARP_ALM2MAP :
+          ((type==1) ? SHARP_MAP2ALM : SHARP_ALM2MAP_DERIV1);
+        if ((jtype==SHARP_ALM2MAP_DERIV1)&&(spin!=0)) continue;
+        sharp_alm_info *ainfo;
+        sharp_make_triangular_alm_info(lmax,mmax_try[im],1,&ainfo);
+        ptrdiff_t nalms=get_nalms(ainfo);
+        int nalm=(spin==0) ? 1 : 2,
+            nmaps=((spin==0)&&(jtype!=SHARP_ALM2MAP_DERIV1)) ? 1 : 2;
+        dcmplx **alm, **alm2;
+        double **map, **map2;
+        ALLOC2D(alm,dcmplx,ntrans*nalm,nalms);
+        ALLOC2D(alm2,dcmplx,ntrans*nalm,nalms);
+        ALLOC2D(map,double,ntrans*nmaps,npix);
+        ALLOC2D(map2,double,ntrans*nmaps,npix);
+        int state=1234;
+        for (int n=0; n<ntrans*nalm; ++n)
+          random_alm(alm[n],ainfo,(jtype==SHARP_ALM2MAP_DERIV1) ? 1 : spin,
+            n+1);
+        for (int n=0; n<ntrans*nmaps; ++n)
+          for (ptrdiff_t i=0; i<npix; ++i)
+            map[n][i]=drand(-1,1,&state);
+
+        double dmax=0, amax=0;
+        if (jtype==SHARP_MAP2ALM)
+          {
+          sharp_execute(jtype,spin,&alm[0],&map[0],ginfo,ainfo,ntrans,
+            SHARP_DP|SHARP_SMALL_MMAX,NULL,NULL);
+          sharp_execute(jtype,spin,&alm2[0],&map[0],ginfo,ainfo,ntrans,
+            SHARP_DP|SHARP_NO_SMALL_MMAX,NULL,NULL);
+          for (int n=0; n<ntrans*nalm; ++n)
+            for (ptrdiff_t i=0; i<nalms; ++i)
+              {
+              dmax=fmax(dmax,cabs(alm[n][i]-alm2[n][i]));
+              amax=fmax(amax,cabs(alm2[n][i]));
+              }
+          }
+        else
+          {
+          sharp_execute(jtype,spin,&alm[0],&map[0],ginfo,ainfo,ntrans,
+            SHARP_DP|SHARP_SMALL_MMAX,NULL,NULL);
+          sharp_execute(jtype,spin,&alm[0],&map2[0],ginfo,ainfo,ntrans,
+            SHARP_DP|SHARP_NO_SMALL_MMAX,NULL,NULL);
+          for (int n=0; n<ntrans*nmaps; ++n)
+            for (ptrdiff_t i=0; i<npix; ++i)
+              {
+              dmax=fmax(dmax,fabs(map[n][i]-map2[n][i]));
+              amax=fmax(amax,fabs(map2[n][i]));
+              }
+          }
+        UTIL_ASSERT(dmax<=1e-12*amax,"small-mmax transform differs");
+
+        DEALLOC2D(map2);
+        DEALLOC2D(map);
+        DEALLOC2D(alm2);
+        DEALLOC2D(alm);
+        sharp_destroy_alm_info(ainfo);
+        }
+
+  sharp_destroy_geom_info(ginfo);
+  }
+
+static void check_plan(void)
+  {
+  const int lmax=40, spin=2, ntrans=2;
+  sharp_geom_info *ginfo;
+  sharp_alm_info *ainfo;
+  sharp_make_healpix_geom_info(16,1,&ginfo);
+  sharp_make_triangular_alm_info(lmax,lmax,1,&ainfo);
+  ptrdiff_t npix=get_npix(ginfo), nalms=get_nalms(ainfo);
+  int ncomp=2*ntrans;
+  dcmplx **alm, **alm2;
+  double **map, **map2;
+  ALLOC2D(alm,dcmplx,ncomp,nalms);
+  ALLOC2D(alm2,dcmplx,ncomp,nalms);
+  ALLOC2D(map,double,ncomp,npix);
+  ALLOC2D(map2,double,ncomp,npix);
+  for (int n=0; n<ncomp; ++n)
+    random_alm(alm[n],ainfo,spin,n+1);
+
+  sharp_plan *a2m, *m2a;
+  sharp_make_plan(SHARP_ALM2MAP,spin,ginfo,ainfo,ntrans,SHARP_DP,&a2m);
+  sharp_make_plan(SHARP_MAP2ALM,spin,ginfo,ainfo,ntrans,SHARP_DP,&m2a);
+  sharp_execute(SHARP_ALM2MAP,spin,&alm[0],&map[0],ginfo,ainfo,ntrans,SHARP_DP,
+    NULL,NULL);
+  double time=-1;
+  unsigned long long opcnt=0;
+  for (int nthreads=0; nthreads<=1; ++nthreads)
+    {
+    sharp_execute_plan(a2m,&alm[0],&map2[0],0,nthreads,&time,&opcnt);
+    UTIL_ASSERT((time>=0)&&(opcnt>0),"no plan statistics");
+    for (int n=0; n<ncomp; ++n)
+      for (ptrdiff_t i=0; i<npix; ++i)
+        UTIL_ASSERT(fabs(map[n][i]-map2[n][i])<=1e-14*fabs(map[n][i])+1e-15,
+          "planned alm2map differs");
+    }
+
+  sharp_execute(SHARP_MAP2ALM,spin,&alm[0],&map[0],ginfo,ainfo,ntrans,SHARP_DP,
+    NULL,NULL);
+  sharp_execute_plan(m2a,&alm2[0],&map[0],0,0,NULL,NULL);
+  sharp_execute_plan(m2a,&alm2[0],&map[0],SHARP_ADD,1,NULL,NULL);
+  for (int n=0; n<ncomp; ++n)
+    for (ptrdiff_t i=0; i<nalms; ++i)
+      UTIL_ASSERT(cabs(2*alm[n][i]-alm2[n][i])<=1e-14*cabs(alm[n][i])+1e-15,
+        "planned map2alm differs");
+
+  sharp_destroy_plan(m2a);
+  sharp_destroy_plan(a2m);
+  DEALLOC2D(map2);
+  DEALLOC2D(map);
+  DEALLOC2D(alm2);
+  DEALLOC2D(alm);
+  sharp_destroy_alm_info(ainfo);
+  sharp_destroy_geom_info(ginfo);
+  }
+
 static void sharp_acctest(void)
   {
   if (mytask==0) sharp_module_startup("sharp_acctest",1,1,"",1);
@@ -508,12 +997,40 @@ static void sharp_acctest(void)
   check_sign_scale();
   if (mytask==0) printf("Passed.\n\n");
 
+  if (mytask==0) printf("Checking geometry and a_lm info serialization.\n");
+  check_infoio();
+  if (mytask==0) printf("Passed.\n\n");
+
+  if (mytask==0) printf("Checking a_lm layout conversion and arithmetic.\n");
+  check_almops();
+  if (mytask==0) printf("Passed.\n\n");
+
+  if (mytask==0) printf("Checking HEALPix ring subsets.\n");
+  check_healpix_subset();
+  if (mytask==0) printf("Passed.\n\n");
+
+  if (mytask==0) printf("Checking partial-sky geometries.\n");
+  check_masked_geometry();
+  if (mytask==0) printf("Passed.\n\n");
+
+  if (mytask==0) printf("Checking per-ring band limits.\n");
+  check_band_lmax();
+  if (mytask==0) printf("Passed.\n\n");
+
+  if (mytask==0) printf("Checking transforms with small mmax.\n");
+  check_small_mmax();
+  if (mytask==0) printf("Passed.\n\n");
+
+  if (mytask==0) printf("Checking SHT plans.\n");
+  check_plan();
+  if (mytask==0) printf("Passed.\n\n");
+
   if (mytask==0) printf("Testing map analysis accuracy.\n");
 
   sharp_geom_info *ginfo;
   sharp_alm_info *ainfo;
   int lmax=127, mmax=127, nlat=128, nlon=256;
-  get_infos ("gauss", lmax, &mmax, &nlat, &nlon, &ginfo, &ainfo);
+  get_infos ("gauss", lmax, &mmax, 0, &nlat, &nlon, &ginfo, &ainfo);
   for (int nv=1; nv<=6; ++nv)
     for (int ntrans=1; ntrans<=6; ++ntrans)
       {
@@ -544,7 +1061,7 @@ static void sharp_test (int argc, const char **argv)
 
   sharp_geom_info *ginfo;
   sharp_alm_info *ainfo;
-  get_infos (argv[2], lmax, &mmax, &gpar1, &gpar2, &ginfo, &ainfo);
+  get_infos (argv[2], lmax, &mmax, spin, &gpar1, &gpar2, &ginfo, &ainfo);
 
   int ncomp = ntrans*((spin==0) ? 1 : 2);
   double t_a2m=1e30, t_m2a=1e30;
@@ -633,7 +1150,7 @@ static void sharp_bench (int argc, const char **argv)
 
   sharp_geom_info *ginfo;
   sharp_alm_info *ainfo;
-  get_infos (argv[2], lmax, &mmax, &gpar1, &gpar2, &ginfo, &ainfo);
+  get_infos (argv[2], lmax, &mmax, spin, &gpar1, &gpar2, &ginfo, &ainfo);
 
   double ta2m_auto=1e30, tm2a_auto=1e30, ta2m_min=1e30, tm2a_min=1e30;
   unsigned long long opa2m_min=0, opm2a_min=0;
@@ -680,6 +1197,148 @@ static void sharp_bench (int argc, const char **argv)
   sharp_destroy_geom_info(ginfo);
   }
 
+static void sharp_iter (int argc, const char **argv)
+  {
+  if (mytask==0) sharp_announce("sharp_iter");
+  UTIL_ASSERT(argc>=10,"usage: grid lmax mmax geom1 geom2 spin ntrans niter");
+  int lmax=atoi(argv[3]);
+  int mmax=atoi(argv[4]);
+  int gpar1=atoi(argv[5]);
+  int gpar2=atoi(argv[6]);
+  int spin=atoi(argv[7]);
+  int ntrans=atoi(argv[8]);
+  int niter=atoi(argv[9]);
+
+  if (mytask==0) printf("Testing iterative map analysis.\n");
+  if (mytask==0) printf("spin=%d, ntrans=%d\n", spin, ntrans);
+
+  sharp_geom_info *ginfo;
+  sharp_alm_info *ainfo;
+  get_infos (argv[2], lmax, &mmax, spin, &gpar1, &gpar2, &ginfo, &ainfo);
+
+  ptrdiff_t nalms = get_nalms(ainfo);
+  int ncomp = ntrans*((spin==0) ? 1 : 2);
+  ptrdiff_t npix = get_npix(ginfo);
+  double **map;
+  ALLOC2D(map,double,ncomp,npix);
+  dcmplx **alm, **alm2;
+  ALLOC2D(alm,dcmplx,ncomp,nalms);
+  ALLOC2D(alm2,dcmplx,ncomp,nalms);
+  for (int i=0; i<ncomp; ++i)
+    random_alm(alm[i],ainfo,spin,i+1);
+#ifdef USE_MPI
+  sharp_execute_mpi(MPI_COMM_WORLD,SHARP_ALM2MAP,spin,&alm[0],&map[0],ginfo,
+    ainfo,ntrans,SHARP_DP,NULL,NULL);
+#else
+  sharp_execute(SHARP_ALM2MAP,spin,&alm[0],&map[0],ginfo,ainfo,ntrans,
+    SHARP_DP,NULL,NULL);
+#endif
+
+  static const char *name[] = { "Jacobi", "CG" };
+  double *resid=RALLOC(double,ntrans);
+  for (int method=SHARP_ITER_JACOBI; method<=SHARP_ITER_CG; ++method)
+    for (int it=0; it<=niter; ++it)
+      {
+      double t=wallTime();
+#ifdef USE_MPI
+      int nit=sharp_map2alm_iter_mpi(MPI_COMM_WORLD,(sharp_itermethod)method,
+        spin,&alm2[0],&map[0],ginfo,ainfo,ntrans,SHARP_DP,it,0.,resid);
+#else
+      int nit=sharp_map2alm_iter((sharp_itermethod)method,spin,&alm2[0],
+        &map[0],ginfo,ainfo,ntrans,SHARP_DP,it,0.,resid);
+#endif
+      t=maxTime(wallTime()-t);
+      double *sqsum=RALLOC(double,ncomp), *err_abs, *err_rel;
+      for (int i=0; i<ncomp; ++i)
+        {
+        sqsum[i]=0;
+        for (ptrdiff_t j=0; j<nalms; ++j)
+          {
+          sqsum[i]+=creal(alm[i][j])*creal(alm[i][j])
+                   +cimag(alm[i][j])*cimag(alm[i][j]);
+          alm2[i][j]-=alm[i][j];
+          }
+        }
+      get_errors(alm2, nalms, ncomp, sqsum, &err_abs, &err_rel);
+      double maxres=0., maxerel=0.;
+      for (int i=0; i<ntrans; ++i)
+        if (resid[i]>maxres) maxres=resid[i];
+      for (int i=0; i<ncomp; ++i)
+        if (err_rel[i]>maxerel) maxerel=err_rel[i];
+      if (mytask==0)
+        printf("%-6s niter=%2d: time %fs, map residual %e, rms %e\n",
+          name[method],nit,t,maxres,maxerel);
+      DEALLOC(sqsum);
+      DEALLOC(err_abs);
+      DEALLOC(err_rel);
+      }
+
+  DEALLOC(resid);
+  DEALLOC2D(map);
+  DEALLOC2D(alm);
+  DEALLOC2D(alm2);
+  sharp_destroy_alm_info(ainfo);
+  sharp_destroy_geom_info(ginfo);
+  }
+
+static double legbench_time (int clenshaw, double *bl, double *recfac,
+  int lmax, double *x, double *out, int nx)
+  {
+  double tmin=1e30, tacc=0.;
+  int ntries=0;
+  do
+    {
+    double t=wallTime();
+    if (clenshaw)
+      sharp_legendre_transform_clenshaw(bl,recfac,lmax,x,out,nx);
+    else
+      sharp_legendre_transform(bl,recfac,lmax,x,out,nx);
+    t=wallTime()-t;
+    if (t<tmin) tmin=t;
+    tacc+=t;
+    ++ntries;
+    } while((ntries<2)||(tacc<1.));
+  return tmin;
+  }
+
+static void sharp_legbench (int argc, const char **argv)
+  {
+  if (mytask==0) sharp_announce("sharp_legbench");
+  UTIL_ASSERT(argc>=4,"usage: lmax nx");
+  int lmax=atoi(argv[2]);
+  int nx=atoi(argv[3]);
+  const double pi=3.141592653589793238462643383279502884197;
+
+  /* a smooth, beam-like b_l */
+  double *bl=RALLOC(double,lmax+1), *recfac=RALLOC(double,lmax+1);
+  double sigma=(lmax>0) ? -log(1e-3)/((double)lmax*(lmax+1.)) : 0.;
+  for (int l=0; l<=lmax; ++l)
+    bl[l]=(2*l+1)*exp(-sigma*l*(l+1.));
+  sharp_legendre_transform_recfac(recfac,lmax);
+  double *x=RALLOC(double,nx), *out1=RALLOC(double,nx), *out2=RALLOC(double,nx);
+  for (int i=0; i<nx; ++i)
+    x[i]=cos(pi*(i+0.5)/nx);
+
+  double t1=legbench_time(0,bl,recfac,lmax,x,out1,nx);
+  double t2=legbench_time(1,bl,recfac,lmax,x,out2,nx);
+  double maxval=0., maxdiff=0.;
+  for (int i=0; i<nx; ++i)
+    {
+    if (fabs(out1[i])>maxval) maxval=fabs(out1[i]);
+    if (fabs(out1[i]-out2[i])>maxdiff) maxdiff=fabs(out1[i]-out2[i]);
+    }
+  if (mytask==0)
+    printf("lmax=%d nx=%d VLEN=%d: recursion %.3es, Clenshaw %.3es, "
+      "speedup %.2f, max rel. difference %.2e\n",lmax,nx,VLEN,t1,t2,t1/t2,
+      maxdiff/maxval);
+
+  DEALLOC(out2);
+  DEALLOC(out1);
+  DEALLOC(x);
+  DEALLOC(recfac);
+  DEALLOC(bl);
+  }
+
 int main(int argc, const char **argv)
   {
 #ifdef USE_MPI
@@ -698,6 +1357,10 @@ int main(int argc, const char **argv)
     sharp_test(argc,argv);
   else if (strcmp(argv[1],"bench")==0)
     sharp_bench(argc,argv);
+  else if (strcmp(argv[1],"iter")==0)
+    sharp_iter(argc,argv);
+  else if (strcmp(argv[1],"legbench")==0)
+    sharp_legbench(argc,argv);
   else
     UTIL_FAIL("unknown command");
 
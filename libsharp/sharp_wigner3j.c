@@ -0,0 +1,307 @@
+/*
+ *  This file is part of libsharp.
+ *
+ *  libsharp is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libsharp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libsharp; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*! \file sharp_wigner3j.c
+ *  Wigner 3j symbols and pseudo-C_l mode-coupling matrices
+ *
+ *  Copyright (C) 2026 The libsharp developers
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "sharp_wigner3j.h"
+#include "sharp_legendre.h"
+#include "sharp_legendre_roots.h"
+#include "c_utils.h"
+
+/* Values of the unnormalized recursion are rescaled when they exceed this. */
+#define W3J_HUGE 1e100
+
+/* Coefficients of the Schulten-Gordon recursion
+   l A(l+1) f(l+1) + B(l) f(l) + (l+1) A(l) f(l-1) = 0 */
+static inline double sg_A (double l, double l2, double l3, double m1)
+  {
+  double d=l2-l3, s=l2+l3+1.;
+  return sqrt((l*l-d*d)*(s*s-l*l)*(l*l-m1*m1));
+  }
+static inline double sg_B (double l, double l2, double l3, double m1,
+  double m32)
+  { return -(2.*l+1.)*((l2*(l2+1.)-l3*(l3+1.))*m1 - l*(l+1.)*m32); }
+
+int sharp_wigner3j (int l2, int l3, int m2, int m3, int *l1min, double *res)
+  {
+  int m1=-m2-m3;
+  int lmin=IMAX(abs(l2-l3),abs(m1)), lmax=l2+l3;
+  *l1min=lmin;
+  if ((abs(m2)>l2)||(abs(m3)>l3)||(lmin>lmax)) return 0;
+  int n=lmax-lmin+1;
+  double dl2=l2, dl3=l3, dm1=m1, dm32=m3-m2;
+
+  /* Forward recursion from lmin; the solution grows in the classically
+     forbidden region, so we continue until it stops growing. */
+  res[0]=1.;
+  int kf=0;
+  if (n>1)
+    {
+    double Anext=sg_A(lmin+1,dl2,dl3,dm1);
+    res[1] = (lmin==0) ? -dm32/(2.*sqrt(dl2*(dl2+1.)))
+                       : -sg_B(lmin,dl2,dl3,dm1,dm32)/(lmin*Anext);
+    kf=1;
+    double Acur=Anext;
+    for (int l=lmin+1; l<lmax; ++l)
+      {
+      int i=l-lmin;
+      Anext=sg_A(l+1,dl2,dl3,dm1);
+      double fnew = -(sg_B(l,dl2,dl3,dm1,dm32)*res[i] + (l+1)*Acur*res[i-1])
+                    /(l*Anext);
+      if (fabs(fnew)<=fmax(fabs(res[i]),fabs(res[i-1]))) break;
+      res[kf=i+1]=fnew;
+      if (fabs(fnew)>W3J_HUGE)
+        for (int j=0; j<=kf; ++j) res[j]*=1./W3J_HUGE;
+      Acur=Anext;
+      }
+    }
+
+  /* Backward recursion from lmax down to the matching point; the values at
+     kf-1 and kf are used to match both solutions in a least-squares sense. */
+  if (kf<n-1)
+    {
+    double gp=0., gc=1., gk=0., gk1=0.;
+    double Acur=sg_A(lmax,dl2,dl3,dm1), Anext=0.;
+    res[n-1]=1.;
+    for (int l=lmax; l>=lmin+kf; --l)
+      {
+      int i=l-1-lmin;
+      double gn = -(sg_B(l,dl2,dl3,dm1,dm32)*gc + l*Anext*gp)/((l+1)*Acur);
+      if (i>kf) res[i]=gn;
+      else if (i==kf) gk=gn;
+      else gk1=gn;
+      if (fabs(gn)>W3J_HUGE)
+        {
+        for (int j=IMAX(i,kf+1); j<n; ++j) res[j]*=1./W3J_HUGE;
+        gn*=1./W3J_HUGE; gc*=1./W3J_HUGE; gk*=1./W3J_HUGE;
+        }
+      gp=gc; gc=gn;
+      Anext=Acur; Acur=sg_A(l-1,dl2,dl3,dm1);
+      }
+    double scale=(res[kf]*gk+res[kf-1]*gk1)/(gk*gk+gk1*gk1);
+    for (int i=kf+1; i<n; ++i) res[i]*=scale;
+    }
+
+  /* normalisation: sum_l1 (2l1+1) f^2 = 1, sign fixed by f(lmax) */
+  double fm=0.;
+  for (int i=0; i<n; ++i) fm=fmax(fm,fabs(res[i]));
+  double sum=0.;
+  for (int i=0; i<n; ++i)
+    {
+    double v=res[i]/fm;
+    sum+=(2.*(lmin+i)+1.)*v*v;
+    }
+  double norm=1./(fm*sqrt(sum));
+  if ((res[n-1]<0.) != (((l2-l3-m1)&1)!=0)) norm=-norm;
+  for (int i=0; i<n; ++i) res[i]*=norm;
+  return n;
+  }
+
+/* cb[n] = binomial(2n,n)/4^n; with these,
+   (l1 l2 l3; 0 0 0)^2 = cb[g-l1]*cb[g-l2]*cb[g-l3]/(cb[g]*(2g+1)),
+   where 2g=l1+l2+l3 is even. */
+static double *central_binomials (int nmax)
+  {
+  double *cb=RALLOC(double,nmax+1);
+  cb[0]=1.;
+  for (int n=1; n<=nmax; ++n)
+    cb[n]=cb[n-1]*(2.*n-1.)/(2.*n);
+  return cb;
+  }
+
+void sharp_coupling_matrix (int lmax, const double *wl, int lmax_w,
+  double *m00, double *m02, double *mpp, double *mmm)
+  {
+  const double pi=3.141592653589793238462643383279502884197;
+  UTIL_ASSERT((lmax>=0)&&(lmax_w>=0),"bad lmax");
+  lmax_w=IMIN(lmax_w,2*lmax);
+  int gmax=(2*lmax+lmax_w)/2;
+  double *cb=central_binomials(gmax);
+  double *ginv=RALLOC(double,gmax+1);
+  for (int g=0; g<=gmax; ++g)
+    ginv[g]=1./(cb[g]*(2.*g+1.));
+  double *wt=RALLOC(double,lmax_w+1);
+  for (int l=0; l<=lmax_w; ++l)
+    wt[l]=(2.*l+1.)*wl[l]/(4.*pi);
+  int spin2 = (m02!=NULL)||(mpp!=NULL)||(mmm!=NULL);
+  ptrdiff_t ncol=lmax+1;
+
+#pragma omp parallel
+{
+  double *buf = spin2 ? RALLOC(double,2*lmax+1) : NULL;
+  int l1;
+#pragma omp for schedule(dynamic,1)
+  for (l1=0; l1<=lmax; ++l1)
+    /* the sums are symmetric in l1 and l2, so compute them only once */
+    for (int l2=l1; l2<=lmax; ++l2)
+      {
+      int l3lo=l2-l1, l3hi=IMIN(l1+l2,lmax_w);
+      if (m00)
+        {
+        double s=0.;
+        for (int l3=l3lo; l3<=l3hi; l3+=2)
+          {
+          int g=(l1+l2+l3)>>1;
+          s+=wt[l3]*cb[g-l1]*cb[g-l2]*cb[g-l3]*ginv[g];
+          }
+        m00[l1*ncol+l2]=(2.*l2+1.)*s;
+        m00[l2*ncol+l1]=(2.*l1+1.)*s;
+        }
+      if (!spin2) continue;
+      double s02=0., spp=0., smm=0.;
+      if (l1>=2)
+        {
+        int lo;
+        sharp_wigner3j(l1,l2,2,-2,&lo,buf);
+        /* buf[l3-lo] = (l3 l1 l2; 0 2 -2) = (l1 l2 l3; 2 -2 0), lo==l3lo */
+        for (int l3=l3lo; l3<=l3hi; l3+=2)
+          {
+          double v=buf[l3-lo];
+          int g=(l1+l2+l3)>>1;
+          double w000=sqrt(cb[g-l1]*cb[g-l2]*cb[g-l3]*ginv[g]);
+          spp+=wt[l3]*v*v;
+          s02+=wt[l3]*v*((g&1) ? -w000 : w000);
+          }
+        for (int l3=l3lo+1; l3<=l3hi; l3+=2)
+          smm+=wt[l3]*buf[l3-lo]*buf[l3-lo];
+        }
+      if (m02)
+        { m02[l1*ncol+l2]=(2.*l2+1.)*s02; m02[l2*ncol+l1]=(2.*l1+1.)*s02; }
+      if (mpp)
+        { mpp[l1*ncol+l2]=(2.*l2+1.)*spp; mpp[l2*ncol+l1]=(2.*l1+1.)*spp; }
+      if (mmm)
+        { mmm[l1*ncol+l2]=(2.*l2+1.)*smm; mmm[l2*ncol+l1]=(2.*l1+1.)*smm; }
+      }
+  DEALLOC(buf);
+} /* end of parallel region */
+
+  DEALLOC(wt);
+  DEALLOC(ginv);
+  DEALLOC(cb);
+  }
+
+void sharp_coupling_matrix_recursive (int lmax, const double *wl, int lmax_w,
+  double *m00)
+  {
+  const double pi=3.141592653589793238462643383279502884197;
+  UTIL_ASSERT((lmax>=0)&&(lmax_w>=0),"bad lmax");
+  int n=2*lmax+1;
+  /* k[l2] = K(l1,l2) for the current l1, kp[l2] = K(l1-1,l2) */
+  double *k=RALLOC(double,n), *kp=RALLOC(double,n), *kn=RALLOC(double,n),
+         *inv=RALLOC(double,n);
+  for (int l=0; l<n; ++l)
+    {
+    k[l] = (l<=lmax_w) ? wl[l]/(2.*pi) : 0.;
+    kp[l]=kn[l]=0.;
+    inv[l]=1./(2.*l+1.);
+    }
+  ptrdiff_t ncol=lmax+1;
+  for (int l1=0; l1<=lmax; ++l1)
+    {
+    for (int l2=l1; l2<=lmax; ++l2)
+      {
+      m00[l1*ncol+l2]=(l2+0.5)*k[l2];
+      m00[l2*ncol+l1]=(l1+0.5)*k[l2];
+      }
+    if (l1==lmax) break;
+    /* x P_l = ((l+1) P_(l+1) + l P_(l-1))/(2l+1), applied once to P_l1 and
+       once to P_l2; row l1+1 is needed up to l2=2*lmax-l1-1 */
+    double a=(2.*l1+1.)/(l1+1.), b=l1/(l1+1.);
+    for (int l2=l1+1; l2<n-l1-1; ++l2)
+      kn[l2]=a*inv[l2]*((l2+1.)*k[l2+1]+l2*k[l2-1])-b*kp[l2];
+    double *tmp=kp; kp=k; k=kn; kn=tmp;
+    }
+  DEALLOC(inv);
+  DEALLOC(kn);
+  DEALLOC(kp);
+  DEALLOC(k);
+  }
+
+#ifndef NO_LEGENDRE
+
+/* number of rows of the coupling matrix processed per adjoint transform */
+#define COUPLING_BLOCK 64
+
+void sharp_coupling_matrix_gauss (int lmax, const double *wl, int lmax_w,
+  double *m00)
+  {
+  const double pi=3.141592653589793238462643383279502884197;
+  UTIL_ASSERT((lmax>=0)&&(lmax_w>=0),"bad lmax");
+  lmax_w=IMIN(lmax_w,2*lmax);
+  /* the integrand has degree <= 2*lmax+lmax_w */
+  int nx=lmax+lmax_w/2+1;
+  double *x=RALLOC(double,nx), *w=RALLOC(double,nx), *xi=RALLOC(double,nx);
+  sharp_legendre_roots(nx,x,w);
+
+  double *bl=RALLOC(double,lmax_w+1);
+  for (int l=0; l<=lmax_w; ++l)
+    bl[l]=(2.*l+1.)*wl[l]/(4.*pi);
+  sharp_legendre_transform(bl,NULL,lmax_w,x,xi,nx);
+  for (int i=0; i<nx; ++i)
+    w[i]*=xi[i];
+  DEALLOC(bl);
+
+  double *recfac=RALLOC(double,lmax+1);
+  sharp_legendre_transform_recfac(recfac,lmax);
+  int nb=IMIN(COUPLING_BLOCK,lmax+1);
+  double *f=RALLOC(double,nb*(ptrdiff_t)nx);
+  double *pm1=RALLOC(double,nx), *p0=RALLOC(double,nx);
+  for (int i=0; i<nx; ++i)
+    { pm1[i]=0.; p0[i]=1.; }
+  ptrdiff_t ncol=lmax+1;
+  for (int lb=0; lb<=lmax; lb+=nb)
+    {
+    int nrow=IMIN(nb,lmax+1-lb);
+    for (int r=0; r<nrow; ++r)
+      {
+      int l=lb+r;
+      double *fr=f+r*(ptrdiff_t)nx;
+      for (int i=0; i<nx; ++i)
+        fr[i]=p0[i];
+      /* P_{l+1} = ((2l+1) x P_l - l P_{l-1})/(l+1) */
+      double a=(2.*l+1.)/(l+1.), b=l/(l+1.);
+      for (int i=0; i<nx; ++i)
+        {
+        double pnew=a*x[i]*p0[i]-b*pm1[i];
+        pm1[i]=p0[i];
+        p0[i]=pnew;
+        }
+      }
+    sharp_legendre_transform_adjoint_batch(f,nx,nrow,w,recfac,lmax,x,
+      m00+lb*ncol,ncol,nx);
+    }
+  for (int l1=0; l1<=lmax; ++l1)
+    for (int l2=0; l2<=lmax; ++l2)
+      m00[l1*ncol+l2]*=l2+0.5;
+
+  DEALLOC(p0);
+  DEALLOC(pm1);
+  DEALLOC(f);
+  DEALLOC(recfac);
+  DEALLOC(xi);
+  DEALLOC(w);
+  DEALLOC(x);
+  }
+
+#endif
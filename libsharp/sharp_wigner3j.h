@@ -0,0 +1,122 @@
+/*
+ *  This file is part of libsharp.
+ *
+ *  libsharp is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libsharp is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libsharp; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*! \file sharp_wigner3j.h
+ *  Wigner 3j symbols and pseudo-C_l mode-coupling matrices
+ *
+ *  Copyright (C) 2026 The libsharp developers
+ */
+
+#ifndef SHARP_WIGNER3J_H
+#define SHARP_WIGNER3J_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Computes the Wigner 3j symbols
+    \f$\left(\begin{array}{ccc}l_1&l_2&l_3\\-m_2-m_3&m_2&m_3\end{array}\right)\f$
+    for all allowed \f$l_1\f$, using the three-term recursion of
+    Schulten & Gordon (1975). The recursion is run forward from the lower end
+    of the range and backward from the upper end and matched in the middle,
+    so that it is stable for arbitrary arguments.
+    \param l2 first fixed degree
+    \param l3 second fixed degree
+    \param m2 order belonging to \a l2
+    \param m3 order belonging to \a l3
+    \param l1min on exit, the smallest allowed \f$l_1\f$,
+           i.e. \f$\max(|l_2-l_3|,|m_2+m_3|)\f$
+    \param res array of at least \a l2+\a l3+1 entries; on exit, res[i]
+           contains the symbol for \f$l_1\f$=*\a l1min+i.
+    \returns the number of allowed \f$l_1\f$ values, or 0 if
+             \f$|m_2|>l_2\f$ or \f$|m_3|>l_3\f$. */
+int sharp_wigner3j (int l2, int l3, int m2, int m3, int *l1min, double *res);
+
+/*! Computes the MASTER mode-coupling matrices (Hivon et al. 2002) induced by
+    a mask with angular power spectrum \a wl (e.g. computed from the output of
+    a SHARP_MAP2ALM job on the mask):
+    \f[M^{00}_{l_1l_2}=\frac{2l_2+1}{4\pi}\sum_{l_3}(2l_3+1)W_{l_3}
+      \left(\begin{array}{ccc}l_1&l_2&l_3\\0&0&0\end{array}\right)^2\f]
+    \f[M^{02}_{l_1l_2}=\frac{2l_2+1}{4\pi}\sum_{l_3}(2l_3+1)W_{l_3}
+      \left(\begin{array}{ccc}l_1&l_2&l_3\\0&0&0\end{array}\right)
+      \left(\begin{array}{ccc}l_1&l_2&l_3\\2&-2&0\end{array}\right)\f]
+    \f[M^{\pm\pm}_{l_1l_2}=\frac{2l_2+1}{8\pi}\sum_{l_3}(2l_3+1)W_{l_3}
+      \left(1\pm(-1)^{l_1+l_2+l_3}\right)
+      \left(\begin{array}{ccc}l_1&l_2&l_3\\2&-2&0\end{array}\right)^2\f]
+    \f$M^{00}\f$ couples TT, \f$M^{02}\f$ couples TE and TB, \f$M^{++}\f$
+    couples EE to EE (and BB to BB), \f$M^{--}\f$ couples BB to EE (and
+    EE to BB).
+    All matrices are stored row-major with (\a lmax+1)*(\a lmax+1) entries,
+    element \f$(l_1,l_2)\f$ at index \f$l_1\f$*(\a lmax+1)+\f$l_2\f$.
+    Any of the output pointers may be NULL, in which case the corresponding
+    matrix is not computed. The rows are distributed over OpenMP threads.
+    \param lmax maximum multipole of the coupling matrices
+    \param wl mask power spectrum, \a lmax_w+1 entries
+    \param lmax_w maximum multipole of \a wl; higher multipoles are treated
+           as zero
+    \param m00 output array for \f$M^{00}\f$, or NULL
+    \param m02 output array for \f$M^{02}\f$, or NULL
+    \param mpp output array for \f$M^{++}\f$, or NULL
+    \param mmm output array for \f$M^{--}\f$, or NULL */
+void sharp_coupling_matrix (int lmax, const double *wl, int lmax_w,
+  double *m00, double *m02, double *mpp, double *mmm);
+
+/*! Computes the same \f$M^{00}\f$ as sharp_coupling_matrix(), but without
+    evaluating any 3j symbols: using
+    \f$\int_{-1}^1 P_{l_1}P_{l_2}P_{l_3}\,dx=2\left(\begin{array}{ccc}
+    l_1&l_2&l_3\\0&0&0\end{array}\right)^2\f$, the matrix is
+    \f[M^{00}_{l_1l_2}=\frac{2l_2+1}{2}\sum_i w_i\,\xi(x_i)P_{l_1}(x_i)
+      P_{l_2}(x_i)\f]
+    where \f$\xi(x)=\sum_l\frac{2l+1}{4\pi}W_lP_l(x)\f$ is the correlation
+    function of the mask and \f$x_i, w_i\f$ are the nodes and weights of a
+    Gauss-Legendre rule that is exact for this integrand. \f$\xi\f$ is
+    obtained with sharp_legendre_transform(), and the sums over the nodes
+    with sharp_legendre_transform_adjoint_batch(), so that all work is done
+    in the vectorized Legendre kernels on a grid of about
+    \a lmax+\a lmax_w/2 nodes. Each row costs one sum over all nodes, so
+    the total work is O(\a lmax^2 (\a lmax+\a lmax_w)), the same order as
+    the 3j-based construction but with a much smaller constant; see
+    sharp_coupling_matrix_recursive() for an O(\a lmax^2) method.
+    \param lmax maximum multipole of the coupling matrix
+    \param wl mask power spectrum, \a lmax_w+1 entries
+    \param lmax_w maximum multipole of \a wl
+    \param m00 output array with (\a lmax+1)*(\a lmax+1) entries */
+void sharp_coupling_matrix_gauss (int lmax, const double *wl, int lmax_w,
+  double *m00);
+
+/*! Computes the same \f$M^{00}\f$ as sharp_coupling_matrix() in
+    O(\a lmax^2) operations. With
+    \f$K_{l_1l_2}=\int_{-1}^1\xi(x)P_{l_1}(x)P_{l_2}(x)\,dx\f$ (see
+    sharp_coupling_matrix_gauss()), the first row is known in closed form,
+    \f$K_{0l}=W_l/(2\pi)\f$, and applying
+    \f$xP_l=((l+1)P_{l+1}+lP_{l-1})/(2l+1)\f$ to either Legendre factor
+    gives a recursion that yields row \f$l_1+1\f$ from rows \f$l_1\f$ and
+    \f$l_1-1\f$ at O(1) cost per element. The recursion is sequential in
+    \f$l_1\f$; its relative error is about 1e-12 at \a lmax=1500.
+    \param lmax maximum multipole of the coupling matrix
+    \param wl mask power spectrum, \a lmax_w+1 entries
+    \param lmax_w maximum multipole of \a wl
+    \param m00 output array with (\a lmax+1)*(\a lmax+1) entries */
+void sharp_coupling_matrix_recursive (int lmax, const double *wl, int lmax_w,
+  double *m00);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
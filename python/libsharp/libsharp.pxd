@@ -1,13 +1,42 @@
 cdef extern from "sharp.h":
 
     void sharp_legendre_transform_s(float *bl, float *recfac, ptrdiff_t lmax, float *x,
-                                    float *out, ptrdiff_t nx)
+                                    float *out, ptrdiff_t nx) nogil
     void sharp_legendre_transform(double *bl, double *recfac, ptrdiff_t lmax, double *x,
-                                  double *out, ptrdiff_t nx)
+                                  double *out, ptrdiff_t nx) nogil
+    void sharp_legendre_transform_clenshaw(double *bl, double *recfac, ptrdiff_t lmax,
+                                           double *x, double *out, ptrdiff_t nx) nogil
+    void sharp_legendre_transform_clenshaw_s(float *bl, float *recfac, ptrdiff_t lmax,
+                                             float *x, float *out, ptrdiff_t nx) nogil
+    void sharp_legendre_transform_batch(double *bl, ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                        double *recfac, ptrdiff_t lmax, double *x,
+                                        double *out, ptrdiff_t out_stride, ptrdiff_t nx) nogil
+    void sharp_legendre_transform_batch_s(float *bl, ptrdiff_t bl_stride, ptrdiff_t nbl,
+                                          float *recfac, ptrdiff_t lmax, float *x,
+                                          float *out, ptrdiff_t out_stride, ptrdiff_t nx) nogil
+    void sharp_legendre_transform_adjoint_batch(double *f, ptrdiff_t f_stride, ptrdiff_t nf,
+                                                double *w, double *recfac, ptrdiff_t lmax,
+                                                double *x, double *out, ptrdiff_t out_stride,
+                                                ptrdiff_t nx) nogil
+    void sharp_legendre_transform_adjoint_batch_s(float *f, ptrdiff_t f_stride, ptrdiff_t nf,
+                                                  float *w, float *recfac, ptrdiff_t lmax,
+                                                  float *x, float *out, ptrdiff_t out_stride,
+                                                  ptrdiff_t nx) nogil
     void sharp_legendre_transform_recfac(double *r, ptrdiff_t lmax)
     void sharp_legendre_transform_recfac_s(float *r, ptrdiff_t lmax)
     void sharp_legendre_roots(int n, double *x, double *w)
 
+    ctypedef struct sharp_legendre_plan:
+        pass
+    int SHARP_LEGENDRE_PLAN_RECURSION, SHARP_LEGENDRE_PLAN_TABLE, SHARP_LEGENDRE_PLAN_FLOAT
+    void sharp_legendre_make_plan(ptrdiff_t lmax, double *x, ptrdiff_t nx, ptrdiff_t nreuse,
+                                  int flags, sharp_legendre_plan **plan)
+    void sharp_legendre_destroy_plan(sharp_legendre_plan *plan)
+    int sharp_legendre_plan_uses_table(const sharp_legendre_plan *plan)
+    void sharp_legendre_execute_plan(const sharp_legendre_plan *plan, double *bl,
+                                     ptrdiff_t bl_stride, ptrdiff_t nbl, double *out,
+                                     ptrdiff_t out_stride) nogil
+
     # sharp_lowlevel.h
     ctypedef struct sharp_alm_info:
       # Maximum \a l index of the array
@@ -38,18 +67,40 @@ cdef extern from "sharp.h":
     void sharp_destroy_geom_info(sharp_geom_info *info)
 
     ptrdiff_t sharp_map_size(sharp_geom_info *info)
+    ptrdiff_t sharp_map_extent(sharp_geom_info *info)
+    void sharp_make_masked_geom_info(sharp_geom_info *full, double *mask,
+                                     sharp_geom_info **geom_info)
+    void sharp_make_strided_geom_info(sharp_geom_info *full, int stride,
+                                      sharp_geom_info **geom_info)
     ptrdiff_t sharp_alm_count(sharp_alm_info *self)
 
+    unsigned long long sharp_geom_info_hash(sharp_geom_info *info)
+    unsigned long long sharp_alm_info_hash(sharp_alm_info *info)
+    int sharp_geom_info_equal(sharp_geom_info *a, sharp_geom_info *b)
+    int sharp_alm_info_equal(sharp_alm_info *a, sharp_alm_info *b)
+    size_t sharp_geom_info_serialize(sharp_geom_info *info, void *buf)
+    size_t sharp_alm_info_serialize(sharp_alm_info *info, void *buf)
+    size_t sharp_geom_info_deserialize(void *buf, size_t size, sharp_geom_info **info)
+    size_t sharp_alm_info_deserialize(void *buf, size_t size, sharp_alm_info **info)
+
+
+    ctypedef enum:
+        SHARP_PACKED
+        SHARP_REAL_HARMONICS
 
     ctypedef enum sharp_jobtype:
         SHARP_YtW
+        SHARP_MAP2ALM
+        SHARP_Y
+        SHARP_ALM2MAP
         SHARP_Yt
         SHARP_WY
-        SHARP_Y
+        SHARP_ALM2MAP_DERIV1
 
     ctypedef enum:
         SHARP_DP
         SHARP_ADD
+        SHARP_NO_FFT
 
     void sharp_execute(sharp_jobtype type_,
                        int spin,
@@ -62,6 +113,24 @@ cdef extern from "sharp.h":
                        double *time,
                        unsigned long long *opcnt) nogil
 
+    ctypedef struct sharp_plan:
+        pass
+
+    void sharp_make_plan(sharp_jobtype type_, int spin, sharp_geom_info *geom_info,
+                         sharp_alm_info *alm_info, int ntrans, int flags,
+                         sharp_plan **plan) nogil
+    void sharp_execute_plan(sharp_plan *plan, void *alm, void *map, int flags, int nthreads,
+                            double *time, unsigned long long *opcnt) nogil
+    void sharp_destroy_plan(sharp_plan *plan) nogil
+
+    ctypedef enum sharp_itermethod:
+        SHARP_ITER_JACOBI
+        SHARP_ITER_CG
+
+    int sharp_map2alm_iter(sharp_itermethod method, int spin, void *alm,
+        void *map, sharp_geom_info *geom_info, sharp_alm_info *alm_info,
+        int ntrans, int flags, int niter, double epsilon, double *resid) nogil
+
     ctypedef enum:
         SHARP_ERROR_NO_MPI
 
@@ -70,17 +139,64 @@ cdef extern from "sharp.h":
         sharp_alm_info *alm_info, int ntrans, int flags, double *time,
         unsigned long long *opcnt) nogil
 
-    void sharp_normalized_associated_legendre_table(int m, int spin, int lmax, int ntheta,
-        double *theta, int theta_stride, int l_stride, int spin_stride, double *out) nogil
+    void sharp_normalized_associated_legendre_table(ptrdiff_t m, int spin, ptrdiff_t lmax,
+        ptrdiff_t ntheta, double *theta, ptrdiff_t theta_stride, ptrdiff_t l_stride,
+        ptrdiff_t spin_stride, double *out) nogil
+
+    void sharp_normalized_associated_legendre_table_multi(ptrdiff_t nm, const ptrdiff_t *mval,
+        int spin, ptrdiff_t lmax, ptrdiff_t ntheta, double *theta, ptrdiff_t m_stride,
+        ptrdiff_t theta_stride, ptrdiff_t l_stride, ptrdiff_t spin_stride, int flags,
+        double *out) nogil
+    int SHARP_LEGENDRE_TABLE_COMPACT
+    void sharp_wigner_d_table(ptrdiff_t mp, ptrdiff_t lmax, ptrdiff_t ntheta, double *theta,
+        ptrdiff_t m_stride, ptrdiff_t theta_stride, ptrdiff_t l_stride, double *out) nogil
+    void sharp_wigner_d_matrix(ptrdiff_t lmax, ptrdiff_t ntheta, double *theta,
+        double *out) nogil
+
+    int sharp_wigner3j(int l2, int l3, int m2, int m3, int *l1min, double *res) nogil
+    void sharp_coupling_matrix(int lmax, const double *wl, int lmax_w, double *m00,
+        double *m02, double *mpp, double *mmm) nogil
+    void sharp_coupling_matrix_gauss(int lmax, const double *wl, int lmax_w,
+        double *m00) nogil
+    void sharp_coupling_matrix_recursive(int lmax, const double *wl, int lmax_w,
+        double *m00) nogil
 
 
 cdef extern from "sharp_geomhelpers.h":
     void sharp_make_subset_healpix_geom_info(
         int nside, int stride, int nrings,
         int *rings, double *weight, sharp_geom_info **geom_info)
+    void sharp_make_weighted_healpix_geom_info(
+        int nside, int stride, double *weight, sharp_geom_info **geom_info) nogil
+    void sharp_make_nested_healpix_geom_info(
+        int nside, int stride, double *weight, sharp_geom_info **geom_info)
+    void sharp_make_healpix_geom_info(
+        int nside, int stride, sharp_geom_info **geom_info) nogil
     void sharp_make_gauss_geom_info(
         int nrings, int nphi, double phi0,
-        int stride_lon, int stride_lat, sharp_geom_info **geom_info)
+        int stride_lon, int stride_lat, sharp_geom_info **geom_info) nogil
+    void sharp_make_reduced_gauss_geom_info(
+        int nrings, int nphi, int lmax, int spin, double phi0,
+        int stride, sharp_geom_info **geom_info) nogil
+    void sharp_make_octahedral_geom_info(
+        int nrings, int lmax, int spin, double phi0,
+        int stride, sharp_geom_info **geom_info) nogil
+    void sharp_make_fejer1_geom_info(
+        int nrings, int nphi, double phi0,
+        int stride_lon, int stride_lat, sharp_geom_info **geom_info) nogil
+    void sharp_make_ecp_geom_info(
+        int nrings, int nphi, double phi0,
+        int stride_lon, int stride_lat, sharp_geom_info **geom_info) nogil
+    void sharp_make_cc_geom_info(
+        int nrings, int ppring, double phi0,
+        int stride_lon, int stride_lat, sharp_geom_info **geom_info) nogil
+    void sharp_make_fejer2_geom_info(
+        int nrings, int ppring, double phi0,
+        int stride_lon, int stride_lat, sharp_geom_info **geom_info) nogil
+    void sharp_make_mw_geom_info(
+        int nrings, int ppring, double phi0,
+        int stride_lon, int stride_lat, sharp_geom_info **geom_info) nogil
+    double sharp_healpix_ring_weights(int nside, int lmax, double *weight) nogil
 
 cdef extern from "sharp_almhelpers.h":
     void sharp_make_triangular_alm_info (int lmax, int mmax, int stride,
@@ -90,3 +206,9 @@ cdef extern from "sharp_almhelpers.h":
     void sharp_make_mmajor_real_packed_alm_info (int lmax, int stride,
         int nm, const int *ms, sharp_alm_info **alm_info)
 
+
+cdef extern from "sharp_almops.h":
+    void sharp_almxfl(sharp_alm_info *ainfo, void *alm, int ncomp, double *fl,
+                      ptrdiff_t fl_stride, int flags) nogil
+    void sharp_almxfm(sharp_alm_info *ainfo, void *alm, int ncomp, double *fm,
+                      ptrdiff_t fm_stride, int flags) nogil
@@ -1,43 +1,231 @@
+import os
+import threading
+from concurrent.futures import ThreadPoolExecutor
 import numpy as np
 cimport numpy as np
 cimport cython
-
-__all__ = ['legendre_transform', 'legendre_roots', 'sht', 'synthesis', 'adjoint_synthesis',
-           'analysis', 'adjoint_analysis', 'healpix_grid', 'triangular_order', 'rectangular_order',
-           'packed_real_order', 'normalized_associated_legendre_table']
-
-
-def legendre_transform(x, bl, out=None):
-    if out is None:
-        out = np.empty_like(x)
-    if out.shape[0] == 0:
-        return out
-    elif x.dtype == np.float64:
-        if bl.dtype != np.float64:
-            bl = bl.astype(np.float64)
-        return _legendre_transform(x, bl, out=out)
+from libc.stdlib cimport malloc, free
+
+__all__ = ['legendre_transform', 'legendre_transform_adjoint', 'legendre_plan', 'legendre_roots', 'sht', 'sht_batch', 'synthesis', 'adjoint_synthesis', 'analysis_iter',
+           'analysis', 'adjoint_analysis', 'synthesis_deriv1', 'healpix_grid', 'gauss_grid',
+           'reduced_gauss_grid', 'octahedral_grid', 'fejer1_grid', 'ecp_grid', 'cc_grid',
+           'fejer2_grid', 'mw_grid', 'triangular_order', 'rectangular_order',
+           'packed_real_order', 'normalized_associated_legendre_table',
+           'normalized_associated_legendre_table_multi', 'wigner3j', 'coupling_matrix',
+           'wigner_d_table', 'wigner_d_matrices', 'geom_info', 'alm_info', 'Plan']
+
+
+def legendre_transform(x, bl, out=None, method='recursion'):
+    """
+    Computes sum_l bl[l] P_l(x) for every entry of x. If bl is 2D with shape
+    (nbl, lmax + 1), all nbl transforms are done in one pass and the result
+    has shape (nbl, len(x)).
+
+    method='clenshaw' uses Clenshaw's backward summation instead of the
+    forward recursion; it is only available for 1D bl.
+    """
+    if method not in ('recursion', 'clenshaw'):
+        raise ValueError("unknown method: %s" % method)
+    cdef int clenshaw = (method == 'clenshaw')
+    if x.dtype == np.float64:
+        dtype = np.float64
     elif x.dtype == np.float32:
-        if bl.dtype != np.float32:
-            bl = bl.astype(np.float32)
-        return _legendre_transform_s(x, bl, out=out)
+        dtype = np.float32
     else:
         raise ValueError("unsupported dtype")
+    bl = np.asarray(bl)
+    if bl.dtype != dtype:
+        bl = bl.astype(dtype)
+    if bl.ndim == 1:
+        if out is None:
+            out = np.empty_like(x)
+        if out.shape[0] == 0:
+            return out
+        if dtype == np.float64:
+            return _legendre_transform(x, bl, out, clenshaw)
+        else:
+            return _legendre_transform_s(x, bl, out, clenshaw)
+    elif bl.ndim == 2:
+        if clenshaw:
+            raise NotImplementedError("method='clenshaw' requires 1D bl")
+        if out is None:
+            out = np.empty((bl.shape[0], x.shape[0]), dtype=dtype)
+        if out.shape[0] == 0 or out.shape[1] == 0:
+            return out
+        if dtype == np.float64:
+            return _legendre_transform_batch(x, bl, out=out)
+        else:
+            return _legendre_transform_batch_s(x, bl, out=out)
+    else:
+        raise ValueError("bl must be 1D or 2D")
 
 
-def _legendre_transform(double[::1] x, double[::1] bl, double[::1] out):
+def _legendre_transform(double[::1] x, double[::1] bl, double[::1] out, int clenshaw=0):
     if out.shape[0] != x.shape[0]:
         raise ValueError('x and out must have same shape')
-    sharp_legendre_transform(&bl[0], NULL, bl.shape[0] - 1, &x[0], &out[0], x.shape[0])
+    with nogil:
+        if clenshaw:
+            sharp_legendre_transform_clenshaw(&bl[0], NULL, bl.shape[0] - 1, &x[0], &out[0],
+                                                  x.shape[0])
+        else:
+            sharp_legendre_transform(&bl[0], NULL, bl.shape[0] - 1, &x[0], &out[0], x.shape[0])
     return np.asarray(out)
 
 
-def _legendre_transform_s(float[::1] x, float[::1] bl, float[::1] out):
+def _legendre_transform_s(float[::1] x, float[::1] bl, float[::1] out, int clenshaw=0):
     if out.shape[0] != x.shape[0]:
         raise ValueError('x and out must have same shape')
-    sharp_legendre_transform_s(&bl[0], NULL, bl.shape[0] - 1, &x[0], &out[0], x.shape[0])
+    with nogil:
+        if clenshaw:
+            sharp_legendre_transform_clenshaw_s(&bl[0], NULL, bl.shape[0] - 1, &x[0], &out[0],
+                                                  x.shape[0])
+        else:
+            sharp_legendre_transform_s(&bl[0], NULL, bl.shape[0] - 1, &x[0], &out[0], x.shape[0])
+    return np.asarray(out)
+
+
+def _legendre_transform_batch(double[::1] x, double[:, ::1] bl, double[:, ::1] out):
+    if out.shape[0] != bl.shape[0] or out.shape[1] != x.shape[0]:
+        raise ValueError('out must have shape (bl.shape[0], x.shape[0])')
+    with nogil:
+        sharp_legendre_transform_batch(&bl[0, 0], bl.shape[1], bl.shape[0], NULL,
+                                       bl.shape[1] - 1, &x[0], &out[0, 0], out.shape[1],
+                                       x.shape[0])
+    return np.asarray(out)
+
+
+def _legendre_transform_batch_s(float[::1] x, float[:, ::1] bl, float[:, ::1] out):
+    if out.shape[0] != bl.shape[0] or out.shape[1] != x.shape[0]:
+        raise ValueError('out must have shape (bl.shape[0], x.shape[0])')
+    with nogil:
+        sharp_legendre_transform_batch_s(&bl[0, 0], bl.shape[1], bl.shape[0], NULL,
+                                         bl.shape[1] - 1, &x[0], &out[0, 0], out.shape[1],
+                                         x.shape[0])
     return np.asarray(out)
 
 
+def legendre_transform_adjoint(x, f, lmax, w=None, out=None):
+    """
+    Computes sum_i w[i] f[i] P_l(x[i]) for 0 <= l <= lmax, the adjoint of
+    legendre_transform. If f is 2D with shape (nf, len(x)), all nf transforms
+    are done in one pass and the result has shape (nf, lmax + 1).
+    """
+    if x.dtype == np.float64:
+        dtype = np.float64
+    elif x.dtype == np.float32:
+        dtype = np.float32
+    else:
+        raise ValueError("unsupported dtype")
+    f = np.asarray(f)
+    if f.ndim not in (1, 2):
+        raise ValueError("f must be 1D or 2D")
+    f2 = f.reshape((-1, f.shape[-1])).astype(dtype, copy=False)
+    if w is None:
+        w = np.ones(x.shape[0], dtype=dtype)
+    else:
+        w = np.asarray(w).astype(dtype, copy=False)
+    if out is None:
+        out = np.empty(f.shape[:-1] + (lmax + 1,), dtype=dtype)
+    out2 = out.reshape((-1, lmax + 1))
+    if f2.shape[0] == 0:
+        return out
+    if x.shape[0] == 0:
+        out2[...] = 0
+        return out
+    if dtype == np.float64:
+        _legendre_transform_adjoint(x, f2, w, out2)
+    else:
+        _legendre_transform_adjoint_s(x, f2, w, out2)
+    return out
+
+
+def _legendre_transform_adjoint(double[::1] x, double[:, ::1] f, double[::1] w,
+                                double[:, ::1] out):
+    if f.shape[1] != x.shape[0] or w.shape[0] != x.shape[0]:
+        raise ValueError('x, w and f must have the same length')
+    if out.shape[0] != f.shape[0]:
+        raise ValueError('f and out must have the same number of rows')
+    with nogil:
+        sharp_legendre_transform_adjoint_batch(&f[0, 0], f.shape[1], f.shape[0], &w[0], NULL,
+                                               out.shape[1] - 1, &x[0], &out[0, 0],
+                                               out.shape[1], x.shape[0])
+
+
+def _legendre_transform_adjoint_s(float[::1] x, float[:, ::1] f, float[::1] w,
+                                  float[:, ::1] out):
+    if f.shape[1] != x.shape[0] or w.shape[0] != x.shape[0]:
+        raise ValueError('x, w and f must have the same length')
+    if out.shape[0] != f.shape[0]:
+        raise ValueError('f and out must have the same number of rows')
+    with nogil:
+        sharp_legendre_transform_adjoint_batch_s(&f[0, 0], f.shape[1], f.shape[0], &w[0], NULL,
+                                                 out.shape[1] - 1, &x[0], &out[0, 0],
+                                                 out.shape[1], x.shape[0])
+
+
+LEGENDRE_PLAN_MODES = {
+    'auto': 0,
+    'recursion': SHARP_LEGENDRE_PLAN_RECURSION,
+    'table': SHARP_LEGENDRE_PLAN_TABLE,
+    'table_float': SHARP_LEGENDRE_PLAN_TABLE | SHARP_LEGENDRE_PLAN_FLOAT
+}
+
+cdef class legendre_plan:
+    """
+    Repeated Legendre transforms at fixed lmax and x.
+
+    mode is one of 'auto', 'recursion', 'table' or 'table_float'; with 'auto'
+    the table of P_l(x) is precomputed if nreuse > 1 transforms are expected
+    and it fits the library's memory limit.
+    """
+    cdef sharp_legendre_plan *plan
+    cdef readonly ptrdiff_t lmax, nx
+
+    def __cinit__(self, *args, **kw):
+        self.plan = NULL
+
+    def __init__(self, lmax, x, nreuse=2, mode='auto'):
+        cdef double[::1] x_ = np.ascontiguousarray(x, dtype=np.double).reshape(-1)
+        if lmax < 0:
+            raise ValueError("lmax must be >= 0")
+        if mode not in LEGENDRE_PLAN_MODES:
+            raise ValueError("unknown mode: %s" % mode)
+        self.lmax = lmax
+        self.nx = x_.shape[0]
+        sharp_legendre_make_plan(lmax, &x_[0] if self.nx > 0 else NULL, self.nx,
+                                 nreuse, LEGENDRE_PLAN_MODES[mode], &self.plan)
+
+    def __dealloc__(self):
+        if self.plan != NULL:
+            sharp_legendre_destroy_plan(self.plan)
+        self.plan = NULL
+
+    @property
+    def uses_table(self):
+        return bool(sharp_legendre_plan_uses_table(self.plan))
+
+    def transform(self, bl, out=None):
+        """
+        Computes sum_l bl[..., l] P_l(x) for 1D bl (shape (lmax + 1,)) or a
+        batch of 2D bl (shape (nbl, lmax + 1)).
+        """
+        cdef double[:, ::1] bl_, out_
+        bl = np.asarray(bl, dtype=np.double)
+        if bl.shape[-1] != self.lmax + 1:
+            raise ValueError("bl must have lmax + 1 entries in the last axis")
+        bl_ = np.ascontiguousarray(bl).reshape((-1, self.lmax + 1))
+        if out is None:
+            out = np.empty(bl.shape[:-1] + (self.nx,), np.double)
+        if out.shape != bl.shape[:-1] + (self.nx,):
+            raise ValueError("out has wrong shape")
+        out_ = out.reshape((-1, self.nx))
+        if self.nx > 0 and bl_.shape[0] > 0:
+            with nogil:
+                sharp_legendre_execute_plan(self.plan, &bl_[0, 0], bl_.shape[1], bl_.shape[0],
+                                            &out_[0, 0], out_.shape[1])
+        return out
+
+
 def legendre_roots(n):
     x = np.empty(n, np.double)
     w = np.empty(n, np.double)
@@ -53,75 +241,377 @@ JOBTYPE_TO_CONST = {
     'Y': SHARP_Y,
     'Yt': SHARP_Yt,
     'WY': SHARP_WY,
-    'YtW': SHARP_YtW
+    'YtW': SHARP_YtW,
+    'alm2map': SHARP_ALM2MAP,
+    'map2alm': SHARP_MAP2ALM,
+    'alm2map_deriv1': SHARP_ALM2MAP_DERIV1
 }
 
-def sht(jobtype, geom_info ginfo, alm_info ainfo, double[:, :, ::1] input,
-        int spin=0, comm=None, add=False):
-    cdef void *comm_ptr
-    cdef int flags = SHARP_DP | (SHARP_ADD if add else 0)
-    cdef int r
-    cdef sharp_jobtype jobtype_i
-    cdef double[:, :, ::1] output_buf
-    cdef int ntrans = input.shape[0]
-    cdef int ntotcomp = ntrans * input.shape[1]
-    cdef int i, j
+cdef sharp_jobtype _jobtype_const(jobtype) except *:
+    try:
+        return JOBTYPE_TO_CONST[jobtype]
+    except KeyError:
+        raise ValueError('jobtype must be one of: %s' % ', '.join(sorted(JOBTYPE_TO_CONST.keys())))
 
-    if spin == 0 and input.shape[1] != 1:
+
+cdef inline bint _is_alm2map(sharp_jobtype jobtype):
+    return jobtype == SHARP_Y or jobtype == SHARP_WY or jobtype == SHARP_ALM2MAP_DERIV1
+
+
+def _complex_dtype(dtype):
+    return np.result_type(dtype, np.complex64)
+
+
+cdef tuple _sht_arrays(sharp_jobtype jobtype, geom_info ginfo, alm_info ainfo, input,
+                       int spin, bint add, out, bint strided_maps, bint no_fft):
+    """
+    Checks the arguments of a transform and returns (out, alm, map, result,
+    pixstride): `alm` and `map` are the arrays to pass to libsharp, `result`
+    is the array the output has to be copied to afterwards (or None), and
+    `pixstride` is the pixel stride of `map` if `strided_maps` allows one.
+    """
+    cdef bint alm2map = _is_alm2map(jobtype)
+    cdef bint deriv1 = jobtype == SHARP_ALM2MAP_DERIV1
+    input = np.asarray(input)
+    if input.ndim != 3:
+        raise ValueError('input must have 3 dimensions')
+    if input.dtype not in (np.float64, np.float32, np.complex128, np.complex64):
+        raise ValueError('input must be float64, float32, complex128 or complex64')
+    # a_lm are complex unless the layout is packed, maps are complex Fourier
+    # coefficients with no_fft
+    rdtype = np.finfo(input.dtype).dtype
+    alm_dtype = rdtype if ainfo.packed else _complex_dtype(rdtype)
+    map_dtype = _complex_dtype(rdtype) if no_fft else rdtype
+    in_dtype, out_dtype = (alm_dtype, map_dtype) if alm2map else (map_dtype, alm_dtype)
+    if input.dtype != in_dtype:
+        raise ValueError('%s must have dtype %s for this layout'
+                         % ('a_lm' if alm2map else 'maps', in_dtype))
+    if deriv1:
+        if input.shape[1] != 1:
+            raise ValueError('For alm2map_deriv1, we need input.shape[1] == 1')
+    elif spin == 0 and input.shape[1] != 1:
         raise ValueError('For spin == 0, we need input.shape[1] == 1')
     elif spin != 0 and input.shape[1] != 2:
         raise ValueError('For spin != 0, we need input.shape[1] == 2')
 
+    cdef ptrdiff_t npix = ginfo.map_extent(), nalm = ainfo.local_size()
+    if input.shape[2] < (nalm if alm2map else npix):
+        raise ValueError('input %s must have at least %d entries'
+                         % ('a_lm' if alm2map else 'maps', nalm if alm2map else npix))
+    shape = (input.shape[0], 2 if deriv1 else input.shape[1], npix if alm2map else nalm)
+    if out is None:
+        # partial geometries leave the pixels outside of them untouched
+        out = (np.zeros if add or (alm2map and npix != ginfo.local_size()) else np.empty)(
+            shape, dtype=out_dtype)
+    else:
+        if not isinstance(out, np.ndarray) or out.dtype != out_dtype:
+            raise ValueError('out must be a numpy array of dtype %s' % out_dtype)
+        if out.ndim != 3 or out.shape[:2] != shape[:2] or out.shape[2] < shape[2]:
+            raise ValueError('out must have shape (%d, %d, >=%d)' % shape)
+        if not out.flags.writeable:
+            raise ValueError('out is not writeable')
+
+    alm, map = (input, out) if alm2map else (out, input)
+    cdef ptrdiff_t pixstride = 1
+    # outputs that cannot be used in place are computed in a contiguous copy
+    result = None
+    if alm.shape[2] > 1 and alm.strides[2] != alm.itemsize:
+        if not alm2map:
+            result = alm
+        alm = np.ascontiguousarray(alm)
+    if map.shape[2] > 1 and map.strides[2] != map.itemsize:
+        if strided_maps and map.strides[2] > 0 and map.strides[2] % map.itemsize == 0:
+            pixstride = map.strides[2] // map.itemsize
+        else:
+            if alm2map:
+                result = map
+            map = np.ascontiguousarray(map)
+    return out, alm, map, result, pixstride
+
+
+cdef void _component_pointers(np.ndarray arr, void **ptrs):
+    # one pointer per (transform, component), honouring the strides of the
+    # two leading axes
+    cdef char *data = <char*>np.PyArray_DATA(arr)
+    cdef ptrdiff_t i, j, n1 = arr.shape[1]
+    for i in range(arr.shape[0]):
+        for j in range(n1):
+            ptrs[i * n1 + j] = data + i * arr.strides[0] + j * arr.strides[1]
+
+
+def sht(jobtype, geom_info ginfo, alm_info ainfo, input, int spin=0, comm=None,
+        add=False, out=None, no_fft=False, int nthreads=0):
+    """
+    Spherical harmonic transform of `input`, an array of shape
+    (ntrans, ncomp, n) with ncomp == 1 for spin == 0 and 2 otherwise.
+
+    `jobtype` is one of 'Y' (or 'alm2map'), 'Yt', 'YtW' (or 'map2alm'), 'WY'
+    and 'alm2map_deriv1'. The latter computes the gradient of a scalar field:
+    its input has ncomp == 1, its output the two components d/dtheta and
+    1/sin(theta) d/dphi, and `spin` is ignored.
+
+    float64 and float32 arrays are supported, and the result has the same
+    precision as `input`. a_lm arrays hold real numbers for packed layouts
+    (packed_real_order) and complex numbers otherwise. With no_fft=True, the
+    maps hold, for every ring, the complex Fourier coefficients for
+    m = 0 .. mmax instead of pixel values; every ring of `ginfo` must then
+    have mmax + 1 entries.
+
+    If `out` is given, the result is stored in it (or added to it if
+    add=True) and `out` is returned; otherwise a new array is allocated.
+    Both arrays may be non-contiguous views. Map pixels only need to be
+    equally spaced, which is handled without copying; a_lm arrays whose last
+    axis is not contiguous are copied. The GIL is released during the
+    transform.
+
+    With nthreads > 0, the transform uses at most that many OpenMP threads,
+    so that transforms running concurrently in several Python threads do not
+    oversubscribe the cores; see also sht_batch().
+    """
+    cdef void *comm_ptr
+    cdef int r
+    cdef sharp_jobtype jobtype_i
+    cdef sharp_geom_info *gptr = ginfo.ginfo
+    cdef sharp_geom_info *strided = NULL
+    cdef sharp_plan *plan = NULL
+    cdef void **ptrs
+
+    jobtype_i = _jobtype_const(jobtype)
+    if no_fft and comm is not None:
+        raise ValueError('no_fft is not supported with MPI')
+    if nthreads != 0 and comm is not None:
+        raise ValueError('nthreads is not supported with MPI')
+    if nthreads < 0:
+        raise ValueError('nthreads must be nonnegative')
+    cdef bint alm2map = _is_alm2map(jobtype_i)
+    out, alm, map, result, pixstride = _sht_arrays(jobtype_i, ginfo, ainfo, input, spin, add,
+                                                   out, True, no_fft)
+    cdef int flags = ((SHARP_DP if map.dtype in (np.float64, np.complex128) else 0) |
+                      (SHARP_ADD if add else 0) | (SHARP_NO_FFT if no_fft else 0))
+    cdef int ntrans = alm.shape[0]
+    cdef int nalmcomp = ntrans * alm.shape[1], nmapcomp = ntrans * map.shape[1]
+
+    ptrs = <void**>malloc((nalmcomp + nmapcomp) * sizeof(void*))
+    if ptrs == NULL:
+        raise MemoryError()
+    try:
+        _component_pointers(alm, ptrs)
+        _component_pointers(map, ptrs + nalmcomp)
+        if pixstride != 1:
+            sharp_make_strided_geom_info(ginfo.ginfo, pixstride, &strided)
+            gptr = strided
+        if comm is None and nthreads > 0:
+            with nogil:
+                sharp_make_plan(jobtype_i, spin, gptr, ainfo.ainfo, ntrans,
+                                flags & ~SHARP_ADD, &plan)
+                sharp_execute_plan(plan, ptrs, ptrs + nalmcomp, flags & SHARP_ADD, nthreads,
+                                   NULL, NULL)
+        elif comm is None:
+            with nogil:
+                sharp_execute (
+                    jobtype_i,
+                    geom_info=gptr, alm_info=ainfo.ainfo,
+                    spin=spin, alm=ptrs, map=ptrs + nalmcomp,
+                    ntrans=ntrans, flags=flags, time=NULL, opcnt=NULL)
+        else:
+            from mpi4py import MPI
+            if not isinstance(comm, MPI.Comm):
+                raise TypeError('comm must be an mpi4py communicator')
+            from .libsharp_mpi import _addressof
+            comm_ptr = <void*><size_t>_addressof(comm)
+            with nogil:
+                r = sharp_execute_mpi_maybe (
+                    comm_ptr, jobtype_i,
+                    geom_info=gptr, alm_info=ainfo.ainfo,
+                    spin=spin, alm=ptrs, map=ptrs + nalmcomp,
+                    ntrans=ntrans, flags=flags, time=NULL, opcnt=NULL)
+            if r == SHARP_ERROR_NO_MPI:
+                raise Exception('MPI requested, but not available')
+    finally:
+        free(ptrs)
+        if plan != NULL:
+            sharp_destroy_plan(plan)
+        if strided != NULL:
+            sharp_destroy_geom_info(strided)
+
+    if result is not None:
+        result[...] = map if alm2map else alm
+    return out
 
-    cdef size_t[::1] ptrbuf = np.empty(2 * ntotcomp, dtype=np.uintp)
-    cdef double **alm_ptrs = <double**>&ptrbuf[0]
-    cdef double **map_ptrs = <double**>&ptrbuf[ntotcomp]
 
-    try:
-        jobtype_i = JOBTYPE_TO_CONST[jobtype]
-    except KeyError:
-        raise ValueError('jobtype must be one of: %s' % ', '.join(sorted(JOBTYPE_TO_CONST.keys())))
+cdef class Plan:
+    """
+    A transform of fixed type, geometry, a_lm layout, spin, number of
+    simultaneous transforms (ntrans), precision (dtype) and map
+    representation (no_fft), for repeated execution; see sht() for the
+    job types and array layouts. The setup that sht() does on every call is done only once;
+    after each execute(), `time` and `opcnt` hold its wall time in seconds
+    and its floating point operation count. With nthreads > 0, execute()
+    uses at most that many OpenMP threads.
+
+    The plan keeps references to `ginfo` and `ainfo`. MPI is not supported;
+    use sht() with `comm` instead.
+    """
+    cdef sharp_plan *plan
+    cdef sharp_jobtype jobtype_i
+    cdef readonly geom_info ginfo
+    cdef readonly alm_info ainfo
+    cdef readonly object jobtype, dtype
+    cdef readonly int spin, ntrans
+    cdef readonly bint no_fft
+    cdef public int nthreads
+    cdef readonly double time
+    cdef readonly unsigned long long opcnt
 
-    if jobtype_i == SHARP_Y or jobtype_i == SHARP_WY:
-        output = np.empty((input.shape[0], input.shape[1], ginfo.local_size()), dtype=np.float64)
-        output_buf = output
-        for i in range(input.shape[0]):
-            for j in range(input.shape[1]):
-                alm_ptrs[i * input.shape[1] + j] = &input[i, j, 0]
-                map_ptrs[i * input.shape[1] + j] = &output_buf[i, j, 0]
-    else:
-        output = np.empty((input.shape[0], input.shape[1], ainfo.local_size()), dtype=np.float64)
-        output_buf = output
-        for i in range(input.shape[0]):
-            for j in range(input.shape[1]):
-                alm_ptrs[i * input.shape[1] + j] = &output_buf[i, j, 0]
-                map_ptrs[i * input.shape[1] + j] = &input[i, j, 0]
-
-    if comm is None:
-        with nogil:
-            sharp_execute (
-                jobtype_i,
-                geom_info=ginfo.ginfo, alm_info=ainfo.ainfo,
-                spin=spin, alm=alm_ptrs, map=map_ptrs,
-                ntrans=ntrans, flags=flags, time=NULL, opcnt=NULL)
-    else:
-        from mpi4py import MPI
-        if not isinstance(comm, MPI.Comm):
-            raise TypeError('comm must be an mpi4py communicator')
-        from .libsharp_mpi import _addressof
-        comm_ptr = <void*><size_t>_addressof(comm)
-        with nogil:
-            r = sharp_execute_mpi_maybe (
-                comm_ptr, jobtype_i,
-                geom_info=ginfo.ginfo, alm_info=ainfo.ainfo,
-                spin=spin, alm=alm_ptrs, map=map_ptrs,
-                ntrans=ntrans, flags=flags, time=NULL, opcnt=NULL)
-        if r == SHARP_ERROR_NO_MPI:
-            raise Exception('MPI requested, but not available')
+    def __cinit__(self, *args, **kw):
+        self.plan = NULL
+
+    def __init__(self, jobtype, geom_info ginfo, alm_info ainfo, int spin=0, int ntrans=1,
+                 dtype=np.float64, int nthreads=0, no_fft=False):
+        self.jobtype_i = _jobtype_const(jobtype)
+        self.dtype = np.dtype(dtype)
+        if self.dtype != np.float64 and self.dtype != np.float32:
+            raise ValueError('dtype must be float64 or float32')
+        if ntrans < 1:
+            raise ValueError('ntrans must be positive')
+        if spin < 0:
+            raise ValueError('spin must be nonnegative')
+        if ginfo.ginfo == NULL or ainfo.ainfo == NULL:
+            raise NotInitializedError()
+        self.jobtype, self.ginfo, self.ainfo = jobtype, ginfo, ainfo
+        self.spin, self.ntrans, self.nthreads = spin, ntrans, nthreads
+        self.no_fft = no_fft
+        self.time, self.opcnt = 0, 0
+        if self.plan != NULL:
+            sharp_destroy_plan(self.plan)
+            self.plan = NULL
+        sharp_make_plan(self.jobtype_i, spin, ginfo.ginfo, ainfo.ainfo, ntrans,
+                        (SHARP_DP if self.dtype == np.float64 else 0) |
+                        (SHARP_NO_FFT if no_fft else 0), &self.plan)
+
+    def __dealloc__(self):
+        if self.plan != NULL:
+            sharp_destroy_plan(self.plan)
+        self.plan = NULL
+
+    def execute(self, input, out=None, add=False, nthreads=None):
+        """
+        Transforms `input`, of shape (ntrans, ncomp, n) and the precision
+        of the plan; `out` and `add` work as for sht(). `nthreads` overrides the
+        thread limit of the plan for this call.
+        """
+        cdef void **ptrs
+        cdef double time
+        cdef unsigned long long opcnt
+        cdef int flags = SHARP_ADD if add else 0
+        cdef int nthreads_ = self.nthreads if nthreads is None else nthreads
+        if self.plan == NULL:
+            raise NotInitializedError()
+        input = np.asarray(input)
+        if input.dtype.kind not in 'fc' or np.finfo(input.dtype).dtype != self.dtype:
+            raise ValueError('input must have the precision %s' % self.dtype)
+        if input.ndim != 3 or input.shape[0] != self.ntrans:
+            raise ValueError('input must have shape (%d, ncomp, n)' % self.ntrans)
+        cdef bint alm2map = _is_alm2map(self.jobtype_i)
+        out, alm, map, result, _ = _sht_arrays(self.jobtype_i, self.ginfo, self.ainfo, input,
+                                               self.spin, add, out, False, self.no_fft)
+        cdef int nalmcomp = alm.shape[0] * alm.shape[1]
+        ptrs = <void**>malloc((nalmcomp + map.shape[0] * map.shape[1]) * sizeof(void*))
+        if ptrs == NULL:
+            raise MemoryError()
+        try:
+            _component_pointers(alm, ptrs)
+            _component_pointers(map, ptrs + nalmcomp)
+            with nogil:
+                sharp_execute_plan(self.plan, ptrs, ptrs + nalmcomp, flags, nthreads_,
+                                   &time, &opcnt)
+        finally:
+            free(ptrs)
+        self.time, self.opcnt = time, opcnt
+        if result is not None:
+            result[...] = map if alm2map else alm
+        return out
 
-    return output
 
 
+_batch_pool = None
+_batch_pool_lock = threading.Lock()
+
+
+def _max_threads():
+    # the number of threads an OpenMP team would have by default
+    try:
+        n = int(os.environ.get('OMP_NUM_THREADS', '').split(',')[0])
+    except ValueError:
+        n = 0
+    return n if n > 0 else (os.cpu_count() or 1)
+
+
+def _shared_pool():
+    global _batch_pool
+    with _batch_pool_lock:
+        if _batch_pool is None:
+            _batch_pool = ThreadPoolExecutor(max_workers=_max_threads())
+        return _batch_pool
+
+
+def _job_cost(job):
+    # rough operation count, used to start the most expensive jobs first
+    args, kw = job
+    ginfo = kw['ginfo'] if 'ginfo' in kw else args[1]
+    ainfo = kw['ainfo'] if 'ainfo' in kw else args[2]
+    input = kw['input'] if 'input' in kw else args[3]
+    return np.size(input) // max(np.shape(input)[-1], 1) * ainfo.local_size() * \
+        np.sqrt(ginfo.local_size())
+
+
+def sht_batch(jobs, int nthreads=0, nworkers=None):
+    """
+    Runs a list of independent transforms concurrently and returns their
+    results in the same order. Every job is a tuple of positional arguments
+    of sht() (jobtype, ginfo, ainfo, input[, spin]) or a dict of its keyword
+    arguments, so geometries, layouts, spins and precisions may differ.
+
+    The jobs run on a worker pool shared by all calls, `nworkers` (default:
+    the number of jobs, at most `nthreads`) at a time, most expensive first.
+    The `nthreads` OpenMP threads (default: as many as OpenMP would use)
+    are divided evenly among the workers. MPI is not supported.
+    """
+    jobs = [(tuple(job), {}) if not isinstance(job, dict) else ((), dict(job))
+            for job in jobs]
+    for args, kw in jobs:
+        if kw.get('comm') is not None or 'nthreads' in kw:
+            raise ValueError('jobs must not specify comm or nthreads')
+    if not jobs:
+        return []
+    if nthreads < 0:
+        raise ValueError('nthreads must be nonnegative')
+    total = nthreads if nthreads > 0 else _max_threads()
+    nworkers = min(len(jobs), total) if nworkers is None else nworkers
+    if nworkers < 1:
+        raise ValueError('nworkers must be positive')
+    budget = max(total // nworkers, 1)
+
+    order = sorted(range(len(jobs)), key=lambda i: -_job_cost(jobs[i]))
+    results = [None] * len(jobs)
+    queue = iter(order)
+    queue_lock = threading.Lock()
+
+    def worker():
+        while True:
+            with queue_lock:
+                i = next(queue, None)
+            if i is None:
+                return
+            args, kw = jobs[i]
+            results[i] = sht(*args, nthreads=budget, **kw)
+
+    pool = _shared_pool()
+    futures = [pool.submit(worker) for _ in range(nworkers)]
+    for f in futures:
+        f.result()
+    return results
+
 def synthesis(*args, **kw):
     return sht('Y', *args, **kw)
 
@@ -134,6 +624,49 @@ def analysis(*args, **kw):
 def adjoint_analysis(*args, **kw):
     return sht('WY', *args, **kw)
 
+def synthesis_deriv1(*args, **kw):
+    return sht('alm2map_deriv1', *args, **kw)
+
+ITERMETHOD_TO_CONST = {
+    'jacobi': SHARP_ITER_JACOBI,
+    'cg': SHARP_ITER_CG
+}
+
+def analysis_iter(geom_info ginfo, alm_info ainfo, double[:, :, ::1] input,
+                  int spin=0, int niter=3, method='jacobi', double epsilon=0):
+    """
+    Iterative map analysis; see sharp_map2alm_iter in the C API.
+
+    Returns a tuple (alm, niter_done, resid), where resid holds the relative
+    map residual of each of the input.shape[0] transforms.
+    """
+    cdef int ntrans = input.shape[0]
+    cdef int ncomp = ntrans * input.shape[1]
+    cdef sharp_itermethod method_i
+    cdef int i, r
+    if input.shape[1] != (1 if spin == 0 else 2):
+        raise ValueError('For spin == 0, we need input.shape[1] == 1, else 2')
+    try:
+        method_i = ITERMETHOD_TO_CONST[method]
+    except KeyError:
+        raise ValueError('method must be one of: %s' % ', '.join(sorted(ITERMETHOD_TO_CONST.keys())))
+    if input.shape[2] < ginfo.map_extent():
+        raise ValueError('input maps must have at least %d pixels' % ginfo.map_extent())
+
+    output = np.empty((input.shape[0], input.shape[1], ainfo.local_size()), dtype=np.float64)
+    cdef double[:, :, ::1] output_buf = output
+    cdef double[::1] resid = np.empty(ntrans)
+    cdef size_t[::1] ptrbuf = np.empty(2 * ncomp, dtype=np.uintp)
+    cdef double **alm_ptrs = <double**>&ptrbuf[0]
+    cdef double **map_ptrs = <double**>&ptrbuf[ncomp]
+    for i in range(ncomp):
+        alm_ptrs[i] = &output_buf[i // input.shape[1], i % input.shape[1], 0]
+        map_ptrs[i] = &input[i // input.shape[1], i % input.shape[1], 0]
+    with nogil:
+        r = sharp_map2alm_iter(method_i, spin, alm_ptrs, map_ptrs, ginfo.ginfo,
+                               ainfo.ainfo, ntrans, SHARP_DP, niter, epsilon, &resid[0])
+    return output, r, np.asarray(resid)
+
 
 #
 # geom_info
@@ -153,6 +686,66 @@ cdef class geom_info:
             raise NotInitializedError()
         return sharp_map_size(self.ginfo)
 
+    def map_extent(self):
+        """Minimum length of map arrays; exceeds local_size() for partial geometries."""
+        if self.ginfo == NULL:
+            raise NotInitializedError()
+        return sharp_map_extent(self.ginfo)
+
+    def masked(self, mask):
+        """
+        Returns a geometry that covers only the pixels where `mask`, a map in
+        the layout of this geometry, is nonzero. Empty rings are dropped and
+        the remaining rings are cut to the azimuthal range of their observed
+        pixels. Maps keep the layout of this geometry; pixels outside the
+        returned geometry are neither read nor written by transforms.
+        """
+        if self.ginfo == NULL:
+            raise NotInitializedError()
+        cdef double[::1] mask_ = np.ascontiguousarray(mask, dtype=np.float64).reshape(-1)
+        if mask_.shape[0] < self.map_extent():
+            raise ValueError('mask is shorter than the map')
+        cdef geom_info res = geom_info()
+        sharp_make_masked_geom_info(self.ginfo, &mask_[0], &res.ginfo)
+        return res
+
+    def hash(self):
+        """64-bit content hash, suitable as a key for caching plans."""
+        if self.ginfo == NULL:
+            raise NotInitializedError()
+        return sharp_geom_info_hash(self.ginfo)
+
+    def serialize(self):
+        """Returns the geometry as a compact, native-endian bytes object."""
+        if self.ginfo == NULL:
+            raise NotInitializedError()
+        cdef bytearray buf = bytearray(sharp_geom_info_serialize(self.ginfo, NULL))
+        sharp_geom_info_serialize(self.ginfo, <char*>buf)
+        return bytes(buf)
+
+    @staticmethod
+    def deserialize(const unsigned char[::1] buf):
+        """Inverse of serialize(); `buf` may be any buffer, e.g. an mmap."""
+        cdef geom_info res = geom_info()
+        if buf.shape[0] == 0 or \
+           sharp_geom_info_deserialize(&buf[0], buf.shape[0], &res.ginfo) == 0:
+            raise ValueError('buffer does not contain a serialized geom_info')
+        return res
+
+    def __eq__(self, other):
+        if not isinstance(other, geom_info):
+            return NotImplemented
+        cdef geom_info o = other
+        if self.ginfo == NULL or o.ginfo == NULL:
+            return self.ginfo == o.ginfo
+        return bool(sharp_geom_info_equal(self.ginfo, o.ginfo))
+
+    def __hash__(self):
+        return hash(self.hash())
+
+    def __reduce__(self):
+        return (geom_info.deserialize, (self.serialize(),))
+
     def __dealloc__(self):
         if self.ginfo != NULL:
             sharp_destroy_geom_info(self.ginfo)
@@ -161,17 +754,73 @@ cdef class geom_info:
 
 cdef class healpix_grid(geom_info):
 
-    _weight_cache = {}  # { (nside, 'T'/'Q'/'U') -> numpy array of ring weights cached from file }
+    _weight_cache = {}  # { (nside, 'T'/'Q'/'U') or (nside, 'computed', lmax) -> numpy array of ring weights }
 
-    def __init__(self, int nside, stride=1, int[::1] rings=None, double[::1] weights=None):
+    def __init__(self, int nside, stride=1, int[::1] rings=None, double[::1] weights=None,
+                 nest=False):
+        """
+        With `nest=True`, maps are in NESTED ordering; they are transformed
+        directly, without reordering. This requires `nside` to be a power
+        of 2 and does not support `rings`.
+        """
         if weights is not None and weights.shape[0] != 2 * nside:
             raise ValueError('weights must have length 2 * nside')
+        if nest:
+            if nside < 1 or nside & (nside - 1) != 0:
+                raise ValueError('NESTED ordering requires nside to be a power of 2')
+            if rings is not None:
+                raise ValueError('rings are not supported for NESTED ordering')
+            sharp_make_nested_healpix_geom_info(nside, stride,
+                                                weight=NULL if weights is None else &weights[0],
+                                                geom_info=&self.ginfo)
+            return
         sharp_make_subset_healpix_geom_info(nside, stride,
                                             nrings=4 * nside - 1 if rings is None else rings.shape[0],
                                             rings=NULL if rings is None else &rings[0],
                                             weight=NULL if weights is None else &weights[0],
                                             geom_info=&self.ginfo)
 
+    @classmethod
+    def ring_weights(cls, nside, lmax=None):
+        """
+        Computes HEALPix ring weights, without any external files.
+
+        The weights are the smallest corrections to unit weights that make
+        the quadrature exact for all axisymmetric functions of degree up to
+        `lmax`; map2alm with maps band-limited to L needs `lmax` = 2L.
+        Results are cached per (nside, lmax).
+
+        Parameters
+        ----------
+
+        nside: int
+            HEALPix nside parameter
+
+        lmax: int, optional
+            Degree up to which the quadrature is exact (default: 2*nside,
+            which suits analysis up to l=nside)
+
+        Returns
+        -------
+
+        NumPy array with the 2*nside relative ring weights, suitable for
+        the `weights` argument of the constructor.
+
+        """
+        cdef double[::1] buf
+        cdef int nside_ = nside, lmax_
+        if lmax is None:
+            lmax = 2 * nside
+        lmax_ = lmax
+        key = (nside, 'computed', lmax)
+        if key not in cls._weight_cache:
+            w = np.empty(2 * nside, np.double)
+            buf = w
+            with nogil:
+                sharp_healpix_ring_weights(nside_, lmax_, &buf[0])
+            cls._weight_cache[key] = w
+        return cls._weight_cache[key].copy()
+
     @classmethod
     def load_ring_weights(cls, nside, fields):
         """
@@ -216,6 +865,117 @@ cdef class healpix_grid(geom_info):
                 hdulist.close()
         return [cls._weight_cache[(nside, field)].copy() for field in fields]
 
+
+cdef _check_grid(int nrings, int nphi, int stride_lon):
+    if nrings < 1 or nphi < 1:
+        raise ValueError('nrings and nphi must be positive')
+    if stride_lon < 1:
+        raise ValueError('stride must be positive')
+
+
+cdef class gauss_grid(geom_info):
+    """
+    Gauss-Legendre grid with `nrings` rings of `nphi` pixels each, stored
+    ring by ring from north to south. The first pixel of each ring is at
+    azimuth `phi0`; pixels are `stride_lon` entries apart and rings start
+    `stride_lat` (default: nphi * stride_lon) entries apart. Analysis is
+    exact for band limits up to nrings - 1.
+    """
+    def __init__(self, int nrings, int nphi, double phi0=0., int stride_lon=1,
+                 stride_lat=None):
+        _check_grid(nrings, nphi, stride_lon)
+        cdef int stride_lat_ = nphi * stride_lon if stride_lat is None else stride_lat
+        with nogil:
+            sharp_make_gauss_geom_info(nrings, nphi, phi0, stride_lon, stride_lat_,
+                                       &self.ginfo)
+
+
+cdef class reduced_gauss_grid(geom_info):
+    """
+    Gauss-Legendre grid whose rings are shortened towards the poles as far as
+    band limit `lmax` and `spin` allow, with at most `nphi` pixels per ring.
+    Rings are stored one after another, `stride` entries between pixels.
+    """
+    def __init__(self, int nrings, int nphi, int lmax, int spin=0, double phi0=0.,
+                 int stride=1):
+        _check_grid(nrings, nphi, stride)
+        with nogil:
+            sharp_make_reduced_gauss_geom_info(nrings, nphi, lmax, spin, phi0, stride,
+                                               &self.ginfo)
+
+
+cdef class octahedral_grid(geom_info):
+    """
+    Octahedral reduced Gaussian ("O") grid with `nrings` rings; the k-th ring
+    from the nearer pole has 4*k+16 pixels. With lmax >= 0, rings too short
+    for that band limit and `spin` are lengthened. The layout is as for
+    reduced_gauss_grid.
+    """
+    def __init__(self, int nrings, int lmax=-1, int spin=0, double phi0=0., int stride=1):
+        _check_grid(nrings, 1, stride)
+        with nogil:
+            sharp_make_octahedral_geom_info(nrings, lmax, spin, phi0, stride, &self.ginfo)
+
+
+cdef class fejer1_grid(geom_info):
+    """
+    Equidistant cylindrical grid without pixels at the poles, the first ring
+    at colatitude pi/(2*nrings) (Fejer's first rule). The arguments are as
+    for gauss_grid; analysis is exact for band limits up to (nrings - 1) / 2.
+    """
+    def __init__(self, int nrings, int nphi, double phi0=0., int stride_lon=1,
+                 stride_lat=None):
+        _check_grid(nrings, nphi, stride_lon)
+        cdef int stride_lat_ = nphi * stride_lon if stride_lat is None else stride_lat
+        with nogil:
+            sharp_make_fejer1_geom_info(nrings, nphi, phi0, stride_lon, stride_lat_,
+                                        &self.ginfo)
+
+ecp_grid = fejer1_grid
+
+
+cdef class cc_grid(geom_info):
+    """
+    Equidistant cylindrical grid with rings at both poles (Clenshaw-Curtis
+    quadrature). The arguments are as for gauss_grid.
+    """
+    def __init__(self, int nrings, int nphi, double phi0=0., int stride_lon=1,
+                 stride_lat=None):
+        _check_grid(nrings, nphi, stride_lon)
+        cdef int stride_lat_ = nphi * stride_lon if stride_lat is None else stride_lat
+        with nogil:
+            sharp_make_cc_geom_info(nrings, nphi, phi0, stride_lon, stride_lat_, &self.ginfo)
+
+
+cdef class fejer2_grid(geom_info):
+    """
+    Equidistant cylindrical grid with the first ring at colatitude
+    pi/(nrings+1) (Fejer's second rule, i.e. Clenshaw-Curtis without the
+    poles). The arguments are as for gauss_grid.
+    """
+    def __init__(self, int nrings, int nphi, double phi0=0., int stride_lon=1,
+                 stride_lat=None):
+        _check_grid(nrings, nphi, stride_lon)
+        cdef int stride_lat_ = nphi * stride_lon if stride_lat is None else stride_lat
+        with nogil:
+            sharp_make_fejer2_geom_info(nrings, nphi, phi0, stride_lon, stride_lat_,
+                                        &self.ginfo)
+
+
+cdef class mw_grid(geom_info):
+    """
+    McEwen & Wiaux grid, with the first ring at colatitude pi/(2*nrings-1)
+    and the last one at the south pole. It has no quadrature weights, so only
+    synthesis and adjoint synthesis are meaningful. The arguments are as for
+    gauss_grid.
+    """
+    def __init__(self, int nrings, int nphi, double phi0=0., int stride_lon=1,
+                 stride_lat=None):
+        _check_grid(nrings, nphi, stride_lon)
+        cdef int stride_lat_ = nphi * stride_lon if stride_lat is None else stride_lat
+        with nogil:
+            sharp_make_mw_geom_info(nrings, nphi, phi0, stride_lon, stride_lat_, &self.ginfo)
+
 #
 # alm_info
 #
@@ -242,83 +1002,355 @@ cdef class alm_info:
             raise NotInitializedError()
         return np.asarray(<long[:self.ainfo.nm]> self.ainfo.mvstart)
 
+    @property
+    def packed(self):
+        """True if the a_lm are stored as real numbers, False if they are complex."""
+        if self.ainfo == NULL:
+            raise NotInitializedError()
+        return (self.ainfo.flags & SHARP_PACKED) != 0
+
+    @property
+    def real_harmonics(self):
+        """True if the a_lm refer to real instead of complex spherical harmonics."""
+        if self.ainfo == NULL:
+            raise NotInitializedError()
+        return (self.ainfo.flags & SHARP_REAL_HARMONICS) != 0
+
+    def hash(self):
+        """64-bit content hash, suitable as a key for caching plans."""
+        if self.ainfo == NULL:
+            raise NotInitializedError()
+        return sharp_alm_info_hash(self.ainfo)
+
+    def serialize(self):
+        """Returns the a_lm layout as a compact, native-endian bytes object."""
+        if self.ainfo == NULL:
+            raise NotInitializedError()
+        cdef bytearray buf = bytearray(sharp_alm_info_serialize(self.ainfo, NULL))
+        sharp_alm_info_serialize(self.ainfo, <char*>buf)
+        return bytes(buf)
+
+    @staticmethod
+    def deserialize(const unsigned char[::1] buf):
+        """Inverse of serialize(); `buf` may be any buffer, e.g. an mmap."""
+        cdef alm_info res = alm_info()
+        if buf.shape[0] == 0 or \
+           sharp_alm_info_deserialize(&buf[0], buf.shape[0], &res.ainfo) == 0:
+            raise ValueError('buffer does not contain a serialized alm_info')
+        return res
+
+    def __eq__(self, other):
+        if not isinstance(other, alm_info):
+            return NotImplemented
+        cdef alm_info o = other
+        if self.ainfo == NULL or o.ainfo == NULL:
+            return self.ainfo == o.ainfo
+        return bool(sharp_alm_info_equal(self.ainfo, o.ainfo))
+
+    def __hash__(self):
+        return hash(self.hash())
+
+    def __reduce__(self):
+        return (alm_info.deserialize, (self.serialize(),))
+
     def __dealloc__(self):
         if self.ainfo != NULL:
             sharp_destroy_alm_info(self.ainfo)
         self.ainfo = NULL
 
-    @cython.boundscheck(False)
-    def almxfl(self, np.ndarray[double, ndim=3, mode='c'] alm, np.ndarray[double, ndim=2, mode='c'] fl):
+    def almxfl(self, alm, fl):
         """Multiply Alm by a Ell based array
 
 
         Parameters
         ----------
         alm : np.ndarray
-            input alm, 3 dimensions = (different signal x polarizations x lm-ordering)
+            input alm, 3 dimensions = (different signal x polarizations x lm-ordering),
+            with the dtype required by this layout (see sht()) and a contiguous last axis
         fl : np.ndarray
-            either 1 dimension, e.g. gaussian beam, or 2 dimensions e.g. a polarized beam
+            shape (lmax + 1,) or (lmax + 1, 1), e.g. a gaussian beam, or
+            (lmax + 1, npol), e.g. a polarized beam
 
         Returns
         -------
         None, it modifies alms in-place
 
         """
-        cdef int mvstart = 0
-        cdef bint has_multiple_beams = alm.shape[2] > 1 and fl.shape[1] > 1
-        cdef int f, i_m, m, num_ells, i_l, i_signal, i_pol, i_mv
-
-        for i_m in range(self.ainfo.nm):
-            m = self.ainfo.mval[i_m]
-            f = 1 if (m==0) else 2
-            num_ells = self.ainfo.lmax + 1 - m
-
-            if not has_multiple_beams:
-                for i_signal in range(alm.shape[0]):
-                    for i_pol in range(alm.shape[1]):
-                        for i_l in range(num_ells):
-                            l = m + i_l
-                            for i_mv in range(mvstart + f*i_l, mvstart + f*i_l +f):
-                                alm[i_signal, i_pol, i_mv] *= fl[l, 0]
-            else:
-                for i_signal in range(alm.shape[0]):
-                    for i_pol in range(alm.shape[1]):
-                        for i_l in range(num_ells):
-                            l = m + i_l
-                            for i_mv in range(mvstart + f*i_l, mvstart + f*i_l +f):
-                                alm[i_signal, i_pol, i_mv] *= fl[l, i_pol]
-            mvstart += f * num_ells
+        self._filter(alm, fl, self.ainfo.lmax + 1 if self.ainfo != NULL else 0, False)
+
+    def almxfm(self, alm, fm):
+        """
+        Like almxfl, but multiplies by an m dependent factor; `fm` has shape
+        (mmax + 1,), (mmax + 1, 1) or (mmax + 1, npol).
+        """
+        cdef int mmax = -1, i
+        if self.ainfo != NULL:
+            for i in range(self.ainfo.nm):
+                mmax = max(mmax, self.ainfo.mval[i])
+        self._filter(alm, fm, mmax + 1, True)
+
+    cdef _filter(self, alm, f, ptrdiff_t nf, bint by_m):
+        cdef void **ptrs
+        cdef int i, nsig, npol, flags
+        cdef ptrdiff_t f_stride
+        cdef double[:, ::1] f_
+        if self.ainfo == NULL:
+            raise NotInitializedError()
+        if not isinstance(alm, np.ndarray) or alm.ndim != 3:
+            raise ValueError('alm must be a numpy array with 3 dimensions')
+        if alm.dtype not in (np.float64, np.float32, np.complex128, np.complex64):
+            raise ValueError('alm must be float64, float32, complex128 or complex64')
+        rdtype = np.finfo(alm.dtype).dtype
+        if alm.dtype != (rdtype if self.packed else _complex_dtype(rdtype)):
+            raise ValueError('alm has the wrong dtype for this layout')
+        if alm.shape[2] < self.local_size():
+            raise ValueError('alm must have at least %d entries' % self.local_size())
+        if alm.shape[2] > 1 and alm.strides[2] != alm.itemsize:
+            raise ValueError('the last axis of alm must be contiguous')
+        if not alm.flags.writeable:
+            raise ValueError('alm is not writeable')
+        f = np.asarray(f, dtype=np.float64)
+        if f.ndim not in (1, 2) or f.shape[0] != nf or \
+           (f.ndim == 2 and f.shape[1] not in (1, alm.shape[1])):
+            raise ValueError('filter must have shape (%d,), (%d, 1) or (%d, %d)'
+                             % (nf, nf, nf, alm.shape[1]))
+        # one contiguous row per polarization
+        f_ = np.ascontiguousarray(f.reshape((nf, -1)).T) if nf > 0 else np.zeros((1, 1))
+        f_stride = nf if f_.shape[0] > 1 else 0
+        nsig, npol = alm.shape[0], alm.shape[1]
+        flags = SHARP_DP if rdtype == np.float64 else 0
+        if nsig * npol == 0 or nf == 0:
+            return
+        ptrs = <void**>malloc(nsig * npol * sizeof(void*))
+        if ptrs == NULL:
+            raise MemoryError()
+        try:
+            _component_pointers(alm, ptrs)
+            with nogil:
+                for i in range(nsig):
+                    if by_m:
+                        sharp_almxfm(self.ainfo, ptrs + i * npol, npol, &f_[0, 0], f_stride,
+                                     flags)
+                    else:
+                        sharp_almxfl(self.ainfo, ptrs + i * npol, npol, &f_[0, 0], f_stride,
+                                     flags)
+        finally:
+            free(ptrs)
 
 cdef class triangular_order(alm_info):
-    def __init__(self, int lmax, mmax=None, stride=1):
+    """
+    Complex a_lm for m = 0 .. mmax, m-major. With real_harmonics=True, the
+    coefficient stored for m > 0 holds the pair (a_l,m, a_l,-m) of the real
+    spherical harmonics instead of the real and imaginary part.
+    """
+    def __init__(self, int lmax, mmax=None, stride=1, real_harmonics=False):
         mmax = mmax if mmax is not None else lmax
         sharp_make_triangular_alm_info(lmax, mmax, stride, &self.ainfo)
+        if real_harmonics:
+            self.ainfo.flags |= SHARP_REAL_HARMONICS
 
 
 cdef class rectangular_order(alm_info):
-    def __init__(self, int lmax, mmax=None, stride=1):
+    """
+    Complex a_lm for m = 0 .. mmax with lmax + 1 entries for every m;
+    real_harmonics is as for triangular_order.
+    """
+    def __init__(self, int lmax, mmax=None, stride=1, real_harmonics=False):
         mmax = mmax if mmax is not None else lmax
         sharp_make_rectangular_alm_info(lmax, mmax, stride, &self.ainfo)
+        if real_harmonics:
+            self.ainfo.flags |= SHARP_REAL_HARMONICS
 
 
 cdef class packed_real_order(alm_info):
-    def __init__(self, int lmax, stride=1, int[::1] ms=None):
+    """
+    Real a_lm of the real spherical harmonics for the m in `ms` (default: all),
+    m-major, with the a_l,-m following a_l,m for m > 0. With
+    real_harmonics=False, these are instead the real and imaginary parts of
+    the complex a_lm.
+    """
+    def __init__(self, int lmax, stride=1, int[::1] ms=None, real_harmonics=True):
         sharp_make_mmajor_real_packed_alm_info(lmax=lmax, stride=stride,
                                                nm=lmax + 1 if ms is None else ms.shape[0],
                                                ms=NULL if ms is None else &ms[0],
                                                alm_info=&self.ainfo)
+        if not real_harmonics:
+            self.ainfo.flags &= ~SHARP_REAL_HARMONICS
 
 #
 # 
 #
 
 @cython.boundscheck(False)
-def normalized_associated_legendre_table(int lmax, int m, theta):
-    cdef double[::1] theta_ = np.ascontiguousarray(theta, dtype=np.double)
-    out = np.zeros((theta_.shape[0], lmax - m + 1), np.double)
-    cdef double[:, ::1] out_ = out
+def normalized_associated_legendre_table(int lmax, int m, theta, int spin=0):
+    """
+    Returns a table of the normalized associated Legendre functions
+    lambda_lm(theta) for l = m .. lmax, with shape (ntheta, lmax - m + 1).
+
+    For spin != 0 the spin-weighted functions _{+s}lambda_lm and _{-s}lambda_lm
+    are returned in the last axis, giving shape (ntheta, lmax - m + 1, 2).
+    """
+    cdef double[::1] theta_ = np.ascontiguousarray(theta, dtype=np.double).reshape(-1)
+    cdef int nspin = 1 if spin == 0 else 2
     if lmax < m:
         raise ValueError("lmax < m")
-    with nogil:
-        sharp_normalized_associated_legendre_table(m, 0, lmax, theta_.shape[0], &theta_[0], lmax - m + 1, 1, 1, &out_[0,0])
+    if spin < 0:
+        raise ValueError("spin must be nonnegative")
+    out = np.zeros((theta_.shape[0], lmax - m + 1, nspin), np.double)
+    cdef double[:, :, ::1] out_ = out
+    if theta_.shape[0] > 0:
+        with nogil:
+            sharp_normalized_associated_legendre_table(m, spin, lmax, theta_.shape[0], &theta_[0],
+                                                       (lmax - m + 1) * nspin, nspin, 1,
+                                                       &out_[0, 0, 0])
+    return out[:, :, 0] if spin == 0 else out
+
+
+def normalized_associated_legendre_table_multi(int lmax, mval, theta, int spin=0, compact=False):
+    """
+    Computes normalized_associated_legendre_table for all m in mval at once.
+
+    If compact is False, returns an array of shape (nm, ntheta, lmax - min(mval) + 1)
+    (with a trailing axis of length 2 for spin != 0) where entry [im, :, l - mval[im]]
+    holds degree l; entries with l > lmax are zero.
+
+    If compact is True, only l >= m is stored: returns a list with one array of
+    shape (lmax - m + 1, ntheta) (or (lmax - m + 1, ntheta, 2) for spin != 0) per m,
+    all of which are views into one contiguous buffer.
+    """
+    cdef ptrdiff_t[::1] mval_ = np.ascontiguousarray(mval, dtype=np.intp).reshape(-1)
+    cdef double[::1] theta_ = np.ascontiguousarray(theta, dtype=np.double).reshape(-1)
+    cdef ptrdiff_t nm = mval_.shape[0], ntheta = theta_.shape[0]
+    cdef ptrdiff_t nspin = 1 if spin == 0 else 2
+    cdef ptrdiff_t ncols
+    cdef double[::1] buf_
+    if spin < 0:
+        raise ValueError("spin must be nonnegative")
+    if nm > 0 and (np.min(mval_) < 0 or np.max(mval_) > lmax):
+        raise ValueError("need 0 <= m <= lmax")
+    if compact:
+        nl = lmax + 1 - np.asarray(mval_)
+        buf = np.zeros(max(int(np.sum(nl)) * ntheta * nspin, 1), np.double)
+        buf_ = buf
+        if nm > 0 and ntheta > 0:
+            with nogil:
+                sharp_normalized_associated_legendre_table_multi(
+                    nm, &mval_[0], spin, lmax, ntheta, &theta_[0], 0, nspin,
+                    ntheta * nspin, 1, SHARP_LEGENDRE_TABLE_COMPACT, &buf_[0])
+        result = []
+        offset = 0
+        for n in nl:
+            block = buf[offset:offset + n * ntheta * nspin]
+            result.append(block.reshape((n, ntheta, nspin)) if spin != 0 else
+                          block.reshape((n, ntheta)))
+            offset += n * ntheta * nspin
+        return result
+    else:
+        ncols = lmax + 1 - (np.min(mval_) if nm > 0 else 0)
+        out = np.zeros((nm, ntheta, ncols, nspin), np.double)
+        buf_ = out.reshape(-1) if out.size > 0 else np.zeros(1)
+        if nm > 0 and ntheta > 0:
+            with nogil:
+                sharp_normalized_associated_legendre_table_multi(
+                    nm, &mval_[0], spin, lmax, ntheta, &theta_[0], ntheta * ncols * nspin,
+                    ncols * nspin, nspin, 1, 0, &buf_[0])
+        return out[..., 0] if spin == 0 else out
+
+
+def wigner_d_table(int lmax, int mp, theta):
+    """
+    Returns the Wigner d functions d^l_{m,mp}(theta) for fixed mp as an array of
+    shape (2 * lmax + 1, ntheta, lmax + 1), indexed [m + lmax, itheta, l].
+    Entries with l < max(|m|, |mp|) are zero.
+    """
+    cdef double[::1] theta_ = np.ascontiguousarray(theta, dtype=np.double).reshape(-1)
+    cdef ptrdiff_t ntheta = theta_.shape[0]
+    if lmax < 0 or abs(mp) > lmax:
+        raise ValueError("need |mp| <= lmax")
+    out = np.zeros((2 * lmax + 1, ntheta, lmax + 1), np.double)
+    cdef double[:, :, ::1] out_ = out
+    if ntheta > 0:
+        with nogil:
+            sharp_wigner_d_table(mp, lmax, ntheta, &theta_[0], ntheta * (lmax + 1),
+                                 lmax + 1, 1, &out_[0, 0, 0])
     return out
+
+
+def wigner_d_matrices(int lmax, theta):
+    """
+    Returns the full Wigner d matrices for l = 0 .. lmax as a list of arrays;
+    entry l has shape (ntheta, 2 * l + 1, 2 * l + 1) and is indexed
+    [itheta, m + l, mp + l]. The arrays are views into one contiguous buffer.
+    """
+    cdef double[::1] theta_ = np.ascontiguousarray(theta, dtype=np.double).reshape(-1)
+    cdef ptrdiff_t ntheta = theta_.shape[0]
+    cdef ptrdiff_t ntot = (lmax + 1) * (2 * lmax + 1) * (2 * lmax + 3) // 3
+    if lmax < 0:
+        raise ValueError("need lmax >= 0")
+    buf = np.zeros((ntheta, ntot), np.double)
+    cdef double[:, ::1] buf_ = buf
+    if ntheta > 0:
+        with nogil:
+            sharp_wigner_d_matrix(lmax, ntheta, &theta_[0], &buf_[0, 0])
+    return [buf[:, l * (4 * l * l - 1) // 3:(l + 1) * (4 * (l + 1)**2 - 1) // 3].reshape(
+        (ntheta, 2 * l + 1, 2 * l + 1)) for l in range(lmax + 1)]
+
+
+def wigner3j(int l2, int l3, int m2, int m3):
+    """
+    Returns (l1min, w) where w[i] is the Wigner 3j symbol
+    (l1 l2 l3; -m2-m3 m2 m3) for l1 = l1min + i, covering all allowed l1.
+    """
+    cdef int l1min, n
+    cdef double[::1] buf_ = np.zeros(max(l2 + l3 + 1, 1), np.double)
+    with nogil:
+        n = sharp_wigner3j(l2, l3, m2, m3, &l1min, &buf_[0])
+    return l1min, np.asarray(buf_)[:n].copy()
+
+
+def coupling_matrix(wl, int lmax, pol=False, method='3j'):
+    """
+    Mode-coupling matrices of a mask with power spectrum wl (as obtained from
+    the map2alm of the mask), each of shape (lmax + 1, lmax + 1) and indexed
+    [l1, l2].
+
+    If pol is False, returns M^00. Otherwise returns (M^00, M^02, M^++, M^--);
+    see sharp_coupling_matrix for the definitions.
+
+    method='gauss' evaluates M^00 through the correlation function of the mask
+    on Gauss-Legendre nodes instead of through 3j symbols, and
+    method='recursion' through a recursion over the rows that costs only
+    O(lmax^2); neither supports pol=True.
+    """
+    cdef double[::1] wl_ = np.ascontiguousarray(wl, dtype=np.double).reshape(-1)
+    cdef int lmax_w = wl_.shape[0] - 1
+    cdef double[:, ::1] m00_, m02_, mpp_, mmm_
+    cdef bint gauss
+    if lmax < 0 or lmax_w < 0:
+        raise ValueError("need lmax >= 0 and a non-empty wl")
+    m00 = np.empty((lmax + 1, lmax + 1), np.double)
+    m00_ = m00
+    if method in ('gauss', 'recursion'):
+        if pol:
+            raise NotImplementedError("method='%s' only supports pol=False" % method)
+        gauss = method == 'gauss'
+        with nogil:
+            if gauss:
+                sharp_coupling_matrix_gauss(lmax, &wl_[0], lmax_w, &m00_[0, 0])
+            else:
+                sharp_coupling_matrix_recursive(lmax, &wl_[0], lmax_w, &m00_[0, 0])
+        return m00
+    elif method != '3j':
+        raise ValueError("unknown method: %s" % method)
+    if not pol:
+        with nogil:
+            sharp_coupling_matrix(lmax, &wl_[0], lmax_w, &m00_[0, 0], NULL, NULL, NULL)
+        return m00
+    m02 = np.empty_like(m00)
+    mpp = np.empty_like(m00)
+    mmm = np.empty_like(m00)
+    m02_, mpp_, mmm_ = m02, mpp, mmm
+    with nogil:
+        sharp_coupling_matrix(lmax, &wl_[0], lmax_w, &m00_[0, 0], &m02_[0, 0],
+                              &mpp_[0, 0], &mmm_[0, 0])
+    return m00, m02, mpp, mmm
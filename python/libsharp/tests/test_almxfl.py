@@ -0,0 +1,79 @@
+from __future__ import print_function
+import numpy as np
+from numpy.testing import assert_allclose
+
+import libsharp
+
+
+def packed_lm(order):
+    # l and m of every entry of a packed_real_order array
+    lmax = order.mval().max()
+    ls = np.concatenate([np.repeat(np.arange(m, lmax + 1), 1 if m == 0 else 2)
+                         for m in order.mval()])
+    ms = np.concatenate([np.full((lmax + 1 - m) * (1 if m == 0 else 2), m)
+                         for m in order.mval()])
+    return ls, ms
+
+
+def test_almxfl():
+    lmax = 32
+    order = libsharp.packed_real_order(lmax)
+    ls, ms = packed_lm(order)
+    alm = np.random.randn(2, 3, order.local_size())
+    fl = np.random.randn(lmax + 1, 3)
+
+    res = alm.copy()
+    order.almxfl(res, fl)
+    assert_allclose(res, alm * fl[ls].T[None])
+
+    for shared in (fl[:, 0], fl[:, :1]):
+        res = alm.copy()
+        order.almxfl(res, shared)
+        assert_allclose(res, alm * fl[ls, 0])
+
+    res = alm.astype(np.float32)
+    order.almxfl(res, fl)
+    assert_allclose(res, alm * fl[ls].T[None], rtol=1e-5)
+
+    # in place on a view with strided leading axes
+    buf = alm.copy()
+    order.almxfl(buf[::-1, 1:], fl[:, 1:])
+    assert_allclose(buf[:, 1:], alm[:, 1:] * fl[ls, 1:].T[None])
+    assert_allclose(buf[:, 0], alm[:, 0])
+
+    for bad in (alm[:, :, ::2], alm.astype(np.complex128)):
+        try:
+            order.almxfl(bad, fl)
+        except ValueError:
+            pass
+        else:
+            assert False, 'bad alm accepted'
+    try:
+        order.almxfl(alm, fl[:-1])
+    except ValueError:
+        pass
+    else:
+        assert False, 'short filter accepted'
+
+
+def test_almxfm():
+    lmax = 20
+    order = libsharp.packed_real_order(lmax)
+    ls, ms = packed_lm(order)
+    alm = np.random.randn(1, 2, order.local_size())
+    fm = np.random.randn(lmax + 1, 2)
+    res = alm.copy()
+    order.almxfm(res, fm)
+    assert_allclose(res, alm * fm[ms].T[None])
+
+    tri = libsharp.triangular_order(lmax, 10)
+    n = tri.local_size()
+    alm = np.random.randn(1, 1, n) + 1j * np.random.randn(1, 1, n)
+    res = alm.copy()
+    tri.almxfm(res, fm[:11, 0])
+    mcol = np.concatenate([np.full(lmax + 1 - m, m) for m in range(11)])
+    assert_allclose(res, alm * fm[mcol, 0])
+    res = alm.copy()
+    tri.almxfl(res, fm[:, 0])
+    lcol = np.concatenate([np.arange(m, lmax + 1) for m in range(11)])
+    assert_allclose(res, alm * fm[lcol, 0])
@@ -0,0 +1,53 @@
+from __future__ import print_function
+import numpy as np
+
+import libsharp
+
+
+def make_input(nside, lmax, spin, ntrans):
+    order = libsharp.packed_real_order(lmax)
+    alm = np.random.RandomState(2).standard_normal((ntrans, 1 if spin == 0 else 2, order.local_size()))
+    if spin > 0:
+        # components with l < spin do not exist
+        l = np.concatenate([np.arange(m, lmax + 1).repeat(1 if m == 0 else 2) for m in range(lmax + 1)])
+        alm[:, :, l < spin] = 0
+    grid = libsharp.healpix_grid(nside)
+    return grid, order, alm, libsharp.synthesis(grid, order, alm, spin=spin)
+
+
+def test_iterations_converge():
+    for spin, ntrans in [(0, 1), (0, 3), (2, 2)]:
+        grid, order, alm, map = make_input(16, 32, spin, ntrans)
+        for method in ['jacobi', 'cg']:
+            errs = []
+            for niter in [1, 3, 6]:
+                res, n, resid = libsharp.analysis_iter(grid, order, map, spin=spin, niter=niter,
+                                                       method=method)
+                assert n == niter and resid.shape == (ntrans,)
+                errs.append(np.abs(res - alm).max())
+            assert errs[2] < 1e-2 * errs[0], (spin, method, errs)
+
+
+def test_jacobi_niter0_is_analysis():
+    grid, order, alm, map = make_input(8, 16, 0, 2)
+    res, n, resid = libsharp.analysis_iter(grid, order, map, niter=0)
+    assert n == 0
+    assert np.all(res == libsharp.analysis(grid, order, map))
+
+
+def test_cg_niter0_matches_jacobi():
+    for spin in (0, 2):
+        grid, order, alm, map = make_input(8, 16, spin, 2)
+        jac = libsharp.analysis_iter(grid, order, map, spin=spin, niter=0)
+        cg = libsharp.analysis_iter(grid, order, map, spin=spin, niter=0, method='cg')
+        assert cg[1] == 0
+        assert np.all(cg[0] == jac[0])
+        assert np.allclose(cg[2], jac[2]) and np.all(cg[2] < 1)
+
+
+def test_epsilon_stops_early():
+    grid, order, alm, map = make_input(16, 32, 0, 1)
+    res, n, resid = libsharp.analysis_iter(grid, order, map, niter=100, method='cg', epsilon=1e-8)
+    assert 0 < n < 100
+    assert resid[0] < 1e-8
+    assert np.abs(res - alm).max() < 1e-6
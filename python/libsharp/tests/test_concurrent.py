@@ -0,0 +1,81 @@
+from __future__ import print_function
+import threading
+import numpy as np
+from numpy.testing import assert_allclose
+
+import libsharp
+
+
+def make_jobs():
+    jobs = []
+    for nside, lmax, spin in ((8, 16, 0), (16, 24, 2), (4, 8, 1)):
+        grid = libsharp.healpix_grid(nside)
+        order = libsharp.packed_real_order(lmax)
+        ncomp = 1 if spin == 0 else 2
+        alm = libsharp.analysis(grid, order, np.random.randn(2, ncomp, grid.local_size()),
+                                spin=spin)
+        jobs.append(('Y', grid, order, alm, spin))
+    grid = libsharp.gauss_grid(17, 33)
+    order = libsharp.triangular_order(16)
+    maps = np.random.randn(1, 1, grid.local_size()).astype(np.float32)
+    jobs.append(dict(jobtype='YtW', ginfo=grid, ainfo=order, input=maps))
+    return jobs
+
+
+def run(job):
+    return libsharp.sht(*job) if isinstance(job, tuple) else libsharp.sht(**job)
+
+
+def test_nthreads():
+    for job in make_jobs():
+        ref = run(job)
+        args = job if isinstance(job, dict) else dict(zip(('jobtype', 'ginfo', 'ainfo',
+                                                           'input', 'spin'), job))
+        for nthreads in (1, 2):
+            res = libsharp.sht(nthreads=nthreads, **args)
+            assert_allclose(res, ref, atol=1e-5 * abs(ref).max())
+    try:
+        libsharp.sht(nthreads=-1, **args)
+    except ValueError:
+        pass
+    else:
+        assert False, 'negative nthreads accepted'
+
+
+def test_sht_batch():
+    jobs = make_jobs()
+    refs = [run(job) for job in jobs]
+    for kw in ({}, dict(nthreads=2), dict(nthreads=1, nworkers=3)):
+        res = libsharp.sht_batch(jobs, **kw)
+        assert len(res) == len(refs)
+        for r, ref in zip(res, refs):
+            assert r.dtype == ref.dtype
+            assert_allclose(r, ref, atol=1e-5 * abs(ref).max())
+    assert libsharp.sht_batch([]) == []
+
+    bad = jobs[:1] + [('Y', jobs[0][1], jobs[0][2], jobs[0][3][:, :, :-1])]
+    try:
+        libsharp.sht_batch(bad)
+    except ValueError:
+        pass
+    else:
+        assert False, 'error in a job was not propagated'
+
+
+def test_concurrent_threads():
+    jobs = make_jobs()
+    refs = [run(job) for job in jobs]
+    res = [None] * len(jobs)
+
+    def work(i):
+        job = jobs[i]
+        res[i] = libsharp.sht(nthreads=1, **job) if isinstance(job, dict) else \
+            libsharp.sht(*job, nthreads=1)
+
+    threads = [threading.Thread(target=work, args=(i,)) for i in range(len(jobs))]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    for r, ref in zip(res, refs):
+        assert_allclose(r, ref, atol=1e-5 * abs(ref).max())
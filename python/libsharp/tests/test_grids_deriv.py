@@ -0,0 +1,122 @@
+from __future__ import print_function
+import numpy as np
+from numpy.testing import assert_allclose
+
+import libsharp
+
+lmax = 16
+
+
+def random_alm(order):
+    grid = libsharp.gauss_grid(lmax + 1, 2 * lmax + 1)
+    return libsharp.analysis(grid, order, np.random.randn(1, 1, grid.local_size()))
+
+
+def test_grids():
+    order = libsharp.packed_real_order(lmax)
+    alm = random_alm(order)
+    grids = [libsharp.gauss_grid(lmax + 1, 2 * lmax + 1),
+             libsharp.reduced_gauss_grid(lmax + 1, 2 * lmax + 1, lmax),
+             libsharp.octahedral_grid(lmax + 1, lmax),
+             libsharp.fejer1_grid(2 * lmax + 1, 2 * lmax + 1),
+             libsharp.ecp_grid(2 * lmax + 1, 2 * lmax + 1),
+             libsharp.cc_grid(2 * lmax + 1, 2 * lmax + 1),
+             libsharp.fejer2_grid(2 * lmax + 1, 2 * lmax + 1)]
+    for grid in grids:
+        map = libsharp.synthesis(grid, order, alm)
+        assert_allclose(libsharp.analysis(grid, order, map), alm, atol=1e-13)
+
+    # no quadrature weights, but synthesis must agree with the other grids
+    # on the ring at the south pole
+    mw = libsharp.mw_grid(lmax + 1, 2 * lmax + 1)
+    cc = libsharp.cc_grid(lmax + 1, 2 * lmax + 1)
+    assert_allclose(libsharp.synthesis(mw, order, alm)[:, :, -(2 * lmax + 1):],
+                    libsharp.synthesis(cc, order, alm)[:, :, -(2 * lmax + 1):])
+
+    # interleaved grids via stride_lon/stride_lat
+    grid = libsharp.gauss_grid(lmax + 1, 2 * lmax + 1)
+    odd = libsharp.gauss_grid(lmax + 1, 2 * lmax + 1, stride_lon=2)
+    buf = libsharp.synthesis(odd, order, alm)
+    assert_allclose(buf[:, :, ::2], libsharp.synthesis(grid, order, alm))
+    assert np.all(buf[:, :, 1::2] == 0)
+
+
+def test_complex_layouts():
+    grid = libsharp.gauss_grid(lmax + 1, 2 * lmax + 1)
+    for real_harmonics in (False, True):
+        order = libsharp.triangular_order(lmax, real_harmonics=real_harmonics)
+        assert not order.packed and order.real_harmonics == real_harmonics
+        n = order.local_size()
+        alm = np.random.randn(1, 1, n) + 1j * np.random.randn(1, 1, n)
+        alm[:, :, :lmax + 1].imag = 0
+        map = libsharp.synthesis(grid, order, alm)
+        assert map.dtype == np.float64
+        assert_allclose(libsharp.analysis(grid, order, map), alm, atol=1e-13)
+        try:
+            libsharp.synthesis(grid, order, alm.real.copy())
+        except ValueError:
+            pass
+        else:
+            assert False, 'real a_lm accepted for a complex layout'
+
+    # the packed complex convention differs from the real one for m > 0
+    order = libsharp.packed_real_order(lmax)
+    alm = random_alm(order)
+    cplx = libsharp.packed_real_order(lmax, real_harmonics=False)
+    assert cplx.packed and not cplx.real_harmonics
+    m0 = slice(0, lmax + 1)
+    assert_allclose(libsharp.analysis(grid, cplx, libsharp.synthesis(grid, order, alm))[:, :, m0],
+                    alm[:, :, m0], atol=1e-13)
+
+
+def test_deriv1():
+    order = libsharp.packed_real_order(lmax)
+    grid = libsharp.gauss_grid(lmax + 1, 2 * lmax + 2)
+    x, w = libsharp.legendre_roots(lmax + 1)
+
+    # Y_10 = sqrt(3/4pi) cos(theta)
+    alm = np.zeros((1, 1, order.local_size()))
+    alm[0, 0, 1] = 1
+    der = libsharp.synthesis_deriv1(grid, order, alm)
+    assert der.shape == (1, 2, grid.local_size())
+    expected = -np.sqrt(3 / (4 * np.pi)) * np.sqrt(1 - x**2)
+    assert_allclose(der[0, 0].reshape(lmax + 1, -1), expected[:, None] * np.ones(2 * lmax + 2),
+                    atol=1e-14)
+    assert_allclose(der[0, 1], 0, atol=1e-14)
+
+    # the gradient is the spin-1 synthesis of sqrt(l(l+1)) a_lm
+    alm = random_alm(order)
+    ls = np.concatenate([np.repeat(np.arange(m, lmax + 1), 1 if m == 0 else 2)
+                         for m in range(lmax + 1)])
+    elm = np.zeros((1, 2, alm.shape[2]))
+    elm[0, 0] = alm[0, 0] * np.sqrt(ls * (ls + 1.))
+    ref = libsharp.synthesis(grid, order, elm, spin=1)
+    assert_allclose(libsharp.synthesis_deriv1(grid, order, alm), ref, atol=1e-13)
+    plan = libsharp.Plan('alm2map_deriv1', grid, order)
+    assert_allclose(plan.execute(alm), ref, atol=1e-13)
+    try:
+        libsharp.synthesis_deriv1(grid, order, elm)
+    except ValueError:
+        pass
+    else:
+        assert False, 'two-component input accepted for alm2map_deriv1'
+
+
+def test_no_fft():
+    order = libsharp.packed_real_order(lmax)
+    alm = random_alm(order)
+    nphi = 2 * lmax + 2
+    grid = libsharp.gauss_grid(lmax + 1, nphi)
+    phases = libsharp.gauss_grid(lmax + 1, lmax + 1)
+
+    coeffs = libsharp.synthesis(phases, order, alm, no_fft=True)
+    assert coeffs.dtype == np.complex128
+    map = libsharp.synthesis(grid, order, alm)
+    ref = np.fft.rfft(map.reshape(lmax + 1, nphi), axis=1)[:, :lmax + 1] / nphi
+    assert_allclose(coeffs.reshape(lmax + 1, lmax + 1), ref, atol=1e-14)
+    assert_allclose(libsharp.analysis(phases, order, coeffs, no_fft=True), alm, atol=1e-13)
+
+    plan = libsharp.Plan('Y', phases, order, dtype=np.float32, no_fft=True)
+    res = plan.execute(alm.astype(np.float32))
+    assert res.dtype == np.complex64
+    assert_allclose(res, coeffs, atol=1e-5)
@@ -0,0 +1,82 @@
+from __future__ import print_function
+import numpy as np
+from numpy.testing import assert_equal, assert_allclose
+
+import libsharp
+
+JRLL = np.array([2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4])
+JPLL = np.array([1, 3, 5, 7, 0, 2, 4, 6, 1, 3, 5, 7])
+
+
+def nest_pix2ang(nside, pix):
+    """Pixel centres of NESTED pixels, following the HEALPix primer."""
+    npface = nside * nside
+    face, ipf = pix // npface, pix % npface
+    ix = np.zeros_like(pix)
+    iy = np.zeros_like(pix)
+    for bit in range(30):
+        ix |= ((ipf >> (2 * bit)) & 1) << bit
+        iy |= ((ipf >> (2 * bit + 1)) & 1) << bit
+    jr = JRLL[face] * nside - ix - iy - 1
+    nr = np.where(jr < nside, jr, np.where(jr > 3 * nside, 4 * nside - jr, nside))
+    z = np.where(jr < nside, 1 - nr**2 / (3. * nside**2),
+                 np.where(jr > 3 * nside, nr**2 / (3. * nside**2) - 1,
+                          (2 * nside - jr) * 2 / (3. * nside)))
+    kshift = np.where((jr < nside) | (jr > 3 * nside), 0, (jr - nside) & 1)
+    jp = (JPLL[face] * nr + ix - iy + 1 + kshift) // 2
+    jp = np.where(jp > 4 * nr, jp - 4 * nr, np.where(jp < 1, jp + 4 * nr, jp))
+    phi = (jp - (kshift + 1) * 0.5) * np.pi / (2 * nr)
+    return np.arccos(z), phi
+
+
+def ring_pix2ang(nside):
+    theta, phi = [], []
+    for ring in range(1, 4 * nside):
+        northring = min(ring, 4 * nside - ring)
+        if northring < nside:
+            nph, z = 4 * northring, 1 - northring**2 / (3. * nside**2)
+            shift = 0.5
+        else:
+            nph, z = 4 * nside, (2 * nside - northring) * 2 / (3. * nside)
+            shift = 0. if (northring - nside) & 1 else 0.5
+        if northring != ring:
+            z = -z
+        theta.append(np.full(nph, np.arccos(z)))
+        phi.append((np.arange(nph) + shift) * 2 * np.pi / nph)
+    return np.concatenate(theta), np.concatenate(phi)
+
+
+def nest2ring(nside):
+    npix = 12 * nside**2
+    tn, pn = nest_pix2ang(nside, np.arange(npix))
+    tr, pr = ring_pix2ang(nside)
+    ring_order = np.lexsort((pr, tr))
+    nest_order = np.lexsort((pn, tn))
+    assert_allclose(tn[nest_order], tr[ring_order], atol=1e-12)
+    assert_allclose(pn[nest_order], pr[ring_order], atol=1e-12)
+    result = np.empty(npix, dtype=int)
+    result[nest_order] = ring_order
+    return result
+
+
+def test_nested_matches_ring():
+    for nside in [1, 2, 8, 32]:
+        lmax = 2 * nside
+        ainfo = libsharp.packed_real_order(lmax)
+        alm = np.random.randn(1, 1, ainfo.local_size())
+        ring = libsharp.synthesis(libsharp.healpix_grid(nside), ainfo, alm)
+        nest = libsharp.synthesis(libsharp.healpix_grid(nside, nest=True), ainfo, alm)
+        n2r = nest2ring(nside)
+        assert_equal(nest[0, 0], ring[0, 0, n2r])
+        back = libsharp.analysis(libsharp.healpix_grid(nside, nest=True), ainfo, nest)
+        ref = libsharp.analysis(libsharp.healpix_grid(nside), ainfo, ring)
+        assert_allclose(back, ref, atol=1e-13)
+
+
+def test_nested_requires_power_of_two():
+    try:
+        libsharp.healpix_grid(12, nest=True)
+    except ValueError:
+        pass
+    else:
+        assert False
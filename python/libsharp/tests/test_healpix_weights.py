@@ -0,0 +1,39 @@
+from __future__ import print_function
+import numpy as np
+from numpy.polynomial.legendre import legval
+
+from numpy.testing import assert_almost_equal
+
+import libsharp
+
+
+def ring_coordinates(nside):
+    r = np.arange(1, 2 * nside + 1)
+    x = np.where(r < nside, 1 - r**2 / (3. * nside**2), (2 * nside - r) * 2 / (3. * nside))
+    nph = np.where(r < nside, 4 * r, 4 * nside)
+    frac = np.where(r == 2 * nside, 1, 2) * nph / (12. * nside**2)
+    return x, frac
+
+
+def test_ring_weights_quadrature():
+    for nside, lmax in [(1, 2), (4, 8), (16, 40), (32, 64)]:
+        w = libsharp.healpix_grid.ring_weights(nside, lmax)
+        assert w.shape == (2 * nside,)
+        x, frac = ring_coordinates(nside)
+        for l in range(0, lmax + 1, 2):
+            c = np.zeros(l + 1)
+            c[l] = 1
+            assert_almost_equal((frac * w * legval(x, c)).sum(), 1. if l == 0 else 0., 13)
+
+
+def test_ring_weights_analysis():
+    nside, lmax = 32, 16
+    order = libsharp.packed_real_order(lmax)
+    alm = np.random.RandomState(1).standard_normal((1, 1, order.local_size()))
+
+    plain = libsharp.healpix_grid(nside)
+    weighted = libsharp.healpix_grid(nside, weights=libsharp.healpix_grid.ring_weights(nside, 2 * lmax))
+    map = libsharp.synthesis(plain, order, alm)
+    err_plain = np.abs(libsharp.analysis(plain, order, map) - alm).max()
+    err_weighted = np.abs(libsharp.analysis(weighted, order, map) - alm).max()
+    assert err_weighted < 0.1 * err_plain
@@ -0,0 +1,45 @@
+from __future__ import print_function
+import pickle
+import numpy as np
+
+import libsharp
+
+
+def test_geom_info_roundtrip():
+    grid = libsharp.healpix_grid(16)
+    buf = grid.serialize()
+    copy = libsharp.geom_info.deserialize(buf)
+    assert copy == grid
+    assert copy.hash() == grid.hash()
+    assert copy.local_size() == grid.local_size()
+    # unaligned, read-only buffers such as mmaps work as well
+    shifted = np.frombuffer(b'x' + buf, dtype=np.uint8)[1:]
+    assert libsharp.geom_info.deserialize(shifted) == grid
+
+
+def test_alm_info_roundtrip():
+    order = libsharp.packed_real_order(20, ms=np.arange(0, 21, 2, dtype=np.int32))
+    copy = pickle.loads(pickle.dumps(order))
+    assert copy == order
+    assert hash(copy) == hash(order)
+    assert np.all(copy.mvstart() == order.mvstart())
+
+
+def test_distinct_infos():
+    assert libsharp.healpix_grid(16) != libsharp.healpix_grid(8)
+    assert libsharp.healpix_grid(16).hash() != libsharp.healpix_grid(16, weights=np.full(32, 1.1)).hash()
+    assert libsharp.triangular_order(10) != libsharp.rectangular_order(10)
+    assert libsharp.triangular_order(10) != libsharp.packed_real_order(10)
+    cache = {libsharp.triangular_order(10): 'plan'}
+    assert cache[libsharp.triangular_order(10)] == 'plan'
+
+
+def test_invalid_buffer():
+    buf = libsharp.healpix_grid(4).serialize()
+    for bad in [b'', buf[:-1], libsharp.triangular_order(4).serialize()]:
+        try:
+            libsharp.geom_info.deserialize(bad)
+        except ValueError:
+            pass
+        else:
+            assert False
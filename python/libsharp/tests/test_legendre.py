@@ -1,5 +1,5 @@
 import numpy as np
-from scipy.special import legendre
+from scipy.special import legendre, eval_legendre
 from scipy.special import p_roots
 import libsharp
 
@@ -34,6 +34,12 @@ def check_legendre_transform(lmax, ntheta):
     y32 = libsharp.legendre_transform(x.astype(np.float32), bl)
     assert_allclose(y, y0, rtol=1e-5, atol=1e-5)
 
+    # Clenshaw summation
+    y = libsharp.legendre_transform(x, bl, method='clenshaw')
+    assert_allclose(y, y0, rtol=1e-12, atol=1e-12)
+    y32 = libsharp.legendre_transform(x.astype(np.float32), bl, method='clenshaw')
+    assert_allclose(y32, y0, rtol=1e-4, atol=1e-4 * np.abs(y0).max(initial=1))
+
 
 def test_legendre_transform():
     nthetas_to_try = [0, 9, 17, 19] + list(np.random.randint(500, size=20))
@@ -41,6 +47,121 @@ def test_legendre_transform():
         for lmax in [0, 1, 2, 3, 20] + list(np.random.randint(50, size=4)):
             yield check_legendre_transform, lmax, ntheta
 
+def test_legendre_transform_clenshaw_high_lmax():
+    # compare with a long double evaluation of the forward recursion
+    lmax = 3000
+    l = np.arange(lmax + 1)
+    bl = (2 * l + 1) * np.exp(np.log(1e-3) * l * (l + 1) / lmax / (lmax + 1))
+    x = np.cos(np.linspace(0.001, 3.14, 101))
+    X = x.astype(np.longdouble)
+    Pm1, P = np.ones_like(X), X.copy()
+    y0 = bl[0] * Pm1 + bl[1] * P
+    for k in range(2, lmax + 1):
+        Pm1, P = P, ((2 * k - 1) * X * P - (k - 1) * Pm1) / k
+        y0 += bl[k] * P
+    y0 = y0.astype(np.double)
+    tol = 1e-11 * np.abs(y0).max()
+    assert_allclose(libsharp.legendre_transform(x, bl, method='clenshaw'), y0, rtol=0, atol=tol)
+    assert_allclose(libsharp.legendre_transform(x, bl), y0, rtol=0, atol=tol)
+
+
+def check_legendre_transform_batch(lmax, ntheta, nbl):
+    bl = np.random.normal(size=(nbl, lmax + 1))
+    x = np.cos(np.linspace(0, np.pi, ntheta, endpoint=True))
+
+    P = eval_legendre(np.arange(lmax + 1)[None, :], x[:, None])
+    y0 = np.dot(bl, P.T)
+
+    y = libsharp.legendre_transform(x, bl)
+    assert y.shape == (nbl, ntheta)
+    assert_allclose(y, y0, rtol=1e-10, atol=1e-10)
+
+    y32 = libsharp.legendre_transform(x.astype(np.float32), bl)
+    assert_allclose(y32, y0, rtol=1e-3, atol=1e-3)
+
+
+def test_legendre_transform_batch():
+    for ntheta in [1, 9, 17, 130]:
+        for lmax in [0, 1, 2, 20, 63, 64, 150]:
+            for nbl in [1, 2, 5]:
+                yield check_legendre_transform_batch, lmax, ntheta, nbl
+
+
+def check_legendre_plan(lmax, ntheta, nbl, mode):
+    rng = np.random.RandomState(lmax + ntheta + nbl)
+    x = np.cos(np.linspace(0.1, 3.0, ntheta))
+    bl = rng.standard_normal((nbl, lmax + 1))
+    plan = libsharp.legendre_plan(lmax, x, nreuse=10, mode=mode)
+    assert plan.uses_table == (mode != 'recursion')
+    expected = libsharp.legendre_transform(x, bl)
+    rtol = 1e-6 if mode == 'table_float' else 1e-12
+    assert_allclose(plan.transform(bl), expected, rtol=rtol, atol=rtol * np.abs(expected).max())
+    # transforms are repeatable with the same plan, also for 1D input
+    assert_allclose(plan.transform(bl[0]), expected[0], rtol=rtol, atol=rtol * np.abs(expected).max())
+
+
+def test_legendre_plan():
+    for mode in ['recursion', 'table', 'table_float', 'auto']:
+        for lmax, ntheta, nbl in [(0, 3, 1), (1, 5, 2), (20, 17, 5), (300, 101, 1), (300, 64, 9)]:
+            yield check_legendre_plan, lmax, ntheta, nbl, mode
+
+
+def test_legendre_plan_auto():
+    x = np.linspace(-1, 1, 100)
+    assert libsharp.legendre_plan(100, x, nreuse=10).uses_table
+    assert not libsharp.legendre_plan(100, x, nreuse=1).uses_table
+    # too large a table to be worthwhile
+    assert not libsharp.legendre_plan(10000, np.linspace(-1, 1, 1000), nreuse=10).uses_table
+
+
+def check_legendre_transform_adjoint(lmax, ntheta, nf):
+    x = np.cos(np.linspace(0, np.pi, ntheta, endpoint=True))
+    w = np.random.uniform(size=ntheta)
+    f = np.random.normal(size=(nf, ntheta))
+
+    P = eval_legendre(np.arange(lmax + 1)[None, :], x[:, None])
+    y0 = np.dot(f * w, P)
+
+    y = libsharp.legendre_transform_adjoint(x, f, lmax, w=w)
+    assert y.shape == (nf, lmax + 1)
+    assert_allclose(y, y0, rtol=1e-10, atol=1e-10)
+
+    y = libsharp.legendre_transform_adjoint(x, f[0], lmax, w=w)
+    assert_allclose(y, y0[0], rtol=1e-10, atol=1e-10)
+
+    y32 = libsharp.legendre_transform_adjoint(x.astype(np.float32), f, lmax, w=w)
+    assert_allclose(y32, y0, rtol=1e-3, atol=1e-3 * ntheta)
+
+
+def test_legendre_transform_adjoint():
+    for ntheta in [1, 9, 17, 130]:
+        for lmax in [0, 1, 2, 20, 63, 64, 150]:
+            for nf in [1, 3]:
+                yield check_legendre_transform_adjoint, lmax, ntheta, nf
+    # several function groups, and x split into several blocks
+    for lmax, ntheta, nf in [(40, 3000, 1), (40, 3000, 70), (100, 500, 200)]:
+        yield check_legendre_transform_adjoint, lmax, ntheta, nf
+
+
+def test_legendre_transform_adjoint_reproducible():
+    x = np.cos(np.linspace(0, np.pi, 3000))
+    f = np.random.normal(size=(70, 3000))
+    y = libsharp.legendre_transform_adjoint(x, f, 100)
+    for i in range(3):
+        assert np.array_equal(libsharp.legendre_transform_adjoint(x, f, 100), y)
+
+
+def test_legendre_transform_roundtrip():
+    # Cl -> xi(theta) -> Cl is exact on lmax + 1 Gauss-Legendre nodes
+    lmax = 200
+    x, w = libsharp.legendre_roots(lmax + 1)
+    l = np.arange(lmax + 1)
+    cl = np.random.normal(size=(2, lmax + 1))
+    xi = libsharp.legendre_transform(x, cl * (2 * l + 1) / 2.)
+    cl2 = libsharp.legendre_transform_adjoint(x, xi, lmax, w=w)
+    assert_allclose(cl2, cl, rtol=1e-10, atol=1e-10)
+
+
 def check_legendre_roots(n):
     xs, ws = ([], []) if n == 0 else p_roots(n) # from SciPy
     xl, wl = libsharp.legendre_roots(n)
@@ -56,3 +177,22 @@ def test_legendre_roots():
     yield check_legendre_roots, 1
     yield check_legendre_roots, 32
     yield check_legendre_roots, 33
+
+
+def check_legendre_roots_asymptotic(n):
+    xs, ws = p_roots(n)
+    xl, wl = libsharp.legendre_roots(n)
+    assert_allclose(xs, xl, rtol=1e-14, atol=1e-14)
+    assert_allclose(xl, -xl[::-1], rtol=0, atol=0)
+    # the quadrature integrates P_l exactly for l < 2n
+    integrals = libsharp.legendre_transform_adjoint(xl, np.ones(n), 2 * n - 1, w=wl)
+    expected = np.zeros(2 * n)
+    expected[0] = 2
+    assert_allclose(integrals, expected, rtol=1e-13, atol=1e-13)
+
+def test_legendre_roots_asymptotic():
+    """
+    Large orders use the iteration-free asymptotic expansions.
+    """
+    for n in [101, 102, 500, 2001]:
+        yield check_legendre_roots_asymptotic, n
@@ -4,8 +4,9 @@ import numpy as np
 from numpy.testing import assert_almost_equal
 from nose.tools import eq_, ok_
 
-from libsharp import normalized_associated_legendre_table
-from scipy.special import sph_harm, p_roots
+from libsharp import normalized_associated_legendre_table, normalized_associated_legendre_table_multi
+from libsharp import wigner_d_table, wigner_d_matrices
+from scipy.special import sph_harm, p_roots, comb, factorial
 
 def test_compare_legendre_table_with_scipy():
     def test(theta, m, lmax):
@@ -27,10 +28,126 @@ def test_compare_legendre_table_with_scipy():
 
 
 def test_legendre_table_wrapper_logic():
-    # tests the SSE 2 logic in the high-level wrapper by using an odd number of thetas
+    # tests the blocking logic in the high-level wrapper by using an odd number of thetas
     theta = np.asarray([np.pi/2, np.pi/4, 3 * np.pi / 4])
     m = 3
     lmax = 10
     Plm = normalized_associated_legendre_table(lmax, m, theta)
     assert np.allclose(Plm[1, :], normalized_associated_legendre_table(lmax, m, np.pi/4)[0, :])
     assert np.allclose(Plm[2, :], normalized_associated_legendre_table(lmax, m, 3 * np.pi/4)[0, :])
+
+
+def test_legendre_table_addition_theorem():
+    # sum_m |Y_lm|^2 = (2l+1)/(4pi) checks the scaling at high l; the number
+    # of thetas is chosen to not be a multiple of the block size
+    theta = np.linspace(0.001, np.pi - 0.001, 7)
+    lmax = 1000
+    acc = np.zeros((theta.shape[0], lmax + 1))
+    for m in range(lmax + 1):
+        lam = normalized_associated_legendre_table(lmax, m, theta)
+        acc[:, m:] += (2 if m > 0 else 1) * lam**2
+    ref = (2 * np.arange(lmax + 1) + 1) / (4 * np.pi)
+    assert_almost_equal(acc / ref.max(), np.broadcast_to(ref, acc.shape) / ref.max(), decimal=10)
+
+
+def spin_weighted_lambda(s, l, m, theta):
+    # Goldberg et al. (1967) explicit sum, for small l
+    if l < abs(s) or l < abs(m):
+        return 0.
+    pre = (-1)**m * np.sqrt((2 * l + 1) / (4 * np.pi) * factorial(l + m) * factorial(l - m)
+                            / factorial(l + s) / factorial(l - s))
+    tot = 0.
+    for r in range(l - s + 1):
+        k = r + s - m
+        if 0 <= k <= l + s:
+            tot += (comb(l - s, r, exact=True) * comb(l + s, k, exact=True) * (-1)**(l - r - s)
+                    / np.tan(theta / 2)**(2 * r + s - m))
+    return pre * np.sin(theta / 2)**(2 * l) * tot
+
+
+def test_spin_legendre_table():
+    theta = np.asarray([0.3, 1.1, np.pi / 2, 2.0, 2.9])
+    lmax = 9
+    for spin in [1, 2, 3]:
+        for m in [0, 1, 2, 5]:
+            lam = normalized_associated_legendre_table(lmax, m, theta, spin=spin)
+            eq_(lam.shape, (theta.shape[0], lmax - m + 1, 2))
+            for l in range(m, lmax + 1):
+                ref = [[spin_weighted_lambda(spin, l, m, t), spin_weighted_lambda(-spin, l, m, t)]
+                       for t in theta]
+                assert_almost_equal(lam[:, l - m, :], ref, decimal=12)
+
+
+def test_spin_legendre_table_addition_theorem():
+    # sum_m |_sY_lm|^2 = (2l+1)/(4pi) checks the scaling at high l
+    theta = np.asarray([0.01, 1.1, np.pi / 2, 2.9])
+    lmax, spin = 600, 2
+    acc = np.zeros((theta.shape[0], lmax + 1))
+    for m in range(lmax + 1):
+        lam = normalized_associated_legendre_table(lmax, m, theta, spin=spin)
+        acc[:, m:] += lam[:, :, 0]**2
+        if m > 0:
+            acc[:, m:] += lam[:, :, 1]**2
+    l = np.arange(lmax + 1)
+    ref = np.where(l >= spin, (2 * l + 1) / (4 * np.pi), 0.)
+    assert_almost_equal(acc / ref.max(), np.broadcast_to(ref, acc.shape) / ref.max(), decimal=11)
+
+
+def test_legendre_table_multi():
+    theta = np.linspace(0.05, np.pi - 0.05, 13)
+    lmax = 40
+    mval = [7, 0, 3, 40, 12]
+    for spin in [0, 2]:
+        full = normalized_associated_legendre_table_multi(lmax, mval, theta, spin=spin)
+        compact = normalized_associated_legendre_table_multi(lmax, mval, theta, spin=spin,
+                                                             compact=True)
+        for im, m in enumerate(mval):
+            ref = normalized_associated_legendre_table(lmax, m, theta, spin=spin)
+            assert_almost_equal(full[im, :, :lmax - m + 1], ref, decimal=14)
+            ok_(np.all(full[im, :, lmax - m + 1:] == 0))
+            assert_almost_equal(np.swapaxes(compact[im], 0, 1), ref, decimal=14)
+
+
+def wigner_d_explicit(l, m, mp, beta):
+    # Wigner's formula; d^1_{1,0}(beta) = -sin(beta)/sqrt(2)
+    f = factorial
+    s = 0
+    for k in range(max(0, mp - m), min(l + mp, l - m) + 1):
+        s += ((-1)**(m - mp + k) * np.cos(beta / 2)**(2 * l + mp - m - 2 * k) *
+              np.sin(beta / 2)**(m - mp + 2 * k) /
+              (f(l + mp - k) * f(k) * f(m - mp + k) * f(l - m - k)))
+    return np.sqrt(f(l + m) * f(l - m) * f(l + mp) * f(l - mp)) * s
+
+
+def test_wigner_d_table():
+    lmax = 6
+    theta = np.array([0.01, 0.3, 1.1, 2.5, 3.1])
+    for mp in range(-lmax, lmax + 1):
+        d = wigner_d_table(lmax, mp, theta)
+        for m in range(-lmax, lmax + 1):
+            for l in range(lmax + 1):
+                expected = (wigner_d_explicit(l, m, mp, theta)
+                            if l >= max(abs(m), abs(mp)) else 0)
+                assert_almost_equal(d[m + lmax, :, l], expected, decimal=13)
+
+
+def test_wigner_d_matrices():
+    lmax = 5
+    theta = np.array([0.2, 1.3, 2.9])
+    d = wigner_d_matrices(lmax, theta)
+    for l in range(lmax + 1):
+        for m in range(-l, l + 1):
+            for mp in range(-l, l + 1):
+                assert_almost_equal(d[l][:, m + l, mp + l],
+                                    wigner_d_explicit(l, m, mp, theta), decimal=13)
+    # agrees with the column generator
+    assert_almost_equal(d[lmax][:, :, 2].T, wigner_d_table(lmax, -3, theta)[:, :, lmax])
+
+
+def test_wigner_d_matrices_large_l():
+    # rotations about the y axis compose, and the matrices are orthogonal
+    lmax = 200
+    a, b = 0.7, 1.9
+    d = wigner_d_matrices(lmax, [a, b, a + b])[lmax]
+    assert_almost_equal(np.dot(d[0], d[1]), d[2], decimal=12)
+    assert_almost_equal(np.dot(d[0], d[0].T), np.eye(2 * lmax + 1), decimal=12)
@@ -0,0 +1,51 @@
+from __future__ import print_function
+import numpy as np
+from numpy.testing import assert_allclose
+
+import libsharp
+
+
+def patch_mask(nside):
+    grid = libsharp.healpix_grid(nside)
+    # RING-ordered pixel centres
+    theta, phi = [], []
+    for ring in range(1, 4 * nside):
+        northring = min(ring, 4 * nside - ring)
+        if northring < nside:
+            nph, z, shift = 4 * northring, 1 - northring**2 / (3. * nside**2), 0.5
+        else:
+            nph, z = 4 * nside, (2 * nside - northring) * 2 / (3. * nside)
+            shift = 0. if (northring - nside) & 1 else 0.5
+        theta.append(np.full(nph, np.arccos(z if northring == ring else -z)))
+        phi.append((np.arange(nph) + shift) * 2 * np.pi / nph)
+    theta, phi = np.concatenate(theta), np.concatenate(phi)
+    # a patch straddling phi=0 in the northern hemisphere only
+    mask = (theta < 0.8) & ((phi < 0.4) | (phi > 2 * np.pi - 0.6))
+    return grid, mask.astype(np.float64)
+
+
+def test_masked_analysis_and_synthesis():
+    nside, lmax = 16, 32
+    grid, mask = patch_mask(nside)
+    part = grid.masked(mask)
+    assert part.local_size() < grid.local_size() // 10
+    assert part.map_extent() <= grid.local_size()
+    ainfo = libsharp.packed_real_order(lmax)
+
+    m = (np.random.randn(grid.local_size()) * mask)[None, None, :]
+    alm_full = libsharp.analysis(grid, ainfo, m)
+    alm_part = libsharp.analysis(part, ainfo, m[:, :, :part.map_extent()].copy())
+    assert_allclose(alm_part, alm_full, atol=1e-13 * abs(alm_full).max())
+
+    map_full = libsharp.synthesis(grid, ainfo, alm_full)
+    map_part = libsharp.synthesis(part, ainfo, alm_full)
+    observed = mask[:map_part.shape[2]] != 0
+    assert_allclose(map_part[0, 0, observed], map_full[0, 0, :map_part.shape[2]][observed],
+                    atol=1e-13 * abs(map_full).max())
+
+
+def test_empty_mask_rings_dropped():
+    grid, mask = patch_mask(8)
+    part = grid.masked(mask)
+    assert part.hash() != grid.hash()
+    assert grid.masked(np.ones(grid.local_size())) == grid
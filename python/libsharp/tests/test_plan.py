@@ -0,0 +1,56 @@
+from __future__ import print_function
+import numpy as np
+from numpy.testing import assert_allclose
+
+import libsharp
+
+
+def test_plan_matches_sht():
+    grid = libsharp.healpix_grid(16)
+    order = libsharp.packed_real_order(32)
+    for spin in (0, 2):
+        ncomp = 1 if spin == 0 else 2
+        alm = libsharp.analysis(grid, order, np.random.randn(3, ncomp, grid.local_size()),
+                                spin=spin)
+        ref = libsharp.synthesis(grid, order, alm, spin=spin)
+        plan = libsharp.Plan('Y', grid, order, spin=spin, ntrans=3)
+        out = np.empty_like(ref)
+        for nthreads in (None, 1):
+            assert plan.execute(alm, out=out, nthreads=nthreads) is out
+            assert_allclose(out, ref, atol=1e-14 * abs(ref).max())
+            assert plan.time > 0 and plan.opcnt > 0
+
+        aplan = libsharp.Plan('YtW', grid, order, spin=spin, ntrans=3)
+        aref = libsharp.analysis(grid, order, ref, spin=spin)
+        assert_allclose(aplan.execute(ref), aref)
+        aout = aplan.execute(ref)
+        aplan.execute(ref, out=aout, add=True)
+        assert_allclose(aout, 2 * aref)
+
+
+def test_plan_float32():
+    grid = libsharp.healpix_grid(8)
+    order = libsharp.packed_real_order(16)
+    alm = np.random.randn(1, 1, order.local_size())
+    plan = libsharp.Plan('Y', grid, order, dtype=np.float32, nthreads=1)
+    res = plan.execute(alm.astype(np.float32))
+    assert res.dtype == np.float32
+    ref = libsharp.synthesis(grid, order, alm)
+    assert_allclose(res, ref, atol=1e-5 * abs(ref).max())
+    try:
+        plan.execute(alm)
+    except ValueError:
+        pass
+    else:
+        assert False, 'float64 input accepted by float32 plan'
+
+
+def test_plan_strided_maps():
+    grid = libsharp.healpix_grid(8)
+    order = libsharp.packed_real_order(16)
+    alm = np.random.randn(1, 1, order.local_size())
+    ref = libsharp.synthesis(grid, order, alm)
+    buf = np.zeros((1, 1, 2 * grid.local_size()))
+    libsharp.Plan('Y', grid, order).execute(alm, out=buf[:, :, ::2])
+    assert_allclose(buf[:, :, ::2], ref)
+    assert np.all(buf[:, :, 1::2] == 0)
@@ -0,0 +1,87 @@
+from __future__ import print_function
+import numpy as np
+from numpy.testing import assert_allclose
+
+import libsharp
+
+
+def setup_problem(nside=8, lmax=16, spin=0, ntrans=2):
+    grid = libsharp.healpix_grid(nside)
+    order = libsharp.packed_real_order(lmax)
+    ncomp = 1 if spin == 0 else 2
+    alm = libsharp.analysis(grid, order,
+                            np.random.randn(ntrans, ncomp, grid.local_size()), spin=spin)
+    return grid, order, alm
+
+
+def test_float32():
+    for spin in (0, 2):
+        grid, order, alm = setup_problem(spin=spin)
+        map64 = libsharp.synthesis(grid, order, alm, spin=spin)
+        map32 = libsharp.synthesis(grid, order, alm.astype(np.float32), spin=spin)
+        assert map32.dtype == np.float32
+        assert_allclose(map32, map64, atol=1e-5 * abs(map64).max())
+        alm32 = libsharp.adjoint_synthesis(grid, order, map32, spin=spin)
+        assert alm32.dtype == np.float32
+        alm64 = libsharp.adjoint_synthesis(grid, order, map64, spin=spin)
+        assert_allclose(alm32, alm64, atol=1e-5 * abs(alm64).max())
+
+
+def test_out_and_add():
+    grid, order, alm = setup_problem()
+    ref = libsharp.synthesis(grid, order, alm)
+    out = np.empty_like(ref)
+    res = libsharp.synthesis(grid, order, alm, out=out)
+    assert res is out
+    assert_allclose(out, ref)
+    libsharp.synthesis(grid, order, alm, out=out, add=True)
+    assert_allclose(out, 2 * ref)
+
+    aref = libsharp.analysis(grid, order, ref)
+    aout = np.ones_like(aref)
+    libsharp.analysis(grid, order, ref, out=aout, add=True)
+    assert_allclose(aout, aref + 1)
+
+    for bad in (out.astype(np.float32), out[:, :, :-1], out[:1]):
+        try:
+            libsharp.synthesis(grid, order, alm, out=bad)
+        except ValueError:
+            pass
+        else:
+            assert False, 'bad out accepted'
+
+
+def test_strided_maps():
+    grid, order, alm = setup_problem(spin=2)
+    ref = libsharp.synthesis(grid, order, alm, spin=2)
+    npix = grid.local_size()
+
+    # every third element of a larger buffer, with reordered leading axes
+    buf = np.full((2, 2, 3 * npix), 7.)
+    out = buf.transpose(1, 0, 2)[:, :, ::3].transpose(1, 0, 2)
+    libsharp.synthesis(grid, order, alm, spin=2, out=out)
+    assert_allclose(buf[:, :, ::3], ref)
+    assert np.all(buf[:, :, 1::3] == 7.) and np.all(buf[:, :, 2::3] == 7.)
+
+    aref = libsharp.analysis(grid, order, ref, spin=2)
+    assert_allclose(libsharp.analysis(grid, order, out, spin=2), aref,
+                    atol=1e-13 * abs(aref).max())
+
+    # reversed pixel order cannot be expressed as a geometry and is copied
+    rev = np.zeros_like(ref)[:, :, ::-1]
+    libsharp.synthesis(grid, order, alm, spin=2, out=rev)
+    assert_allclose(rev, ref)
+
+
+def test_strided_alm():
+    grid, order, alm = setup_problem()
+    ref = libsharp.synthesis(grid, order, alm)
+    buf = np.zeros(alm.shape[:2] + (2 * alm.shape[2],))
+    buf[:, :, ::2] = alm
+    assert_allclose(libsharp.synthesis(grid, order, buf[:, :, ::2]), ref)
+
+    aref = libsharp.analysis(grid, order, ref)
+    buf[...] = 5.
+    libsharp.analysis(grid, order, ref, out=buf[:, :, 1::2])
+    assert_allclose(buf[:, :, 1::2], aref)
+    assert np.all(buf[:, :, ::2] == 5.)
@@ -0,0 +1,102 @@
+from __future__ import print_function
+import numpy as np
+from math import factorial, sqrt
+from fractions import Fraction
+
+from numpy.testing import assert_almost_equal
+from nose.tools import eq_
+
+from libsharp import wigner3j, coupling_matrix
+
+
+def racah_3j(l1, l2, l3, m1, m2, m3):
+    # Racah's closed formula, evaluated in exact rational arithmetic
+    if m1 + m2 + m3 != 0 or l3 < abs(l1 - l2) or l3 > l1 + l2:
+        return 0.
+    if abs(m1) > l1 or abs(m2) > l2 or abs(m3) > l3:
+        return 0.
+    f = factorial
+    pre = Fraction(f(l1 + l2 - l3) * f(l1 - l2 + l3) * f(-l1 + l2 + l3) * f(l1 - m1) * f(l1 + m1) *
+           f(l2 - m2) * f(l2 + m2) * f(l3 - m3) * f(l3 + m3), f(l1 + l2 + l3 + 1))
+    s = 0
+    for k in range(max(0, l2 - l3 - m1, l1 - l3 + m2), min(l1 + l2 - l3, l1 - m1, l2 + m2) + 1):
+        s += Fraction((-1)**k, f(k) * f(l1 + l2 - l3 - k) * f(l1 - m1 - k) * f(l2 + m2 - k) *
+                        f(l3 - l2 + m1 + k) * f(l3 - l1 - m2 + k))
+    return (-1)**(l1 - l2 - m3) * float(s) * sqrt(pre)
+
+
+def test_wigner3j_racah():
+    def test(l2, l3, m2, m3):
+        l1min, w = wigner3j(l2, l3, m2, m3)
+        eq_(l1min, max(abs(l2 - l3), abs(m2 + m3)))
+        eq_(w.shape[0], l2 + l3 - l1min + 1)
+        ref = [racah_3j(l1, l2, l3, -m2 - m3, m2, m3) for l1 in range(l1min, l2 + l3 + 1)]
+        assert_almost_equal(w, ref, decimal=14)
+
+    for args in [(2, 3, -1, 0), (5, 7, 2, -2), (4, 4, 0, 0), (6, 3, 1, 2), (7, 7, 3, -3),
+                 (0, 0, 0, 0), (1, 1, 0, 0), (20, 17, 5, -7), (25, 25, 2, -2), (12, 3, -2, -1)]:
+        yield (test,) + args
+
+
+def test_wigner3j_large():
+    # deep in the classically forbidden region the values are tiny; check
+    # normalization and the orthogonality of two recursions
+    l2, l3 = 3000, 2500
+    l1min, w = wigner3j(l2, l3, -40, 300)
+    l1 = l1min + np.arange(w.shape[0])
+    assert_almost_equal(np.sum((2 * l1 + 1) * w**2), 1, decimal=12)
+    l1min2, w2 = wigner3j(l2, l3, -41, 301)
+    w2 = w2[l1min - l1min2:]
+    assert_almost_equal(np.sum((2 * l1 + 1) * w * w2), 0, decimal=12)
+
+
+def test_wigner3j_invalid():
+    eq_(wigner3j(2, 3, 4, 0)[1].shape[0], 0)
+
+
+def test_coupling_matrix_full_sky():
+    # an unmasked sky has W_0 = 4 pi and no other power
+    lmax = 30
+    wl = np.zeros(10)
+    wl[0] = 4 * np.pi
+    m00, m02, mpp, mmm = coupling_matrix(wl, lmax, pol=True)
+    eye = np.eye(lmax + 1)
+    eye2 = eye.copy()
+    eye2[:2, :2] = 0
+    assert_almost_equal(m00, eye)
+    assert_almost_equal(m02, eye2)
+    assert_almost_equal(mpp, eye2)
+    assert_almost_equal(mmm, 0)
+
+
+def test_coupling_matrix():
+    lmax = 12
+    wl = 1. / (1 + np.arange(20.))**2
+    m00, m02, mpp, mmm = coupling_matrix(wl, lmax, pol=True)
+    for l1, l2 in [(0, 0), (2, 5), (7, 3), (12, 12), (12, 1)]:
+        ref = np.zeros(4)
+        for l3 in range(abs(l1 - l2), min(l1 + l2, wl.shape[0] - 1) + 1):
+            a = racah_3j(l1, l2, l3, 0, 0, 0)
+            b = racah_3j(l1, l2, l3, 2, -2, 0)
+            c = (2 * l2 + 1) * (2 * l3 + 1) * wl[l3] / (4 * np.pi)
+            ref += c * np.array([a * a, a * b, b * b if (l1 + l2 + l3) % 2 == 0 else 0,
+                                 b * b if (l1 + l2 + l3) % 2 == 1 else 0])
+        assert_almost_equal([m00[l1, l2], m02[l1, l2], mpp[l1, l2], mmm[l1, l2]], ref)
+    assert_almost_equal(coupling_matrix(wl, lmax), m00)
+
+
+def test_coupling_matrix_gauss():
+    lmax = 200
+    wl = 1. / (1 + np.arange(301.))**2
+    m00 = coupling_matrix(wl, lmax)
+    m00_gauss = coupling_matrix(wl, lmax, method='gauss')
+    assert_almost_equal(m00_gauss / np.max(np.abs(m00)), m00 / np.max(np.abs(m00)), decimal=12)
+
+
+def test_coupling_matrix_recursion():
+    lmax = 200
+    for wl in (1. / (1 + np.arange(301.))**2, np.random.RandomState(3).uniform(0, 1, 81)):
+        m00 = coupling_matrix(wl, lmax)
+        m00_rec = coupling_matrix(wl, lmax, method='recursion')
+        assert_almost_equal(m00_rec / np.max(np.abs(m00)), m00 / np.max(np.abs(m00)),
+                            decimal=12)